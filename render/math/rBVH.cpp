@@ -0,0 +1,804 @@
+/*!
+ * \file rBVH.cpp
+ * \brief \b Classes: \a rBVH
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rBVH.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+
+namespace e_engine {
+
+namespace {
+
+const uint32_t NO_NODE = UINT32_MAX;
+
+const uint32_t NUM_BINS          = 16;
+const uint32_t MAX_LEAF_SIZE     = 4;  //!< Larger nodes are split whenever possible
+const uint32_t MAX_SAH_LEAF_SIZE = 16; //!< Larger nodes are split even if the SAH says no
+const float    TRAVERSAL_COST    = 1.0f; //!< Relative to testing the box of one object
+
+//! Starting a thread costs more than sorting a few thousand objects
+const uint32_t MIN_OBJECTS_PER_THREAD = 4096;
+
+const uint32_t ALL_PLANES = ( 1 << rFrustum::NUM_PLANES ) - 1;
+const uint32_t OUTSIDE    = UINT32_MAX;
+
+struct BOX {
+   float min[3] = {std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max()};
+   float max[3] = {-std::numeric_limits<float>::max(),
+                   -std::numeric_limits<float>::max(),
+                   -std::numeric_limits<float>::max()};
+
+   void grow( float const *_min, float const *_max ) {
+      for ( uint32_t i = 0; i < 3; ++i ) {
+         min[i] = std::min( min[i], _min[i] );
+         max[i] = std::max( max[i], _max[i] );
+      }
+   }
+
+   void grow( BOX const &_box ) { grow( _box.min, _box.max ); }
+
+   float area() const {
+      float lX = max[0] - min[0];
+      float lY = max[1] - min[1];
+      float lZ = max[2] - min[2];
+
+      if ( lX < 0.0f || lY < 0.0f || lZ < 0.0f )
+         return 0.0f;
+
+      return lX * lY + lY * lZ + lZ * lX;
+   }
+};
+
+//! An object during the build (sorted in place, so all loops run over continuous memory)
+struct PRIMITIVE {
+   BOX      box;
+   float    center[3];
+   uint32_t object;
+};
+
+struct BUILD_NODE {
+   BOX      box;
+   uint32_t children; //!< Index of the first child (inner nodes)
+   uint32_t begin;    //!< First object in the primitive array (leaves)
+   uint32_t count;    //!< Number of objects (0 for inner nodes)
+};
+
+/*!
+ * \brief Binned SAH builder
+ *
+ * Every node sorts its range of the primitive array, so the objects of every subtree stay one
+ * continuous range. Subtrees are built by different threads, the nodes are allocated from one
+ * array with an atomic counter.
+ */
+class Builder {
+ public:
+   std::vector<PRIMITIVE>  vPrims;
+   std::vector<BUILD_NODE> vNodes;
+   std::atomic<uint32_t>   vNumNodes;
+   uint32_t                vMaxParallelDepth;
+
+   Builder( uint32_t _maxParallelDepth ) : vNumNodes( 1 ), vMaxParallelDepth( _maxParallelDepth ) {}
+
+   void buildNode( uint32_t _node, uint32_t _begin, uint32_t _end, uint32_t _depth );
+};
+
+void Builder::buildNode( uint32_t _node, uint32_t _begin, uint32_t _end, uint32_t _depth ) {
+   BUILD_NODE &lNode   = vNodes[_node]; // vNodes is never resized during the build
+   BOX         lCenters;
+   uint32_t    lCount = _end - _begin;
+
+   lNode.box = BOX();
+   for ( uint32_t i = _begin; i < _end; ++i ) {
+      lNode.box.grow( vPrims[i].box );
+      lCenters.grow( vPrims[i].center, vPrims[i].center );
+   }
+
+   lNode.children = NO_NODE;
+   lNode.begin    = _begin;
+   lNode.count    = lCount;
+
+   if ( lCount <= MAX_LEAF_SIZE )
+      return;
+
+   // Bin the objects on all axes at once (axes without extent are skipped later)
+   float    lMin[3], lScale[3];
+   BOX      lBins[3][NUM_BINS];
+   uint32_t lBinCount[3][NUM_BINS] = {};
+
+   for ( uint32_t a = 0; a < 3; ++a ) {
+      float lExtent = lCenters.max[a] - lCenters.min[a];
+      lMin[a]       = lCenters.min[a];
+      lScale[a]     = lExtent > 0.0f ? NUM_BINS / lExtent : 0.0f;
+   }
+
+   auto lBinOf = [&]( PRIMITIVE const &_prim, uint32_t _axis ) {
+      float lPos = ( _prim.center[_axis] - lMin[_axis] ) * lScale[_axis];
+      return std::min( NUM_BINS - 1, static_cast<uint32_t>( lPos ) );
+   };
+
+   for ( uint32_t i = _begin; i < _end; ++i ) {
+      for ( uint32_t a = 0; a < 3; ++a ) {
+         uint32_t lBin = lBinOf( vPrims[i], a );
+         lBins[a][lBin].grow( vPrims[i].box );
+         lBinCount[a][lBin]++;
+      }
+   }
+
+   // Find the best split (bin border) on all axes
+   float    lBestCost = std::numeric_limits<float>::max();
+   uint32_t lBestAxis = 3;
+   uint32_t lBestBin  = 0;
+
+   for ( uint32_t a = 0; a < 3; ++a ) {
+      if ( lScale[a] == 0.0f )
+         continue;
+
+      float    lRightArea[NUM_BINS];
+      uint32_t lRightCount[NUM_BINS];
+      BOX      lAccum;
+      uint32_t lNum = 0;
+
+      for ( uint32_t i = NUM_BINS - 1; i > 0; --i ) {
+         lAccum.grow( lBins[a][i] );
+         lNum += lBinCount[a][i];
+         lRightArea[i]  = lAccum.area();
+         lRightCount[i] = lNum;
+      }
+
+      lAccum = BOX();
+      lNum   = 0;
+
+      for ( uint32_t i = 0; i < NUM_BINS - 1; ++i ) {
+         lAccum.grow( lBins[a][i] );
+         lNum += lBinCount[a][i];
+
+         if ( lNum == 0 || lRightCount[i + 1] == 0 )
+            continue;
+
+         float lCost = lAccum.area() * lNum + lRightArea[i + 1] * lRightCount[i + 1];
+         if ( lCost < lBestCost ) {
+            lBestCost = lCost;
+            lBestAxis = a;
+            lBestBin  = i;
+         }
+      }
+   }
+
+   uint32_t lMid;
+
+   if ( lBestAxis < 3 ) {
+      float lArea = lNode.box.area();
+      if ( TRAVERSAL_COST * lArea + lBestCost >= lArea * lCount && lCount <= MAX_SAH_LEAF_SIZE )
+         return;
+
+      // Same bin computation as above --> both sides are not empty
+      auto lIt = std::partition( vPrims.begin() + _begin,
+                                 vPrims.begin() + _end,
+                                 [&]( PRIMITIVE const &_prim ) {
+                                    return lBinOf( _prim, lBestAxis ) <= lBestBin;
+                                 } );
+
+      lMid = static_cast<uint32_t>( lIt - vPrims.begin() );
+   } else {
+      // All centers are at the same point --> no split is better than another
+      if ( lCount <= MAX_SAH_LEAF_SIZE )
+         return;
+
+      lMid = _begin + lCount / 2;
+   }
+
+   uint32_t lChildren = vNumNodes.fetch_add( 2 );
+   lNode.children     = lChildren;
+   lNode.count        = 0;
+
+   if ( lCount >= MIN_OBJECTS_PER_THREAD && _depth < vMaxParallelDepth ) {
+      std::thread lThread( &Builder::buildNode, this, lChildren, _begin, lMid, _depth + 1 );
+      buildNode( lChildren + 1, lMid, _end, _depth + 1 );
+      lThread.join();
+   } else {
+      buildNode( lChildren, _begin, lMid, _depth + 1 );
+      buildNode( lChildren + 1, lMid, _end, _depth + 1 );
+   }
+}
+
+//! Copies the build nodes in depth first order (children next to each other)
+void flatten( std::vector<BUILD_NODE> const &_in,
+              uint32_t                       _src,
+              uint32_t                       _dst,
+              std::vector<rBVH::NODE> &      _out,
+              std::vector<uint32_t> &        _parents ) {
+   BUILD_NODE const &lSrc = _in[_src];
+
+   std::copy( lSrc.box.min, lSrc.box.min + 3, _out[_dst].min );
+   std::copy( lSrc.box.max, lSrc.box.max + 3, _out[_dst].max );
+
+   if ( lSrc.count > 0 ) {
+      _out[_dst].offset = lSrc.begin;
+      _out[_dst].count  = lSrc.count;
+      return;
+   }
+
+   uint32_t lFirst   = static_cast<uint32_t>( _out.size() );
+   _out[_dst].offset = lFirst;
+   _out[_dst].count  = 0;
+
+   _out.resize( lFirst + 2 );
+   _parents.resize( lFirst + 2, _dst );
+
+   flatten( _in, lSrc.children, lFirst, _out, _parents );
+   flatten( _in, lSrc.children + 1, lFirst + 1, _out, _parents );
+}
+
+/*!
+ * \brief Tests a box against the frustum planes in _mask
+ * \returns OUTSIDE or the planes the box is not completely inside of
+ */
+inline uint32_t classify( rFrustum const &_frustum,
+                          float const *   _min,
+                          float const *   _max,
+                          uint32_t        _mask ) {
+   for ( uint32_t i = 0; i < rFrustum::NUM_PLANES; ++i ) {
+      if ( !( _mask & ( 1 << i ) ) )
+         continue;
+
+      rVec4f const &lP = _frustum.getPlane( static_cast<rFrustum::PLANE>( i ) );
+
+      // Farthest / nearest corner in the direction of the normal
+      float lFar = lP.w, lNear = lP.w;
+      for ( uint32_t j = 0; j < 3; ++j ) {
+         lFar += lP[j] * ( lP[j] >= 0.0f ? _max[j] : _min[j] );
+         lNear += lP[j] * ( lP[j] >= 0.0f ? _min[j] : _max[j] );
+      }
+
+      if ( lFar < 0.0f )
+         return OUTSIDE;
+
+      if ( lNear >= 0.0f )
+         _mask &= ~( 1 << i );
+   }
+
+   return _mask;
+}
+
+inline bool overlaps( float const *_min, float const *_max, rBVH::AABB const &_box ) {
+   return _min[0] <= _box.max.x && _max[0] >= _box.min.x && _min[1] <= _box.max.y &&
+          _max[1] >= _box.min.y && _min[2] <= _box.max.z && _max[2] >= _box.min.z;
+}
+
+inline bool contains( rBVH::AABB const &_box, float const *_min, float const *_max ) {
+   return _min[0] >= _box.min.x && _max[0] <= _box.max.x && _min[1] >= _box.min.y &&
+          _max[1] <= _box.max.y && _min[2] >= _box.min.z && _max[2] <= _box.max.z;
+}
+
+/*!
+ * \brief Slab test
+ * \param[in,out] _dist In: the maximum distance, out: the distance where the ray enters the box
+ */
+inline bool intersect( float const *_min,
+                       float const *_max,
+                       float const *_origin,
+                       float const *_invDir,
+                       float &      _dist ) {
+   float lEnter = 0.0f;
+   float lExit  = _dist;
+
+   for ( uint32_t i = 0; i < 3; ++i ) {
+      float lNear = ( _min[i] - _origin[i] ) * _invDir[i];
+      float lFar  = ( _max[i] - _origin[i] ) * _invDir[i];
+      if ( lNear > lFar )
+         std::swap( lNear, lFar );
+
+      // Written so that NaN (ray in the plane of a slab) keeps the old value
+      lEnter = lNear > lEnter ? lNear : lEnter;
+      lExit  = lFar < lExit ? lFar : lExit;
+   }
+
+   if ( lEnter > lExit )
+      return false;
+
+   _dist = lEnter;
+   return true;
+}
+
+inline float distanceSquared( float const *_min, float const *_max, rVec3f const &_point ) {
+   float lDist = 0.0f;
+   for ( uint32_t i = 0; i < 3; ++i ) {
+      float lD = std::max( std::max( _min[i] - _point[i], _point[i] - _max[i] ), 0.0f );
+      lDist += lD * lD;
+   }
+
+   return lDist;
+}
+}
+
+/*!
+ * \brief Builds the tree
+ *
+ * Objects with an empty box are not added to the tree.
+ *
+ * \param[in] _bounds     The boxes of all objects (the object index is the index in this array)
+ * \param[in] _numThreads The maximum number of threads (0: one per CPU core)
+ */
+void rBVH::build( std::vector<AABB> const &_bounds, unsigned _numThreads ) {
+   clear();
+
+   vBounds = _bounds;
+   vLeafOf.assign( vBounds.size(), NO_NODE );
+
+   for ( uint32_t i = 0; i < vBounds.size(); ++i )
+      if ( !vBounds[i].isEmpty() )
+         vIndices.push_back( i );
+
+   if ( vIndices.empty() )
+      return;
+
+   if ( _numThreads == 0 )
+      _numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+   // Every parallel level doubles the number of threads
+   uint32_t lMaxParallelDepth = 0;
+   while ( ( 1u << lMaxParallelDepth ) < _numThreads )
+      lMaxParallelDepth++;
+
+   Builder lBuilder( lMaxParallelDepth );
+   lBuilder.vPrims.resize( vIndices.size() );
+   lBuilder.vNodes.resize( vIndices.size() * 2 );
+
+   for ( uint32_t i = 0; i < vIndices.size(); ++i ) {
+      PRIMITIVE & lPrim   = lBuilder.vPrims[i];
+      AABB const &lBounds = vBounds[vIndices[i]];
+      lPrim.object        = vIndices[i];
+
+      for ( uint32_t j = 0; j < 3; ++j ) {
+         lPrim.box.min[j] = lBounds.min[j];
+         lPrim.box.max[j] = lBounds.max[j];
+         lPrim.center[j]  = ( lBounds.min[j] + lBounds.max[j] ) * 0.5f;
+      }
+   }
+
+   lBuilder.buildNode( 0, 0, static_cast<uint32_t>( vIndices.size() ), 0 );
+
+   vNodes.reserve( lBuilder.vNumNodes );
+   vParents.reserve( lBuilder.vNumNodes );
+   vNodes.resize( 1 );
+   vParents.resize( 1, NO_NODE );
+   flatten( lBuilder.vNodes, 0, 0, vNodes, vParents );
+
+   for ( uint32_t i = 0; i < vIndices.size(); ++i )
+      vIndices[i] = lBuilder.vPrims[i].object;
+
+   vRefitMarks.assign( vNodes.size(), 0 );
+
+   for ( uint32_t i = 0; i < vNodes.size(); ++i )
+      for ( uint32_t j = 0; j < vNodes[i].count; ++j )
+         vLeafOf[vIndices[vNodes[i].offset + j]] = i;
+}
+
+/*!
+ * \brief Removes all objects
+ */
+void rBVH::clear() {
+   vNodes.clear();
+   vIndices.clear();
+   vParents.clear();
+   vLeafOf.clear();
+   vBounds.clear();
+   vRefitNodes.clear();
+   vRefitMarks.clear();
+   vNumEmptyInTree = 0;
+   vNeedsRebuild   = false;
+}
+
+/*!
+ * \brief Changes the box of an object (the tree is updated in refit())
+ *
+ * Objects that had an empty box in build() are not in the tree. They get the new box, but are
+ * only found after the next build() (see getNeedsRebuild()). Objects in the tree with an empty
+ * box stay in their leaf, but are not returned by the queries.
+ *
+ * \returns false if the object does not exist
+ */
+bool rBVH::setBounds( uint32_t _object, AABB const &_bounds ) {
+   if ( _object >= vBounds.size() ) {
+      eLOG( "Invalid object ", _object );
+      return false;
+   }
+
+   bool lWasEmpty   = vBounds[_object].isEmpty();
+   vBounds[_object] = _bounds;
+
+   uint32_t lLeaf = vLeafOf[_object];
+   if ( lLeaf == NO_NODE ) {
+      vNeedsRebuild = vNeedsRebuild || !_bounds.isEmpty();
+      return true;
+   }
+
+   if ( lWasEmpty && !_bounds.isEmpty() )
+      vNumEmptyInTree--;
+   else if ( !lWasEmpty && _bounds.isEmpty() )
+      vNumEmptyInTree++;
+
+   if ( !vRefitMarks[lLeaf] ) {
+      vRefitMarks[lLeaf] = 1;
+      vRefitNodes.push_back( lLeaf );
+   }
+
+   return true;
+}
+
+/*!
+ * \brief Updates the boxes of all nodes above objects changed with setBounds()
+ *
+ * Only the paths from the changed leaves to the root are touched: O(k * log n) for k changed
+ * objects.
+ */
+void rBVH::refit() {
+   if ( vRefitNodes.empty() )
+      return;
+
+   // Collect all parents (vRefitNodes grows in the loop)
+   for ( size_t i = 0; i < vRefitNodes.size(); ++i ) {
+      uint32_t lParent = vParents[vRefitNodes[i]];
+      if ( lParent != NO_NODE && !vRefitMarks[lParent] ) {
+         vRefitMarks[lParent] = 1;
+         vRefitNodes.push_back( lParent );
+      }
+   }
+
+   // Children always have larger indexes than their parent
+   std::sort( vRefitNodes.begin(), vRefitNodes.end(), std::greater<uint32_t>() );
+
+   for ( uint32_t i : vRefitNodes ) {
+      NODE &lNode = vNodes[i];
+      BOX   lBox;
+
+      if ( lNode.isLeaf() ) {
+         for ( uint32_t j = 0; j < lNode.count; ++j ) {
+            AABB const &lObj = vBounds[vIndices[lNode.offset + j]];
+            if ( !lObj.isEmpty() )
+               lBox.grow( &lObj.min[0], &lObj.max[0] );
+         }
+      } else {
+         lBox.grow( vNodes[lNode.offset].min, vNodes[lNode.offset].max );
+         lBox.grow( vNodes[lNode.offset + 1].min, vNodes[lNode.offset + 1].max );
+      }
+
+      std::copy( lBox.min, lBox.min + 3, lNode.min );
+      std::copy( lBox.max, lBox.max + 3, lNode.max );
+      vRefitMarks[i] = 0;
+   }
+
+   vRefitNodes.clear();
+}
+
+/*!
+ * \brief Adds all objects of a subtree (they are one continuous range in vIndices)
+ *
+ * Objects whose box was set to empty after build() are skipped.
+ */
+void rBVH::getSubtreeObjects( uint32_t _node, std::vector<uint32_t> &_out ) const {
+   uint32_t lFirst = _node;
+   uint32_t lLast  = _node;
+
+   while ( !vNodes[lFirst].isLeaf() )
+      lFirst = vNodes[lFirst].offset;
+
+   while ( !vNodes[lLast].isLeaf() )
+      lLast = vNodes[lLast].offset + 1;
+
+   auto lBegin = vIndices.begin() + vNodes[lFirst].offset;
+   auto lEnd   = vIndices.begin() + vNodes[lLast].offset + vNodes[lLast].count;
+
+   if ( vNumEmptyInTree == 0 ) {
+      _out.insert( _out.end(), lBegin, lEnd );
+      return;
+   }
+
+   for ( auto i = lBegin; i != lEnd; ++i )
+      if ( !vBounds[*i].isEmpty() )
+         _out.push_back( *i );
+}
+
+/*!
+ * \brief Finds all objects whose box is (partially) inside the frustum
+ *
+ * Subtrees completely inside of a plane are not tested against this plane again, subtrees
+ * completely inside of the frustum are added without further tests.
+ *
+ * \param[out] _out The objects are appended (unordered)
+ */
+void rBVH::queryFrustum( rFrustum const &_frustum, std::vector<uint32_t> &_out ) const {
+   if ( vNodes.empty() )
+      return;
+
+   std::vector<std::pair<uint32_t, uint32_t>> lStack; // Node, planes to test
+   lStack.emplace_back( 0, ALL_PLANES );
+
+   while ( !lStack.empty() ) {
+      uint32_t    lIndex = lStack.back().first;
+      uint32_t    lMask  = lStack.back().second;
+      NODE const &lNode  = vNodes[lIndex];
+      lStack.pop_back();
+
+      lMask = classify( _frustum, lNode.min, lNode.max, lMask );
+      if ( lMask == OUTSIDE )
+         continue;
+
+      if ( lMask == 0 ) {
+         getSubtreeObjects( lIndex, _out );
+         continue;
+      }
+
+      if ( lNode.isLeaf() ) {
+         for ( uint32_t i = 0; i < lNode.count; ++i ) {
+            uint32_t    lObj = vIndices[lNode.offset + i];
+            AABB const &lBox = vBounds[lObj];
+            if ( lBox.isEmpty() )
+               continue;
+
+            if ( classify( _frustum, &lBox.min[0], &lBox.max[0], lMask ) != OUTSIDE )
+               _out.push_back( lObj );
+         }
+
+         continue;
+      }
+
+      lStack.emplace_back( lNode.offset + 1, lMask );
+      lStack.emplace_back( lNode.offset, lMask );
+   }
+}
+
+/*!
+ * \brief Finds all objects whose box overlaps _box
+ * \param[out] _out The objects are appended (unordered)
+ */
+void rBVH::queryAABB( AABB const &_box, std::vector<uint32_t> &_out ) const {
+   if ( vNodes.empty() )
+      return;
+
+   std::vector<uint32_t> lStack = {0};
+
+   while ( !lStack.empty() ) {
+      uint32_t    lIndex = lStack.back();
+      NODE const &lNode  = vNodes[lIndex];
+      lStack.pop_back();
+
+      if ( !overlaps( lNode.min, lNode.max, _box ) )
+         continue;
+
+      if ( contains( _box, lNode.min, lNode.max ) ) {
+         getSubtreeObjects( lIndex, _out );
+         continue;
+      }
+
+      if ( lNode.isLeaf() ) {
+         for ( uint32_t i = 0; i < lNode.count; ++i ) {
+            uint32_t    lObj = vIndices[lNode.offset + i];
+            AABB const &lBox = vBounds[lObj];
+            if ( !lBox.isEmpty() && overlaps( &lBox.min[0], &lBox.max[0], _box ) )
+               _out.push_back( lObj );
+         }
+
+         continue;
+      }
+
+      lStack.push_back( lNode.offset + 1 );
+      lStack.push_back( lNode.offset );
+   }
+}
+
+/*!
+ * \brief Finds all objects whose box is hit by the ray
+ * \param[in]  _direction Does not need to be normalized (_maxDist is in multiples of it)
+ * \param[out] _out       The objects are appended (unordered)
+ */
+void rBVH::queryRay( rVec3f const &         _origin,
+                     rVec3f const &         _direction,
+                     float                  _maxDist,
+                     std::vector<uint32_t> &_out ) const {
+   if ( vNodes.empty() )
+      return;
+
+   float lOrigin[3] = {_origin.x, _origin.y, _origin.z};
+   float lInvDir[3] = {1.0f / _direction.x, 1.0f / _direction.y, 1.0f / _direction.z};
+
+   std::vector<uint32_t> lStack = {0};
+
+   while ( !lStack.empty() ) {
+      NODE const &lNode = vNodes[lStack.back()];
+      float       lDist = _maxDist;
+      lStack.pop_back();
+
+      if ( !intersect( lNode.min, lNode.max, lOrigin, lInvDir, lDist ) )
+         continue;
+
+      if ( lNode.isLeaf() ) {
+         for ( uint32_t i = 0; i < lNode.count; ++i ) {
+            uint32_t    lObj = vIndices[lNode.offset + i];
+            AABB const &lBox = vBounds[lObj];
+            lDist            = _maxDist;
+            if ( lBox.isEmpty() )
+               continue;
+
+            if ( intersect( &lBox.min[0], &lBox.max[0], lOrigin, lInvDir, lDist ) )
+               _out.push_back( lObj );
+         }
+
+         continue;
+      }
+
+      lStack.push_back( lNode.offset + 1 );
+      lStack.push_back( lNode.offset );
+   }
+}
+
+/*!
+ * \brief Finds the object whose box is hit first by the ray
+ *
+ * The children are visited front to back and subtrees behind the current hit are skipped. If the
+ * origin is inside of several boxes, any of them is returned (distance 0).
+ *
+ * \param[in]     _direction Does not need to be normalized (_dist is in multiples of it)
+ * \param[in,out] _dist      In: the maximum distance, out: the distance to the hit box
+ * \returns the object or INVALID_OBJECT
+ */
+uint32_t rBVH::raycast( rVec3f const &_origin, rVec3f const &_direction, float &_dist ) const {
+   if ( vNodes.empty() )
+      return INVALID_OBJECT;
+
+   float    lOrigin[3] = {_origin.x, _origin.y, _origin.z};
+   float    lInvDir[3] = {1.0f / _direction.x, 1.0f / _direction.y, 1.0f / _direction.z};
+   uint32_t lBest      = INVALID_OBJECT;
+   float    lBestDist  = _dist;
+
+   std::vector<std::pair<uint32_t, float>> lStack; // Node, entry distance
+   float                                   lRootDist = lBestDist;
+   if ( !intersect( vNodes[0].min, vNodes[0].max, lOrigin, lInvDir, lRootDist ) )
+      return INVALID_OBJECT;
+
+   lStack.emplace_back( 0, lRootDist );
+
+   while ( !lStack.empty() ) {
+      NODE const &lNode  = vNodes[lStack.back().first];
+      float       lEntry = lStack.back().second;
+      lStack.pop_back();
+
+      if ( lEntry > lBestDist )
+         continue;
+
+      if ( lNode.isLeaf() ) {
+         for ( uint32_t i = 0; i < lNode.count; ++i ) {
+            uint32_t    lObj  = vIndices[lNode.offset + i];
+            AABB const &lBox  = vBounds[lObj];
+            float       lDist = lBestDist;
+            if ( lBox.isEmpty() )
+               continue;
+
+            if ( !intersect( &lBox.min[0], &lBox.max[0], lOrigin, lInvDir, lDist ) )
+               continue;
+
+            if ( lBest == INVALID_OBJECT || lDist < lBestDist ) {
+               lBest     = lObj;
+               lBestDist = lDist;
+            }
+         }
+
+         continue;
+      }
+
+      NODE const &lA     = vNodes[lNode.offset];
+      NODE const &lB     = vNodes[lNode.offset + 1];
+      float       lDistA = lBestDist;
+      float       lDistB = lBestDist;
+      bool        lHitA  = intersect( lA.min, lA.max, lOrigin, lInvDir, lDistA );
+      bool        lHitB  = intersect( lB.min, lB.max, lOrigin, lInvDir, lDistB );
+
+      // The nearer child is pushed last --> visited first
+      if ( lHitA && lHitB && lDistA < lDistB ) {
+         lStack.emplace_back( lNode.offset + 1, lDistB );
+         lStack.emplace_back( lNode.offset, lDistA );
+         continue;
+      }
+
+      if ( lHitA )
+         lStack.emplace_back( lNode.offset, lDistA );
+
+      if ( lHitB )
+         lStack.emplace_back( lNode.offset + 1, lDistB );
+   }
+
+   if ( lBest != INVALID_OBJECT )
+      _dist = lBestDist;
+
+   return lBest;
+}
+
+/*!
+ * \brief Finds the _k objects with the nearest boxes (distance 0 if the point is inside)
+ *
+ * The nodes are visited ordered by their distance, until no node can contain a nearer object.
+ *
+ * \param[out] _out The objects are appended (nearest first)
+ */
+void rBVH::queryNearest( rVec3f const &_point, uint32_t _k, std::vector<uint32_t> &_out ) const {
+   if ( vNodes.empty() || _k == 0 )
+      return;
+
+   typedef std::pair<float, uint32_t> ENTRY; // Squared distance, node / object
+
+   std::priority_queue<ENTRY, std::vector<ENTRY>, std::greater<ENTRY>> lNodes; // Nearest on top
+   std::priority_queue<ENTRY> lBest;                                           // Farthest on top
+
+   lNodes.emplace( distanceSquared( vNodes[0].min, vNodes[0].max, _point ), 0 );
+
+   while ( !lNodes.empty() ) {
+      ENTRY lEntry = lNodes.top();
+      lNodes.pop();
+
+      if ( lBest.size() == _k && lEntry.first >= lBest.top().first )
+         break;
+
+      NODE const &lNode = vNodes[lEntry.second];
+
+      if ( !lNode.isLeaf() ) {
+         for ( uint32_t i = 0; i < 2; ++i ) {
+            NODE const &lChild = vNodes[lNode.offset + i];
+            float       lDist  = distanceSquared( lChild.min, lChild.max, _point );
+            if ( lBest.size() < _k || lDist < lBest.top().first )
+               lNodes.emplace( lDist, lNode.offset + i );
+         }
+
+         continue;
+      }
+
+      for ( uint32_t i = 0; i < lNode.count; ++i ) {
+         uint32_t    lObj = vIndices[lNode.offset + i];
+         AABB const &lBox = vBounds[lObj];
+         if ( lBox.isEmpty() )
+            continue;
+
+         float lDist = distanceSquared( &lBox.min[0], &lBox.max[0], _point );
+         if ( lBest.size() < _k ) {
+            lBest.emplace( lDist, lObj );
+         } else if ( lDist < lBest.top().first ) {
+            lBest.pop();
+            lBest.emplace( lDist, lObj );
+         }
+      }
+   }
+
+   size_t lOldSize = _out.size();
+   _out.resize( lOldSize + lBest.size() );
+
+   for ( size_t i = _out.size(); i > lOldSize; --i ) {
+      _out[i - 1] = lBest.top().second;
+      lBest.pop();
+   }
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
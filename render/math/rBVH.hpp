@@ -0,0 +1,121 @@
+/*!
+ * \file rBVH.hpp
+ * \brief \b Classes: \a rBVH
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rFrustum.hpp"
+#include <limits>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::rBVH
+ * \brief Bounding volume hierarchy over the axis aligned bounding boxes of objects
+ *
+ * Objects are referenced by their index in the array passed to build(). Objects with an empty box
+ * are not part of the tree.
+ *
+ * The tree is built top down with the surface area heuristic (binned). Large subtrees are built
+ * in parallel. The finished tree is stored as a flat array of 32 byte nodes in depth first
+ * order, where the two children of a node are always next to each other.
+ *
+ * When objects move, setBounds() and refit() only update the boxes on the paths from the changed
+ * leaves to the root. The tree structure stays the same, so the query performance drops when
+ * many objects moved far away. Call build() again in this case.
+ *
+ * \code
+ * rBVH lBVH;
+ * lBVH.build( lBounds );
+ * lBVH.setBounds( lMovedObject, lNewBox );
+ * lBVH.refit();
+ * lBVH.queryFrustum( lFrustum, lVisible );
+ * \endcode
+ *
+ * \note Queries are thread safe, but not concurrent to build(), setBounds() or refit()
+ */
+class RENDER_API rBVH final {
+ public:
+   static const uint32_t INVALID_OBJECT = UINT32_MAX;
+
+   //! Axis aligned bounding box (empty if min > max)
+   struct AABB {
+      rVec3f min = rVec3f( std::numeric_limits<float>::max() );
+      rVec3f max = rVec3f( -std::numeric_limits<float>::max() );
+
+      bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+   };
+
+   //! A node of the flattened tree (2 nodes per cache line)
+   struct NODE {
+      float    min[3];
+      uint32_t offset; //!< Inner node: index of the first child, leaf: first object in vIndices
+      float    max[3];
+      uint32_t count; //!< Number of objects of the leaf (0 for inner nodes)
+
+      bool isLeaf() const { return count > 0; }
+   };
+
+ private:
+   std::vector<NODE>     vNodes;
+   std::vector<uint32_t> vIndices; //!< Object indexes, sorted by leaf
+   std::vector<uint32_t> vParents; //!< Parent node of every node (the root has none)
+   std::vector<uint32_t> vLeafOf;  //!< Object --> leaf node (UINT32_MAX: not in the tree)
+   std::vector<AABB>     vBounds;  //!< The boxes of all objects
+
+   std::vector<uint32_t> vRefitNodes; //!< Changed leaves since the last refit()
+   std::vector<uint8_t>  vRefitMarks; //!< Nodes already in vRefitNodes
+
+   uint32_t vNumEmptyInTree = 0; //!< Objects in the tree whose box was set to empty
+   bool     vNeedsRebuild   = false;
+
+   void getSubtreeObjects( uint32_t _node, std::vector<uint32_t> &_out ) const;
+
+ public:
+   void build( std::vector<AABB> const &_bounds, unsigned _numThreads = 0 );
+   void clear();
+
+   bool setBounds( uint32_t _object, AABB const &_bounds );
+   void refit();
+
+   void queryFrustum( rFrustum const &_frustum, std::vector<uint32_t> &_out ) const;
+   void queryAABB( AABB const &_box, std::vector<uint32_t> &_out ) const;
+   void queryRay( rVec3f const &         _origin,
+                  rVec3f const &         _direction,
+                  float                  _maxDist,
+                  std::vector<uint32_t> &_out ) const;
+   void queryNearest( rVec3f const &_point, uint32_t _k, std::vector<uint32_t> &_out ) const;
+
+   uint32_t raycast( rVec3f const &_origin, rVec3f const &_direction, float &_dist ) const;
+
+   //! True if an object without a box got one (it is only added by build())
+   bool getNeedsRebuild() const { return vNeedsRebuild; }
+
+   size_t getNumObjects() const { return vBounds.size(); }
+   AABB const &getBounds( uint32_t _object ) const { return vBounds[_object]; }
+
+   std::vector<NODE> const &getNodes() const { return vNodes; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,306 @@
+/*!
+ * \file rFrustum.cpp
+ * \brief \b Classes: \a rFrustum, \a rBoundingVolume
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rFrustum.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && !COMPILER_MSC
+#define R_FRUSTUM_AVX2 1
+#include <immintrin.h>
+#else
+#define R_FRUSTUM_AVX2 0
+#endif
+
+namespace e_engine {
+
+namespace {
+
+/*
+ * Both kernels compute the signed distance as ( ( a * x + b * y ) + c * z ) + d and test it with
+ * distance >= -radius, so the AVX2 kernel returns exactly the same objects as the scalar one.
+ */
+size_t cullScalar( rVec4f const *          _planes,
+                   rFrustum::SPHERES const &_in,
+                   size_t                   _begin,
+                   size_t                   _end,
+                   uint32_t *               _visible,
+                   size_t                   _count ) {
+   for ( size_t i = _begin; i < _end; ++i ) {
+      float lX       = _in.x[i];
+      float lY       = _in.y[i];
+      float lZ       = _in.z[i];
+      float lNegR    = -_in.radius[i];
+      bool  lVisible = true;
+
+      for ( uint32_t p = 0; p < rFrustum::NUM_PLANES && lVisible; ++p ) {
+         rVec4f const &lP = _planes[p];
+         lVisible         = lP.x * lX + lP.y * lY + lP.z * lZ + lP.w >= lNegR;
+      }
+
+      if ( lVisible )
+         _visible[_count++] = static_cast<uint32_t>( i );
+   }
+
+   return _count;
+}
+
+#if R_FRUSTUM_AVX2
+//! Tests blocks of 8 spheres, returns the index of the first sphere that was not tested
+__attribute__( ( target( "avx2" ) ) ) size_t cullAVX2( rVec4f const *          _planes,
+                                                       rFrustum::SPHERES const &_in,
+                                                       size_t                   _num,
+                                                       uint32_t *               _visible,
+                                                       size_t &                 _count ) {
+   __m256 lA[rFrustum::NUM_PLANES], lB[rFrustum::NUM_PLANES];
+   __m256 lC[rFrustum::NUM_PLANES], lD[rFrustum::NUM_PLANES];
+
+   for ( uint32_t p = 0; p < rFrustum::NUM_PLANES; ++p ) {
+      lA[p] = _mm256_set1_ps( _planes[p].x );
+      lB[p] = _mm256_set1_ps( _planes[p].y );
+      lC[p] = _mm256_set1_ps( _planes[p].z );
+      lD[p] = _mm256_set1_ps( _planes[p].w );
+   }
+
+   __m256 lSign = _mm256_set1_ps( -0.0f );
+
+   size_t i = 0;
+   for ( ; i + 8 <= _num; i += 8 ) {
+      __m256 lX    = _mm256_loadu_ps( _in.x + i );
+      __m256 lY    = _mm256_loadu_ps( _in.y + i );
+      __m256 lZ    = _mm256_loadu_ps( _in.z + i );
+      __m256 lNegR = _mm256_xor_ps( _mm256_loadu_ps( _in.radius + i ), lSign );
+      __m256 lIn   = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+
+      for ( uint32_t p = 0; p < rFrustum::NUM_PLANES; ++p ) {
+         __m256 lDist = _mm256_add_ps( _mm256_mul_ps( lA[p], lX ), _mm256_mul_ps( lB[p], lY ) );
+         lDist        = _mm256_add_ps( lDist, _mm256_mul_ps( lC[p], lZ ) );
+         lDist        = _mm256_add_ps( lDist, lD[p] );
+         lIn          = _mm256_and_ps( lIn, _mm256_cmp_ps( lDist, lNegR, _CMP_GE_OQ ) );
+      }
+
+      for ( int lMask = _mm256_movemask_ps( lIn ); lMask != 0; lMask &= lMask - 1 )
+         _visible[_count++] = static_cast<uint32_t>( i + __builtin_ctz( lMask ) );
+   }
+
+   return i;
+}
+
+bool hasAVX2() {
+   static const bool lAVX2 = __builtin_cpu_supports( "avx2" );
+   return lAVX2;
+}
+#endif
+}
+
+/*!
+ * \brief Transforms the bounding sphere into world space
+ *
+ * The radius is scaled by the largest scale factor of the model matrix, so the sphere stays
+ * conservative for non uniform scaling.
+ *
+ * \param[in]  _model  The model matrix
+ * \param[out] _sphere The sphere ( center x, y, z, radius )
+ */
+void rBoundingVolume::getWorldSphere( rMat4f const &_model, rVec4f &_sphere ) const {
+   float const *lM = &_model[0];
+
+   float lScale = 0.0f;
+   for ( uint32_t c = 0; c < 3; ++c ) {
+      float const *lCol = lM + c * 4;
+      lScale = std::max( lScale, lCol[0] * lCol[0] + lCol[1] * lCol[1] + lCol[2] * lCol[2] );
+   }
+
+   _sphere.x = lM[0] * center.x + lM[4] * center.y + lM[8] * center.z + lM[12];
+   _sphere.y = lM[1] * center.x + lM[5] * center.y + lM[9] * center.z + lM[13];
+   _sphere.z = lM[2] * center.x + lM[6] * center.y + lM[10] * center.z + lM[14];
+   _sphere.w = radius * std::sqrt( lScale );
+}
+
+/*!
+ * \brief Transforms the bounding box into world space
+ *
+ * The result is the axis aligned box around the transformed box (Arvo's method), so it may be
+ * larger than the box of the transformed vertices.
+ *
+ * \param[in]  _model The model matrix
+ * \param[out] _min   The minimum of the world space box
+ * \param[out] _max   The maximum of the world space box
+ */
+void rBoundingVolume::getWorldAABB( rMat4f const &_model, rVec3f &_min, rVec3f &_max ) const {
+   for ( uint32_t r = 0; r < 3; ++r ) {
+      _min[r] = _model.get( 3, r );
+      _max[r] = _model.get( 3, r );
+
+      for ( uint32_t c = 0; c < 3; ++c ) {
+         float lA = _model.get( c, r ) * min[c];
+         float lB = _model.get( c, r ) * max[c];
+         _min[r] += std::min( lA, lB );
+         _max[r] += std::max( lA, lB );
+      }
+   }
+}
+
+/*!
+ * \brief Computes the bounding volume of points
+ * \param[in] _data   The first coordinate (x) of the first point
+ * \param[in] _num    The number of points
+ * \param[in] _stride The number of floats from one point to the next (for interleaved vertices)
+ * \returns an invalid volume if _num is 0
+ */
+rBoundingVolume rBoundingVolume::fromPoints( float const *_data, size_t _num, size_t _stride ) {
+   rBoundingVolume lOut;
+   if ( _num == 0 )
+      return lOut;
+
+   lOut.min.set( _data );
+   lOut.max.set( _data );
+
+   for ( size_t i = 1; i < _num; ++i ) {
+      float const *lP = _data + i * _stride;
+      for ( uint32_t j = 0; j < 3; ++j ) {
+         lOut.min[j] = std::min( lOut.min[j], lP[j] );
+         lOut.max[j] = std::max( lOut.max[j], lP[j] );
+      }
+   }
+
+   for ( uint32_t j = 0; j < 3; ++j )
+      lOut.center[j] = ( lOut.min[j] + lOut.max[j] ) * 0.5f;
+
+   float lMaxDist = 0.0f;
+   for ( size_t i = 0; i < _num; ++i ) {
+      float const *lP = _data + i * _stride;
+      float        lX = lP[0] - lOut.center.x;
+      float        lY = lP[1] - lOut.center.y;
+      float        lZ = lP[2] - lOut.center.z;
+      lMaxDist        = std::max( lMaxDist, lX * lX + lY * lY + lZ * lZ );
+   }
+
+   lOut.radius = std::sqrt( lMaxDist );
+   return lOut;
+}
+
+
+/*!
+ * \brief Creates a frustum that contains everything
+ */
+rFrustum::rFrustum() {
+   for ( auto &i : vPlanes )
+      i = rVec4f( 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+/*!
+ * \brief Extracts the planes from a view projection matrix (Vulkan clip space)
+ */
+void rFrustum::setMatrix( rMat4f const &_viewProjection ) {
+   // Rows of the matrix (clip = M * v --> row r of M is the clip coordinate r)
+   rVec4f lRow[4];
+   for ( uint32_t r = 0; r < 4; ++r )
+      lRow[r].setMat( _viewProjection.get( 0, r ),
+                      _viewProjection.get( 1, r ),
+                      _viewProjection.get( 2, r ),
+                      _viewProjection.get( 3, r ) );
+
+   for ( uint32_t j = 0; j < 4; ++j ) {
+      vPlanes[LEFT_PLANE][j]   = lRow[3][j] + lRow[0][j];
+      vPlanes[RIGHT_PLANE][j]  = lRow[3][j] - lRow[0][j];
+      vPlanes[BOTTOM_PLANE][j] = lRow[3][j] + lRow[1][j];
+      vPlanes[TOP_PLANE][j]    = lRow[3][j] - lRow[1][j];
+      vPlanes[NEAR_PLANE][j]   = lRow[2][j];
+      vPlanes[FAR_PLANE][j]    = lRow[3][j] - lRow[2][j];
+   }
+
+   for ( auto &i : vPlanes ) {
+      float lLength = std::sqrt( i.x * i.x + i.y * i.y + i.z * i.z );
+      if ( lLength > 0.0f )
+         i *= 1.0f / lLength;
+   }
+}
+
+/*!
+ * \brief Tests a sphere against the frustum
+ * \returns false if the sphere is completely outside of one plane
+ */
+bool rFrustum::isVisible( rVec3f const &_center, float _radius ) const {
+   for ( auto const &i : vPlanes )
+      if ( i.x * _center.x + i.y * _center.y + i.z * _center.z + i.w < -_radius )
+         return false;
+
+   return true;
+}
+
+/*!
+ * \brief Tests an axis aligned bounding box against the frustum
+ *
+ * Only the corner of the box that is farthest in the direction of the plane normal is tested.
+ * Boxes near a frustum corner may be reported as visible although they are not (conservative).
+ *
+ * \returns false if the box is completely outside of one plane
+ */
+bool rFrustum::isVisible( rVec3f const &_min, rVec3f const &_max ) const {
+   for ( auto const &i : vPlanes ) {
+      float lX = i.x >= 0.0f ? _max.x : _min.x;
+      float lY = i.y >= 0.0f ? _max.y : _min.y;
+      float lZ = i.z >= 0.0f ? _max.z : _min.z;
+
+      if ( i.x * lX + i.y * lY + i.z * lZ + i.w < 0.0f )
+         return false;
+   }
+
+   return true;
+}
+
+/*!
+ * \brief Tests spheres [0, _num) against the frustum
+ *
+ * Spheres with an infinite radius are always visible.
+ *
+ * \param[in]  _in      The bounding spheres in world space
+ * \param[in]  _num     The number of spheres
+ * \param[out] _visible The indexes of the visible spheres (ascending, at least _num elements)
+ * \returns the number of visible spheres
+ */
+size_t rFrustum::cull( SPHERES const &_in, size_t _num, uint32_t *_visible ) const {
+   size_t lCount = 0;
+   size_t lBegin = 0;
+
+#if R_FRUSTUM_AVX2
+   if ( hasAVX2() )
+      lBegin = cullAVX2( vPlanes, _in, _num, _visible, lCount );
+#endif
+
+   return cullScalar( vPlanes, _in, lBegin, _num, _visible, lCount );
+}
+
+/*!
+ * \brief Returns the name of the kernel used on this CPU
+ */
+const char *rFrustum::getKernelName() {
+#if R_FRUSTUM_AVX2
+   if ( hasAVX2() )
+      return "AVX2 x8";
+#endif
+
+   return "scalar";
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
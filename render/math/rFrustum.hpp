@@ -0,0 +1,107 @@
+/*!
+ * \file rFrustum.hpp
+ * \brief \b Classes: \a rFrustum, \a rBoundingVolume
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rMatrixMath.hpp"
+
+namespace e_engine {
+
+/*!
+ * \brief Axis aligned bounding box and bounding sphere of a mesh (in object space)
+ *
+ * The sphere is centered in the box, its radius is the distance to the farthest vertex (which is
+ * never larger than half the diagonal of the box).
+ */
+struct RENDER_API rBoundingVolume {
+   rVec3f min    = rVec3f( 0.0f );
+   rVec3f max    = rVec3f( 0.0f );
+   rVec3f center = rVec3f( 0.0f ); //!< Center of the bounding sphere
+   float  radius = -1.0f;          //!< Radius of the bounding sphere (< 0: no vertices)
+
+   bool isValid() const { return radius >= 0.0f; }
+
+   void getWorldSphere( rMat4f const &_model, rVec4f &_sphere ) const;
+   void getWorldAABB( rMat4f const &_model, rVec3f &_min, rVec3f &_max ) const;
+
+   static rBoundingVolume fromPoints( float const *_data, size_t _num, size_t _stride = 3 );
+};
+
+/*!
+ * \class e_engine::rFrustum
+ * \brief The 6 clipping planes of a view projection matrix
+ *
+ * The planes are extracted from the (Vulkan) clip space: -w <= x <= w, -w <= y <= w and
+ * 0 <= z <= w. All plane normals point inside and are normalized, so the plane equation is the
+ * signed distance to the plane.
+ *
+ * cull() tests many bounding spheres (structure of arrays) at once. With AVX2 8 spheres are tested
+ * per iteration, otherwise one after another with the same operations, so both give the same
+ * results. The class does not depend on Vulkan and can be used on the CPU alone.
+ *
+ * \code
+ * rFrustum lFrustum( *lScene->getViewProjectionMatrix() );
+ * size_t   lNumVisible = lFrustum.cull( lSpheres, lNum, lVisible.data() );
+ * \endcode
+ */
+class RENDER_API rFrustum final {
+ public:
+   enum PLANE {
+      LEFT_PLANE = 0,
+      RIGHT_PLANE,
+      BOTTOM_PLANE,
+      TOP_PLANE,
+      NEAR_PLANE,
+      FAR_PLANE,
+      NUM_PLANES
+   };
+
+   //! Bounding spheres in world space (all arrays with at least _num elements)
+   struct SPHERES {
+      float const *x      = nullptr;
+      float const *y      = nullptr;
+      float const *z      = nullptr;
+      float const *radius = nullptr;
+   };
+
+ private:
+   rVec4f vPlanes[NUM_PLANES]; //!< ( a, b, c, d ): a * x + b * y + c * z + d >= 0 is inside
+
+ public:
+   rFrustum();
+   rFrustum( rMat4f const &_viewProjection ) { setMatrix( _viewProjection ); }
+
+   void setMatrix( rMat4f const &_viewProjection );
+
+   rVec4f const &getPlane( PLANE _plane ) const { return vPlanes[_plane]; }
+
+   bool isVisible( rVec3f const &_center, float _radius ) const;
+   bool isVisible( rVec3f const &_min, rVec3f const &_max ) const;
+
+   size_t cull( SPHERES const &_in, size_t _num, uint32_t *_visible ) const;
+
+   static const char *getKernelName();
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
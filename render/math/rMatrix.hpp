@@ -21,6 +21,8 @@
 
 #include "defines.hpp"
 
+#include "rMatrixExpression.hpp"
+#include "rMatrixSIMD.hpp"
 #include <stdint.h>
 #include <string>
 #include <type_traits>
@@ -31,13 +33,36 @@ namespace e_engine {
 
 namespace internal {
 
+/*!
+ * \brief Tag for the constexpr constructors of rMatrixData
+ *
+ * A constexpr constructor has to initialize all members (and exactly one member of a union), so
+ * the constexpr constructors of rMatrix zero the data (vDataMat) first. The default constructor
+ * still leaves the data uninitialized.
+ */
+struct rMatrixZero {};
+
 template <class T, uint32_t R, uint32_t S>
 struct rMatrixData {
    T vDataMat[R * S];
+
+   rMatrixData() = default;
+   constexpr rMatrixData( rMatrixZero ) : vDataMat{} {}
+};
+
+//! 4x4 matrices are aligned to one column for the SIMD kernels (see rMatrixKernels)
+template <class T>
+struct rMatrixData<T, 4, 4> {
+   alignas( 4 * sizeof( T ) ) T vDataMat[16];
+
+   rMatrixData() = default;
+   constexpr rMatrixData( rMatrixZero ) : vDataMat{} {}
 };
 
 template <class T>
 struct rMatrixData<T, 2, 1> {
+   // x, y, ... and vDataMat share the memory. Constant expressions may only use vDataMat (the
+   // initialized member of the union)
    union {
       struct {
          T x, y;
@@ -46,6 +71,9 @@ struct rMatrixData<T, 2, 1> {
       T vDataMat[2];
    };
 
+   rMatrixData() = default;
+   constexpr rMatrixData( rMatrixZero ) : vDataMat{} {}
+
    void normalize() {
       T lLength2 = x * x + y * y;
 
@@ -64,6 +92,8 @@ struct rMatrixData<T, 2, 1> {
 
 template <class T>
 struct rMatrixData<T, 3, 1> {
+   // x, y, ... and vDataMat share the memory. Constant expressions may only use vDataMat (the
+   // initialized member of the union)
    union {
       struct {
          T x, y, z;
@@ -72,6 +102,9 @@ struct rMatrixData<T, 3, 1> {
       T vDataMat[3];
    };
 
+   rMatrixData() = default;
+   constexpr rMatrixData( rMatrixZero ) : vDataMat{} {}
+
    void normalize() {
       T lLength2 = x * x + y * y + z * z;
 
@@ -91,6 +124,8 @@ struct rMatrixData<T, 3, 1> {
 
 template <class T>
 struct rMatrixData<T, 4, 1> {
+   // x, y, ... and vDataMat share the memory. Constant expressions may only use vDataMat (the
+   // initialized member of the union)
    union {
       struct {
          T x, y, z, w;
@@ -99,6 +134,9 @@ struct rMatrixData<T, 4, 1> {
       T vDataMat[4];
    };
 
+   rMatrixData() = default;
+   constexpr rMatrixData( rMatrixZero ) : vDataMat{} {}
+
    void normalize() {
       T lLength2 = x * x + y * y + z * z + w * w;
 
@@ -123,15 +161,17 @@ class rMatrix : public internal::rMatrixData<TYPE, ROWS, COLLUMNS> {
    static_assert( ( ROWS * COLLUMNS ) >= 2, "Matrix size (ROWS*COLLUMNS) must be at least 2" );
 
  private:
+   typedef internal::rMatrixData<TYPE, ROWS, COLLUMNS> DATA;
+
    template <uint32_t POS, class... ARGS>
-   inline void setHelper( TYPE &&_arg, ARGS &&... _args );
+   constexpr void setHelper( TYPE &&_arg, ARGS &&... _args );
    template <uint32_t POS>
-   inline void setHelper( TYPE &&_arg );
+   constexpr void setHelper( TYPE &&_arg );
 
    template <uint32_t POS, class... ARGS>
-   inline void setHelper( const TYPE &_arg, ARGS &&... _args );
+   constexpr void setHelper( const TYPE &_arg, ARGS &&... _args );
    template <uint32_t POS>
-   inline void setHelper( const TYPE &_arg );
+   constexpr void setHelper( const TYPE &_arg );
 
 
    inline void TYPE2String( uint32_t &&_pos, std::string &_str );
@@ -141,103 +181,99 @@ class rMatrix : public internal::rMatrixData<TYPE, ROWS, COLLUMNS> {
    using internal::rMatrixData<TYPE, ROWS, COLLUMNS>::vDataMat;
 
    rMatrix() {}
-   rMatrix( TYPE &_f ) { fill( std::forward<TYPE>( _f ) ); }
-   rMatrix( TYPE &&_f ) { fill( _f ); }
-   rMatrix( TYPE *_f );
-   rMatrix( const rMatrix<TYPE, ROWS, COLLUMNS> &_newMatrix );
+   constexpr rMatrix( TYPE &_f ) : DATA( internal::rMatrixZero() ) {
+      fill( std::forward<TYPE>( _f ) );
+   }
+   constexpr rMatrix( TYPE &&_f ) : DATA( internal::rMatrixZero() ) { fill( _f ); }
+   constexpr rMatrix( TYPE const *_f );
+   rMatrix( const rMatrix<TYPE, ROWS, COLLUMNS> &_newMatrix ) = default;
 
-   template <class... ARGS>
-   rMatrix( TYPE &&_a1, ARGS &&... _args );
+   template <class E>
+   rMatrix( internal::rMatrixExpr<E> const &_expr );
 
-   ~rMatrix() {}
+   template <class... ARGS>
+   constexpr rMatrix( TYPE &&_a1, ARGS &&... _args );
 
-   TYPE &get( uint32_t _position ) { return vDataMat[_position]; }
-   TYPE const &get( uint32_t _position ) const { return vDataMat[_position]; }
-   TYPE &get( uint32_t _x, uint32_t _y ) { return vDataMat[( _x * ROWS ) + _y]; }
-   TYPE const &get( uint32_t _x, uint32_t _y ) const { return vDataMat[( _x * ROWS ) + _y]; }
+   constexpr TYPE &get( uint32_t _position ) { return vDataMat[_position]; }
+   constexpr TYPE const &get( uint32_t _position ) const { return vDataMat[_position]; }
+   constexpr TYPE &get( uint32_t _x, uint32_t _y ) { return vDataMat[( _x * ROWS ) + _y]; }
+   constexpr TYPE const &get( uint32_t _x, uint32_t _y ) const {
+      return vDataMat[( _x * ROWS ) + _y];
+   }
 
    template <uint32_t I>
-   TYPE &             get() {
+   constexpr TYPE &get() {
       static_assert( I < ROWS * COLLUMNS, "Out of range" );
       return vDataMat[I];
    }
    template <uint32_t I>
-   TYPE const &       get() const {
+   constexpr TYPE const &get() const {
       static_assert( I < ROWS * COLLUMNS, "Out of range" );
       return vDataMat[I];
    }
    template <uint32_t X, uint32_t Y>
-   TYPE &get() {
+   constexpr TYPE &get() {
       static_assert( X < COLLUMNS && Y < ROWS, "Out of range" );
       return vDataMat[( X * ROWS ) + Y];
    }
    template <uint32_t X, uint32_t Y>
-   TYPE const &get() const {
+   constexpr TYPE const &get() const {
       static_assert( X < COLLUMNS && Y < ROWS, "Out of range" );
       return vDataMat[( X * ROWS ) + Y];
    }
 
    TYPE *getMatrix() { return vDataMat; }
-   void set( uint32_t _position, TYPE _newVal ) { vDataMat[_position] = _newVal; }
+   constexpr void set( uint32_t _position, TYPE _newVal ) { vDataMat[_position] = _newVal; }
 
-   void set( uint32_t _x, uint32_t _y, TYPE _newVal ) { vDataMat[( _x * ROWS ) + _y] = _newVal; }
-   void set( TYPE *_matrix );
+   constexpr void set( uint32_t _x, uint32_t _y, TYPE _newVal ) {
+      vDataMat[( _x * ROWS ) + _y] = _newVal;
+   }
+   constexpr void set( TYPE const *_matrix );
 
    template <class... ARGS>
-   void setMat( ARGS &&... _args );
+   constexpr void setMat( ARGS &&... _args );
 
-   uint32_t getRowSize() { return ROWS; }
-   uint32_t getCollumnSize() { return COLLUMNS; }
-   uint32_t getSize() { return ROWS * COLLUMNS; }
+   constexpr uint32_t getRowSize() const { return ROWS; }
+   constexpr uint32_t getCollumnSize() const { return COLLUMNS; }
+   constexpr uint32_t getSize() const { return ROWS * COLLUMNS; }
 
    // DTTSEIW = DUMMY_TEMPLATE_THAT_STD_ENABLE_IF_WORKS
    template <class DTTSEIW = void>
-   typename std::enable_if<ROWS == COLLUMNS, DTTSEIW>::type toIdentityMatrix();
+   constexpr typename std::enable_if<ROWS == COLLUMNS, DTTSEIW>::type toIdentityMatrix();
 
-   void fill( TYPE &_f ) { fill( std::forward<TYPE>( _f ) ); }
-   void fill( TYPE &&_f );
+   constexpr void fill( TYPE &_f ) { fill( std::forward<TYPE>( _f ) ); }
+   constexpr void fill( TYPE &&_f );
 
    template <uint32_t R, uint32_t C>
-   void downscale( rMatrix<TYPE, R, C> *_new ) const;
+   constexpr void downscale( rMatrix<TYPE, R, C> *_new ) const;
 
    template <uint32_t R, uint32_t C>
-   void upscale( rMatrix<TYPE, R, C> *_new ) const;
+   constexpr void upscale( rMatrix<TYPE, R, C> *_new ) const;
 
    template <uint32_t COLLUMNS_NEW>
    void multiply( const rMatrix<TYPE, COLLUMNS, COLLUMNS_NEW> &_matrix,
-                  rMatrix<TYPE, ROWS, COLLUMNS_NEW> *          _targetMatrix );
+                  rMatrix<TYPE, ROWS, COLLUMNS_NEW> *          _targetMatrix ) const;
 
    // Hardcoded multiply methods
-   void multiply( const rMatrix<TYPE, 2, 2> &_matrix, rMatrix<TYPE, 2, 2> *_targetMatrix );
-   void multiply( const rMatrix<TYPE, 3, 3> &_matrix, rMatrix<TYPE, 3, 3> *_targetMatrix );
-   void multiply( const rMatrix<TYPE, 4, 4> &_matrix, rMatrix<TYPE, 4, 4> *_targetMatrix );
+   void multiply( const rMatrix<TYPE, 2, 2> &_matrix, rMatrix<TYPE, 2, 2> *_targetMatrix ) const;
+   void multiply( const rMatrix<TYPE, 3, 3> &_matrix, rMatrix<TYPE, 3, 3> *_targetMatrix ) const;
+   void multiply( const rMatrix<TYPE, 4, 4> &_matrix, rMatrix<TYPE, 4, 4> *_targetMatrix ) const;
+   void multiply( const rMatrix<TYPE, 4, 1> &_vector, rMatrix<TYPE, 4, 1> *_targetVector ) const;
+
+   void transpose( rMatrix<TYPE, COLLUMNS, ROWS> *_targetMatrix ) const;
 
    void add( const rMatrix<TYPE, ROWS, COLLUMNS> &_matrix,
-             rMatrix<TYPE, ROWS, COLLUMNS> *      _targetMatrix );
+             rMatrix<TYPE, ROWS, COLLUMNS> *      _targetMatrix ) const;
    void subtract( const rMatrix<TYPE, ROWS, COLLUMNS> &_matrix,
-                  rMatrix<TYPE, ROWS, COLLUMNS> *      _targetMatrix );
-
-   // Operators
-
-   /*!
-    * The template parameters are changed due to a conflict with the already existing templates.
-    */
-   template <class T, uint32_t R, uint32_t C, uint32_t C_N>
-   friend rMatrix<T, R, C_N> operator*( rMatrix<T, R, C> _lMatrix, rMatrix<T, C, C_N> &_rMatrix );
-
-   template <class T, uint32_t R, uint32_t C>
-   friend rMatrix<T, R, C> operator*( T _lScalar, const rMatrix<T, R, C> &_rMatrix );
-
-   template <class T, uint32_t R, uint32_t C>
-   friend rMatrix<T, R, C> operator*( rMatrix<T, R, C> _lMatrix, const T &_rScalar );
+                  rMatrix<TYPE, ROWS, COLLUMNS> *      _targetMatrix ) const;
 
-   template <class T, uint32_t R, uint32_t C>
-   friend rMatrix<T, R, C> operator+( rMatrix<T, R, C> _lMatrix, const rMatrix<T, R, C> &_rMatrix );
+   // Operators (operator*, operator+ and operator- are in rMatrixExpression.hpp)
 
-   template <class T, uint32_t R, uint32_t C>
-   friend rMatrix<T, R, C> operator-( rMatrix<T, R, C> _lMatrix, const rMatrix<T, R, C> &_rMatrix );
+   rMatrix<TYPE, ROWS, COLLUMNS> &operator=( const rMatrix<TYPE, ROWS, COLLUMNS> &_newMatrix ) =
+         default;
 
-   rMatrix<TYPE, ROWS, COLLUMNS> &operator=( rMatrix<TYPE, ROWS, COLLUMNS> _newMatrix );
+   template <class E>
+   rMatrix<TYPE, ROWS, COLLUMNS> &operator=( internal::rMatrixExpr<E> const &_expr );
 
    rMatrix<TYPE, ROWS, COLLUMNS> &operator+=( const rMatrix<TYPE, ROWS, COLLUMNS> &_rMatrix );
    rMatrix<TYPE, ROWS, COLLUMNS> &operator-=( const rMatrix<TYPE, ROWS, COLLUMNS> &_rMatrix );
@@ -245,11 +281,11 @@ class rMatrix : public internal::rMatrixData<TYPE, ROWS, COLLUMNS> {
    rMatrix<TYPE, ROWS, COLLUMNS> &operator*=( const TYPE &_rScalar );
    rMatrix<TYPE, ROWS, COLLUMNS> &operator/=( const TYPE &_rScalar );
 
-   TYPE &operator[]( uint32_t _x ) { return get( _x ); }
-   TYPE &operator()( uint32_t _x, uint32_t _y ) { return get( _x, _y ); }
+   constexpr TYPE &operator[]( uint32_t _x ) { return get( _x ); }
+   constexpr TYPE &operator()( uint32_t _x, uint32_t _y ) { return get( _x, _y ); }
 
-   TYPE const &operator[]( uint32_t _x ) const { return get( _x ); }
-   TYPE const &operator()( uint32_t _x, uint32_t _y ) const { return get( _x, _y ); }
+   constexpr TYPE const &operator[]( uint32_t _x ) const { return get( _x ); }
+   constexpr TYPE const &operator()( uint32_t _x, uint32_t _y ) const { return get( _x, _y ); }
 
    void print( std::string _name = "Matrix", char _type = 'D' );
 };
@@ -264,23 +300,30 @@ class rMatrix : public internal::rMatrixData<TYPE, ROWS, COLLUMNS> {
 //
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( TYPE *_f ) {
+constexpr rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( TYPE const *_f )
+    : DATA( internal::rMatrixZero() ) {
    if ( _f == nullptr )
       return;
 
    for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
-      vDataMat[i]   = _f[i];
+      vDataMat[i] = _f[i];
 }
 
+/*!
+ * \brief Evaluates a matrix expression (see internal::rMatrixExpr)
+ */
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( const rMatrix<TYPE, ROWS, COLLUMNS> &_newMatrix ) {
-   for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
-      vDataMat[i]   = _newMatrix.vDataMat[i];
+template <class E>
+rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( internal::rMatrixExpr<E> const &_expr ) {
+   static_assert( E::ROWS == ROWS && E::COLLUMNS == COLLUMNS, "Wrong size of the expression" );
+   static_assert( std::is_same<typename E::TYPE, TYPE>::value, "Wrong type of the expression" );
+   _expr.self().evalTo( vDataMat );
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <class... ARGS>
-rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( TYPE &&_a1, ARGS &&... _args ) {
+constexpr rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( TYPE &&_a1, ARGS &&... _args )
+    : DATA( internal::rMatrixZero() ) {
    static_assert( sizeof...( _args ) == ( ROWS * COLLUMNS - 1 ),
                   "Wrong Number of arguments for this size of matrix / vector" );
    setHelper<0>( std::forward<TYPE>( _a1 ), std::forward<ARGS>( _args )... );
@@ -297,11 +340,17 @@ rMatrix<TYPE, ROWS, COLLUMNS>::rMatrix( TYPE &&_a1, ARGS &&... _args ) {
 //        |_|
 
 
+/*!
+ * \brief Evaluates a matrix expression (see internal::rMatrixExpr)
+ * \note The expression may contain this matrix
+ */
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS> &               rMatrix<TYPE, ROWS, COLLUMNS>::operator=(
-      rMatrix<TYPE, ROWS, COLLUMNS> _newMatrix ) {
-   for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
-      vDataMat[i]   = _newMatrix.get( i );
+template <class E>
+rMatrix<TYPE, ROWS, COLLUMNS> &rMatrix<TYPE, ROWS, COLLUMNS>::operator=(
+      internal::rMatrixExpr<E> const &_expr ) {
+   static_assert( E::ROWS == ROWS && E::COLLUMNS == COLLUMNS, "Wrong size of the expression" );
+   static_assert( std::is_same<typename E::TYPE, TYPE>::value, "Wrong type of the expression" );
+   _expr.self().evalTo( vDataMat );
    return *this;
 }
 
@@ -331,6 +380,11 @@ rMatrix<TYPE, ROWS, COLLUMNS> &               rMatrix<TYPE, ROWS, COLLUMNS>::ope
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 rMatrix<TYPE, ROWS, COLLUMNS> &rMatrix<TYPE, ROWS, COLLUMNS>::operator*=( const TYPE &_rScalar ) {
+   if ( ROWS * COLLUMNS == 16 ) {
+      internal::rMatrixKernels<TYPE>::scale( vDataMat, _rScalar, vDataMat );
+      return *this;
+   }
+
    for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
       vDataMat[i] *= _rScalar;
 
@@ -346,44 +400,6 @@ rMatrix<TYPE, ROWS, COLLUMNS> &rMatrix<TYPE, ROWS, COLLUMNS>::operator/=( const
 }
 
 
-
-
-template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS, uint32_t COLLUMNS_NEW>
-rMatrix<TYPE, ROWS, COLLUMNS_NEW> operator*( rMatrix<TYPE, ROWS, COLLUMNS> _lMatrix,
-                                             rMatrix<TYPE, COLLUMNS, COLLUMNS_NEW> &_rMatrix ) {
-   rMatrix<TYPE, ROWS, COLLUMNS_NEW> _target;
-   _lMatrix.multiply( _rMatrix, &_target );
-   return _target;
-}
-
-
-template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS> operator*( TYPE                                 _lScalar,
-                                         const rMatrix<TYPE, ROWS, COLLUMNS> &_rMatrix ) {
-   rMatrix<TYPE, ROWS, COLLUMNS> lTarget = _rMatrix;
-   lTarget *= _lScalar;
-   return lTarget;
-}
-
-template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS> operator*( rMatrix<TYPE, ROWS, COLLUMNS> _lMatrix,
-                                         const TYPE &_rScalar ) {
-   return _lMatrix *= _rScalar;
-}
-
-template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS> operator+( rMatrix<TYPE, ROWS, COLLUMNS> _lMatrix,
-                                         const rMatrix<TYPE, ROWS, COLLUMNS> &_rMatrix ) {
-   return _lMatrix += _rMatrix;
-}
-
-template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-rMatrix<TYPE, ROWS, COLLUMNS> operator-( rMatrix<TYPE, ROWS, COLLUMNS> _lMatrix,
-                                         const rMatrix<TYPE, ROWS, COLLUMNS> &_rMatrix ) {
-   return _lMatrix -= _rMatrix;
-}
-
-
 //  ______             _       __ _                _                   _        _
 //  | ___ \           | |     / _(_)              | |                 | |      (_)
 //  | |_/ / __ ___  __| | ___| |_ _ _ __   ___  __| |  _ __ ___   __ _| |_ _ __ ___  __
@@ -400,7 +416,7 @@ rMatrix<TYPE, ROWS, COLLUMNS> operator-( rMatrix<TYPE, ROWS, COLLUMNS> _lMatrix,
 // DTTSEIW = DUMMY_TEMPLATE_THAT_STD_ENABLE_IF_WORKS
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <class DTTSEIW>
-typename std::enable_if<ROWS == COLLUMNS, DTTSEIW>::type
+constexpr typename std::enable_if<ROWS == COLLUMNS, DTTSEIW>::type
 rMatrix<TYPE, ROWS, COLLUMNS>::toIdentityMatrix() {
    vDataMat[0] = 1;
    for ( uint32_t i = 1; i < ROWS * ROWS; ++i )
@@ -411,14 +427,14 @@ rMatrix<TYPE, ROWS, COLLUMNS>::toIdentityMatrix() {
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-void rMatrix<TYPE, ROWS, COLLUMNS>::fill( TYPE &&_f ) {
-   for ( uint32_t i = 1; i < ROWS * COLLUMNS; ++i )
-      vDataMat[i]   = _f;
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::fill( TYPE &&_f ) {
+   for ( uint32_t i = 0; i < ROWS * COLLUMNS; ++i )
+      vDataMat[i] = _f;
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t R, uint32_t C>
-void rMatrix<TYPE, ROWS, COLLUMNS>::downscale( rMatrix<TYPE, R, C> *_new ) const {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::downscale( rMatrix<TYPE, R, C> *_new ) const {
    static_assert( ( ROWS * COLLUMNS ) >= 2, "Matrix size (R*C) must be at least 2" );
    static_assert( R <= ROWS && C <= COLLUMNS, "The matrix to downscale must be smaller" );
 
@@ -429,7 +445,7 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::downscale( rMatrix<TYPE, R, C> *_new ) const
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t R, uint32_t C>
-void rMatrix<TYPE, ROWS, COLLUMNS>::upscale( rMatrix<TYPE, R, C> *_new ) const {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::upscale( rMatrix<TYPE, R, C> *_new ) const {
    static_assert( ( ROWS * COLLUMNS ) >= 2, "Matrix size (R*C) must be at least 2" );
    static_assert( R >= ROWS && C >= COLLUMNS, "The matrix to upscale must be larger" );
 
@@ -457,8 +473,9 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::upscale( rMatrix<TYPE, R, C> *_new ) const {
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t COLLUMNS_NEW>
-void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, COLLUMNS, COLLUMNS_NEW> &_matrix,
-                                              rMatrix<TYPE, ROWS, COLLUMNS_NEW> *_targetMatrix ) {
+void rMatrix<TYPE, ROWS, COLLUMNS>::multiply(
+      const rMatrix<TYPE, COLLUMNS, COLLUMNS_NEW> &_matrix,
+      rMatrix<TYPE, ROWS, COLLUMNS_NEW> *          _targetMatrix ) const {
    uint32_t currentIndex = 0;
    TYPE     currentSum   = 0;
    for ( uint32_t i = 0; i < COLLUMNS_NEW; ++i ) { // Second Matrix
@@ -476,7 +493,7 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, COLLUMNS, COLL
 // HARDCODED 2x2
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 2, 2> &_matrix,
-                                              rMatrix<TYPE, 2, 2> *_targetMatrix ) {
+                                              rMatrix<TYPE, 2, 2> *_targetMatrix ) const {
    // clang-format off
    _targetMatrix->vDataMat[0] = ( ( vDataMat[0] * _matrix.vDataMat[0] ) + ( vDataMat[2] * _matrix.vDataMat[1] ) );
    _targetMatrix->vDataMat[1] = ( ( vDataMat[1] * _matrix.vDataMat[0] ) + ( vDataMat[3] * _matrix.vDataMat[1] ) );
@@ -489,7 +506,7 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 2, 2> &_matrix
 // HARDCODED 3x3
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 3, 3> &_matrix,
-                                              rMatrix<TYPE, 3, 3> *_targetMatrix ) {
+                                              rMatrix<TYPE, 3, 3> *_targetMatrix ) const {
    // clang-format off
    _targetMatrix->vDataMat[0] = ( ( vDataMat[0] * _matrix.vDataMat[0] ) + ( vDataMat[3] * _matrix.vDataMat[1] ) + ( vDataMat[6] * _matrix.vDataMat[2] ) );
    _targetMatrix->vDataMat[1] = ( ( vDataMat[1] * _matrix.vDataMat[0] ) + ( vDataMat[4] * _matrix.vDataMat[1] ) + ( vDataMat[7] * _matrix.vDataMat[2] ) );
@@ -504,40 +521,57 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 3, 3> &_matrix
 }
 
 
-// HARDCODED 4x4
+// HARDCODED 4x4 (SSE / AVX, see rMatrixKernels)
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 4, 4> &_matrix,
-                                              rMatrix<TYPE, 4, 4> *_targetMatrix ) {
-   // clang-format off
-   _targetMatrix->vDataMat[0]  = ( ( vDataMat[0] * _matrix.vDataMat[0]  ) + ( vDataMat[4] * _matrix.vDataMat[1]  ) + ( vDataMat[8]  * _matrix.vDataMat[2]  ) + ( vDataMat[12] * _matrix.vDataMat[3]  ) );
-   _targetMatrix->vDataMat[1]  = ( ( vDataMat[1] * _matrix.vDataMat[0]  ) + ( vDataMat[5] * _matrix.vDataMat[1]  ) + ( vDataMat[9]  * _matrix.vDataMat[2]  ) + ( vDataMat[13] * _matrix.vDataMat[3]  ) );
-   _targetMatrix->vDataMat[2]  = ( ( vDataMat[2] * _matrix.vDataMat[0]  ) + ( vDataMat[6] * _matrix.vDataMat[1]  ) + ( vDataMat[10] * _matrix.vDataMat[2]  ) + ( vDataMat[14] * _matrix.vDataMat[3]  ) );
-   _targetMatrix->vDataMat[3]  = ( ( vDataMat[3] * _matrix.vDataMat[0]  ) + ( vDataMat[7] * _matrix.vDataMat[1]  ) + ( vDataMat[11] * _matrix.vDataMat[2]  ) + ( vDataMat[15] * _matrix.vDataMat[3]  ) );
-   _targetMatrix->vDataMat[4]  = ( ( vDataMat[0] * _matrix.vDataMat[4]  ) + ( vDataMat[4] * _matrix.vDataMat[5]  ) + ( vDataMat[8]  * _matrix.vDataMat[6]  ) + ( vDataMat[12] * _matrix.vDataMat[7]  ) );
-   _targetMatrix->vDataMat[5]  = ( ( vDataMat[1] * _matrix.vDataMat[4]  ) + ( vDataMat[5] * _matrix.vDataMat[5]  ) + ( vDataMat[9]  * _matrix.vDataMat[6]  ) + ( vDataMat[13] * _matrix.vDataMat[7]  ) );
-   _targetMatrix->vDataMat[6]  = ( ( vDataMat[2] * _matrix.vDataMat[4]  ) + ( vDataMat[6] * _matrix.vDataMat[5]  ) + ( vDataMat[10] * _matrix.vDataMat[6]  ) + ( vDataMat[14] * _matrix.vDataMat[7]  ) );
-   _targetMatrix->vDataMat[7]  = ( ( vDataMat[3] * _matrix.vDataMat[4]  ) + ( vDataMat[7] * _matrix.vDataMat[5]  ) + ( vDataMat[11] * _matrix.vDataMat[6]  ) + ( vDataMat[15] * _matrix.vDataMat[7]  ) );
-   _targetMatrix->vDataMat[8]  = ( ( vDataMat[0] * _matrix.vDataMat[8]  ) + ( vDataMat[4] * _matrix.vDataMat[9]  ) + ( vDataMat[8]  * _matrix.vDataMat[10] ) + ( vDataMat[12] * _matrix.vDataMat[11] ) );
-   _targetMatrix->vDataMat[9]  = ( ( vDataMat[1] * _matrix.vDataMat[8]  ) + ( vDataMat[5] * _matrix.vDataMat[9]  ) + ( vDataMat[9]  * _matrix.vDataMat[10] ) + ( vDataMat[13] * _matrix.vDataMat[11] ) );
-   _targetMatrix->vDataMat[10] = ( ( vDataMat[2] * _matrix.vDataMat[8]  ) + ( vDataMat[6] * _matrix.vDataMat[9]  ) + ( vDataMat[10] * _matrix.vDataMat[10] ) + ( vDataMat[14] * _matrix.vDataMat[11] ) );
-   _targetMatrix->vDataMat[11] = ( ( vDataMat[3] * _matrix.vDataMat[8]  ) + ( vDataMat[7] * _matrix.vDataMat[9]  ) + ( vDataMat[11] * _matrix.vDataMat[10] ) + ( vDataMat[15] * _matrix.vDataMat[11] ) );
-   _targetMatrix->vDataMat[12] = ( ( vDataMat[0] * _matrix.vDataMat[12] ) + ( vDataMat[4] * _matrix.vDataMat[13] ) + ( vDataMat[8]  * _matrix.vDataMat[14] ) + ( vDataMat[12] * _matrix.vDataMat[15] ) );
-   _targetMatrix->vDataMat[13] = ( ( vDataMat[1] * _matrix.vDataMat[12] ) + ( vDataMat[5] * _matrix.vDataMat[13] ) + ( vDataMat[9]  * _matrix.vDataMat[14] ) + ( vDataMat[13] * _matrix.vDataMat[15] ) );
-   _targetMatrix->vDataMat[14] = ( ( vDataMat[2] * _matrix.vDataMat[12] ) + ( vDataMat[6] * _matrix.vDataMat[13] ) + ( vDataMat[10] * _matrix.vDataMat[14] ) + ( vDataMat[14] * _matrix.vDataMat[15] ) );
-   _targetMatrix->vDataMat[15] = ( ( vDataMat[3] * _matrix.vDataMat[12] ) + ( vDataMat[7] * _matrix.vDataMat[13] ) + ( vDataMat[11] * _matrix.vDataMat[14] ) + ( vDataMat[15] * _matrix.vDataMat[15] ) );
-   // clang-format on
+                                              rMatrix<TYPE, 4, 4> *_targetMatrix ) const {
+   internal::rMatrixKernels<TYPE>::multiply( vDataMat, _matrix.vDataMat, _targetMatrix->vDataMat );
+}
+
+// HARDCODED 4x4 * 4x1
+template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
+void rMatrix<TYPE, ROWS, COLLUMNS>::multiply( const rMatrix<TYPE, 4, 1> &_vector,
+                                              rMatrix<TYPE, 4, 1> *_targetVector ) const {
+   internal::rMatrixKernels<TYPE>::transform( vDataMat, _vector.vDataMat, _targetVector->vDataMat );
+}
+
+template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
+void rMatrix<TYPE, ROWS, COLLUMNS>::transpose(
+      rMatrix<TYPE, COLLUMNS, ROWS> *_targetMatrix ) const {
+   if ( ROWS == 4 && COLLUMNS == 4 ) {
+      internal::rMatrixKernels<TYPE>::transpose( vDataMat, _targetMatrix->vDataMat );
+      return;
+   }
+
+   TYPE lTemp[ROWS * COLLUMNS];
+   for ( uint32_t x = 0; x < COLLUMNS; ++x )
+      for ( uint32_t y = 0; y < ROWS; ++y )
+         lTemp[( y * COLLUMNS ) + x] = get( x, y );
+
+   _targetMatrix->set( lTemp );
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 void rMatrix<TYPE, ROWS, COLLUMNS>::add( const rMatrix<TYPE, ROWS, COLLUMNS> &_matrix,
-                                         rMatrix<TYPE, ROWS, COLLUMNS> *_targetMatrix ) {
+                                         rMatrix<TYPE, ROWS, COLLUMNS> *_targetMatrix ) const {
+   if ( ROWS * COLLUMNS == 16 ) {
+      internal::rMatrixKernels<TYPE>::add( vDataMat, _matrix.vDataMat, _targetMatrix->vDataMat );
+      return;
+   }
+
    for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
       _targetMatrix->set( i, ( vDataMat[i] + _matrix.get( i ) ) );
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 void rMatrix<TYPE, ROWS, COLLUMNS>::subtract( const rMatrix<TYPE, ROWS, COLLUMNS> &_matrix,
-                                              rMatrix<TYPE, ROWS, COLLUMNS> *_targetMatrix ) {
+                                              rMatrix<TYPE, ROWS, COLLUMNS> *_targetMatrix ) const {
+   if ( ROWS * COLLUMNS == 16 ) {
+      internal::rMatrixKernels<TYPE>::subtract(
+            vDataMat, _matrix.vDataMat, _targetMatrix->vDataMat );
+      return;
+   }
+
    for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
       _targetMatrix->set( i, ( vDataMat[i] - _matrix.get( i ) ) );
 }
@@ -553,14 +587,14 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::subtract( const rMatrix<TYPE, ROWS, COLLUMNS
 
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
-void rMatrix<TYPE, ROWS, COLLUMNS>::set( TYPE *_matrix ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::set( TYPE const *_matrix ) {
    for ( uint32_t i = 0; i < ( ROWS * COLLUMNS ); ++i )
-      vDataMat[i]   = _matrix[i];
+      vDataMat[i] = _matrix[i];
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <class... ARGS>
-void rMatrix<TYPE, ROWS, COLLUMNS>::setMat( ARGS &&... _args ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::setMat( ARGS &&... _args ) {
    static_assert(
          sizeof...( _args ) == ( ROWS * COLLUMNS ),
          "Wrong Number of arguments to set the size of this size of matrix / vector [set2]" );
@@ -571,28 +605,28 @@ void rMatrix<TYPE, ROWS, COLLUMNS>::setMat( ARGS &&... _args ) {
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t POS, class... ARGS>
-inline void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( TYPE &&_arg, ARGS &&... _args ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( TYPE &&_arg, ARGS &&... _args ) {
    vDataMat[( ( POS % ROWS ) * COLLUMNS ) + ( POS / ROWS )] = _arg;
    setHelper<POS + 1>( static_cast<TYPE>( std::forward<ARGS>( _args ) )... );
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t POS>
-inline void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( TYPE &&_arg ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( TYPE &&_arg ) {
    vDataMat[( ( POS % ROWS ) * COLLUMNS ) + ( POS / ROWS )] = _arg;
 }
 
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t POS, class... ARGS>
-inline void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( const TYPE &_arg, ARGS &&... _args ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( const TYPE &_arg, ARGS &&... _args ) {
    vDataMat[( ( POS % ROWS ) * COLLUMNS ) + ( POS / ROWS )] = _arg;
    setHelper<POS + 1>( std::forward<ARGS>( _args )... );
 }
 
 template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
 template <uint32_t POS>
-inline void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( const TYPE &_arg ) {
+constexpr void rMatrix<TYPE, ROWS, COLLUMNS>::setHelper( const TYPE &_arg ) {
    vDataMat[( ( POS % ROWS ) * COLLUMNS ) + ( POS / ROWS )] = _arg;
 }
 
@@ -0,0 +1,423 @@
+/*!
+ * \file rMatrixExpression.hpp
+ * \brief \b Classes: \a rMatrixExpr, \a rMatrixProduct, \a rMatrixElementwise, \a rMatrixScaled
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rMatrixSIMD.hpp"
+#include <stdint.h>
+#include <type_traits>
+
+namespace e_engine {
+
+template <class TYPE, uint32_t ROWS, uint32_t COLLUMNS>
+class rMatrix;
+
+namespace internal {
+
+/*!
+ * \brief Base of all lazily evaluated rMatrix expressions
+ *
+ * operator*, operator+ and operator- on matrices do not compute anything, they return an
+ * expression that references the operands. The expression is evaluated when it is assigned to
+ * (or used to construct) a rMatrix:
+ *
+ *  - A chain of products (A * B * C * v) is evaluated column by column from right to left, so
+ *    every column of the result is one matrix vector product per matrix and no temporary matrix
+ *    is needed. 4x4 matrices use the rMatrixKernels (SSE / AVX).
+ *  - Sums, differences and scalar products (A + B - s * C) are evaluated in one loop over the
+ *    elements.
+ *
+ * A product inside a sum (or a sum inside a product) is evaluated into a temporary first.
+ *
+ * \warning Expressions store references to their operands: do not store them with auto, use
+ *          rMatrix (or eval()) instead.
+ */
+template <class E>
+struct rMatrixExpr {
+   E const &self() const { return *static_cast<E const *>( this ); }
+
+   //! Evaluates the expression into a new rMatrix (for template argument deduction)
+   auto eval() const { return rMatrix<typename E::TYPE, E::ROWS, E::COLLUMNS>( self() ); }
+};
+
+
+/*!
+ * \brief Matrix vector product _out = _m * _v for a ROWS x COLLUMNS matrix
+ * \note _out may alias _v
+ */
+template <class T, uint32_t R, uint32_t C>
+struct rMatrixTransform {
+   static inline void apply( T const *_m, T const *_v, T *_out ) {
+      T lOut[R];
+
+      // Same order as rMatrix::multiply
+      for ( uint32_t j = 0; j < R; ++j ) {
+         T lSum = 0;
+         for ( uint32_t k = 0; k < C; ++k )
+            lSum += _m[k * R + j] * _v[k];
+
+         lOut[j] = lSum;
+      }
+
+      for ( uint32_t j = 0; j < R; ++j )
+         _out[j] = lOut[j];
+   }
+};
+
+template <class T>
+struct rMatrixTransform<T, 4, 4> {
+   static inline void apply( T const *_m, T const *_v, T *_out ) {
+      rMatrixKernels<T>::transform( _m, _v, _out );
+   }
+};
+
+
+/*!
+ * \brief Leaf of an expression: an existing matrix (not owned)
+ */
+template <class T, uint32_t R, uint32_t C>
+struct rMatrixRef {
+   typedef T TYPE;
+   static const uint32_t ROWS           = R;
+   static const uint32_t COLLUMNS       = C;
+   static const bool     IS_LEAF        = true;
+   static const bool     IS_LINEAR      = true;
+   static const bool     IS_ELEMENTWISE = true;
+
+   T const *vData;
+
+   rMatrixRef( T const *_data ) : vData( _data ) {}
+
+   T        at( uint32_t _i ) const { return vData[_i]; }
+   T const *data() const { return vData; }
+   T const *column( uint32_t _j, T * ) const { return vData + _j * R; }
+   void     applyColumn( T const *_in, T *_out ) const {
+      rMatrixTransform<T, R, C>::apply( vData, _in, _out );
+   }
+
+   void evalTo( T *_out ) const {
+      for ( uint32_t i = 0; i < R * C; ++i )
+         _out[i] = vData[i];
+   }
+
+   bool aliases( T const *_ptr ) const { return _ptr == vData; }
+};
+
+/*!
+ * \brief Leaf of an expression: an evaluated sub expression (owned)
+ */
+template <class T, uint32_t R, uint32_t C>
+struct rMatrixTemp {
+   typedef T TYPE;
+   static const uint32_t ROWS           = R;
+   static const uint32_t COLLUMNS       = C;
+   static const bool     IS_LEAF        = true;
+   static const bool     IS_LINEAR      = true;
+   static const bool     IS_ELEMENTWISE = true;
+
+   T vData[R * C];
+
+   template <class E>
+   rMatrixTemp( E const &_expr ) {
+      _expr.evalTo( vData );
+   }
+
+   T        at( uint32_t _i ) const { return vData[_i]; }
+   T const *data() const { return vData; }
+   T const *column( uint32_t _j, T * ) const { return vData + _j * R; }
+   void     applyColumn( T const *_in, T *_out ) const {
+      rMatrixTransform<T, R, C>::apply( vData, _in, _out );
+   }
+
+   void evalTo( T *_out ) const {
+      for ( uint32_t i = 0; i < R * C; ++i )
+         _out[i] = vData[i];
+   }
+
+   bool aliases( T const * ) const { return false; }
+};
+
+
+/*!
+ * \brief Lazy product _left * _right (see rMatrixExpr)
+ */
+template <class L, class R>
+struct rMatrixProduct : rMatrixExpr<rMatrixProduct<L, R>> {
+   static_assert( L::COLLUMNS == R::ROWS, "Matrix product: collumns of left != rows of right" );
+
+   typedef typename L::TYPE TYPE;
+   static const uint32_t ROWS           = L::ROWS;
+   static const uint32_t COLLUMNS       = R::COLLUMNS;
+   static const bool     IS_LEAF        = false;
+   static const bool     IS_LINEAR      = true;
+   static const bool     IS_ELEMENTWISE = false;
+
+   //! A single 4x4 * 4x4 product is one kernel call (which may alias)
+   typedef std::integral_constant<bool,
+                                  L::IS_LEAF && R::IS_LEAF && ROWS == 4 && COLLUMNS == 4 &&
+                                        R::ROWS == 4>
+         SINGLE_KERNEL;
+
+   L vLeft;
+   R vRight;
+
+   rMatrixProduct( L const &_left, R const &_right ) : vLeft( _left ), vRight( _right ) {}
+
+   void applyColumn( TYPE const *_in, TYPE *_out ) const {
+      TYPE lTemp[R::ROWS];
+      vRight.applyColumn( _in, lTemp );
+      vLeft.applyColumn( lTemp, _out );
+   }
+
+   TYPE const *column( uint32_t _j, TYPE *_buffer ) const {
+      TYPE lTemp[R::ROWS];
+      vLeft.applyColumn( vRight.column( _j, lTemp ), _buffer );
+      return _buffer;
+   }
+
+   void evalColumns( TYPE *_out ) const {
+      for ( uint32_t j = 0; j < COLLUMNS; ++j ) {
+         TYPE lTemp[R::ROWS];
+         vLeft.applyColumn( vRight.column( j, lTemp ), _out + j * ROWS );
+      }
+   }
+
+   void evalTo( TYPE *_out, std::true_type ) const {
+      rMatrixKernels<TYPE>::multiply( vLeft.data(), vRight.data(), _out );
+   }
+
+   void evalTo( TYPE *_out, std::false_type ) const {
+      // Column j of the result only reads column j of a matrix on the right side, but all columns
+      // of the matrices on the left side
+      if ( vLeft.aliases( _out ) || ( !R::IS_LEAF && vRight.aliases( _out ) ) ) {
+         TYPE lTemp[ROWS * COLLUMNS];
+         evalColumns( lTemp );
+
+         for ( uint32_t i = 0; i < ROWS * COLLUMNS; ++i )
+            _out[i] = lTemp[i];
+
+         return;
+      }
+
+      evalColumns( _out );
+   }
+
+   void evalTo( TYPE *_out ) const { evalTo( _out, SINGLE_KERNEL() ); }
+
+   bool aliases( TYPE const *_ptr ) const {
+      return vLeft.aliases( _ptr ) || vRight.aliases( _ptr );
+   }
+};
+
+
+struct rMatrixAdd {
+   template <class T>
+   static T apply( T _a, T _b ) {
+      return _a + _b;
+   }
+};
+
+struct rMatrixSubtract {
+   template <class T>
+   static T apply( T _a, T _b ) {
+      return _a - _b;
+   }
+};
+
+/*!
+ * \brief Lazy element wise operation (OP is rMatrixAdd or rMatrixSubtract)
+ */
+template <class L, class R, class OP>
+struct rMatrixElementwise : rMatrixExpr<rMatrixElementwise<L, R, OP>> {
+   static_assert( L::ROWS == R::ROWS && L::COLLUMNS == R::COLLUMNS, "Matrix sizes differ" );
+
+   typedef typename L::TYPE TYPE;
+   static const uint32_t ROWS           = L::ROWS;
+   static const uint32_t COLLUMNS       = L::COLLUMNS;
+   static const bool     IS_LEAF        = false;
+   static const bool     IS_LINEAR      = false;
+   static const bool     IS_ELEMENTWISE = true;
+
+   L vLeft;
+   R vRight;
+
+   rMatrixElementwise( L const &_left, R const &_right ) : vLeft( _left ), vRight( _right ) {}
+
+   TYPE at( uint32_t _i ) const { return OP::apply( vLeft.at( _i ), vRight.at( _i ) ); }
+
+   //! Element i only depends on element i of the operands --> may always alias
+   void evalTo( TYPE *_out ) const {
+      for ( uint32_t i = 0; i < ROWS * COLLUMNS; ++i )
+         _out[i] = at( i );
+   }
+
+   bool aliases( TYPE const *_ptr ) const {
+      return vLeft.aliases( _ptr ) || vRight.aliases( _ptr );
+   }
+};
+
+/*!
+ * \brief Lazy product with a scalar
+ */
+template <class E>
+struct rMatrixScaled : rMatrixExpr<rMatrixScaled<E>> {
+   typedef typename E::TYPE TYPE;
+   static const uint32_t ROWS           = E::ROWS;
+   static const uint32_t COLLUMNS       = E::COLLUMNS;
+   static const bool     IS_LEAF        = false;
+   static const bool     IS_LINEAR      = false;
+   static const bool     IS_ELEMENTWISE = true;
+
+   E    vExpr;
+   TYPE vScalar;
+
+   rMatrixScaled( E const &_expr, TYPE _scalar ) : vExpr( _expr ), vScalar( _scalar ) {}
+
+   TYPE at( uint32_t _i ) const { return vExpr.at( _i ) * vScalar; }
+
+   void evalTo( TYPE *_out ) const {
+      for ( uint32_t i = 0; i < ROWS * COLLUMNS; ++i )
+         _out[i] = at( i );
+   }
+
+   bool aliases( TYPE const *_ptr ) const { return vExpr.aliases( _ptr ); }
+};
+
+
+//! Maps an operand (rMatrix or expression) to its expression node
+template <class X, class = void>
+struct rMatrixNode {
+   static const bool value = false;
+};
+
+template <class T, uint32_t R, uint32_t C>
+struct rMatrixNode<rMatrix<T, R, C>, void> {
+   static const bool value = true;
+   typedef rMatrixRef<T, R, C> type;
+
+   static type make( rMatrix<T, R, C> const &_mat ) { return type( _mat.vDataMat ); }
+};
+
+template <class X>
+struct rMatrixNode<X, typename std::enable_if<std::is_base_of<rMatrixExpr<X>, X>::value>::type> {
+   static const bool value = true;
+   typedef X type;
+
+   static X const &make( X const &_expr ) { return _expr; }
+};
+
+//! Evaluates nodes into a rMatrixTemp if they do not support the operation (OK == false)
+template <class N, bool OK>
+struct rMatrixConvert {
+   typedef N type;
+
+   static N const &make( N const &_node ) { return _node; }
+};
+
+template <class N>
+struct rMatrixConvert<N, false> {
+   typedef rMatrixTemp<typename N::TYPE, N::ROWS, N::COLLUMNS> type;
+
+   static type make( N const &_node ) { return type( _node ); }
+};
+
+//! Operand of a product
+template <class X>
+struct rMatrixLinearOperand {
+   typedef typename rMatrixNode<X>::type NODE;
+   typedef rMatrixConvert<NODE, NODE::IS_LINEAR> CONV;
+   typedef typename CONV::type type;
+
+   static type make( X const &_x ) { return CONV::make( rMatrixNode<X>::make( _x ) ); }
+};
+
+//! Operand of an element wise operation
+template <class X>
+struct rMatrixElementOperand {
+   typedef typename rMatrixNode<X>::type NODE;
+   typedef rMatrixConvert<NODE, NODE::IS_ELEMENTWISE> CONV;
+   typedef typename CONV::type type;
+
+   static type make( X const &_x ) { return CONV::make( rMatrixNode<X>::make( _x ) ); }
+};
+
+//! Only enables the operators for rMatrix and expressions
+template <class A, class B = A>
+using rMatrixEnable = typename std::enable_if<rMatrixNode<A>::value && rMatrixNode<B>::value>::type;
+
+template <class A, class B>
+using rMatrixProductOf = rMatrixProduct<typename rMatrixLinearOperand<A>::type,
+                                        typename rMatrixLinearOperand<B>::type>;
+
+template <class A, class B, class OP>
+using rMatrixElementwiseOf = rMatrixElementwise<typename rMatrixElementOperand<A>::type,
+                                                typename rMatrixElementOperand<B>::type,
+                                                OP>;
+
+template <class A>
+using rMatrixScaledOf = rMatrixScaled<typename rMatrixElementOperand<A>::type>;
+
+
+//   _____                      _
+//  |  _  |                    | |
+//  | | | |_ __   ___ _ __ __ _| |_ ___  _ __ ___
+//  | | | | '_ \ / _ \ '__/ _` | __/ _ \| '__/ __|
+//  \ \_/ / |_) |  __/ | | (_| | || (_) | |  \__ \
+//   \___/| .__/ \___|_|  \__,_|\__\___/|_|  |___/
+//        | |
+//        |_|
+
+// The operators are in the internal namespace, which is associated with rMatrix (base class
+// rMatrixData) and all expressions, so they are always found by argument dependent lookup
+
+template <class A, class B, class = rMatrixEnable<A, B>>
+inline rMatrixProductOf<A, B> operator*( A const &_a, B const &_b ) {
+   return rMatrixProductOf<A, B>( rMatrixLinearOperand<A>::make( _a ),
+                                  rMatrixLinearOperand<B>::make( _b ) );
+}
+
+template <class A, class = rMatrixEnable<A>>
+inline rMatrixScaledOf<A> operator*( A const &_a, typename rMatrixNode<A>::type::TYPE _scalar ) {
+   return rMatrixScaledOf<A>( rMatrixElementOperand<A>::make( _a ), _scalar );
+}
+
+template <class A, class = rMatrixEnable<A>>
+inline rMatrixScaledOf<A> operator*( typename rMatrixNode<A>::type::TYPE _scalar, A const &_a ) {
+   return rMatrixScaledOf<A>( rMatrixElementOperand<A>::make( _a ), _scalar );
+}
+
+template <class A, class B, class = rMatrixEnable<A, B>>
+inline rMatrixElementwiseOf<A, B, rMatrixAdd> operator+( A const &_a, B const &_b ) {
+   return rMatrixElementwiseOf<A, B, rMatrixAdd>( rMatrixElementOperand<A>::make( _a ),
+                                                  rMatrixElementOperand<B>::make( _b ) );
+}
+
+template <class A, class B, class = rMatrixEnable<A, B>>
+inline rMatrixElementwiseOf<A, B, rMatrixSubtract> operator-( A const &_a, B const &_b ) {
+   return rMatrixElementwiseOf<A, B, rMatrixSubtract>( rMatrixElementOperand<A>::make( _a ),
+                                                       rMatrixElementOperand<B>::make( _b ) );
+}
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
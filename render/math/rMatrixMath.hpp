@@ -22,6 +22,7 @@
 
 #include "defines.hpp"
 
+#include "rQuat.hpp"
 #include "rVectorMath.hpp"
 
 namespace e_engine {
@@ -51,26 +52,55 @@ using rMatNd = rMatrix<double, N, N>;
 template <class T, int N>
 using rMat = rMatrix<T, N, N>;
 
+/*!
+ * \brief Matrix builders
+ *
+ * identity, scale, translate and perspectiveFocal are constexpr, so constant matrices can be
+ * computed at compile time:
+ *
+ * \code
+ * constexpr rMat4f buildOffset() {
+ *    rMat4f lOut = rMatrixMath::identity<float>();
+ *    rMatrixMath::translate( rVec3f( 0.0f, 1.0f, 0.0f ), lOut );
+ *    return lOut;
+ * }
+ *
+ * static constexpr rMat4f OFFSET = buildOffset(); // read only data, no code at runtime
+ * \endcode
+ */
 class rMatrixMath {
  public:
+   template <class T, int N = 4>
+   static constexpr rMat<T, N> identity();
+
    template <class T>
-   static void scale( T _n, rMat4<T> &_out );
+   static constexpr void scale( T _n, rMat4<T> &_out );
    template <class T>
-   static void scale( const rVec3<T> &_n, rMat4<T> &_out );
+   static constexpr void scale( const rVec3<T> &_n, rMat4<T> &_out );
 
    template <class T>
-   static void translate( const rVec3<T> &_n, rMat4<T> &_out );
+   static constexpr void translate( const rVec3<T> &_n, rMat4<T> &_out );
 
    template <class T>
    static void rotate( const rVec3<T> &_axis, T _angle, rMat4<T> &_out );
 
    template <class T>
    static void perspective( T _aspectRatio, T _nearZ, T _farZ, T _fofy, rMat4<T> &_out );
+   template <class T>
+   static constexpr void perspectiveFocal(
+         T _aspectRatio, T _nearZ, T _farZ, T _focal, rMat4<T> &_out );
+
+   template <class T>
+   static bool inverse( rMat4<T> const &_in, rMat4<T> &_out );
+   template <class T>
+   static bool affineInverse( rMat4<T> const &_in, rMat4<T> &_out );
 
    template <class T>
    static void getNormalMatrix( rMat4<T> const &_in, rMat3<T> &_out );
    template <class T>
    static void getNormalMatrix( rMat3<T> const &_in, rMat3<T> &_out );
+   template <class T>
+   static void getNormalMatrix( rMat4<T> const &_in, T _uniformScale, rMat3<T> &_out );
 
    template <class T>
    static void camera( const rVec3<T> &_position,
@@ -79,75 +109,58 @@ class rMatrixMath {
                        rMat4<T> &      _out );
 };
 
+template <class T, int N>
+constexpr rMat<T, N> rMatrixMath::identity() {
+   rMat<T, N> lOut( static_cast<T>( 0 ) );
+   lOut.toIdentityMatrix();
+   return lOut;
+}
+
+// The vector builders use get<I>() instead of x, y, z (only vDataMat can be read in constant
+// expressions, see rMatrixData)
+
 template <class T>
-void rMatrixMath::scale( T _n, rMat4<T> &_out ) {
+constexpr void rMatrixMath::scale( T _n, rMat4<T> &_out ) {
    _out.setMat( _n, 0, 0, 0, 0, _n, 0, 0, 0, 0, _n, 0, 0, 0, 0, 1 );
 }
 
 template <class T>
-void rMatrixMath::scale( const rVec3<T> &_n, rMat4<T> &_out ) {
-   _out.setMat( _n.x, 0, 0, 0, 0, _n.y, 0, 0, 0, 0, _n.z, 0, 0, 0, 0, 1 );
+constexpr void rMatrixMath::scale( const rVec3<T> &_n, rMat4<T> &_out ) {
+   T lX = _n.template get<0>(), lY = _n.template get<1>(), lZ = _n.template get<2>();
+   _out.setMat( lX, 0, 0, 0, 0, lY, 0, 0, 0, 0, lZ, 0, 0, 0, 0, 1 );
 }
 
 template <class T>
-void rMatrixMath::translate( const rVec3<T> &_n, rMat4<T> &_out ) {
-   _out.setMat( 1, 0, 0, _n.x, 0, 1, 0, _n.y, 0, 0, 1, _n.z, 0, 0, 0, 1 );
+constexpr void rMatrixMath::translate( const rVec3<T> &_n, rMat4<T> &_out ) {
+   T lX = _n.template get<0>(), lY = _n.template get<1>(), lZ = _n.template get<2>();
+   _out.setMat( 1, 0, 0, lX, 0, 1, 0, lY, 0, 0, 1, lZ, 0, 0, 0, 1 );
 }
 
+/*!
+ * \brief Rotation matrix for a rotation of _angle degree around _axis
+ */
 template <class T>
 void rMatrixMath::rotate( const rVec3<T> &_axis, T _angle, rMat4<T> &_out ) {
-   rVec3<T> lAxis = _axis;
-   lAxis.normalize();
-   T lAngleToUse = static_cast<T>( DEG_TO_RAD( _angle ) / 2 );
-   T lSin        = static_cast<T>( sin( lAngleToUse ) );
-
-
-   rVec4<T> lTemp;
-   lTemp.x = _axis.x * lSin;
-   lTemp.y = _axis.y * lSin;
-   lTemp.z = _axis.z * lSin;
-   lTemp.w = static_cast<T>( cos( lAngleToUse ) );
-
-   lTemp.normalize();
-
-   T x2 = lTemp.x * lTemp.x;
-   T y2 = lTemp.y * lTemp.y;
-   T z2 = lTemp.z * lTemp.z;
-   T xy = lTemp.x * lTemp.y;
-   T xz = lTemp.x * lTemp.z;
-   T yz = lTemp.y * lTemp.z;
-   T wx = lTemp.w * lTemp.x;
-   T wy = lTemp.w * lTemp.y;
-   T wz = lTemp.w * lTemp.z;
-
-   _out.template get<0, 0>() = 1 - 2 * y2 - 2 * z2;
-   _out.template get<1, 0>() = 2 * xy - 2 * wz;
-   _out.template get<2, 0>() = 2 * xz + 2 * wy;
-   _out.template get<3, 0>() = 0;
-
-   _out.template get<0, 1>() = 2 * xy + 2 * wz;
-   _out.template get<1, 1>() = 1 - 2 * x2 - 2 * z2;
-   _out.template get<2, 1>() = 2 * yz + 2 * wx;
-   _out.template get<3, 1>() = 0;
-
-   _out.template get<0, 2>() = 2 * xz - 2 * wy;
-   _out.template get<1, 2>() = 2 * yz - 2 * wx;
-   _out.template get<2, 2>() = 1 - 2 * x2 - 2 * y2;
-   _out.template get<3, 2>() = 0;
-
-   _out.template get<0, 3>() = 0;
-   _out.template get<1, 3>() = 0;
-   _out.template get<2, 3>() = 0;
-   _out.template get<3, 3>() = 1;
+   rQuat<T>::fromAxisAngle( _axis, _angle ).toMatrix( _out );
 }
 
 template <class T>
 void rMatrixMath::perspective( T _aspectRatio, T _nearZ, T _farZ, T _fofy, rMat4<T> &_out ) {
    T f = static_cast<T>( 1.0 / tan( static_cast<double>( DEG_TO_RAD( _fofy / 2 ) ) ) );
+   perspectiveFocal( _aspectRatio, _nearZ, _farZ, f, _out );
+}
 
+/*!
+ * \brief Perspective projection for a precomputed focal length (1 / tan( fofy / 2 ))
+ *
+ * Same as perspective, but without tan, so it can be used for compile time projection presets.
+ */
+template <class T>
+constexpr void rMatrixMath::perspectiveFocal(
+      T _aspectRatio, T _nearZ, T _farZ, T _focal, rMat4<T> &_out ) {
    _out.fill( 0 );
-   _out.template get<0, 0>() = f / _aspectRatio;
-   _out.template get<1, 1>() = f;
+   _out.template get<0, 0>() = _focal / _aspectRatio;
+   _out.template get<1, 1>() = _focal;
    _out.template get<2, 2>() = ( _farZ + _nearZ ) / ( _nearZ - _farZ );
    _out.template get<3, 2>() = ( 2 * _farZ * _nearZ ) / ( _nearZ - _farZ );
    _out.template get<2, 3>() = -1;
@@ -183,6 +196,30 @@ void rMatrixMath::camera( const rVec3<T> &_position,
    _out.template get<3, 2>() = rVectorMath::dotProduct( f, _position );
 }
 
+/*!
+ * \brief Inverse of a 4x4 matrix
+ * \returns false (and leaves _out unchanged) if the matrix is singular
+ * \note _in and _out may be the same matrix
+ */
+template <class T>
+bool rMatrixMath::inverse( rMat4<T> const &_in, rMat4<T> &_out ) {
+   return internal::rMatrixInverse<T>::general( &_in[0], _out.getMatrix() );
+}
+
+/*!
+ * \brief Inverse of a rotation * scale + translation matrix (orthogonal columns, last row 0 0 0 1)
+ *
+ * Much cheaper than inverse (transpose instead of cofactors), but the result is wrong for matrices
+ * with shearing or a projection part.
+ *
+ * \returns false (and leaves _out unchanged) if one of the axes is scaled to 0
+ * \note _in and _out may be the same matrix
+ */
+template <class T>
+bool rMatrixMath::affineInverse( rMat4<T> const &_in, rMat4<T> &_out ) {
+   return internal::rMatrixInverse<T>::affine( &_in[0], _out.getMatrix() );
+}
+
 
 template <class T>
 void rMatrixMath::getNormalMatrix( rMat4<T> const &_in, rMat3<T> &_out ) {
@@ -221,6 +258,22 @@ void rMatrixMath::getNormalMatrix( rMat3<T> const &_in, rMat3<T> &_out ) {
                                   _in.template get<1, 0>() * _in.template get<0, 1>() );
    _out /= lDeterminante;
 }
+
+/*!
+ * \brief Normal matrix of a rigid transformation with a uniform scale
+ *
+ * For M = R * s (R orthonormal) the inverse transpose is R / s = M / s^2, so no inverse is needed.
+ * Only use this if the matrix really has no non uniform scale or shearing (for instance view *
+ * model with a rigid view matrix and a model with scale.x == scale.y == scale.z).
+ *
+ * \param[in] _in           The (model view) matrix
+ * \param[in] _uniformScale The scale of the matrix
+ */
+template <class T>
+void rMatrixMath::getNormalMatrix( rMat4<T> const &_in, T _uniformScale, rMat3<T> &_out ) {
+   _in.downscale( &_out );
+   _out *= 1 / ( _uniformScale * _uniformScale );
+}
 }
 
 
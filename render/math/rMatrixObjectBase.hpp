@@ -23,6 +23,7 @@
 #include "defines.hpp"
 
 #include "rMatrixSceneBase.hpp"
+#include <atomic>
 #include <mutex>
 
 namespace e_engine {
@@ -30,18 +31,65 @@ namespace e_engine {
 /*!
  * \brief Class for managing Camera space matrix
  *
+ * The setters only update the scale / rotation / translation matrix and mark the derived matrices
+ * as dirty. A derived matrix is recomputed when its getter is called (or on updateFinalMatrix), so
+ * several setter calls in one frame cost one update. Changes of the scene view / projection matrix
+ * are detected with rMatrixSceneBase::getMatrixVersion.
  *
+ * With setParentMatrix the model matrix is placed relative to a parent (world = parent * local),
+ * for instance the world matrix of a rTransformGraph node (see rSceneBase::attachObject).
+ *
+ * The first change after updateFinalMatrix calls matricesChanged, so an owner (see
+ * rSceneBase::updateMatrices) only has to publish the changed objects.
+ *
+ * The render thread does not use these getters (and vMatrixAccess). updateFinalMatrix publishes a
+ * snapshot of all matrices into a triple buffer. The render thread takes the newest published
+ * snapshot once per frame with latchRenderMatrices and reads it with getRenderMatrices, both
+ * without locking, so the game logic never waits for the renderer and vice versa.
  */
 template <class T>
 class rMatrixObjectBase {
+ public:
+   //! Snapshot of the matrices for the render thread
+   struct RENDER_MATRICES {
+      rMat4<T> model;
+      rMat4<T> modelView;
+      rMat4<T> modelViewProjection;
+      rMat4<T> viewProjection;
+      rMat3<T> normal;
+      rVec3<T> positionModelView;
+   };
+
  private:
+   enum DIRTY_FLAGS : uint32_t {
+      DIRTY_MODEL      = 1,
+      DIRTY_MODEL_VIEW = 2, //!< Model view matrix and position in model view space
+      DIRTY_MVP        = 4,
+      DIRTY_NORMAL     = 8,
+      DIRTY_RENDER     = 16, //!< The render snapshot is outdated (cleared by updateFinalMatrix)
+
+      DIRTY_SCENE = DIRTY_MODEL_VIEW | DIRTY_MVP | DIRTY_NORMAL | DIRTY_RENDER,
+      DIRTY_ALL   = DIRTY_MODEL | DIRTY_SCENE,
+   };
+
+   //! Local matrices that were possibly modified directly (not built by their setter)
+   enum EDITED_FLAGS : uint32_t {
+      EDITED_SCALE       = 1,
+      EDITED_ROTATION    = 2,
+      EDITED_TRANSLATION = 4,
+
+      EDITED_ALL = EDITED_SCALE | EDITED_ROTATION | EDITED_TRANSLATION,
+   };
+
    rMat4<T> vScaleMatrix_MAT;
    rMat4<T> vRotationMatrix_MAT;
    rMat4<T> vTranslationMatrix_MAT;
+   rMat4<T> vParentMatrix_MAT;
 
-   rMat4<T> *vViewProjectionMatrix_MAT;
-   rMat4<T> *vViewMatrix_MAT;
-   rMat4<T> *vProjectionMatrix_MAT;
+   rMatrixSceneBase<T> *vScene;
+   rMat4<T> *           vViewProjectionMatrix_MAT;
+   rMat4<T> *           vViewMatrix_MAT;
+   rMat4<T> *           vProjectionMatrix_MAT;
 
    rMat4<T> vModelMatrix_MAT;
    rMat4<T> vModelViewMatrix_MAT;
@@ -52,22 +100,49 @@ class rMatrixObjectBase {
    rVec3<T> vPosition;
    rVec3<T> vPositionModelView;
    rVec3<T> vScale;
+   rQuat<T> vRotation;
+
+   bool     vHasParent_B  = false;
+   uint32_t vDirty        = DIRTY_ALL;
+   uint32_t vEdited       = 0;
+   uint64_t vSceneVersion = 0; //!< The scene matrix version the matrices were computed with
+
+   static const uint32_t RENDER_NEW_BIT = 4; //!< Set in vRenderMiddle when it was not read yet
+
+   RENDER_MATRICES       vRenderMatrices[3];
+   std::atomic<uint32_t> vRenderMiddle; //!< Last published, not yet read snapshot (+ NEW bit)
+   uint32_t              vRenderWrite = 0; //!< Owned by updateFinalMatrix (under vMatrixAccess)
+   uint32_t              vRenderRead  = 2; //!< Latched snapshot, owned by the render thread
 
    rMatrixObjectBase();
 
+   inline void markDirty();
+   inline void checkScene();
+   inline void updateModel();
+   inline void updateModelView();
+   inline void updateMVP();
+   inline void updateNormal();
+
  protected:
    std::recursive_mutex vMatrixAccess;
 
+   //! Called (under vMatrixAccess) when the published matrices become outdated
+   virtual void matricesChanged() {}
+
  public:
    rMatrixObjectBase( rMatrixSceneBase<T> *_scene );
+   virtual ~rMatrixObjectBase() {}
 
    inline void setPosition( const rVec3<T> &_pos );
    inline void getPosition( rVec3<T> &_pos );
    inline rVec3<T> *getPosition() { return &vPosition; }
-   inline rVec3<T> *getPositionModelView() { return &vPositionModelView; }
+   inline rVec3<T> *getPositionModelView();
    inline void addPositionDelta( const rVec3<T> &_pos );
 
    inline void setRotation( const rVec3<T> &_axis, T _angle );
+   inline void setRotation( const rQuat<T> &_rotation );
+   inline rQuat<T> const *getRotation() { return &vRotation; }
+   inline void addRotationDelta( const rQuat<T> &_rotation );
 
    inline void setScale( T _scale );
    inline void setScale( const rVec3<T> &_scale );
@@ -79,36 +154,50 @@ class rMatrixObjectBase {
    inline rMat4<T> *getRotationMatrix() { return &vRotationMatrix_MAT; }
    inline rMat4<T> *getTranslationMatrix() { return &vTranslationMatrix_MAT; }
 
-   inline rMat4<T> *getModelMatrix() { return &vModelMatrix_MAT; }
-   inline rMat4<T> *getModelViewMatrix() { return &vModelViewMatrix_MAT; }
+   inline void setParentMatrix( rMat4<T> const &_parent );
+   inline void clearParentMatrix();
+
+   inline rMat4<T> *getModelMatrix();
+   inline void getModelMatrix( rMat4<T> &_model );
+   inline rMat4<T> *getModelViewMatrix();
    inline rMat4<T> *getViewMatrix() { return vViewMatrix_MAT; }
 
    inline rMat4<T> *getProjectionMatrix() { return vProjectionMatrix_MAT; }
    inline rMat4<T> *getViewProjectionMatrix() { return vViewProjectionMatrix_MAT; }
-   inline rMat4<T> *getModelViewProjectionMatrix() { return &vModelViewProjectionMatrix_MAT; }
+   inline rMat4<T> *getModelViewProjectionMatrix();
 
-   inline rMat3<T> *getNormalMatrix() { return &vNormalMatrix; }
+   inline rMat3<T> *getNormalMatrix();
 
+   inline void invalidate();
    inline void updateFinalMatrix();
+
+   inline RENDER_MATRICES const *latchRenderMatrices();
+
+   //! Returns the snapshot of the last latchRenderMatrices (render thread only)
+   inline RENDER_MATRICES const *getRenderMatrices() const { return &vRenderMatrices[vRenderRead]; }
 };
 
 template <class T>
-rMatrixObjectBase<T>::rMatrixObjectBase( rMatrixSceneBase<T> *_scene ) {
-   vScaleMatrix_MAT.toIdentityMatrix();
-   vRotationMatrix_MAT.toIdentityMatrix();
-   vTranslationMatrix_MAT.toIdentityMatrix();
-   vModelViewMatrix_MAT.toIdentityMatrix();
-
+rMatrixObjectBase<T>::rMatrixObjectBase( rMatrixSceneBase<T> *_scene )
+    : vScaleMatrix_MAT( rMatrixMath::identity<T>() ),
+      vRotationMatrix_MAT( rMatrixMath::identity<T>() ),
+      vTranslationMatrix_MAT( rMatrixMath::identity<T>() ),
+      vParentMatrix_MAT( rMatrixMath::identity<T>() ),
+      vScene( _scene ),
+      vModelMatrix_MAT( rMatrixMath::identity<T>() ),
+      vModelViewMatrix_MAT( rMatrixMath::identity<T>() ),
+      vModelViewProjectionMatrix_MAT( rMatrixMath::identity<T>() ),
+      vNormalMatrix( rMatrixMath::identity<T, 3>() ),
+      vPosition( static_cast<T>( 0 ) ),
+      vScale( static_cast<T>( 1 ) ),
+      vRenderMiddle( 1 ) {
    vViewProjectionMatrix_MAT = _scene->getViewProjectionMatrix();
    vViewMatrix_MAT           = _scene->getViewMatrix();
    vProjectionMatrix_MAT     = _scene->getProjectionMatrix();
 
-   vModelMatrix_MAT = vTranslationMatrix_MAT * vRotationMatrix_MAT * vScaleMatrix_MAT;
-
-   if ( vViewProjectionMatrix_MAT )
-      vModelViewProjectionMatrix_MAT = *vViewProjectionMatrix_MAT * vModelMatrix_MAT;
-   else
-      vModelViewProjectionMatrix_MAT.toIdentityMatrix();
+   // Make sure there is always a valid snapshot for the renderer
+   updateFinalMatrix();
+   latchRenderMatrices();
 }
 
 template <class T>
@@ -118,7 +207,8 @@ void rMatrixObjectBase<T>::setScale( T _scale ) {
 
    vScaleMatrix_MAT.setMat( _scale, 0, 0, 0, 0, _scale, 0, 0, 0, 0, _scale, 0, 0, 0, 0, 1 );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_SCALE );
+   markDirty();
 }
 
 template <class T>
@@ -128,7 +218,8 @@ void rMatrixObjectBase<T>::setScale( const rVec3<T> &_scale ) {
 
    vScaleMatrix_MAT.setMat( _scale.x, 0, 0, 0, 0, _scale.y, 0, 0, 0, 0, _scale.z, 0, 0, 0, 0, 1 );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_SCALE );
+   markDirty();
 }
 
 
@@ -139,15 +230,37 @@ void rMatrixObjectBase<T>::addScaleDelta( const rVec3<T> &_scale ) {
 
    vScaleMatrix_MAT.setMat( vScale.x, 0, 0, 0, 0, vScale.y, 0, 0, 0, 0, vScale.z, 0, 0, 0, 0, 1 );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_SCALE );
+   markDirty();
 }
 
 template <class T>
 void rMatrixObjectBase<T>::setRotation( const rVec3<T> &_axis, T _angle ) {
+   setRotation( rQuat<T>::fromAxisAngle( _axis, _angle ) );
+}
+
+template <class T>
+void rMatrixObjectBase<T>::setRotation( const rQuat<T> &_rotation ) {
    std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
-   rMatrixMath::rotate( _axis, _angle, vRotationMatrix_MAT );
+   vRotation = _rotation;
+   vRotation.toMatrix( vRotationMatrix_MAT );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_ROTATION );
+   markDirty();
+}
+
+/*!
+ * \brief Rotates the object further by _rotation (applied after the current rotation)
+ */
+template <class T>
+void rMatrixObjectBase<T>::addRotationDelta( const rQuat<T> &_rotation ) {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   vRotation = _rotation * vRotation;
+   vRotation.normalize(); // Keep rounding errors from adding up
+   vRotation.toMatrix( vRotationMatrix_MAT );
+
+   vEdited &= ~static_cast<uint32_t>( EDITED_ROTATION );
+   markDirty();
 }
 
 
@@ -158,7 +271,8 @@ void rMatrixObjectBase<T>::setPosition( const rVec3<T> &_pos ) {
 
    vTranslationMatrix_MAT.setMat( 1, 0, 0, _pos.x, 0, 1, 0, _pos.y, 0, 0, 1, _pos.z, 0, 0, 0, 1 );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_TRANSLATION );
+   markDirty();
 }
 
 
@@ -170,27 +284,252 @@ void rMatrixObjectBase<T>::addPositionDelta( const rVec3<T> &_pos ) {
    vTranslationMatrix_MAT.setMat(
          1, 0, 0, vPosition.x, 0, 1, 0, vPosition.y, 0, 0, 1, vPosition.z, 0, 0, 0, 1 );
 
-   updateFinalMatrix();
+   vEdited &= ~static_cast<uint32_t>( EDITED_TRANSLATION );
+   markDirty();
+}
+
+
+/*!
+ * \brief Places the object relative to a parent (model matrix = _parent * local)
+ */
+template <class T>
+void rMatrixObjectBase<T>::setParentMatrix( rMat4<T> const &_parent ) {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   vParentMatrix_MAT = _parent;
+   vHasParent_B      = true;
+
+   markDirty();
+}
+
+template <class T>
+void rMatrixObjectBase<T>::clearParentMatrix() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   if ( !vHasParent_B )
+      return;
+
+   vHasParent_B = false;
+   markDirty();
+}
+
+
+//  _____      _   _
+// |  __ \    | | | |
+// | |  \/ ___| |_| |_ ___ _ __ ___
+// | | __ / _ \ __| __/ _ \ '__/ __|
+// | |_\ \  __/ |_| ||  __/ |  \__ \
+//  \____/\___|\__|\__\___|_|  |___/
+//
+
+template <class T>
+rVec3<T> *rMatrixObjectBase<T>::getPositionModelView() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   checkScene();
+   updateModelView();
+   return &vPositionModelView;
+}
+
+template <class T>
+rMat4<T> *rMatrixObjectBase<T>::getModelMatrix() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   updateModel();
+   return &vModelMatrix_MAT;
+}
+
+/*!
+ * \brief Copies the model matrix (under the lock, so other threads can use it safely)
+ */
+template <class T>
+void rMatrixObjectBase<T>::getModelMatrix( rMat4<T> &_model ) {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   updateModel();
+   _model = vModelMatrix_MAT;
+}
+
+template <class T>
+rMat4<T> *rMatrixObjectBase<T>::getModelViewMatrix() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   checkScene();
+   updateModelView();
+   return &vModelViewMatrix_MAT;
+}
+
+template <class T>
+rMat4<T> *rMatrixObjectBase<T>::getModelViewProjectionMatrix() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   checkScene();
+   updateMVP();
+   return &vModelViewProjectionMatrix_MAT;
+}
+
+template <class T>
+rMat3<T> *rMatrixObjectBase<T>::getNormalMatrix() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   checkScene();
+   updateNormal();
+   return &vNormalMatrix;
 }
 
+/*!
+ * \brief Marks all matrices dirty
+ *
+ * Required after modifying the matrices from getScaleMatrix / getRotationMatrix /
+ * getTranslationMatrix directly (the setters do this on their own). The normal matrix is then
+ * calculated with the general inverse until the setters have built all three matrices again.
+ */
+template <class T>
+void rMatrixObjectBase<T>::invalidate() {
+   std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
+   vEdited = EDITED_ALL;
+   markDirty();
+}
 
+/*!
+ * \brief Updates the dirty matrices and publishes them for the render thread
+ *
+ * Call this once per frame (from the game logic) after changing the object or the camera. The
+ * renderer only sees the changes after this function. Nothing is done when neither the object nor
+ * the camera changed since the last call.
+ */
 template <class T>
 void rMatrixObjectBase<T>::updateFinalMatrix() {
    std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
-   vModelMatrix_MAT = vTranslationMatrix_MAT * vRotationMatrix_MAT * vScaleMatrix_MAT;
+   checkScene();
+
+   if ( !( vDirty & DIRTY_RENDER ) )
+      return;
+
+   updateMVP();
+   updateNormal();
+
+   RENDER_MATRICES &lSnap = vRenderMatrices[vRenderWrite];
+
+   lSnap.model               = vModelMatrix_MAT;
+   lSnap.modelView           = vModelViewMatrix_MAT;
+   lSnap.modelViewProjection = vModelViewProjectionMatrix_MAT;
+   lSnap.viewProjection      = *vViewProjectionMatrix_MAT;
+   lSnap.normal              = vNormalMatrix;
+   lSnap.positionModelView   = vPositionModelView;
 
-   if ( vViewProjectionMatrix_MAT )
-      vModelViewProjectionMatrix_MAT = *vViewProjectionMatrix_MAT * vModelMatrix_MAT;
+   // Swap the written snapshot with the middle one; the old middle is free to write next time
+   uint32_t lOld = vRenderMiddle.exchange( vRenderWrite | RENDER_NEW_BIT,
+                                           std::memory_order_acq_rel );
+   vRenderWrite = lOld & ~RENDER_NEW_BIT;
 
-   if ( vViewMatrix_MAT ) {
-      vModelViewMatrix_MAT = *vViewMatrix_MAT * vModelMatrix_MAT;
+   vDirty &= ~static_cast<uint32_t>( DIRTY_RENDER );
+}
 
-      rVec4<T> lTemp( 0, 0, 0, 1 );
-      lTemp = vModelViewMatrix_MAT * lTemp;
-      lTemp.downscale( &vPositionModelView );
+/*!
+ * \brief Latches the newest snapshot published with updateFinalMatrix (lock free)
+ *
+ * The snapshot stays valid and unchanged until the next call of this function, getRenderMatrices
+ * returns it until then. Call this once per frame, so that culling, the push constants and the
+ * uniforms of one frame all use the same snapshot.
+ *
+ * \warning Must only be called from ONE thread (the render thread)
+ */
+template <class T>
+typename rMatrixObjectBase<T>::RENDER_MATRICES const *rMatrixObjectBase<T>::latchRenderMatrices() {
+   if ( vRenderMiddle.load( std::memory_order_relaxed ) & RENDER_NEW_BIT ) {
+      uint32_t lOld = vRenderMiddle.exchange( vRenderRead, std::memory_order_acq_rel );
+      vRenderRead   = lOld & ~RENDER_NEW_BIT;
    }
 
-   rMatrixMath::getNormalMatrix( vModelViewMatrix_MAT, vNormalMatrix );
+   return &vRenderMatrices[vRenderRead];
+}
+
+
+//  _   _           _       _
+// | | | |         | |     | |
+// | | | |_ __   __| | __ _| |_ ___
+// | | | | '_ \ / _` |/ _` | __/ _ \
+// | |_| | |_) | (_| | (_| | ||  __/
+//  \___/| .__/ \__,_|\__,_|\__\___|
+//       | |
+//       |_|
+
+//! Marks all matrices dirty (and reports the first change after updateFinalMatrix)
+template <class T>
+void rMatrixObjectBase<T>::markDirty() {
+   bool lWasPublished = !( vDirty & DIRTY_RENDER );
+   vDirty             = DIRTY_ALL;
+
+   if ( lWasPublished )
+      matricesChanged();
+}
+
+//! Marks the scene dependent matrices dirty when the view / projection matrix changed
+template <class T>
+void rMatrixObjectBase<T>::checkScene() {
+   uint64_t lVersion = vScene->getMatrixVersion();
+   if ( lVersion != vSceneVersion ) {
+      vSceneVersion = lVersion;
+      vDirty |= DIRTY_SCENE;
+   }
+}
+
+template <class T>
+void rMatrixObjectBase<T>::updateModel() {
+   if ( !( vDirty & DIRTY_MODEL ) )
+      return;
+
+   // Multiply directly into the members (no temporaries from operator*)
+   rMat4<T> lTranslationRotation;
+   vTranslationMatrix_MAT.multiply( vRotationMatrix_MAT, &lTranslationRotation );
+
+   if ( vHasParent_B ) {
+      rMat4<T> lLocal;
+      lTranslationRotation.multiply( vScaleMatrix_MAT, &lLocal );
+      vParentMatrix_MAT.multiply( lLocal, &vModelMatrix_MAT );
+   } else {
+      lTranslationRotation.multiply( vScaleMatrix_MAT, &vModelMatrix_MAT );
+   }
+
+   vDirty &= ~static_cast<uint32_t>( DIRTY_MODEL );
+}
+
+template <class T>
+void rMatrixObjectBase<T>::updateModelView() {
+   if ( !( vDirty & DIRTY_MODEL_VIEW ) )
+      return;
+
+   updateModel();
+   vViewMatrix_MAT->multiply( vModelMatrix_MAT, &vModelViewMatrix_MAT );
+
+   // The position in model view space is the translation column
+   vPositionModelView.x = vModelViewMatrix_MAT.template get<3, 0>();
+   vPositionModelView.y = vModelViewMatrix_MAT.template get<3, 1>();
+   vPositionModelView.z = vModelViewMatrix_MAT.template get<3, 2>();
+
+   vDirty &= ~static_cast<uint32_t>( DIRTY_MODEL_VIEW );
+}
+
+template <class T>
+void rMatrixObjectBase<T>::updateMVP() {
+   if ( !( vDirty & DIRTY_MVP ) )
+      return;
+
+   updateModel();
+   vViewProjectionMatrix_MAT->multiply( vModelMatrix_MAT, &vModelViewProjectionMatrix_MAT );
+
+   vDirty &= ~static_cast<uint32_t>( DIRTY_MVP );
+}
+
+template <class T>
+void rMatrixObjectBase<T>::updateNormal() {
+   if ( !( vDirty & DIRTY_NORMAL ) )
+      return;
+
+   updateModelView();
+
+   // The view matrix is rigid (camera), so with a uniform scale no inverse is needed. This only
+   // holds if the model matrix is exactly T * R * S from the setters (no parent, no direct edits)
+   bool lUniform = vScale.x == vScale.y && vScale.y == vScale.z && vScale.x != 0;
+   if ( lUniform && !vHasParent_B && vEdited == 0 )
+      rMatrixMath::getNormalMatrix( vModelViewMatrix_MAT, vScale.x, vNormalMatrix );
+   else
+      rMatrixMath::getNormalMatrix( vModelViewMatrix_MAT, vNormalMatrix );
+
+   vDirty &= ~static_cast<uint32_t>( DIRTY_NORMAL );
 }
 }
 
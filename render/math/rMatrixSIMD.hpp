@@ -0,0 +1,655 @@
+/*!
+ * \file rMatrixSIMD.hpp
+ * \brief \b Classes: \a rMatrixKernels
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include <stdint.h>
+
+// Define R_MATRIX_NO_SIMD to force the scalar kernels
+#if !defined( R_MATRIX_NO_SIMD ) &&                                                                \
+      ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define R_MATRIX_SSE 1
+#include <emmintrin.h>
+#else
+#define R_MATRIX_SSE 0
+#endif
+
+#if R_MATRIX_SSE && defined( __AVX__ )
+#define R_MATRIX_AVX 1
+#include <immintrin.h>
+#else
+#define R_MATRIX_AVX 0
+#endif
+
+namespace e_engine {
+
+namespace internal {
+
+/*!
+ * \brief Kernels for column major 4x4 matrices (16 values) used by rMatrix
+ *
+ * The generic version is plain C++ and works for every type. float and double have SSE
+ * specializations (AVX for double when the compiler targets AVX). The instruction set is selected
+ * at compile time: SSE2 is always there on x86-64, so a runtime check would only cost an indirect
+ * call per matrix.
+ *
+ * All versions do the same operations in the same order (no horizontal adds, no FMA), so they
+ * produce bit identical results. The output may alias the inputs.
+ *
+ * Only unaligned loads / stores are used: rMatrix<T, 4, 4> is aligned, but C++14 operator new does
+ * not honor alignments above 16 bytes. On aligned addresses they are as fast as aligned loads.
+ */
+template <class T>
+struct rMatrixKernels {
+   static inline void multiply( T const *_a, T const *_b, T *_out );
+   static inline void transform( T const *_m, T const *_v, T *_out );
+   static inline void transpose( T const *_m, T *_out );
+   static inline void add( T const *_a, T const *_b, T *_out );
+   static inline void subtract( T const *_a, T const *_b, T *_out );
+   static inline void scale( T const *_a, T _s, T *_out );
+   static inline void copy( T const *_a, T *_out );
+};
+
+template <class T>
+void rMatrixKernels<T>::multiply( T const *_a, T const *_b, T *_out ) {
+   T lOut[16];
+
+   for ( uint32_t i = 0; i < 4; ++i ) {
+      T const *lB = _b + i * 4;
+      for ( uint32_t j = 0; j < 4; ++j )
+         lOut[i * 4 + j] =
+               _a[j] * lB[0] + _a[4 + j] * lB[1] + _a[8 + j] * lB[2] + _a[12 + j] * lB[3];
+   }
+
+   copy( lOut, _out );
+}
+
+template <class T>
+void rMatrixKernels<T>::transform( T const *_m, T const *_v, T *_out ) {
+   T lOut[4];
+
+   for ( uint32_t j = 0; j < 4; ++j )
+      lOut[j] = _m[j] * _v[0] + _m[4 + j] * _v[1] + _m[8 + j] * _v[2] + _m[12 + j] * _v[3];
+
+   for ( uint32_t j = 0; j < 4; ++j )
+      _out[j] = lOut[j];
+}
+
+template <class T>
+void rMatrixKernels<T>::transpose( T const *_m, T *_out ) {
+   T lOut[16];
+
+   for ( uint32_t i = 0; i < 4; ++i )
+      for ( uint32_t j = 0; j < 4; ++j )
+         lOut[j * 4 + i] = _m[i * 4 + j];
+
+   copy( lOut, _out );
+}
+
+template <class T>
+void rMatrixKernels<T>::add( T const *_a, T const *_b, T *_out ) {
+   for ( uint32_t i = 0; i < 16; ++i )
+      _out[i] = _a[i] + _b[i];
+}
+
+template <class T>
+void rMatrixKernels<T>::subtract( T const *_a, T const *_b, T *_out ) {
+   for ( uint32_t i = 0; i < 16; ++i )
+      _out[i] = _a[i] - _b[i];
+}
+
+template <class T>
+void rMatrixKernels<T>::scale( T const *_a, T _s, T *_out ) {
+   for ( uint32_t i = 0; i < 16; ++i )
+      _out[i] = _a[i] * _s;
+}
+
+template <class T>
+void rMatrixKernels<T>::copy( T const *_a, T *_out ) {
+   for ( uint32_t i = 0; i < 16; ++i )
+      _out[i] = _a[i];
+}
+
+
+#if R_MATRIX_SSE
+
+//  _____ _             _
+// |  ___| |           | |
+// | |_  | | ___   __ _| |_
+// |  _| | |/ _ \ / _` | __|
+// | |   | | (_) | (_| | |_
+// \_|   |_|\___/ \__,_|\__|
+//
+
+template <>
+struct rMatrixKernels<float> {
+   //! Column _a0.._a3 times the 4 values of _b (same order as the scalar version)
+   static inline __m128 column( __m128 _a0, __m128 _a1, __m128 _a2, __m128 _a3, float const *_b ) {
+      __m128 lR = _mm_mul_ps( _a0, _mm_set1_ps( _b[0] ) );
+      lR        = _mm_add_ps( lR, _mm_mul_ps( _a1, _mm_set1_ps( _b[1] ) ) );
+      lR        = _mm_add_ps( lR, _mm_mul_ps( _a2, _mm_set1_ps( _b[2] ) ) );
+      return _mm_add_ps( lR, _mm_mul_ps( _a3, _mm_set1_ps( _b[3] ) ) );
+   }
+
+   static inline void multiply( float const *_a, float const *_b, float *_out ) {
+      __m128 lA0 = _mm_loadu_ps( _a + 0 );
+      __m128 lA1 = _mm_loadu_ps( _a + 4 );
+      __m128 lA2 = _mm_loadu_ps( _a + 8 );
+      __m128 lA3 = _mm_loadu_ps( _a + 12 );
+
+      // Column i of the result only depends on column i of _b, so _out may alias _b
+      _mm_storeu_ps( _out + 0, column( lA0, lA1, lA2, lA3, _b + 0 ) );
+      _mm_storeu_ps( _out + 4, column( lA0, lA1, lA2, lA3, _b + 4 ) );
+      _mm_storeu_ps( _out + 8, column( lA0, lA1, lA2, lA3, _b + 8 ) );
+      _mm_storeu_ps( _out + 12, column( lA0, lA1, lA2, lA3, _b + 12 ) );
+   }
+
+   static inline void transform( float const *_m, float const *_v, float *_out ) {
+      __m128 lA0 = _mm_loadu_ps( _m + 0 );
+      __m128 lA1 = _mm_loadu_ps( _m + 4 );
+      __m128 lA2 = _mm_loadu_ps( _m + 8 );
+      __m128 lA3 = _mm_loadu_ps( _m + 12 );
+      _mm_storeu_ps( _out, column( lA0, lA1, lA2, lA3, _v ) );
+   }
+
+   static inline void transpose( float const *_m, float *_out ) {
+      __m128 lC0 = _mm_loadu_ps( _m + 0 );
+      __m128 lC1 = _mm_loadu_ps( _m + 4 );
+      __m128 lC2 = _mm_loadu_ps( _m + 8 );
+      __m128 lC3 = _mm_loadu_ps( _m + 12 );
+      _MM_TRANSPOSE4_PS( lC0, lC1, lC2, lC3 );
+      _mm_storeu_ps( _out + 0, lC0 );
+      _mm_storeu_ps( _out + 4, lC1 );
+      _mm_storeu_ps( _out + 8, lC2 );
+      _mm_storeu_ps( _out + 12, lC3 );
+   }
+
+   static inline void add( float const *_a, float const *_b, float *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm_storeu_ps( _out + i, _mm_add_ps( _mm_loadu_ps( _a + i ), _mm_loadu_ps( _b + i ) ) );
+   }
+
+   static inline void subtract( float const *_a, float const *_b, float *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm_storeu_ps( _out + i, _mm_sub_ps( _mm_loadu_ps( _a + i ), _mm_loadu_ps( _b + i ) ) );
+   }
+
+   static inline void scale( float const *_a, float _s, float *_out ) {
+      __m128 lS = _mm_set1_ps( _s );
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm_storeu_ps( _out + i, _mm_mul_ps( _mm_loadu_ps( _a + i ), lS ) );
+   }
+
+   static inline void copy( float const *_a, float *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm_storeu_ps( _out + i, _mm_loadu_ps( _a + i ) );
+   }
+};
+
+
+//  ______             _     _
+//  |  _  \           | |   | |
+//  | | | |___  _   _| |__ | | ___
+//  | | | / _ \| | | | '_ \| |/ _ \
+//  | |/ / (_) | |_| | |_) | |  __/
+//  |___/ \___/ \__,_|_.__/|_|\___|
+//
+
+#if R_MATRIX_AVX
+
+template <>
+struct rMatrixKernels<double> {
+   static inline __m256d column(
+         __m256d _a0, __m256d _a1, __m256d _a2, __m256d _a3, double const *_b ) {
+      __m256d lR = _mm256_mul_pd( _a0, _mm256_set1_pd( _b[0] ) );
+      lR         = _mm256_add_pd( lR, _mm256_mul_pd( _a1, _mm256_set1_pd( _b[1] ) ) );
+      lR         = _mm256_add_pd( lR, _mm256_mul_pd( _a2, _mm256_set1_pd( _b[2] ) ) );
+      return _mm256_add_pd( lR, _mm256_mul_pd( _a3, _mm256_set1_pd( _b[3] ) ) );
+   }
+
+   static inline void multiply( double const *_a, double const *_b, double *_out ) {
+      __m256d lA0 = _mm256_loadu_pd( _a + 0 );
+      __m256d lA1 = _mm256_loadu_pd( _a + 4 );
+      __m256d lA2 = _mm256_loadu_pd( _a + 8 );
+      __m256d lA3 = _mm256_loadu_pd( _a + 12 );
+
+      _mm256_storeu_pd( _out + 0, column( lA0, lA1, lA2, lA3, _b + 0 ) );
+      _mm256_storeu_pd( _out + 4, column( lA0, lA1, lA2, lA3, _b + 4 ) );
+      _mm256_storeu_pd( _out + 8, column( lA0, lA1, lA2, lA3, _b + 8 ) );
+      _mm256_storeu_pd( _out + 12, column( lA0, lA1, lA2, lA3, _b + 12 ) );
+   }
+
+   static inline void transform( double const *_m, double const *_v, double *_out ) {
+      __m256d lA0 = _mm256_loadu_pd( _m + 0 );
+      __m256d lA1 = _mm256_loadu_pd( _m + 4 );
+      __m256d lA2 = _mm256_loadu_pd( _m + 8 );
+      __m256d lA3 = _mm256_loadu_pd( _m + 12 );
+      _mm256_storeu_pd( _out, column( lA0, lA1, lA2, lA3, _v ) );
+   }
+
+   static inline void transpose( double const *_m, double *_out ) {
+      __m256d lC0 = _mm256_loadu_pd( _m + 0 );  // 00 01 02 03
+      __m256d lC1 = _mm256_loadu_pd( _m + 4 );  // 10 11 12 13
+      __m256d lC2 = _mm256_loadu_pd( _m + 8 );  // 20 21 22 23
+      __m256d lC3 = _mm256_loadu_pd( _m + 12 ); // 30 31 32 33
+
+      __m256d lT0 = _mm256_unpacklo_pd( lC0, lC1 ); // 00 10 02 12
+      __m256d lT1 = _mm256_unpackhi_pd( lC0, lC1 ); // 01 11 03 13
+      __m256d lT2 = _mm256_unpacklo_pd( lC2, lC3 ); // 20 30 22 32
+      __m256d lT3 = _mm256_unpackhi_pd( lC2, lC3 ); // 21 31 23 33
+
+      _mm256_storeu_pd( _out + 0, _mm256_permute2f128_pd( lT0, lT2, 0x20 ) );
+      _mm256_storeu_pd( _out + 4, _mm256_permute2f128_pd( lT1, lT3, 0x20 ) );
+      _mm256_storeu_pd( _out + 8, _mm256_permute2f128_pd( lT0, lT2, 0x31 ) );
+      _mm256_storeu_pd( _out + 12, _mm256_permute2f128_pd( lT1, lT3, 0x31 ) );
+   }
+
+   static inline void add( double const *_a, double const *_b, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm256_storeu_pd( _out + i,
+                           _mm256_add_pd( _mm256_loadu_pd( _a + i ), _mm256_loadu_pd( _b + i ) ) );
+   }
+
+   static inline void subtract( double const *_a, double const *_b, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm256_storeu_pd( _out + i,
+                           _mm256_sub_pd( _mm256_loadu_pd( _a + i ), _mm256_loadu_pd( _b + i ) ) );
+   }
+
+   static inline void scale( double const *_a, double _s, double *_out ) {
+      __m256d lS = _mm256_set1_pd( _s );
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm256_storeu_pd( _out + i, _mm256_mul_pd( _mm256_loadu_pd( _a + i ), lS ) );
+   }
+
+   static inline void copy( double const *_a, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 4 )
+         _mm256_storeu_pd( _out + i, _mm256_loadu_pd( _a + i ) );
+   }
+};
+
+#else // R_MATRIX_AVX
+
+template <>
+struct rMatrixKernels<double> {
+   //! One half (2 rows) of a column; _a0.._a3 are the same halves of the 4 columns of the matrix
+   static inline __m128d column(
+         __m128d _a0, __m128d _a1, __m128d _a2, __m128d _a3, double const *_b ) {
+      __m128d lR = _mm_mul_pd( _a0, _mm_set1_pd( _b[0] ) );
+      lR         = _mm_add_pd( lR, _mm_mul_pd( _a1, _mm_set1_pd( _b[1] ) ) );
+      lR         = _mm_add_pd( lR, _mm_mul_pd( _a2, _mm_set1_pd( _b[2] ) ) );
+      return _mm_add_pd( lR, _mm_mul_pd( _a3, _mm_set1_pd( _b[3] ) ) );
+   }
+
+   static inline void multiply( double const *_a, double const *_b, double *_out ) {
+      __m128d lLo0 = _mm_loadu_pd( _a + 0 );
+      __m128d lHi0 = _mm_loadu_pd( _a + 2 );
+      __m128d lLo1 = _mm_loadu_pd( _a + 4 );
+      __m128d lHi1 = _mm_loadu_pd( _a + 6 );
+      __m128d lLo2 = _mm_loadu_pd( _a + 8 );
+      __m128d lHi2 = _mm_loadu_pd( _a + 10 );
+      __m128d lLo3 = _mm_loadu_pd( _a + 12 );
+      __m128d lHi3 = _mm_loadu_pd( _a + 14 );
+
+      for ( uint32_t i = 0; i < 16; i += 4 ) {
+         __m128d lLo = column( lLo0, lLo1, lLo2, lLo3, _b + i );
+         __m128d lHi = column( lHi0, lHi1, lHi2, lHi3, _b + i );
+         _mm_storeu_pd( _out + i, lLo );
+         _mm_storeu_pd( _out + i + 2, lHi );
+      }
+   }
+
+   static inline void transform( double const *_m, double const *_v, double *_out ) {
+      __m128d lLo = column( _mm_loadu_pd( _m + 0 ),
+                            _mm_loadu_pd( _m + 4 ),
+                            _mm_loadu_pd( _m + 8 ),
+                            _mm_loadu_pd( _m + 12 ),
+                            _v );
+      __m128d lHi = column( _mm_loadu_pd( _m + 2 ),
+                            _mm_loadu_pd( _m + 6 ),
+                            _mm_loadu_pd( _m + 10 ),
+                            _mm_loadu_pd( _m + 14 ),
+                            _v );
+      _mm_storeu_pd( _out, lLo );
+      _mm_storeu_pd( _out + 2, lHi );
+   }
+
+   static inline void transpose( double const *_m, double *_out ) {
+      __m128d lC[8];
+      for ( uint32_t i = 0; i < 8; ++i )
+         lC[i] = _mm_loadu_pd( _m + i * 2 );
+
+      // lC[2 * c] = rows 0,1 of column c; lC[2 * c + 1] = rows 2,3 of column c
+      _mm_storeu_pd( _out + 0, _mm_unpacklo_pd( lC[0], lC[2] ) );
+      _mm_storeu_pd( _out + 2, _mm_unpacklo_pd( lC[4], lC[6] ) );
+      _mm_storeu_pd( _out + 4, _mm_unpackhi_pd( lC[0], lC[2] ) );
+      _mm_storeu_pd( _out + 6, _mm_unpackhi_pd( lC[4], lC[6] ) );
+      _mm_storeu_pd( _out + 8, _mm_unpacklo_pd( lC[1], lC[3] ) );
+      _mm_storeu_pd( _out + 10, _mm_unpacklo_pd( lC[5], lC[7] ) );
+      _mm_storeu_pd( _out + 12, _mm_unpackhi_pd( lC[1], lC[3] ) );
+      _mm_storeu_pd( _out + 14, _mm_unpackhi_pd( lC[5], lC[7] ) );
+   }
+
+   static inline void add( double const *_a, double const *_b, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 2 )
+         _mm_storeu_pd( _out + i, _mm_add_pd( _mm_loadu_pd( _a + i ), _mm_loadu_pd( _b + i ) ) );
+   }
+
+   static inline void subtract( double const *_a, double const *_b, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 2 )
+         _mm_storeu_pd( _out + i, _mm_sub_pd( _mm_loadu_pd( _a + i ), _mm_loadu_pd( _b + i ) ) );
+   }
+
+   static inline void scale( double const *_a, double _s, double *_out ) {
+      __m128d lS = _mm_set1_pd( _s );
+      for ( uint32_t i = 0; i < 16; i += 2 )
+         _mm_storeu_pd( _out + i, _mm_mul_pd( _mm_loadu_pd( _a + i ), lS ) );
+   }
+
+   static inline void copy( double const *_a, double *_out ) {
+      for ( uint32_t i = 0; i < 16; i += 2 )
+         _mm_storeu_pd( _out + i, _mm_loadu_pd( _a + i ) );
+   }
+};
+
+#endif // R_MATRIX_AVX
+#endif // R_MATRIX_SSE
+
+
+//  _____
+// |_   _|
+//   | | _ ____   _____ _ __ ___  ___
+//   | || '_ \ \ / / _ \ '__/ __|/ _ \
+//  _| || | | \ V /  __/ |  \__ \  __/
+//  \___/_| |_|\_/ \___|_|  |___/\___|
+//
+
+/*!
+ * \brief Inverse of column major 4x4 matrices (16 values)
+ *
+ * general uses the 2x2 block matrix method (block adjugates instead of a full cofactor expansion,
+ * one division). affine only works for matrices with orthogonal columns in the upper 3x3 part
+ * (rotation * scale + translation) and uses transpose(R) / scale^2 instead of a real inverse.
+ *
+ * Like rMatrixKernels, the SSE version (float) does the same operations in the same order as the
+ * generic version. Both return false (and do not touch _out) if the matrix is singular. The output
+ * may alias the input.
+ */
+template <class T>
+struct rMatrixInverse {
+   static inline bool general( T const *_m, T *_out );
+   static inline bool affine( T const *_m, T *_out );
+
+   // 2x2 matrices ( a, b, c, d ) --> | a b |
+   //                                 | c d |
+   static inline void mul2( T const *_a, T const *_b, T *_out );
+   static inline void adjMul2( T const *_a, T const *_b, T *_out );
+   static inline void mulAdj2( T const *_a, T const *_b, T *_out );
+};
+
+//! _a * _b
+template <class T>
+void rMatrixInverse<T>::mul2( T const *_a, T const *_b, T *_out ) {
+   _out[0] = _a[0] * _b[0] + _a[1] * _b[2];
+   _out[1] = _a[1] * _b[3] + _a[0] * _b[1];
+   _out[2] = _a[2] * _b[0] + _a[3] * _b[2];
+   _out[3] = _a[3] * _b[3] + _a[2] * _b[1];
+}
+
+//! adjugate( _a ) * _b
+template <class T>
+void rMatrixInverse<T>::adjMul2( T const *_a, T const *_b, T *_out ) {
+   _out[0] = _a[3] * _b[0] - _a[1] * _b[2];
+   _out[1] = _a[3] * _b[1] - _a[1] * _b[3];
+   _out[2] = _a[0] * _b[2] - _a[2] * _b[0];
+   _out[3] = _a[0] * _b[3] - _a[2] * _b[1];
+}
+
+//! _a * adjugate( _b )
+template <class T>
+void rMatrixInverse<T>::mulAdj2( T const *_a, T const *_b, T *_out ) {
+   _out[0] = _a[0] * _b[3] - _a[1] * _b[2];
+   _out[1] = _a[1] * _b[0] - _a[0] * _b[1];
+   _out[2] = _a[2] * _b[3] - _a[3] * _b[2];
+   _out[3] = _a[3] * _b[0] - _a[2] * _b[1];
+}
+
+template <class T>
+bool rMatrixInverse<T>::general( T const *_m, T *_out ) {
+   // Works on the transposed matrix (the columns are used as rows): inverse( M^T ) = inverse( M )^T
+   T lA[4] = {_m[0], _m[1], _m[4], _m[5]};
+   T lB[4] = {_m[2], _m[3], _m[6], _m[7]};
+   T lC[4] = {_m[8], _m[9], _m[12], _m[13]};
+   T lD[4] = {_m[10], _m[11], _m[14], _m[15]};
+
+   T lDetA = _m[0] * _m[5] - _m[1] * _m[4];
+   T lDetB = _m[2] * _m[7] - _m[3] * _m[6];
+   T lDetC = _m[8] * _m[13] - _m[9] * _m[12];
+   T lDetD = _m[10] * _m[15] - _m[11] * _m[14];
+
+   T lDC[4], lAB[4], lX[4], lY[4], lZ[4], lW[4], lTemp[4];
+   adjMul2( lD, lC, lDC );
+   adjMul2( lA, lB, lAB );
+
+   mul2( lB, lDC, lTemp );
+   for ( uint32_t i = 0; i < 4; ++i )
+      lX[i] = lDetD * lA[i] - lTemp[i];
+
+   mul2( lC, lAB, lTemp );
+   for ( uint32_t i = 0; i < 4; ++i )
+      lW[i] = lDetA * lD[i] - lTemp[i];
+
+   mulAdj2( lD, lAB, lTemp );
+   for ( uint32_t i = 0; i < 4; ++i )
+      lY[i] = lDetB * lC[i] - lTemp[i];
+
+   mulAdj2( lA, lDC, lTemp );
+   for ( uint32_t i = 0; i < 4; ++i )
+      lZ[i] = lDetC * lB[i] - lTemp[i];
+
+   T lTrace = ( lAB[0] * lDC[0] + lAB[1] * lDC[2] ) + ( lAB[2] * lDC[1] + lAB[3] * lDC[3] );
+   T lDet   = ( lDetA * lDetD + lDetB * lDetC ) - lTrace;
+
+   if ( lDet == 0 )
+      return false;
+
+   T lSign[4] = {1 / lDet, -1 / lDet, -1 / lDet, 1 / lDet};
+   for ( uint32_t i = 0; i < 4; ++i ) {
+      lX[i] *= lSign[i];
+      lY[i] *= lSign[i];
+      lZ[i] *= lSign[i];
+      lW[i] *= lSign[i];
+   }
+
+   T lRes[16] = {lX[3], lX[1], lY[3], lY[1], lX[2], lX[0], lY[2], lY[0],
+                 lZ[3], lZ[1], lW[3], lW[1], lZ[2], lZ[0], lW[2], lW[0]};
+
+   for ( uint32_t i = 0; i < 16; ++i )
+      _out[i] = lRes[i];
+
+   return true;
+}
+
+template <class T>
+bool rMatrixInverse<T>::affine( T const *_m, T *_out ) {
+   // Column i of the 3x3 part is R_i * s_i --> row i of the inverse is column i / s_i^2
+   T lS[3][4];
+   for ( uint32_t i = 0; i < 3; ++i ) {
+      T const *lCol = _m + i * 4;
+      T        lLen = ( lCol[0] * lCol[0] + lCol[1] * lCol[1] ) + lCol[2] * lCol[2];
+
+      if ( lLen == 0 )
+         return false;
+
+      T lInv = 1 / lLen;
+      for ( uint32_t j = 0; j < 3; ++j )
+         lS[i][j] = lCol[j] * lInv;
+   }
+
+   T lT[3] = {_m[12], _m[13], _m[14]};
+
+   for ( uint32_t i = 0; i < 3; ++i ) {
+      _out[i * 4 + 0] = lS[0][i];
+      _out[i * 4 + 1] = lS[1][i];
+      _out[i * 4 + 2] = lS[2][i];
+      _out[i * 4 + 3] = 0;
+   }
+
+   for ( uint32_t i = 0; i < 3; ++i )
+      _out[12 + i] = -( ( lS[i][0] * lT[0] + lS[i][1] * lT[1] ) + lS[i][2] * lT[2] );
+
+   _out[15] = 1;
+   return true;
+}
+
+#if R_MATRIX_SSE
+
+// Lanes in memory order: ( _a[_x], _a[_y], _b[_z], _b[_w] )
+#define R_INV_SHUFFLE( _a, _b, _x, _y, _z, _w ) \
+   _mm_shuffle_ps( _a, _b, _MM_SHUFFLE( _w, _z, _y, _x ) )
+#define R_INV_SWIZZLE( _a, _x, _y, _z, _w ) R_INV_SHUFFLE( _a, _a, _x, _y, _z, _w )
+
+template <>
+struct rMatrixInverse<float> {
+   static inline __m128 mul2( __m128 _a, __m128 _b ) {
+      __m128 lFirst  = _mm_mul_ps( _a, R_INV_SWIZZLE( _b, 0, 3, 0, 3 ) );
+      __m128 lSecond = R_INV_SWIZZLE( _b, 2, 1, 2, 1 );
+      lSecond        = _mm_mul_ps( R_INV_SWIZZLE( _a, 1, 0, 3, 2 ), lSecond );
+      return _mm_add_ps( lFirst, lSecond );
+   }
+
+   static inline __m128 adjMul2( __m128 _a, __m128 _b ) {
+      __m128 lFirst  = _mm_mul_ps( R_INV_SWIZZLE( _a, 3, 3, 0, 0 ), _b );
+      __m128 lSecond = R_INV_SWIZZLE( _b, 2, 3, 0, 1 );
+      lSecond        = _mm_mul_ps( R_INV_SWIZZLE( _a, 1, 1, 2, 2 ), lSecond );
+      return _mm_sub_ps( lFirst, lSecond );
+   }
+
+   static inline __m128 mulAdj2( __m128 _a, __m128 _b ) {
+      __m128 lFirst  = _mm_mul_ps( _a, R_INV_SWIZZLE( _b, 3, 0, 3, 0 ) );
+      __m128 lSecond = R_INV_SWIZZLE( _b, 2, 1, 2, 1 );
+      lSecond        = _mm_mul_ps( R_INV_SWIZZLE( _a, 1, 0, 3, 2 ), lSecond );
+      return _mm_sub_ps( lFirst, lSecond );
+   }
+
+   static inline bool general( float const *_m, float *_out ) {
+      __m128 lC0 = _mm_loadu_ps( _m + 0 );
+      __m128 lC1 = _mm_loadu_ps( _m + 4 );
+      __m128 lC2 = _mm_loadu_ps( _m + 8 );
+      __m128 lC3 = _mm_loadu_ps( _m + 12 );
+
+      __m128 lA = _mm_movelh_ps( lC0, lC1 );
+      __m128 lB = _mm_movehl_ps( lC1, lC0 );
+      __m128 lC = _mm_movelh_ps( lC2, lC3 );
+      __m128 lD = _mm_movehl_ps( lC3, lC2 );
+
+      // ( |A|, |B|, |C|, |D| )
+      __m128 lDetL   = R_INV_SHUFFLE( lC0, lC2, 0, 2, 0, 2 );
+      __m128 lDetR   = R_INV_SHUFFLE( lC1, lC3, 1, 3, 1, 3 );
+      __m128 lDetSub = _mm_mul_ps( lDetL, lDetR );
+      lDetL          = R_INV_SHUFFLE( lC0, lC2, 1, 3, 1, 3 );
+      lDetR          = R_INV_SHUFFLE( lC1, lC3, 0, 2, 0, 2 );
+      lDetSub        = _mm_sub_ps( lDetSub, _mm_mul_ps( lDetL, lDetR ) );
+
+      __m128 lDetA = R_INV_SWIZZLE( lDetSub, 0, 0, 0, 0 );
+      __m128 lDetB = R_INV_SWIZZLE( lDetSub, 1, 1, 1, 1 );
+      __m128 lDetC = R_INV_SWIZZLE( lDetSub, 2, 2, 2, 2 );
+      __m128 lDetD = R_INV_SWIZZLE( lDetSub, 3, 3, 3, 3 );
+
+      __m128 lDC = adjMul2( lD, lC );
+      __m128 lAB = adjMul2( lA, lB );
+      __m128 lX  = _mm_sub_ps( _mm_mul_ps( lDetD, lA ), mul2( lB, lDC ) );
+      __m128 lW  = _mm_sub_ps( _mm_mul_ps( lDetA, lD ), mul2( lC, lAB ) );
+      __m128 lY  = _mm_sub_ps( _mm_mul_ps( lDetB, lC ), mulAdj2( lD, lAB ) );
+      __m128 lZ  = _mm_sub_ps( _mm_mul_ps( lDetC, lB ), mulAdj2( lA, lDC ) );
+
+      // ( t0 + t1 ) + ( t2 + t3 ) in all lanes
+      __m128 lTrace = _mm_mul_ps( lAB, R_INV_SWIZZLE( lDC, 0, 2, 1, 3 ) );
+      lTrace        = _mm_add_ps( lTrace, R_INV_SWIZZLE( lTrace, 1, 0, 3, 2 ) );
+      lTrace        = _mm_add_ps( lTrace, R_INV_SWIZZLE( lTrace, 2, 3, 0, 1 ) );
+
+      __m128 lDet = _mm_sub_ps(
+            _mm_add_ps( _mm_mul_ps( lDetA, lDetD ), _mm_mul_ps( lDetB, lDetC ) ), lTrace );
+
+      if ( _mm_cvtss_f32( lDet ) == 0 )
+         return false;
+
+      __m128 lSign = _mm_div_ps( _mm_set_ps( 1, -1, -1, 1 ), lDet );
+      lX           = _mm_mul_ps( lX, lSign );
+      lY           = _mm_mul_ps( lY, lSign );
+      lZ           = _mm_mul_ps( lZ, lSign );
+      lW           = _mm_mul_ps( lW, lSign );
+
+      _mm_storeu_ps( _out + 0, R_INV_SHUFFLE( lX, lY, 3, 1, 3, 1 ) );
+      _mm_storeu_ps( _out + 4, R_INV_SHUFFLE( lX, lY, 2, 0, 2, 0 ) );
+      _mm_storeu_ps( _out + 8, R_INV_SHUFFLE( lZ, lW, 3, 1, 3, 1 ) );
+      _mm_storeu_ps( _out + 12, R_INV_SHUFFLE( lZ, lW, 2, 0, 2, 0 ) );
+      return true;
+   }
+
+   static inline bool affine( float const *_m, float *_out ) {
+      __m128 lS[4];
+      for ( uint32_t i = 0; i < 3; ++i ) {
+         __m128 lCol = _mm_loadu_ps( _m + i * 4 );
+         __m128 lSq  = _mm_mul_ps( lCol, lCol );
+         __m128 lLen = _mm_add_ps( _mm_add_ps( lSq, R_INV_SWIZZLE( lSq, 1, 1, 1, 1 ) ),
+                                   R_INV_SWIZZLE( lSq, 2, 2, 2, 2 ) );
+
+         if ( _mm_cvtss_f32( lLen ) == 0 )
+            return false;
+
+         lLen  = R_INV_SWIZZLE( lLen, 0, 0, 0, 0 );
+         lS[i] = _mm_mul_ps( lCol, _mm_div_ps( _mm_set1_ps( 1 ), lLen ) );
+      }
+
+      __m128 lT = _mm_loadu_ps( _m + 12 );
+      lS[3]     = _mm_set_ps( 1, 0, 0, 0 );
+
+      // Rows --> columns (lane 3 of the new columns 0 - 2 is 0)
+      _MM_TRANSPOSE4_PS( lS[0], lS[1], lS[2], lS[3] );
+
+      __m128 lNewT = _mm_add_ps(
+            _mm_add_ps( _mm_mul_ps( lS[0], R_INV_SWIZZLE( lT, 0, 0, 0, 0 ) ),
+                        _mm_mul_ps( lS[1], R_INV_SWIZZLE( lT, 1, 1, 1, 1 ) ) ),
+            _mm_mul_ps( lS[2], R_INV_SWIZZLE( lT, 2, 2, 2, 2 ) ) );
+
+      lNewT = _mm_xor_ps( lNewT, _mm_set1_ps( -0.0f ) );
+      lNewT = _mm_or_ps( _mm_and_ps( lNewT, _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) ) ),
+                         _mm_set_ps( 1, 0, 0, 0 ) );
+
+      _mm_storeu_ps( _out + 0, lS[0] );
+      _mm_storeu_ps( _out + 4, lS[1] );
+      _mm_storeu_ps( _out + 8, lS[2] );
+      _mm_storeu_ps( _out + 12, lNewT );
+      return true;
+   }
+};
+
+#undef R_INV_SHUFFLE
+#undef R_INV_SWIZZLE
+
+#endif // R_MATRIX_SSE
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
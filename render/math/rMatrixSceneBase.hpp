@@ -23,6 +23,7 @@
 #include "defines.hpp"
 
 #include "rMatrixMath.hpp"
+#include <atomic>
 #include <mutex>
 
 namespace e_engine {
@@ -32,7 +33,9 @@ class rWorld;
 /*!
  * \brief Class for managing Camera space matrix
  *
- *
+ * Every change of the view / projection matrix increments the matrix version. Objects
+ * (rMatrixObjectBase) compare it with the version they last used to find out whether their
+ * matrices are outdated.
  */
 template <class T>
 class rMatrixSceneBase {
@@ -42,10 +45,19 @@ class rMatrixSceneBase {
    rMat4<T> vProjectionMatrix_MAT;
    rMat4<T> vViewMatrix_MAT;
    rMat4<T> vViewProjectionMatrix_MAT;
-   rMat4<T> vVulkanClipSpace_MAT;
+
+   //! OpenGL clip space --> Vulkan clip space (y down, z from 0 to 1)
+   // clang-format off
+   static constexpr rMat4<T> VULKAN_CLIP_SPACE = rMat4<T>( static_cast<T>( 1 ), 0, 0, 0,
+                                                           0, -1, 0,   0,
+                                                           0,  0, 0.5, 0,
+                                                           0,  0, 0.5, 1 );
+   // clang-format on
 
    std::recursive_mutex vMatrixAccess;
 
+   std::atomic<uint64_t> vMatrixVersion;
+
  public:
    rMatrixSceneBase() = delete;
    rMatrixSceneBase( rWorld *_init );
@@ -61,25 +73,25 @@ class rMatrixSceneBase {
    inline rMat4<T> *getViewMatrix() { return &vViewMatrix_MAT; }
    inline rMat4<T> *getViewProjectionMatrix() { return &vViewProjectionMatrix_MAT; }
 
+   //! Incremented every time the view or projection matrix changes
+   inline uint64_t getMatrixVersion() const {
+      return vMatrixVersion.load( std::memory_order_acquire );
+   }
+
    rWorld *getWorldPtr() { return vWoldPtr; }
 };
 
 
 template <class T>
-rMatrixSceneBase<T>::rMatrixSceneBase( rWorld *_init ) : vWoldPtr( _init ) {
-   vProjectionMatrix_MAT.toIdentityMatrix();
-   vViewMatrix_MAT.toIdentityMatrix();
-   vViewProjectionMatrix_MAT.toIdentityMatrix();
+constexpr rMat4<T> rMatrixSceneBase<T>::VULKAN_CLIP_SPACE;
 
-   // clang-format off
-   vVulkanClipSpace_MAT.setMat( 1.0,  0.0, 0.0, 0.0,
-                                0.0, -1.0, 0.0, 0.0,
-                                0.0,  0.0, 0.5, 0.0,
-                                0.0,  0.0, 0.5, 1.0 );
-   // clang-format on
-
-   vViewProjectionMatrix_MAT = vVulkanClipSpace_MAT * vProjectionMatrix_MAT * vViewMatrix_MAT;
-}
+template <class T>
+rMatrixSceneBase<T>::rMatrixSceneBase( rWorld *_init )
+    : vWoldPtr( _init ),
+      vProjectionMatrix_MAT( rMatrixMath::identity<T>() ),
+      vViewMatrix_MAT( rMatrixMath::identity<T>() ),
+      vViewProjectionMatrix_MAT( VULKAN_CLIP_SPACE ), // clip space * identity * identity
+      vMatrixVersion( 1 ) {}
 
 /*!
  * \brief calculates the projection matrix (perspective)
@@ -96,7 +108,8 @@ void rMatrixSceneBase<T>::calculateProjectionPerspective( T _aspectRatio,
                                                           T _fofy ) {
    std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
    rMatrixMath::perspective( _aspectRatio, _nearZ, _farZ, _fofy, vProjectionMatrix_MAT );
-   vViewProjectionMatrix_MAT = vVulkanClipSpace_MAT * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vViewProjectionMatrix_MAT = VULKAN_CLIP_SPACE * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vMatrixVersion.fetch_add( 1, std::memory_order_release );
 }
 
 /*!
@@ -113,7 +126,8 @@ void rMatrixSceneBase<T>::calculateProjectionPerspective(
       T _width, T _height, T _nearZ, T _farZ, T _fofy ) {
    std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
    rMatrixMath::perspective( _width / _height, _nearZ, _farZ, _fofy, vProjectionMatrix_MAT );
-   vViewProjectionMatrix_MAT = vVulkanClipSpace_MAT * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vViewProjectionMatrix_MAT = VULKAN_CLIP_SPACE * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vMatrixVersion.fetch_add( 1, std::memory_order_release );
 }
 
 /*!
@@ -129,7 +143,8 @@ void rMatrixSceneBase<T>::setCamera( const rVec3<T> &_position,
                                      const rVec3<T> &_upVector ) {
    std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
    rMatrixMath::camera( _position, _lookAt, _upVector, vViewMatrix_MAT );
-   vViewProjectionMatrix_MAT = vVulkanClipSpace_MAT * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vViewProjectionMatrix_MAT = VULKAN_CLIP_SPACE * vProjectionMatrix_MAT * vViewMatrix_MAT;
+   vMatrixVersion.fetch_add( 1, std::memory_order_release );
 }
 }
 
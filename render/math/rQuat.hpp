@@ -0,0 +1,476 @@
+/*!
+ * \file rQuat.hpp
+ * \brief \b Classes: \a rQuat
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rVectorMath.hpp"
+#include <stddef.h>
+
+namespace e_engine {
+
+namespace internal {
+
+/*!
+ * \brief Kernels for quaternions stored as x, y, z, w
+ *
+ * float has an SSE specialization that does the same operations in the same order as the generic
+ * version.
+ */
+template <class T>
+struct rQuatKernels {
+   static const int SLERP_TERMS = 16;
+
+   static inline void toMatrix( T const *_q, T *_out );
+   static inline void slerp( T const *_from, T const *_to, T _t, T *_out, size_t _num );
+
+   static inline void slerpCoefficients( T _t, T *_coefT, T *_coefD );
+   static inline void slerpScalar( T const *_from,
+                                   T const *_to,
+                                   T        _t,
+                                   T const *_coefT,
+                                   T const *_coefD,
+                                   T *      _out,
+                                   size_t   _num );
+};
+
+/*!
+ * \brief Converts the (unit) quaternion _q into a column major 4x4 rotation matrix
+ */
+template <class T>
+void rQuatKernels<T>::toMatrix( T const *_q, T *_out ) {
+   T x2 = _q[0] + _q[0];
+   T y2 = _q[1] + _q[1];
+   T z2 = _q[2] + _q[2];
+
+   T xx = _q[0] * x2;
+   T yy = _q[1] * y2;
+   T zz = _q[2] * z2;
+   T xy = _q[0] * y2;
+   T xz = _q[0] * z2;
+   T yz = _q[1] * z2;
+   T wx = _q[3] * x2;
+   T wy = _q[3] * y2;
+   T wz = _q[3] * z2;
+
+   _out[0]  = ( 1 - yy ) - zz;
+   _out[1]  = xy + wz;
+   _out[2]  = xz - wy;
+   _out[3]  = 0;
+   _out[4]  = xy - wz;
+   _out[5]  = ( 1 - xx ) - zz;
+   _out[6]  = yz + wx;
+   _out[7]  = 0;
+   _out[8]  = xz + wy;
+   _out[9]  = yz - wx;
+   _out[10] = ( 1 - xx ) - yy;
+   _out[11] = 0;
+   _out[12] = 0;
+   _out[13] = 0;
+   _out[14] = 0;
+   _out[15] = 1;
+}
+
+/*!
+ * \brief The t dependent parts of the slerp polynomial (see slerp)
+ */
+template <class T>
+void rQuatKernels<T>::slerpCoefficients( T _t, T *_coefT, T *_coefD ) {
+   // Correction of the last term (minimizes the max. error for SLERP_TERMS terms)
+   const T lMu = static_cast<T>( 1.91666847728754 );
+   T       lD  = 1 - _t;
+
+   for ( int i = 0; i < SLERP_TERMS; ++i ) {
+      T lU = static_cast<T>( 1.0 / ( ( i + 1 ) * ( 2 * i + 3 ) ) );
+      T lV = static_cast<T>( ( i + 1 ) / static_cast<double>( 2 * i + 3 ) );
+
+      if ( i == SLERP_TERMS - 1 ) {
+         lU *= lMu;
+         lV *= lMu;
+      }
+
+      _coefT[i] = lU * ( _t * _t ) - lV;
+      _coefD[i] = lU * ( lD * lD ) - lV;
+   }
+}
+
+/*!
+ * \brief Slerps _num quaternion pairs with the same _t
+ *
+ * Uses the series of sin( t * theta ) / sin( theta ) in cos( theta ) from David Eberly ("A Fast and
+ * Accurate Algorithm for Computing SLERP"), cut after 16 terms: no acos / sin / division, only
+ * multiplications and additions, so several quaternions can be computed at once. The error of the
+ * weights is below 1e-7. Always takes the shortest path.
+ */
+template <class T>
+void rQuatKernels<T>::slerp( T const *_from, T const *_to, T _t, T *_out, size_t _num ) {
+   T lCoefT[SLERP_TERMS], lCoefD[SLERP_TERMS];
+   slerpCoefficients( _t, lCoefT, lCoefD );
+   slerpScalar( _from, _to, _t, lCoefT, lCoefD, _out, _num );
+}
+
+template <class T>
+void rQuatKernels<T>::slerpScalar( T const *_from,
+                                   T const *_to,
+                                   T        _t,
+                                   T const *_coefT,
+                                   T const *_coefD,
+                                   T *      _out,
+                                   size_t   _num ) {
+   for ( size_t i = 0; i < _num; ++i ) {
+      T const *lA = _from + i * 4;
+      T const *lB = _to + i * 4;
+
+      T    lDot = lA[0] * lB[0] + lA[1] * lB[1] + lA[2] * lB[2] + lA[3] * lB[3];
+      bool lNeg = lDot < 0;
+      T    lXm1 = ( lNeg ? -lDot : lDot ) - 1;
+      T    lCT  = 1;
+      T    lCD  = 1;
+
+      for ( int j = SLERP_TERMS - 1; j >= 0; --j ) {
+         lCT = 1 + ( _coefT[j] * lXm1 ) * lCT;
+         lCD = 1 + ( _coefD[j] * lXm1 ) * lCD;
+      }
+
+      lCT = _t * lCT;
+      lCD = ( 1 - _t ) * lCD;
+
+      if ( lNeg )
+         lCT = -lCT;
+
+      // Element j is only read before it is written --> _out may alias _from or _to
+      for ( int j = 0; j < 4; ++j )
+         _out[i * 4 + j] = lA[j] * lCD + lB[j] * lCT;
+   }
+}
+
+#if R_MATRIX_SSE
+
+template <>
+inline void rQuatKernels<float>::toMatrix( float const *_q, float *_out ) {
+   const __m128 lMask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+   const __m128 lNeg  = _mm_set1_ps( -0.0f );
+
+   __m128 lQ  = _mm_loadu_ps( _q );
+   __m128 lQ2 = _mm_add_ps( lQ, lQ );
+
+// Component order: ( a, b, c, unused )
+#define R_QUAT_SHUFFLE( _v, _a, _b, _c ) _mm_shuffle_ps( _v, _v, _MM_SHUFFLE( 3, _c, _b, _a ) )
+#define R_QUAT_COLUMN( _base, _a, _signA, _b, _signB )                                             \
+   _mm_and_ps(                                                                                     \
+         _mm_add_ps( _mm_add_ps( _base, _mm_xor_ps( _a, _mm_and_ps( lNeg, _signA ) ) ),            \
+                     _mm_xor_ps( _b, _mm_and_ps( lNeg, _signB ) ) ),                               \
+         lMask )
+
+   // ( yy, xy, xz ) and ( zz, wz, wy )
+   __m128 lA0 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 1, 0, 0 ), R_QUAT_SHUFFLE( lQ2, 1, 1, 2 ) );
+   __m128 lB0 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 2, 3, 3 ), R_QUAT_SHUFFLE( lQ2, 2, 2, 1 ) );
+   // ( xy, xx, yz ) and ( wz, zz, wx )
+   __m128 lA1 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 0, 0, 1 ), R_QUAT_SHUFFLE( lQ2, 1, 0, 2 ) );
+   __m128 lB1 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 3, 2, 3 ), R_QUAT_SHUFFLE( lQ2, 2, 2, 0 ) );
+   // ( xz, yz, xx ) and ( wy, wx, yy )
+   __m128 lA2 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 0, 1, 0 ), R_QUAT_SHUFFLE( lQ2, 2, 2, 0 ) );
+   __m128 lB2 = _mm_mul_ps( R_QUAT_SHUFFLE( lQ, 3, 3, 1 ), R_QUAT_SHUFFLE( lQ2, 1, 0, 1 ) );
+
+   // Lane masks for the values to subtract
+   const __m128 lL0  = _mm_castsi128_ps( _mm_set_epi32( 0, 0, 0, -1 ) );
+   const __m128 lL1  = _mm_castsi128_ps( _mm_set_epi32( 0, 0, -1, 0 ) );
+   const __m128 lL2  = _mm_castsi128_ps( _mm_set_epi32( 0, -1, 0, 0 ) );
+   const __m128 lL01 = _mm_or_ps( lL0, lL1 );
+   const __m128 lL02 = _mm_or_ps( lL0, lL2 );
+   const __m128 lL12 = _mm_or_ps( lL1, lL2 );
+
+   // ( 1 - yy ) - zz,  xy + wz,  xz - wy
+   _mm_storeu_ps( _out + 0, R_QUAT_COLUMN( _mm_set_ps( 0, 0, 0, 1 ), lA0, lL0, lB0, lL02 ) );
+   // xy - wz,  ( 1 - xx ) - zz,  yz + wx
+   _mm_storeu_ps( _out + 4, R_QUAT_COLUMN( _mm_set_ps( 0, 0, 1, 0 ), lA1, lL1, lB1, lL01 ) );
+   // xz + wy,  yz - wx,  ( 1 - xx ) - yy
+   _mm_storeu_ps( _out + 8, R_QUAT_COLUMN( _mm_set_ps( 0, 1, 0, 0 ), lA2, lL2, lB2, lL12 ) );
+   _mm_storeu_ps( _out + 12, _mm_set_ps( 1, 0, 0, 0 ) );
+
+#undef R_QUAT_SHUFFLE
+#undef R_QUAT_COLUMN
+}
+
+template <>
+inline void rQuatKernels<float>::slerp(
+      float const *_from, float const *_to, float _t, float *_out, size_t _num ) {
+   float lCoefT[SLERP_TERMS], lCoefD[SLERP_TERMS];
+   slerpCoefficients( _t, lCoefT, lCoefD );
+
+   const __m128 lOne  = _mm_set1_ps( 1.0f );
+   const __m128 lNeg  = _mm_set1_ps( -0.0f );
+   const __m128 lT    = _mm_set1_ps( _t );
+   const __m128 lD    = _mm_set1_ps( 1 - _t );
+   size_t       lDone = _num & ~static_cast<size_t>( 7 );
+
+   // 2 x 4 quaternions at once (transposed to x[4], y[4], z[4], w[4]). The polynomials are long
+   // dependency chains, so two independent groups keep the CPU busy.
+   for ( size_t i = 0; i < lDone; i += 8 ) {
+      __m128 lA[2][4], lB[2][4], lXm1[2], lSign[2], lCT[2], lCD[2];
+
+      for ( int g = 0; g < 2; ++g ) {
+         for ( int k = 0; k < 4; ++k ) {
+            lA[g][k] = _mm_loadu_ps( _from + ( i + g * 4 + k ) * 4 );
+            lB[g][k] = _mm_loadu_ps( _to + ( i + g * 4 + k ) * 4 );
+         }
+
+         _MM_TRANSPOSE4_PS( lA[g][0], lA[g][1], lA[g][2], lA[g][3] );
+         _MM_TRANSPOSE4_PS( lB[g][0], lB[g][1], lB[g][2], lB[g][3] );
+
+         __m128 lDot = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( lA[g][0], lB[g][0] ),
+                                                           _mm_mul_ps( lA[g][1], lB[g][1] ) ),
+                                               _mm_mul_ps( lA[g][2], lB[g][2] ) ),
+                                   _mm_mul_ps( lA[g][3], lB[g][3] ) );
+
+         lSign[g] = _mm_and_ps( _mm_cmplt_ps( lDot, _mm_setzero_ps() ), lNeg );
+         lXm1[g]  = _mm_sub_ps( _mm_xor_ps( lDot, lSign[g] ), lOne );
+         lCT[g]   = lOne;
+         lCD[g]   = lOne;
+      }
+
+      for ( int j = SLERP_TERMS - 1; j >= 0; --j ) {
+         __m128 lFacT = _mm_set1_ps( lCoefT[j] );
+         __m128 lFacD = _mm_set1_ps( lCoefD[j] );
+
+         for ( int g = 0; g < 2; ++g ) {
+            lCT[g] = _mm_add_ps( lOne, _mm_mul_ps( _mm_mul_ps( lFacT, lXm1[g] ), lCT[g] ) );
+            lCD[g] = _mm_add_ps( lOne, _mm_mul_ps( _mm_mul_ps( lFacD, lXm1[g] ), lCD[g] ) );
+         }
+      }
+
+      for ( int g = 0; g < 2; ++g ) {
+         __m128 lWT = _mm_xor_ps( _mm_mul_ps( lT, lCT[g] ), lSign[g] );
+         __m128 lWD = _mm_mul_ps( lD, lCD[g] );
+
+         for ( int k = 0; k < 4; ++k )
+            lA[g][k] = _mm_add_ps( _mm_mul_ps( lA[g][k], lWD ), _mm_mul_ps( lB[g][k], lWT ) );
+
+         _MM_TRANSPOSE4_PS( lA[g][0], lA[g][1], lA[g][2], lA[g][3] );
+
+         for ( int k = 0; k < 4; ++k )
+            _mm_storeu_ps( _out + ( i + g * 4 + k ) * 4, lA[g][k] );
+      }
+   }
+
+   slerpScalar( _from + lDone * 4, _to + lDone * 4, _t, lCoefT, lCoefD, _out + lDone * 4,
+                _num - lDone );
+}
+
+#endif // R_MATRIX_SSE
+}
+
+/*!
+ * \class e_engine::rQuat
+ * \brief Quaternion (x, y, z, w) for rotations
+ *
+ * Rotations are combined with operator*: ( a * b ) rotates by b first and then by a (like the
+ * matrix product of the rotation matrices).
+ *
+ * All functions except normalize and length expect unit quaternions.
+ */
+template <class T>
+class rQuat {
+ public:
+   T x = 0;
+   T y = 0;
+   T z = 0;
+   T w = 1;
+
+   rQuat() = default;
+   rQuat( T _x, T _y, T _z, T _w ) : x( _x ), y( _y ), z( _z ), w( _w ) {}
+
+   static inline rQuat fromAxisAngle( rVec3<T> const &_axis, T _angle );
+
+   inline rQuat operator*( rQuat const &_q ) const;
+   inline rQuat &operator*=( rQuat const &_q );
+   inline rQuat operator-() const { return rQuat( -x, -y, -z, -w ); }
+
+   inline bool operator==( rQuat const &_q ) const {
+      return x == _q.x && y == _q.y && z == _q.z && w == _q.w;
+   }
+   inline bool operator!=( rQuat const &_q ) const { return !( *this == _q ); }
+
+   rQuat conjugate() const { return rQuat( -x, -y, -z, w ); }
+   inline rQuat inverse() const;
+
+   T dot( rQuat const &_q ) const { return x * _q.x + y * _q.y + z * _q.z + w * _q.w; }
+   T length() const { return static_cast<T>( sqrt( dot( *this ) ) ); }
+   inline void normalize();
+
+   inline rVec3<T> rotate( rVec3<T> const &_v ) const;
+
+   inline void toMatrix( rMatrix<T, 4, 4> &_out ) const;
+   inline void toMatrix( rMatrix<T, 3, 3> &_out ) const;
+
+   static inline rQuat nlerp( rQuat const &_from, rQuat const &_to, T _t );
+   static inline rQuat slerp( rQuat const &_from, rQuat const &_to, T _t );
+
+   static inline void slerp( rQuat const *_from, rQuat const *_to, T _t, rQuat *_out, size_t _num );
+};
+
+typedef rQuat<float>  rQuatf;
+typedef rQuat<double> rQuatd;
+
+/*!
+ * \brief Creates the rotation around _axis
+ * \param[in] _axis  The rotation axis (does not need to be normalized)
+ * \param[in] _angle The angle in degree
+ */
+template <class T>
+rQuat<T> rQuat<T>::fromAxisAngle( rVec3<T> const &_axis, T _angle ) {
+   rVec3<T> lAxis = _axis;
+   lAxis.normalize();
+
+   T lHalf = static_cast<T>( DEG_TO_RAD( _angle ) / 2 );
+   T lSin  = static_cast<T>( sin( lHalf ) );
+
+   return rQuat( lAxis.x * lSin, lAxis.y * lSin, lAxis.z * lSin, static_cast<T>( cos( lHalf ) ) );
+}
+
+/*!
+ * \brief Combines the rotations (first _q, then this)
+ */
+template <class T>
+rQuat<T> rQuat<T>::operator*( rQuat const &_q ) const {
+   return rQuat( ( w * _q.x ) + ( x * _q.w ) + ( y * _q.z ) - ( z * _q.y ),
+                 ( w * _q.y ) - ( x * _q.z ) + ( y * _q.w ) + ( z * _q.x ),
+                 ( w * _q.z ) + ( x * _q.y ) - ( y * _q.x ) + ( z * _q.w ),
+                 ( w * _q.w ) - ( x * _q.x ) - ( y * _q.y ) - ( z * _q.z ) );
+}
+
+template <class T>
+rQuat<T> &rQuat<T>::operator*=( rQuat const &_q ) {
+   *this = *this * _q;
+   return *this;
+}
+
+/*!
+ * \brief Inverse of a quaternion of any length (the conjugate is enough for unit quaternions)
+ */
+template <class T>
+rQuat<T> rQuat<T>::inverse() const {
+   T lInv = 1 / dot( *this );
+   return rQuat( -x * lInv, -y * lInv, -z * lInv, w * lInv );
+}
+
+template <class T>
+void rQuat<T>::normalize() {
+   T lInv = 1 / length();
+   x *= lInv;
+   y *= lInv;
+   z *= lInv;
+   w *= lInv;
+}
+
+/*!
+ * \brief Rotates the vector (faster than converting to a matrix for a few vectors)
+ */
+template <class T>
+rVec3<T> rQuat<T>::rotate( rVec3<T> const &_v ) const {
+   // t = 2 * cross( q.xyz, v );  v' = v + w * t + cross( q.xyz, t )
+   T lTX = 2 * ( y * _v.z - z * _v.y );
+   T lTY = 2 * ( z * _v.x - x * _v.z );
+   T lTZ = 2 * ( x * _v.y - y * _v.x );
+
+   rVec3<T> lOut;
+   lOut.x = _v.x + w * lTX + ( y * lTZ - z * lTY );
+   lOut.y = _v.y + w * lTY + ( z * lTX - x * lTZ );
+   lOut.z = _v.z + w * lTZ + ( x * lTY - y * lTX );
+   return lOut;
+}
+
+template <class T>
+void rQuat<T>::toMatrix( rMatrix<T, 4, 4> &_out ) const {
+   internal::rQuatKernels<T>::toMatrix( &x, _out.getMatrix() );
+}
+
+template <class T>
+void rQuat<T>::toMatrix( rMatrix<T, 3, 3> &_out ) const {
+   T lTemp[16];
+   internal::rQuatKernels<T>::toMatrix( &x, lTemp );
+
+   for ( uint32_t i = 0; i < 3; ++i )
+      for ( uint32_t j = 0; j < 3; ++j )
+         _out.get( i, j ) = lTemp[i * 4 + j];
+}
+
+/*!
+ * \brief Normalized linear interpolation (shortest path)
+ *
+ * Cheaper than slerp; the angular speed is not constant, which is fine for small angles.
+ */
+template <class T>
+rQuat<T> rQuat<T>::nlerp( rQuat const &_from, rQuat const &_to, T _t ) {
+   T lT = _from.dot( _to ) < 0 ? -_t : _t;
+   T lD = 1 - _t;
+
+   rQuat lRes( _from.x * lD + _to.x * lT,
+               _from.y * lD + _to.y * lT,
+               _from.z * lD + _to.z * lT,
+               _from.w * lD + _to.w * lT );
+   lRes.normalize();
+   return lRes;
+}
+
+/*!
+ * \brief Spherical linear interpolation (shortest path)
+ */
+template <class T>
+rQuat<T> rQuat<T>::slerp( rQuat const &_from, rQuat const &_to, T _t ) {
+   T lDot  = _from.dot( _to );
+   T lSign = 1;
+
+   if ( lDot < 0 ) {
+      lDot  = -lDot;
+      lSign = -1;
+   }
+
+   // sin( theta ) is too small for a stable division --> nlerp is exact enough
+   if ( lDot > static_cast<T>( 0.9995 ) )
+      return nlerp( _from, _to, _t );
+
+   T lTheta = static_cast<T>( acos( lDot ) );
+   T lSin   = static_cast<T>( sin( lTheta ) );
+   T lD     = static_cast<T>( sin( ( 1 - _t ) * lTheta ) ) / lSin;
+   T lT     = lSign * static_cast<T>( sin( _t * lTheta ) ) / lSin;
+
+   return rQuat( _from.x * lD + _to.x * lT,
+                 _from.y * lD + _to.y * lT,
+                 _from.z * lD + _to.z * lT,
+                 _from.w * lD + _to.w * lT );
+}
+
+/*!
+ * \brief Slerps _num quaternions with the same _t (e.g. blending two animation poses)
+ *
+ * Uses a polynomial approximation of slerp (error < 1e-7, see internal::rQuatKernels::slerp)
+ * that is computed for 4 quaternions at once with SSE. _out may be _from or _to.
+ */
+template <class T>
+void rQuat<T>::slerp( rQuat const *_from, rQuat const *_to, T _t, rQuat *_out, size_t _num ) {
+   static_assert( sizeof( rQuat ) == 4 * sizeof( T ), "rQuat must be x, y, z, w without padding" );
+   internal::rQuatKernels<T>::slerp( &_from->x, &_to->x, _t, &_out->x, _num );
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,395 @@
+/*!
+ * \file rTransformBatch.cpp
+ * \brief \b Classes: \a rTransformBatch
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rTransformBatch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && !COMPILER_MSC
+#define R_BATCH_AVX2 1
+#include <immintrin.h>
+#define R_BATCH_INLINE __attribute__( ( always_inline ) ) inline
+#else
+#define R_BATCH_AVX2 0
+#define R_BATCH_INLINE inline
+#endif
+
+namespace e_engine {
+
+namespace {
+
+/*
+ * The kernel is written once for a single float and for the GCC / Clang vector extensions. It is
+ * always inlined, so it is compiled for the target of the caller. Vectors are only passed by
+ * reference / pointer: vector arguments would change the ABI.
+ *
+ * All matrices are column major: element (column c, row r) is at c * 4 + r.
+ */
+template <class V>
+R_BATCH_INLINE void transformT( rTransformBatch::INPUT const &_in,
+                                size_t                        _i,
+                                float const *                 _view,
+                                float const *                 _vp,
+                                V *                           _model,
+                                V *                           _mv,
+                                V *                           _mvp,
+                                V *                           _normal ) {
+   V px, py, pz, x, y, z, w, sx, sy, sz;
+   std::memcpy( &px, _in.posX + _i, sizeof( V ) );
+   std::memcpy( &py, _in.posY + _i, sizeof( V ) );
+   std::memcpy( &pz, _in.posZ + _i, sizeof( V ) );
+   std::memcpy( &x, _in.rotX + _i, sizeof( V ) );
+   std::memcpy( &y, _in.rotY + _i, sizeof( V ) );
+   std::memcpy( &z, _in.rotZ + _i, sizeof( V ) );
+   std::memcpy( &w, _in.rotW + _i, sizeof( V ) );
+   std::memcpy( &sx, _in.scaleX + _i, sizeof( V ) );
+   std::memcpy( &sy, _in.scaleY + _i, sizeof( V ) );
+   std::memcpy( &sz, _in.scaleZ + _i, sizeof( V ) );
+
+   V x2 = x * x;
+   V y2 = y * y;
+   V z2 = z * z;
+   V xy = x * y;
+   V xz = x * z;
+   V yz = y * z;
+   V wx = w * x;
+   V wy = w * y;
+   V wz = w * z;
+
+   V lZero = V();
+
+   // Model = translation * rotation * scale
+   _model[0]  = ( 1.0f - 2.0f * y2 - 2.0f * z2 ) * sx;
+   _model[1]  = ( 2.0f * xy + 2.0f * wz ) * sx;
+   _model[2]  = ( 2.0f * xz - 2.0f * wy ) * sx;
+   _model[3]  = lZero;
+   _model[4]  = ( 2.0f * xy - 2.0f * wz ) * sy;
+   _model[5]  = ( 1.0f - 2.0f * x2 - 2.0f * z2 ) * sy;
+   _model[6]  = ( 2.0f * yz + 2.0f * wx ) * sy;
+   _model[7]  = lZero;
+   _model[8]  = ( 2.0f * xz + 2.0f * wy ) * sz;
+   _model[9]  = ( 2.0f * yz - 2.0f * wx ) * sz;
+   _model[10] = ( 1.0f - 2.0f * x2 - 2.0f * y2 ) * sz;
+   _model[11] = lZero;
+   _model[12] = px;
+   _model[13] = py;
+   _model[14] = pz;
+   _model[15] = lZero + 1.0f;
+
+   // The last row of the model matrix is ( 0, 0, 0, 1 ), those terms are left out
+   for ( uint32_t r = 0; r < 4; ++r ) {
+      for ( uint32_t c = 0; c < 3; ++c ) {
+         V const *lM     = _model + c * 4;
+         _mv[c * 4 + r]  = _view[r] * lM[0] + _view[4 + r] * lM[1] + _view[8 + r] * lM[2];
+         _mvp[c * 4 + r] = _vp[r] * lM[0] + _vp[4 + r] * lM[1] + _vp[8 + r] * lM[2];
+      }
+
+      _mv[12 + r]  = _view[r] * px + _view[4 + r] * py + _view[8 + r] * pz + _view[12 + r];
+      _mvp[12 + r] = _vp[r] * px + _vp[4 + r] * py + _vp[8 + r] * pz + _vp[12 + r];
+   }
+
+   // Normal matrix: same as rMatrixMath::getNormalMatrix (cofactors / determinant)
+   V a00 = _mv[0], a01 = _mv[1], a02 = _mv[2];
+   V a10 = _mv[4], a11 = _mv[5], a12 = _mv[6];
+   V a20 = _mv[8], a21 = _mv[9], a22 = _mv[10];
+
+   V lDet = a00 * ( a11 * a22 - a12 * a21 ) - a01 * ( a10 * a22 - a12 * a20 ) +
+            a02 * ( a10 * a21 - a11 * a20 );
+
+   _normal[0] = ( a11 * a22 - a21 * a12 ) / lDet;
+   _normal[1] = -( a10 * a22 - a20 * a12 ) / lDet;
+   _normal[2] = ( a10 * a21 - a20 * a11 ) / lDet;
+   _normal[3] = -( a01 * a22 - a21 * a02 ) / lDet;
+   _normal[4] = ( a00 * a22 - a20 * a02 ) / lDet;
+   _normal[5] = -( a00 * a21 - a20 * a01 ) / lDet;
+   _normal[6] = ( a01 * a12 - a11 * a02 ) / lDet;
+   _normal[7] = -( a00 * a12 - a10 * a02 ) / lDet;
+   _normal[8] = ( a00 * a11 - a10 * a01 ) / lDet;
+}
+
+void computeScalar( rTransformBatch::INPUT const & _in,
+                    rTransformBatch::OUTPUT const &_out,
+                    float const *                  _view,
+                    float const *                  _vp,
+                    size_t                         _begin,
+                    size_t                         _end ) {
+   float lModel[16], lMV[16], lMVP[16], lNormal[9];
+
+   for ( size_t i = _begin; i < _end; ++i ) {
+      transformT<float>( _in, i, _view, _vp, lModel, lMV, lMVP, lNormal );
+
+      if ( _out.model )
+         _out.model[i].set( lModel );
+      if ( _out.modelView )
+         _out.modelView[i].set( lMV );
+      if ( _out.modelViewProjection )
+         _out.modelViewProjection[i].set( lMVP );
+      if ( _out.normal )
+         _out.normal[i].set( lNormal );
+   }
+}
+
+#if R_BATCH_AVX2
+typedef float VEC8 __attribute__( ( vector_size( 32 ) ) );
+
+/*!
+ * \brief Transposes 8 rows (one matrix element for 8 objects) into 8 objects
+ *
+ * Writes 8 consecutive floats to _out[l].getMatrix() + _offset for every lane l.
+ */
+template <class M>
+__attribute__( ( target( "avx2" ) ) ) R_BATCH_INLINE void storeLanes( VEC8 const *_rows,
+                                                                      M *         _out,
+                                                                      uint32_t    _offset ) {
+   __m256 r0 = reinterpret_cast<__m256 const &>( _rows[0] );
+   __m256 r1 = reinterpret_cast<__m256 const &>( _rows[1] );
+   __m256 r2 = reinterpret_cast<__m256 const &>( _rows[2] );
+   __m256 r3 = reinterpret_cast<__m256 const &>( _rows[3] );
+   __m256 r4 = reinterpret_cast<__m256 const &>( _rows[4] );
+   __m256 r5 = reinterpret_cast<__m256 const &>( _rows[5] );
+   __m256 r6 = reinterpret_cast<__m256 const &>( _rows[6] );
+   __m256 r7 = reinterpret_cast<__m256 const &>( _rows[7] );
+
+   __m256 t0 = _mm256_unpacklo_ps( r0, r1 );
+   __m256 t1 = _mm256_unpackhi_ps( r0, r1 );
+   __m256 t2 = _mm256_unpacklo_ps( r2, r3 );
+   __m256 t3 = _mm256_unpackhi_ps( r2, r3 );
+   __m256 t4 = _mm256_unpacklo_ps( r4, r5 );
+   __m256 t5 = _mm256_unpackhi_ps( r4, r5 );
+   __m256 t6 = _mm256_unpacklo_ps( r6, r7 );
+   __m256 t7 = _mm256_unpackhi_ps( r6, r7 );
+
+   __m256 s0 = _mm256_shuffle_ps( t0, t2, 0x44 );
+   __m256 s1 = _mm256_shuffle_ps( t0, t2, 0xEE );
+   __m256 s2 = _mm256_shuffle_ps( t1, t3, 0x44 );
+   __m256 s3 = _mm256_shuffle_ps( t1, t3, 0xEE );
+   __m256 s4 = _mm256_shuffle_ps( t4, t6, 0x44 );
+   __m256 s5 = _mm256_shuffle_ps( t4, t6, 0xEE );
+   __m256 s6 = _mm256_shuffle_ps( t5, t7, 0x44 );
+   __m256 s7 = _mm256_shuffle_ps( t5, t7, 0xEE );
+
+   _mm256_storeu_ps( _out[0].getMatrix() + _offset, _mm256_permute2f128_ps( s0, s4, 0x20 ) );
+   _mm256_storeu_ps( _out[1].getMatrix() + _offset, _mm256_permute2f128_ps( s1, s5, 0x20 ) );
+   _mm256_storeu_ps( _out[2].getMatrix() + _offset, _mm256_permute2f128_ps( s2, s6, 0x20 ) );
+   _mm256_storeu_ps( _out[3].getMatrix() + _offset, _mm256_permute2f128_ps( s3, s7, 0x20 ) );
+   _mm256_storeu_ps( _out[4].getMatrix() + _offset, _mm256_permute2f128_ps( s0, s4, 0x31 ) );
+   _mm256_storeu_ps( _out[5].getMatrix() + _offset, _mm256_permute2f128_ps( s1, s5, 0x31 ) );
+   _mm256_storeu_ps( _out[6].getMatrix() + _offset, _mm256_permute2f128_ps( s2, s6, 0x31 ) );
+   _mm256_storeu_ps( _out[7].getMatrix() + _offset, _mm256_permute2f128_ps( s3, s7, 0x31 ) );
+}
+
+//! Computes blocks of 8 objects, returns the index of the first object that was not computed
+__attribute__( ( target( "avx2" ) ) ) size_t computeAVX2( rTransformBatch::INPUT const & _in,
+                                                          rTransformBatch::OUTPUT const &_out,
+                                                          float const *                  _view,
+                                                          float const *                  _vp,
+                                                          size_t                         _begin,
+                                                          size_t                         _end ) {
+   VEC8 lModel[16], lMV[16], lMVP[16], lNormal[9];
+
+   size_t i = _begin;
+   for ( ; i + 8 <= _end; i += 8 ) {
+      transformT<VEC8>( _in, i, _view, _vp, lModel, lMV, lMVP, lNormal );
+
+      if ( _out.model ) {
+         storeLanes( lModel, _out.model + i, 0 );
+         storeLanes( lModel + 8, _out.model + i, 8 );
+      }
+
+      if ( _out.modelView ) {
+         storeLanes( lMV, _out.modelView + i, 0 );
+         storeLanes( lMV + 8, _out.modelView + i, 8 );
+      }
+
+      if ( _out.modelViewProjection ) {
+         storeLanes( lMVP, _out.modelViewProjection + i, 0 );
+         storeLanes( lMVP + 8, _out.modelViewProjection + i, 8 );
+      }
+
+      if ( _out.normal ) {
+         storeLanes( lNormal, _out.normal + i, 0 );
+         for ( uint32_t l = 0; l < 8; ++l )
+            _out.normal[i + l].getMatrix()[8] = lNormal[8][l];
+      }
+   }
+
+   return i;
+}
+
+bool hasAVX2() {
+   static const bool lAVX2 = __builtin_cpu_supports( "avx2" );
+   return lAVX2;
+}
+#endif
+}
+
+/*!
+ * \brief Computes the matrices of the objects [_begin, _end)
+ *
+ * Thread safe as long as the ranges of the threads do not overlap.
+ *
+ * \param[in]  _in             The transformations of the objects
+ * \param[out] _out            The matrices to compute
+ * \param[in]  _view           The view matrix of the scene
+ * \param[in]  _viewProjection The view projection matrix of the scene
+ * \param[in]  _begin          The first object
+ * \param[in]  _end            One after the last object
+ */
+void rTransformBatch::compute( INPUT const & _in,
+                               OUTPUT const &_out,
+                               rMat4f const &_view,
+                               rMat4f const &_viewProjection,
+                               size_t        _begin,
+                               size_t        _end ) {
+   float lView[16], lVP[16];
+   std::memcpy( lView, &_view[0], sizeof( lView ) );
+   std::memcpy( lVP, &_viewProjection[0], sizeof( lVP ) );
+
+#if R_BATCH_AVX2
+   if ( hasAVX2() )
+      _begin = computeAVX2( _in, _out, lView, lVP, _begin, _end );
+#endif
+
+   computeScalar( _in, _out, lView, lVP, _begin, _end );
+}
+
+/*!
+ * \brief Computes the matrices of the objects [0, _num) with several threads
+ *
+ * Every thread gets one range (a multiple of 8 objects). Use compute() directly with an existing
+ * thread pool.
+ *
+ * \param[in] _numThreads The number of threads to use (0: one per CPU core)
+ */
+void rTransformBatch::computeParallel( INPUT const & _in,
+                                       OUTPUT const &_out,
+                                       rMat4f const &_view,
+                                       rMat4f const &_viewProjection,
+                                       size_t        _num,
+                                       unsigned      _numThreads ) {
+   if ( _numThreads == 0 )
+      _numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+   // Starting a thread costs more than computing a few thousand objects
+   size_t lChunk = std::max<size_t>( ( _num + _numThreads - 1 ) / _numThreads, 4096 );
+   lChunk        = ( lChunk + 7 ) & ~static_cast<size_t>( 7 );
+
+   std::vector<std::thread> lThreads;
+   for ( size_t i = lChunk; i < _num; i += lChunk ) {
+      size_t lEnd = std::min( i + lChunk, _num );
+      lThreads.emplace_back( [&, i, lEnd]() {
+         compute( _in, _out, _view, _viewProjection, i, lEnd );
+      } );
+   }
+
+   compute( _in, _out, _view, _viewProjection, 0, std::min( lChunk, _num ) );
+
+   for ( auto &i : lThreads )
+      i.join();
+}
+
+/*!
+ * \brief Returns the name of the kernel used on this CPU
+ */
+const char *rTransformBatch::getKernelName() {
+#if R_BATCH_AVX2
+   if ( hasAVX2() )
+      return "AVX2 x8";
+#endif
+
+   return "scalar";
+}
+
+/*!
+ * \brief Sets the number of objects (new objects have the identity transformation)
+ */
+void rTransformBatch::resize( size_t _num ) {
+   for ( auto &i : vPos )
+      i.resize( _num, 0.0f );
+
+   vRot[0].resize( _num, 0.0f );
+   vRot[1].resize( _num, 0.0f );
+   vRot[2].resize( _num, 0.0f );
+   vRot[3].resize( _num, 1.0f );
+
+   for ( auto &i : vScale )
+      i.resize( _num, 1.0f );
+}
+
+void rTransformBatch::setPosition( size_t _index, rVec3f const &_pos ) {
+   vPos[0][_index] = _pos.x;
+   vPos[1][_index] = _pos.y;
+   vPos[2][_index] = _pos.z;
+}
+
+/*!
+ * \brief Sets the rotation as unit quaternion ( x, y, z, w )
+ */
+void rTransformBatch::setRotation( size_t _index, rVec4f const &_quaternion ) {
+   vRot[0][_index] = _quaternion.x;
+   vRot[1][_index] = _quaternion.y;
+   vRot[2][_index] = _quaternion.z;
+   vRot[3][_index] = _quaternion.w;
+}
+
+/*!
+ * \brief Sets the rotation as in rMatrixObjectBase::setRotation
+ * \param[in] _angle The angle in degree
+ */
+void rTransformBatch::setRotation( size_t _index, rVec3f const &_axis, float _angle ) {
+   setRotation( _index, rQuatf::fromAxisAngle( _axis, _angle ) );
+}
+
+void rTransformBatch::setRotation( size_t _index, rQuatf const &_rotation ) {
+   vRot[0][_index] = _rotation.x;
+   vRot[1][_index] = _rotation.y;
+   vRot[2][_index] = _rotation.z;
+   vRot[3][_index] = _rotation.w;
+}
+
+void rTransformBatch::setScale( size_t _index, rVec3f const &_scale ) {
+   vScale[0][_index] = _scale.x;
+   vScale[1][_index] = _scale.y;
+   vScale[2][_index] = _scale.z;
+}
+
+/*!
+ * \brief Returns the input arrays for compute()
+ * \note The pointers are only valid until the next resize()
+ */
+rTransformBatch::INPUT rTransformBatch::getInput() const {
+   INPUT lIn;
+   lIn.posX   = vPos[0].data();
+   lIn.posY   = vPos[1].data();
+   lIn.posZ   = vPos[2].data();
+   lIn.rotX   = vRot[0].data();
+   lIn.rotY   = vRot[1].data();
+   lIn.rotZ   = vRot[2].data();
+   lIn.rotW   = vRot[3].data();
+   lIn.scaleX = vScale[0].data();
+   lIn.scaleY = vScale[1].data();
+   lIn.scaleZ = vScale[2].data();
+   return lIn;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,108 @@
+/*!
+ * \file rTransformBatch.hpp
+ * \brief \b Classes: \a rTransformBatch
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rMatrixMath.hpp"
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::rTransformBatch
+ * \brief Computes the matrices of many objects at once
+ *
+ * Does the same as rMatrixObjectBase::updateFinalMatrix, but for N objects whose position,
+ * rotation (unit quaternion x, y, z, w) and scale are stored as structure of arrays. With AVX2 8
+ * objects are computed at once (one object per SIMD lane), otherwise one after another with the
+ * same operations, so both give the same results.
+ *
+ * compute() only touches the objects in [_begin, _end), so a thread pool can split the objects into
+ * ranges (preferably multiples of 8). computeParallel() does this with its own threads.
+ *
+ * \code
+ * rTransformBatch::OUTPUT lOut;
+ * lOut.modelViewProjection = lMVPs.data(); // Everything not needed may stay nullptr
+ * rTransformBatch::compute( lBatch.getInput(), lOut, lView, lViewProjection, 0, lBatch.size() );
+ * \endcode
+ */
+class RENDER_API rTransformBatch final {
+ public:
+   //! The input arrays (all with at least _end elements)
+   struct INPUT {
+      float const *posX   = nullptr;
+      float const *posY   = nullptr;
+      float const *posZ   = nullptr;
+      float const *rotX   = nullptr; //!< Unit quaternion
+      float const *rotY   = nullptr;
+      float const *rotZ   = nullptr;
+      float const *rotW   = nullptr;
+      float const *scaleX = nullptr;
+      float const *scaleY = nullptr;
+      float const *scaleZ = nullptr;
+   };
+
+   //! The output arrays (nullptr for matrices that are not needed)
+   struct OUTPUT {
+      rMat4f *model               = nullptr;
+      rMat4f *modelView           = nullptr;
+      rMat4f *modelViewProjection = nullptr;
+      rMat3f *normal              = nullptr; //!< Inverse transpose of the model view matrix
+   };
+
+ private:
+   std::vector<float> vPos[3];
+   std::vector<float> vRot[4];
+   std::vector<float> vScale[3];
+
+ public:
+   static void compute( INPUT const & _in,
+                        OUTPUT const &_out,
+                        rMat4f const &_view,
+                        rMat4f const &_viewProjection,
+                        size_t        _begin,
+                        size_t        _end );
+
+   static void computeParallel( INPUT const & _in,
+                                OUTPUT const &_out,
+                                rMat4f const &_view,
+                                rMat4f const &_viewProjection,
+                                size_t        _num,
+                                unsigned      _numThreads = 0 );
+
+   static const char *getKernelName();
+
+   void   resize( size_t _num );
+   size_t size() const { return vPos[0].size(); }
+
+   void setPosition( size_t _index, rVec3f const &_pos );
+   void setRotation( size_t _index, rVec4f const &_quaternion );
+   void setRotation( size_t _index, rVec3f const &_axis, float _angle );
+   void setRotation( size_t _index, rQuatf const &_rotation );
+   void setScale( size_t _index, rVec3f const &_scale );
+
+   INPUT getInput() const;
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
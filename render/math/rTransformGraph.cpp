@@ -0,0 +1,371 @@
+/*!
+ * \file rTransformGraph.cpp
+ * \brief \b Classes: \a rTransformGraph
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rTransformGraph.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace e_engine {
+
+namespace {
+
+//! Starting a thread costs more than computing a few thousand matrices
+const uint32_t MIN_NODES_PER_THREAD = 4096;
+
+//! Waits until all threads reached the barrier (reusable)
+class Barrier final {
+ private:
+   std::mutex              vMutex;
+   std::condition_variable vVar;
+   unsigned                vNumThreads;
+   unsigned                vWaiting    = 0;
+   uint64_t                vGeneration = 0;
+
+ public:
+   Barrier( unsigned _numThreads ) : vNumThreads( _numThreads ) {}
+
+   void wait() {
+      std::unique_lock<std::mutex> lLock( vMutex );
+      uint64_t                     lGeneration = vGeneration;
+
+      if ( ++vWaiting == vNumThreads ) {
+         vWaiting = 0;
+         vGeneration++;
+         vVar.notify_all();
+         return;
+      }
+
+      vVar.wait( lLock, [&]() { return lGeneration != vGeneration; } );
+   }
+};
+}
+
+const rTransformGraph::NODE rTransformGraph::INVALID_NODE;
+
+
+/*!
+ * \brief Adds a new node (with an identity local matrix)
+ * \param[in] _parent The parent node (INVALID_NODE for a root node)
+ * \returns the handle of the new node or INVALID_NODE if _parent does not exist
+ */
+rTransformGraph::NODE rTransformGraph::addNode( NODE _parent ) {
+   if ( _parent != INVALID_NODE && _parent >= vPos.size() ) {
+      eLOG( "Invalid parent node ", _parent );
+      return INVALID_NODE;
+   }
+
+   NODE lHandle = static_cast<NODE>( vPos.size() );
+
+   vLocal.push_back( rMatrixMath::identity<float>() );
+   vWorld.push_back( rMatrixMath::identity<float>() );
+
+   vParent.push_back( _parent == INVALID_NODE ? INVALID_NODE : vPos[_parent] );
+   vDirty.push_back( 1 );
+   vHandle.push_back( lHandle );
+   vPos.push_back( static_cast<uint32_t>( vLocal.size() - 1 ) );
+
+   vOrderDirty = true;
+   vAnyDirty   = true;
+   return lHandle;
+}
+
+/*!
+ * \brief Moves a node (with all its children) to a new parent
+ * \param[in] _node   The node to move
+ * \param[in] _parent The new parent (INVALID_NODE to make _node a root node)
+ * \returns false if a node does not exist or _node is an ancestor of _parent
+ */
+bool rTransformGraph::setParent( NODE _node, NODE _parent ) {
+   if ( _node >= vPos.size() || ( _parent != INVALID_NODE && _parent >= vPos.size() ) ) {
+      eLOG( "Invalid node ", _node, " or parent ", _parent );
+      return false;
+   }
+
+   uint32_t lPos       = vPos[_node];
+   uint32_t lParentPos = _parent == INVALID_NODE ? INVALID_NODE : vPos[_parent];
+
+   for ( uint32_t i = lParentPos; i != INVALID_NODE; i = vParent[i] ) {
+      if ( i == lPos ) {
+         eLOG( "Node ", _node, " can not be a child of its own descendant ", _parent );
+         return false;
+      }
+   }
+
+   vParent[lPos] = lParentPos;
+   vDirty[lPos]  = 1;
+   vOrderDirty   = true;
+   vAnyDirty     = true;
+   return true;
+}
+
+/*!
+ * \brief Sets the transformation of a node relative to its parent
+ * \returns false if the node does not exist
+ */
+bool rTransformGraph::setLocalMatrix( NODE _node, rMat4f const &_mat ) {
+   if ( _node >= vPos.size() ) {
+      eLOG( "Invalid node ", _node );
+      return false;
+   }
+
+   uint32_t lPos = vPos[_node];
+   vLocal[lPos]  = _mat;
+   vDirty[lPos]  = 1;
+   vAnyDirty     = true;
+   return true;
+}
+
+/*!
+ * \returns the parent of the node (INVALID_NODE for root nodes and invalid nodes)
+ */
+rTransformGraph::NODE rTransformGraph::getParent( NODE _node ) const {
+   if ( _node >= vPos.size() )
+      return INVALID_NODE;
+
+   uint32_t lParent = vParent[vPos[_node]];
+   return lParent == INVALID_NODE ? INVALID_NODE : vHandle[lParent];
+}
+
+/*!
+ * \returns the local matrix of the node (nullptr if the node does not exist)
+ */
+rMat4f const *rTransformGraph::getLocalMatrix( NODE _node ) const {
+   return _node < vPos.size() ? &vLocal[vPos[_node]] : nullptr;
+}
+
+/*!
+ * \returns the world matrix of the node from the last update() (nullptr for invalid nodes)
+ * \note The pointer is only valid until the next update()
+ */
+rMat4f const *rTransformGraph::getWorldMatrix( NODE _node ) const {
+   return _node < vPos.size() ? &vWorld[vPos[_node]] : nullptr;
+}
+
+/*!
+ * \returns true if the last update() recomputed the world matrix of the node
+ */
+bool rTransformGraph::getWorldChanged( NODE _node ) const {
+   if ( _node >= vPos.size() )
+      return false;
+
+   uint32_t lPos = vPos[_node];
+   return lPos < vChanged.size() && vChanged[lPos] != 0;
+}
+
+/*!
+ * \returns the depth of the deepest node + 1
+ */
+uint32_t rTransformGraph::getNumLevels() {
+   if ( vOrderDirty )
+      sortNodes();
+
+   return vLevels.empty() ? 0 : static_cast<uint32_t>( vLevels.size() - 1 );
+}
+
+/*!
+ * \brief Removes all nodes (all handles become invalid)
+ */
+void rTransformGraph::clear() {
+   vLocal.clear();
+   vWorld.clear();
+   vParent.clear();
+   vDirty.clear();
+   vChanged.clear();
+   vHandle.clear();
+   vPos.clear();
+   vLevels.clear();
+   vOrderDirty = false;
+   vAnyDirty   = false;
+   vAnyChanged = false;
+}
+
+
+/*!
+ * \brief Sorts the nodes by their depth (stable)
+ */
+void rTransformGraph::sortNodes() {
+   uint32_t              lNum      = static_cast<uint32_t>( vLocal.size() );
+   uint32_t              lMaxDepth = 0;
+   std::vector<uint32_t> lDepth( lNum, INVALID_NODE );
+   std::vector<uint32_t> lChain;
+
+   for ( uint32_t i = 0; i < lNum; ++i ) {
+      // Walk up until the depth is known (or a root node is reached)
+      uint32_t j = i;
+      while ( lDepth[j] == INVALID_NODE && vParent[j] != INVALID_NODE ) {
+         lChain.push_back( j );
+         j = vParent[j];
+      }
+
+      if ( lDepth[j] == INVALID_NODE )
+         lDepth[j] = 0;
+
+      for ( uint32_t lCurrent = lDepth[j]; !lChain.empty(); lChain.pop_back() )
+         lDepth[lChain.back()] = ++lCurrent;
+
+      lMaxDepth = std::max( lMaxDepth, lDepth[i] );
+   }
+
+   // Counting sort
+   vLevels.assign( lMaxDepth + 2, 0 );
+   for ( uint32_t i = 0; i < lNum; ++i )
+      vLevels[lDepth[i] + 1]++;
+
+   for ( size_t i = 1; i < vLevels.size(); ++i )
+      vLevels[i] += vLevels[i - 1];
+
+   std::vector<uint32_t> lNext( vLevels.begin(), vLevels.end() - 1 );
+   std::vector<uint32_t> lNewPos( lNum );
+   for ( uint32_t i = 0; i < lNum; ++i )
+      lNewPos[i] = lNext[lDepth[i]]++;
+
+   std::vector<rMat4f>   lLocal( lNum );
+   std::vector<rMat4f>   lWorld( lNum );
+   std::vector<uint32_t> lParent( lNum );
+   std::vector<uint8_t>  lDirty( lNum );
+   std::vector<uint8_t>  lChanged( lNum, 0 );
+   std::vector<NODE>     lHandle( lNum );
+
+   for ( uint32_t i = 0; i < lNum; ++i ) {
+      uint32_t lPos    = lNewPos[i];
+      lLocal[lPos]     = vLocal[i];
+      lWorld[lPos]     = vWorld[i];
+      lParent[lPos]    = vParent[i] == INVALID_NODE ? INVALID_NODE : lNewPos[vParent[i]];
+      lDirty[lPos]     = vDirty[i];
+      lChanged[lPos]   = i < vChanged.size() ? vChanged[i] : 0;
+      lHandle[lPos]    = vHandle[i];
+      vPos[vHandle[i]] = lPos;
+   }
+
+   vLocal.swap( lLocal );
+   vWorld.swap( lWorld );
+   vParent.swap( lParent );
+   vDirty.swap( lDirty );
+   vChanged.swap( lChanged );
+   vHandle.swap( lHandle );
+   vOrderDirty = false;
+}
+
+/*!
+ * \brief Computes the world matrices of the dirty nodes in [_begin, _end) (one level)
+ */
+void rTransformGraph::updateRange( uint32_t _begin, uint32_t _end ) {
+   for ( uint32_t i = _begin; i < _end; ++i ) {
+      uint32_t lParent = vParent[i];
+
+      if ( lParent == INVALID_NODE ) {
+         if ( vDirty[i] )
+            vWorld[i] = vLocal[i];
+
+         continue;
+      }
+
+      // The parent is in an older level and thus already final
+      if ( vDirty[lParent] )
+         vDirty[i] = 1;
+
+      if ( vDirty[i] )
+         vWorld[lParent].multiply( vLocal[i], &vWorld[i] );
+   }
+}
+
+/*!
+ * \brief Computes the world matrices of all dirty nodes and their children
+ *
+ * The levels are computed one after another. Levels with many nodes are split over the threads,
+ * small levels are computed by one thread (threads are only started for large graphs).
+ *
+ * \param[in] _numThreads The maximum number of threads (0: one per CPU core)
+ */
+void rTransformGraph::update( unsigned _numThreads ) {
+   if ( vOrderDirty )
+      sortNodes();
+
+   if ( !vAnyDirty ) {
+      if ( vAnyChanged )
+         std::fill( vChanged.begin(), vChanged.end(), 0 );
+
+      vAnyChanged = false;
+      return;
+   }
+
+   if ( _numThreads == 0 )
+      _numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+   uint32_t lNumLevels = static_cast<uint32_t>( vLevels.size() - 1 );
+   uint32_t lLargest   = 0;
+   for ( uint32_t i = 0; i < lNumLevels; ++i )
+      lLargest = std::max( lLargest, vLevels[i + 1] - vLevels[i] );
+
+   unsigned lNumThreads = std::min<unsigned>( _numThreads, lLargest / MIN_NODES_PER_THREAD );
+
+   if ( lNumThreads <= 1 ) {
+      for ( uint32_t i = 0; i < lNumLevels; ++i )
+         updateRange( vLevels[i], vLevels[i + 1] );
+   } else {
+      Barrier lBarrier( lNumThreads );
+
+      auto lIsParallel = [&]( uint32_t _level ) {
+         return _level < lNumLevels &&
+                vLevels[_level + 1] - vLevels[_level] >= MIN_NODES_PER_THREAD;
+      };
+
+      auto lWorker = [&]( unsigned _id ) {
+         for ( uint32_t i = 0; i < lNumLevels; ++i ) {
+            uint32_t lBegin = vLevels[i];
+            uint32_t lNum   = vLevels[i + 1] - lBegin;
+
+            if ( lIsParallel( i ) ) {
+               uint32_t lChunk = ( lNum + lNumThreads - 1 ) / lNumThreads;
+               updateRange( lBegin + std::min( lNum, _id * lChunk ),
+                            lBegin + std::min( lNum, ( _id + 1 ) * lChunk ) );
+            } else if ( _id == 0 ) {
+               updateRange( lBegin, lBegin + lNum );
+            }
+
+            // Small levels in a row are all done by thread 0 --> no need to sync
+            if ( lIsParallel( i ) || lIsParallel( i + 1 ) )
+               lBarrier.wait();
+         }
+      };
+
+      std::vector<std::thread> lThreads;
+      for ( unsigned i = 1; i < lNumThreads; ++i )
+         lThreads.emplace_back( lWorker, i );
+
+      lWorker( 0 );
+
+      for ( auto &i : lThreads )
+         i.join();
+   }
+
+   // The dirty marks (passed on to the children) are exactly the recomputed nodes
+   vChanged.swap( vDirty );
+   vDirty.assign( vChanged.size(), 0 );
+   vAnyDirty   = false;
+   vAnyChanged = true;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
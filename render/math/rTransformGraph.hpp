@@ -0,0 +1,103 @@
+/*!
+ * \file rTransformGraph.hpp
+ * \brief \b Classes: \a rTransformGraph
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rMatrixMath.hpp"
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::rTransformGraph
+ * \brief Transformation hierarchy (parent / child) with world matrix propagation
+ *
+ * Every node has a local matrix (relative to its parent) and a world matrix (parent world * local).
+ * The nodes are stored in flat arrays sorted by their depth, so update() computes the world
+ * matrices level by level: all parents of a level are final before the level is computed, and the
+ * nodes of one level can be split over several threads.
+ *
+ * Only dirty subtrees are recomputed: setLocalMatrix and setParent mark a node, and update()
+ * passes the mark on to all children. getWorldChanged() tells which nodes the last update()
+ * recomputed (rSceneBase uses this to only touch the objects attached to these nodes).
+ *
+ * Nodes are referenced by handles (NODE), which stay valid when the nodes are sorted again.
+ *
+ * \code
+ * rTransformGraph        lGraph;
+ * rTransformGraph::NODE lCar   = lGraph.addNode();
+ * rTransformGraph::NODE lWheel = lGraph.addNode( lCar );
+ * lGraph.setLocalMatrix( lWheel, lWheelOffset );
+ * lGraph.update();
+ * rMat4f const *lWheelWorld = lGraph.getWorldMatrix( lWheel );
+ * \endcode
+ *
+ * \note The class itself is not thread safe (update() uses its own threads)
+ */
+class RENDER_API rTransformGraph final {
+ public:
+   typedef uint32_t NODE;
+
+   static const NODE INVALID_NODE = UINT32_MAX;
+
+ private:
+   // All indexed by the position in the sorted order
+   std::vector<rMat4f>   vLocal;
+   std::vector<rMat4f>   vWorld;
+   std::vector<uint32_t> vParent; //!< Position of the parent (INVALID_NODE for roots)
+   std::vector<uint8_t>  vDirty;
+   std::vector<uint8_t>  vChanged; //!< Recomputed by the last update()
+   std::vector<NODE>     vHandle;
+
+   std::vector<uint32_t> vPos;    //!< Handle --> position
+   std::vector<uint32_t> vLevels; //!< Start positions of the levels (+ end)
+
+   bool vOrderDirty = false; //!< Nodes were added / moved since the last sort
+   bool vAnyDirty   = false;
+   bool vAnyChanged = false; //!< vChanged has a set mark
+
+   void sortNodes();
+   void updateRange( uint32_t _begin, uint32_t _end );
+
+ public:
+   NODE addNode( NODE _parent = INVALID_NODE );
+   bool setParent( NODE _node, NODE _parent );
+   bool setLocalMatrix( NODE _node, rMat4f const &_mat );
+
+   NODE getParent( NODE _node ) const;
+   rMat4f const *getLocalMatrix( NODE _node ) const;
+   rMat4f const *getWorldMatrix( NODE _node ) const;
+   bool getWorldChanged( NODE _node ) const;
+
+   //! True if the last update() recomputed any node
+   bool getAnyChanged() const { return vAnyChanged; }
+
+   void update( unsigned _numThreads = 0 );
+
+   size_t   size() const { return vPos.size(); }
+   uint32_t getNumLevels();
+   void     clear();
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -19,9 +19,11 @@
 
 #include "rObjectBase.hpp"
 #include "rPipeline.hpp"
+#include "rScene.hpp"
 #include "iInit.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include <cstring>
 #include <regex>
 
 namespace e_engine {
@@ -32,6 +34,14 @@ namespace e_engine {
  */
 rObjectBase::~rObjectBase() {}
 
+/*!
+ * \brief Tells the scene that the matrices have to be published again (see publishMatrices)
+ */
+void rObjectBase::signalMatricesChanged() {
+   if ( vScene )
+      vScene->queueMatrices( vSceneIndex );
+}
+
 bool rObjectBase::setPipeline( rPipeline *_pipe ) {
    if ( !checkIsCompatible( _pipe ) ) {
       eLOG( "Pipeline not compatible with object ", vName_str );
@@ -109,25 +119,120 @@ bool rObjectBase::setData( VkCommandBuffer _buf, aiMesh const *_mesh ) {
       default: eLOG( "This object type does not support mesh data!" ); return false;
    }
 
-   std::vector<uint32_t> lIndex;
-   std::vector<float>    lData;
+   if ( getVertexStride( getDataLayout() ) == 0 ) {
+      eLOG( "Data layout ", uEnum2Str::toStr( getDataLayout() ) );
+      return false;
+   }
+
+   static_assert( sizeof( aiVector3D ) == 3 * sizeof( float ), "Unexpected assimp vector type" );
+
+   uint32_t *lIndex;
+   float *   lVertices;
+
+   if ( !beginData( lIndexSize * _mesh->mNumFaces, _mesh->mNumVertices, &lIndex, &lVertices ) )
+      return false;
+
+   // Converted straight into the staging memory
+   if ( !packMesh( _mesh, getMeshType(), getDataLayout(), lIndex, lVertices ) ) {
+      eLOG( "Invalid data! Object ", vName_str );
+      cancelData();
+      return false;
+   }
 
-   lIndex.resize( lIndexSize * _mesh->mNumFaces );
-   for ( uint32_t i = 0; i < _mesh->mNumFaces; i++ )
-      for ( uint32_t j              = 0; j < lIndexSize; j++ )
-         lIndex[i * lIndexSize + j] = _mesh->mFaces[i].mIndices[j];
+   auto lPositions = reinterpret_cast<float const *>( _mesh->mVertices );
+   return endData( _buf, rBoundingVolume::fromPoints( lPositions, _mesh->mNumVertices ) );
+}
 
-   switch ( getDataLayout() ) {
-      case POS_NORM: setupVertexData_PN( _mesh, lData ); break;
-      default: eLOG( "Data layout ", uEnum2Str::toStr( getDataLayout() ) ); return false;
+/*!
+ * \brief Starts uploading already converted mesh data
+ *
+ * The data is copied into staging buffers before this function returns.
+ *
+ * \param[in] _buf  The command buffer to record the copy commands into
+ * \param[in] _mesh The mesh (type and layout must match the object)
+ * \returns true on success
+ */
+bool rObjectBase::setData( VkCommandBuffer _buf, MESH_DATA const &_mesh ) {
+   if ( _mesh.type != getMeshType() || _mesh.layout != getDataLayout() ) {
+      eLOG( "Mesh type or data layout does not match object ", vName_str );
+      return false;
    }
 
-   vLoadBuffers = setData_IMPL( _buf, lIndex, lData );
+   uint32_t *lIndex;
+   float *   lVertices;
+
+   if ( !beginData( _mesh.numIndices, _mesh.numVertices, &lIndex, &lVertices ) )
+      return false;
+
+   memcpy( lIndex, _mesh.index, _mesh.numIndices * sizeof( uint32_t ) );
+   memcpy( lVertices,
+           _mesh.vertices,
+           _mesh.numVertices * getVertexStride( _mesh.layout ) * sizeof( float ) );
+
+   return endData( _buf, _mesh.bounds );
+}
+
+/*!
+ * \brief Creates the buffers of the object and returns their staging memory
+ *
+ * The staging memory may be written from any thread. Then call endData (or cancelData) from the
+ * thread recording the command buffer.
+ *
+ * \param[in]  _numIndices  The number of indexes
+ * \param[in]  _numVertices The number of vertices (in the layout of the object)
+ * \param[out] _index       The staging memory for the indexes
+ * \param[out] _vertices    The staging memory for the vertices
+ * \returns true on success
+ */
+bool rObjectBase::beginData( uint32_t   _numIndices,
+                             uint32_t   _numVertices,
+                             uint32_t **_index,
+                             float **   _vertices ) {
+   if ( vIsLoaded_B || vPartialLoaded_B || vDataStarted_B ) {
+      eLOG( "Data already loaded! Object ", vName_str );
+      return false;
+   }
+
+   uint32_t lNumFloats = _numVertices * getVertexStride( getDataLayout() );
+   if ( !beginData_IMPL( _numIndices, lNumFloats, _index, _vertices ) ) {
+      eLOG( "Failed to create the buffers of object ", vName_str );
+      return false;
+   }
+
+   vDataStarted_B = true;
+   return true;
+}
 
+/*!
+ * \brief Records the upload of the data written into the staging memory (see beginData)
+ * \param[in] _buf    The command buffer to record the copy commands into
+ * \param[in] _bounds The bounding volume of the mesh
+ */
+bool rObjectBase::endData( VkCommandBuffer _buf, rBoundingVolume const &_bounds ) {
+   if ( !vDataStarted_B ) {
+      eLOG( "beginData not called yet! Object ", vName_str );
+      return false;
+   }
+
+   vBoundingVolume = _bounds;
+   vLoadBuffers    = endData_IMPL( _buf );
+
+   vDataStarted_B   = false;
    vPartialLoaded_B = true;
    return true;
 }
 
+/*!
+ * \brief Frees the buffers created by beginData (when the data could not be converted)
+ */
+void rObjectBase::cancelData() {
+   if ( !vDataStarted_B )
+      return;
+
+   cancelData_IMPL();
+   vDataStarted_B = false;
+}
+
 bool rObjectBase::finishData() {
    if ( vIsLoaded_B ) {
       eLOG( "Data already loaded! Object ", vName_str );
@@ -150,20 +255,99 @@ bool rObjectBase::finishData() {
    return true;
 }
 
-bool rObjectBase::setupVertexData_PN( aiMesh const *_mesh, std::vector<float> &_out ) {
-   if ( !_mesh->HasNormals() ) {
-      eLOG( "Invalid data! Object ", vName_str );
+/*!
+ * \brief Returns the number of indexes per face (0 if not supported)
+ */
+uint32_t rObjectBase::getIndexSize( MESH_TYPES _type ) {
+   switch ( _type ) {
+      case POINTS_3D: return 1;
+      case LINES_3D: return 2;
+      case MESH_3D: return 3;
+      default: return 0;
+   }
+}
+
+/*!
+ * \brief Returns the number of floats per vertex (0 if not supported)
+ */
+uint32_t rObjectBase::getVertexStride( VERTEX_DATA_LAYOUT _layout ) {
+   switch ( _layout ) {
+      case POS: return 3;
+      case POS_NORM: return 6;
+      case POS_COLOR: return 7;
+      case POS_UV: return 5;
+      case POS_NORM_COLOR: return 10;
+      case POS_NORM_UV: return 8;
+      case POS_NORM_UV_COLOR: return 12;
+      default: return 0;
+   }
+}
+
+/*!
+ * \brief Converts the faces and vertices of a mesh
+ *
+ * UVs are taken from the first texture coordinate set and colors from the first color set.
+ *
+ * \param[in]  _mesh     The mesh to convert
+ * \param[in]  _type     The mesh type (getIndexSize() indexes per face)
+ * \param[in]  _layout   The vertex layout
+ * \param[out] _index    getIndexSize() * mNumFaces indexes
+ * \param[out] _vertices getVertexStride() * mNumVertices floats
+ * \returns false if the mesh does not have the required faces or vertex attributes
+ */
+bool rObjectBase::packMesh( aiMesh const *     _mesh,
+                            MESH_TYPES         _type,
+                            VERTEX_DATA_LAYOUT _layout,
+                            uint32_t *         _index,
+                            float *            _vertices ) {
+   uint32_t lIndexSize = getIndexSize( _type );
+   uint32_t lStride    = getVertexStride( _layout );
+
+   bool lNorm  = _layout == POS_NORM || _layout == POS_NORM_COLOR || _layout == POS_NORM_UV ||
+                _layout == POS_NORM_UV_COLOR;
+   bool lUV    = _layout == POS_UV || _layout == POS_NORM_UV || _layout == POS_NORM_UV_COLOR;
+   bool lColor = _layout == POS_COLOR || _layout == POS_NORM_COLOR || _layout == POS_NORM_UV_COLOR;
+
+   if ( lIndexSize == 0 || lStride == 0 )
       return false;
+
+   if ( ( lNorm && !_mesh->HasNormals() ) || ( lUV && !_mesh->HasTextureCoords( 0 ) ) ||
+        ( lColor && !_mesh->HasVertexColors( 0 ) ) )
+      return false;
+
+   for ( uint32_t i = 0; i < _mesh->mNumFaces; i++ ) {
+      aiFace const &lFace = _mesh->mFaces[i];
+      if ( lFace.mNumIndices != lIndexSize )
+         return false;
+
+      for ( uint32_t j = 0; j < lIndexSize; j++ )
+         _index[i * lIndexSize + j] = lFace.mIndices[j];
    }
 
-   _out.resize( _mesh->mNumVertices * 3 * 2 );
    for ( uint32_t i = 0; i < _mesh->mNumVertices; i++ ) {
-      _out[6 * i + 0] = _mesh->mVertices[i].x;
-      _out[6 * i + 1] = _mesh->mVertices[i].y;
-      _out[6 * i + 2] = _mesh->mVertices[i].z;
-      _out[6 * i + 3] = _mesh->mNormals[i].x;
-      _out[6 * i + 4] = _mesh->mNormals[i].y;
-      _out[6 * i + 5] = _mesh->mNormals[i].z;
+      float *lOut = _vertices + i * lStride;
+
+      *lOut++ = _mesh->mVertices[i].x;
+      *lOut++ = _mesh->mVertices[i].y;
+      *lOut++ = _mesh->mVertices[i].z;
+
+      if ( lNorm ) {
+         *lOut++ = _mesh->mNormals[i].x;
+         *lOut++ = _mesh->mNormals[i].y;
+         *lOut++ = _mesh->mNormals[i].z;
+      }
+
+      if ( lUV ) {
+         *lOut++ = _mesh->mTextureCoords[0][i].x;
+         *lOut++ = _mesh->mTextureCoords[0][i].y;
+      }
+
+      if ( lColor ) {
+         *lOut++ = _mesh->mColors[0][i].r;
+         *lOut++ = _mesh->mColors[0][i].g;
+         *lOut++ = _mesh->mColors[0][i].b;
+         *lOut++ = _mesh->mColors[0][i].a;
+      }
    }
 
    return true;
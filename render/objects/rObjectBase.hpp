@@ -22,6 +22,7 @@
 #include "defines.hpp"
 
 #include "rBuffer.hpp"
+#include "rFrustum.hpp"
 #include "rMatrixMath.hpp"
 #include "rShaderBase.hpp"
 #include <array>
@@ -52,6 +53,7 @@ namespace e_engine {
 #define NORMAL_MATRIX_FLAG ( 1 << 9 )
 
 class rPipeline;
+class rSceneBase;
 
 namespace internal {
 class rRendererBase;
@@ -117,6 +119,24 @@ class RENDER_API rObjectBase {
       UNDEFINED
    };
 
+   /*!
+    * \brief Index and vertex data ready for the upload (see setData)
+    *
+    * The vertices are interleaved in the order of the layout name (position, normal, uv, color).
+    * The pointers are only read during setData, so they may point into a memory mapped file.
+    */
+   struct MESH_DATA {
+      MESH_TYPES         type   = UNDEFINED_3D;
+      VERTEX_DATA_LAYOUT layout = UNDEFINED;
+
+      uint32_t const *index       = nullptr;
+      uint32_t        numIndices  = 0;
+      float const *   vertices    = nullptr;
+      uint32_t        numVertices = 0;
+
+      rBoundingVolume bounds;
+   };
+
    using UNIFORM_BUFFER = const rShaderBase::UniformBuffer *;
    using UNIFORM_VAR    = rShaderBase::UniformBuffer::Var;
    using PUSH_CONSTANT  = rShaderBase::PushConstantVar;
@@ -124,20 +144,26 @@ class RENDER_API rObjectBase {
  private:
    std::vector<rBuffer *> vLoadBuffers;
 
+   rSceneBase *vScene      = nullptr; //!< Set by rSceneBase::addObject
+   unsigned    vSceneIndex = 0;       //!< The index in vScene
+
+   friend class rSceneBase;
+
  protected:
    std::string vName_str;
 
+   bool       vDataStarted_B   = false; //!< Between beginData and endData / cancelData
    bool       vPartialLoaded_B = false;
    bool       vIsLoaded_B      = false;
    rPipeline *vPipeline        = nullptr;
 
-   virtual std::vector<rBuffer *> setData_IMPL( VkCommandBuffer,
-                                                std::vector<uint32_t> const &,
-                                                std::vector<float> const & ) {
-      return {};
-   };
+   rBoundingVolume vBoundingVolume; //!< Of the mesh passed to endData (object space)
+
+   virtual bool beginData_IMPL( uint32_t, uint32_t, uint32_t **, float ** ) { return false; }
+   virtual std::vector<rBuffer *> endData_IMPL( VkCommandBuffer ) { return {}; }
+   virtual void cancelData_IMPL() {}
 
-   bool setupVertexData_PN( aiMesh const *_mesh, std::vector<float> &_out );
+   void signalMatricesChanged();
 
  public:
    rObjectBase( std::string _name ) : vName_str( _name ) {}
@@ -157,6 +183,14 @@ class RENDER_API rObjectBase {
    virtual ~rObjectBase();
 
    bool setData( VkCommandBuffer _buf, aiMesh const *_mesh );
+   bool setData( VkCommandBuffer _buf, MESH_DATA const &_mesh );
+
+   bool beginData( uint32_t   _numIndices,
+                   uint32_t   _numVertices,
+                   uint32_t **_index,
+                   float **   _vertices );
+   bool endData( VkCommandBuffer _buf, rBoundingVolume const &_bounds );
+   void cancelData();
 
    bool finishData();
 
@@ -168,10 +202,36 @@ class RENDER_API rObjectBase {
    virtual void signalRenderReset( internal::rRendererBase * ) {}
    virtual bool supportsPushConstants() { return false; };
 
+   /*!
+    * \brief Returns the matrices for frustum culling (from the render thread)
+    * \returns false if the object can not be culled (always rendered)
+    */
+   virtual bool getCullingMatrices( rMat4f const **, rMat4f const ** ) { return false; }
+
+   /*!
+    * \brief Copies the current model matrix (from the game logic, not the render snapshot)
+    * \returns false if the object has no model matrix
+    */
+   virtual bool copyModelMatrix( rMat4f & ) { return false; }
+
+   /*!
+    * \brief Sets the world matrix of the parent (nullptr: no parent), see rSceneBase::attachObject
+    * \returns false if the object has no model matrix
+    */
+   virtual bool setParentTransform( rMat4f const * ) { return false; }
+
+   //! Publishes the matrices for the render thread (see rMatrixObjectBase::updateFinalMatrix)
+   virtual void publishMatrices() {}
+
+   //! Selects the published matrices of the next frame (see rMatrixObjectBase::latchRenderMatrices)
+   virtual void latchMatrices() {}
+
    rPipeline *  getPipeline() { return vPipeline; }
    rShaderBase *getShader();
    bool         getIsDataLoaded() const { return vIsLoaded_B; }
    std::string  getName() const { return vName_str; }
+
+   rBoundingVolume const &getBoundingVolume() const { return vBoundingVolume; }
    bool setPipeline( rPipeline *_pipe );
 
    virtual uint32_t getMatrix( rMat4f **_mat, MATRIX_TYPES _type );
@@ -185,6 +245,15 @@ class RENDER_API rObjectBase {
 
    virtual uint32_t getVector( rVec3f **_vec, VECTOR_TYPES _type );
    virtual uint32_t getVector( rVec3d **_vec, VECTOR_TYPES _type );
+
+   static uint32_t getIndexSize( MESH_TYPES _type );
+   static uint32_t getVertexStride( VERTEX_DATA_LAYOUT _layout );
+
+   static bool packMesh( aiMesh const *     _mesh,
+                         MESH_TYPES         _type,
+                         VERTEX_DATA_LAYOUT _layout,
+                         uint32_t *         _index,
+                         float *            _vertices );
 };
 
 
@@ -45,8 +45,8 @@ void rSimpleMesh::record( VkCommandBuffer _buf ) {
    vPipeline->cmdBindPipeline( _buf, VK_PIPELINE_BIND_POINT_GRAPHICS );
 
    if ( vHasModelMatrix_PC ) {
-      std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
-      vShader->cmdUpdatePushConstant( _buf, vMatrixModelVar_PC, getModelMatrix()->getMatrix() );
+      RENDER_MATRICES const *lMatrices = getRenderMatrices();
+      vShader->cmdUpdatePushConstant( _buf, vMatrixModelVar_PC, lMatrices->model.getMatrix() );
    }
 
    vkCmdBindVertexBuffers( _buf, vPipeline->getVertexBindPoint(), 1, &lVertex, &lOffsets[0] );
@@ -58,17 +58,35 @@ void rSimpleMesh::record( VkCommandBuffer _buf ) {
  * \brief Inits the object (partialy)
  * \note This function SHOULD NOT be called directly! Use the functions in rScene instead!
  */
-std::vector<rBuffer *> rSimpleMesh::setData_IMPL( VkCommandBuffer              _buf,
-                                                  const std::vector<uint32_t> &_index,
-                                                  const std::vector<float> &   _data ) {
+bool rSimpleMesh::beginData_IMPL( uint32_t   _numIndices,
+                                  uint32_t   _numFloats,
+                                  uint32_t **_index,
+                                  float **   _vertices ) {
    iLOG( "Initializing simple mesh object ", vName_str );
 
-   vIndex.cmdInit( _index, _buf, VK_BUFFER_USAGE_INDEX_BUFFER_BIT );
-   vVertex.cmdInit( _data, _buf, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+   *_index    = vIndex.beginInit<uint32_t>( _numIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT );
+   *_vertices = vVertex.beginInit<float>( _numFloats, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+
+   if ( !*_index || !*_vertices ) {
+      cancelData_IMPL();
+      return false;
+   }
+
+   return true;
+}
+
+std::vector<rBuffer *> rSimpleMesh::endData_IMPL( VkCommandBuffer _buf ) {
+   vIndex.cmdEndInit( _buf );
+   vVertex.cmdEndInit( _buf );
 
    return {&vIndex, &vVertex};
 }
 
+void rSimpleMesh::cancelData_IMPL() {
+   vIndex.cancelInit();
+   vVertex.cancelInit();
+}
+
 void rSimpleMesh::signalRenderReset( internal::rRendererBase * ) {
    if ( !vPipeline ) {
       eLOG( "Pipeline not setup!" );
@@ -115,15 +133,39 @@ void rSimpleMesh::updateUniforms() {
       return;
    }
 
-   if ( vHasMVPMatrix ) {
-      std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
-      vShader->updateUniform( vMatrixMVPVar, getModelViewProjectionMatrix()->getMatrix() );
-   }
+   // Lock free snapshot of this frame (latched by rRendererBase::updateUniforms)
+   RENDER_MATRICES const *lMatrices = getRenderMatrices();
 
-   if ( vHasVPMatrix ) {
-      std::lock_guard<std::recursive_mutex> lLock( vMatrixAccess );
-      vShader->updateUniform( vMatrixVPVar, getViewProjectionMatrix()->getMatrix() );
-   }
+   if ( vHasMVPMatrix )
+      vShader->updateUniform( vMatrixMVPVar, lMatrices->modelViewProjection.getMatrix() );
+
+   if ( vHasVPMatrix )
+      vShader->updateUniform( vMatrixVPVar, lMatrices->viewProjection.getMatrix() );
+}
+
+/*!
+ * \brief Returns the matrices of the latched snapshot (see rMatrixObjectBase::getRenderMatrices)
+ */
+bool rSimpleMesh::getCullingMatrices( rMat4f const **_model, rMat4f const **_viewProjection ) {
+   RENDER_MATRICES const *lMatrices = getRenderMatrices();
+
+   *_model          = &lMatrices->model;
+   *_viewProjection = &lMatrices->viewProjection;
+   return true;
+}
+
+bool rSimpleMesh::copyModelMatrix( rMat4f &_model ) {
+   getModelMatrix( _model );
+   return true;
+}
+
+bool rSimpleMesh::setParentTransform( rMat4f const *_parent ) {
+   if ( _parent )
+      setParentMatrix( *_parent );
+   else
+      clearParentMatrix();
+
+   return true;
 }
 
 bool rSimpleMesh::checkIsCompatible( rPipeline *_pipe ) {
@@ -46,9 +46,14 @@ class RENDER_API rSimpleMesh final : public rMatrixObjectBase<float>, public rOb
    bool          vHasVPMatrix       = false;
    bool          vHasModelMatrix_PC = false;
 
-   std::vector<rBuffer *> setData_IMPL( VkCommandBuffer              _buf,
-                                        const std::vector<uint32_t> &_index,
-                                        const std::vector<float> &   _data ) override;
+   bool beginData_IMPL( uint32_t   _numIndices,
+                        uint32_t   _numFloats,
+                        uint32_t **_index,
+                        float **   _vertices ) override;
+   std::vector<rBuffer *> endData_IMPL( VkCommandBuffer _buf ) override;
+   void cancelData_IMPL() override;
+
+   void matricesChanged() override { signalMatricesChanged(); }
 
    VERTEX_DATA_LAYOUT getDataLayout() const override { return POS_NORM; }
    MESH_TYPES         getMeshType() const override { return MESH_3D; }
@@ -65,6 +70,11 @@ class RENDER_API rSimpleMesh final : public rMatrixObjectBase<float>, public rOb
 
    bool isMesh() override { return true; }
    bool supportsPushConstants() override { return vHasModelMatrix_PC; }
+   bool getCullingMatrices( rMat4f const **_model, rMat4f const **_viewProjection ) override;
+   bool copyModelMatrix( rMat4f &_model ) override;
+   bool setParentTransform( rMat4f const *_parent ) override;
+   void publishMatrices() override { updateFinalMatrix(); }
+   void latchMatrices() override { latchRenderMatrices(); }
    void record( VkCommandBuffer _buf ) override;
    void updateUniforms() override;
    void signalRenderReset( internal::rRendererBase * ) override;
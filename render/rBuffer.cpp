@@ -25,7 +25,6 @@
 #include "iInit.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
-#include <string.h> // memcpy
 
 namespace e_engine {
 
@@ -34,6 +33,8 @@ rBuffer::rBuffer( rWorld *_tempWorld ) : rBuffer( _tempWorld->getInitPtr() ) {}
 rBuffer::rBuffer( iInit *_init ) : vDevice_vk( _init->getDevice() ), vInitPtr( _init ) {}
 
 rBuffer::~rBuffer() {
+   cancelInit();
+
    if ( vIsLoaded )
       destroy();
 }
@@ -60,44 +61,31 @@ bool rBuffer::errorCleanup() {
 }
 
 /*!
- * \brief Creates the buffer
+ * \brief Creates the buffer and returns the mapped staging memory
  * \vkIntern
  *
- * This function creates the buffers and allocates the memory for the data. The command buffer must
- * be submitted to a queue supporting TRANSFER before the buffer can be marked ready with
- * doneCopying()
+ * This function creates the buffers and allocates the memory for the data. The data must be
+ * written into the returned memory before cmdEndInit() records the copy command; the staging
+ * memory can be written from any thread. The command buffer must be submitted to a queue supporting
+ * TRANSFER before the buffer can be marked ready with doneCopying()
  *
- * \returns true on success
- * \todo concurrent sharing mode and sparse binding (both only if necessary)
+ * \param[in] _size  The size of the buffer in bytes
+ * \param[in] _flags The usage of the buffer
  *
- * Available data types:
- *  - double
- *  - float
- *  - uint8_t
- *  - uint16_t
- *  - uint32_t
- *  - uint64_t
- *  - int8_t
- *  - int16_t
- *  - int32_t
- *  - int64_t
+ * \returns the staging memory or nullptr on error
+ * \todo concurrent sharing mode and sparse binding (both only if necessary)
  */
-template <class T>
-bool rBuffer::cmdInit( std::vector<T> const &_data,
-                       VkCommandBuffer       _buff,
-                       VkBufferUsageFlags    _flags ) {
+void *rBuffer::beginInitBytes( size_t _size, VkBufferUsageFlags _flags ) {
    if ( vIsLoaded ) {
       eLOG( "Data already loaded!" );
-      return false;
+      return nullptr;
    }
 
-   if ( vSettingUpInProgress ) {
+   if ( vSettingUpInProgress || vStaging ) {
       eLOG( "Init not finished jet! This init stage is already complete" );
-      return false;
+      return nullptr;
    }
 
-   void *lData;
-
    uint32_t lIndex_temp  = 0;
    uint32_t lIndex_final = 0;
 
@@ -109,7 +97,7 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
    lBuffInfo.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
    lBuffInfo.pNext                 = nullptr;
    lBuffInfo.flags                 = 0;
-   lBuffInfo.size                  = _data.size() * sizeof( T );
+   lBuffInfo.size                  = _size;
    lBuffInfo.usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
    lBuffInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
    lBuffInfo.queueFamilyIndexCount = 0;
@@ -117,21 +105,23 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
 
 #if D_LOG_VULKAN
    dLOG( "Creating buffer:" );
-   dLOG( "  -- size:  ", _data.size() * sizeof( T ), " = ", _data.size(), "*", sizeof( T ) );
+   dLOG( "  -- size:  ", _size );
    dLOG( "  -- usage: ", uEnum2Str::toStr( static_cast<VkBufferUsageFlagBits>( _flags ) ) );
 #endif
 
    auto lRes = vkCreateBuffer( vDevice_vk, &lBuffInfo, nullptr, &vTempBuffer_vk );
    if ( lRes ) {
       eLOG( "'vkCreateBuffer' returned ", uEnum2Str::toStr( lRes ) );
-      return errorCleanup();
+      errorCleanup();
+      return nullptr;
    }
 
    lBuffInfo.usage = _flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
    lRes            = vkCreateBuffer( vDevice_vk, &lBuffInfo, nullptr, &vBuffer_vk );
    if ( lRes ) {
       eLOG( "'vkCreateBuffer' returned ", uEnum2Str::toStr( lRes ) );
-      return errorCleanup();
+      errorCleanup();
+      return nullptr;
    }
 
    // =================
@@ -150,7 +140,8 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
 
    if ( lIndex_temp == UINT32_MAX || lIndex_final == UINT32_MAX ) {
       eLOG( "Unable to find memory type" );
-      return errorCleanup();
+      errorCleanup();
+      return nullptr;
    }
 
    VkMemoryAllocateInfo lAllocInfo = {};
@@ -161,7 +152,8 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
    lRes = vkAllocateMemory( vDevice_vk, &lAllocInfo, nullptr, &vMemTemp_vk );
    if ( lRes ) {
       eLOG( "'vkAllocateMemory' returned ", uEnum2Str::toStr( lRes ) );
-      return errorCleanup();
+      errorCleanup();
+      return nullptr;
    }
 
    lAllocInfo.allocationSize  = lMemReqs_final.size;
@@ -169,31 +161,43 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
    lRes                       = vkAllocateMemory( vDevice_vk, &lAllocInfo, nullptr, &vMem_vk );
    if ( lRes ) {
       eLOG( "'vkAllocateMemory' returned ", uEnum2Str::toStr( lRes ) );
-      return errorCleanup();
+      errorCleanup();
+      return nullptr;
    }
 
-   // ===========
-   // Copy memory
-   // ===========
-
    // Make device memory available
-   lRes = vkMapMemory( vDevice_vk, vMemTemp_vk, 0, lAllocInfo.allocationSize, 0, &lData );
+   lRes = vkMapMemory( vDevice_vk, vMemTemp_vk, 0, VK_WHOLE_SIZE, 0, &vStaging );
    if ( lRes ) {
       eLOG( "'vkMapMemory' returned ", uEnum2Str::toStr( lRes ) );
-      return errorCleanup();
+      vStaging = nullptr;
+      errorCleanup();
+      return nullptr;
    }
 
-   // Copy the data into the device memory
-   memcpy( lData, _data.data(), _data.size() * sizeof( T ) );
+   vStagingSize = _size;
+   return vStaging;
+}
+
+/*!
+ * \brief Records the copy from the staging memory (see beginInit) into the final buffer
+ * \vkIntern
+ * \returns true on success
+ */
+bool rBuffer::cmdEndInit( VkCommandBuffer _buff ) {
+   if ( !vStaging ) {
+      eLOG( "beginInit not called!" );
+      return false;
+   }
 
    // Done copying
    vkUnmapMemory( vDevice_vk, vMemTemp_vk );
+   vStaging = nullptr;
 
    // ============
    // Bind Buffers
    // ============
 
-   lRes = vkBindBufferMemory( vDevice_vk, vTempBuffer_vk, vMemTemp_vk, 0 );
+   auto lRes = vkBindBufferMemory( vDevice_vk, vTempBuffer_vk, vMemTemp_vk, 0 );
    if ( lRes ) {
       eLOG( "'vkBindBufferMemory' returned ", uEnum2Str::toStr( lRes ) );
       return errorCleanup();
@@ -213,15 +217,27 @@ bool rBuffer::cmdInit( std::vector<T> const &_data,
    VkBufferCopy lRegion = {};
    lRegion.srcOffset    = 0;
    lRegion.dstOffset    = 0;
-   lRegion.size         = _data.size() * sizeof( T );
+   lRegion.size         = vStagingSize;
 
    vkCmdCopyBuffer( _buff, vTempBuffer_vk, vBuffer_vk, 1, &lRegion );
 
-   vSize                = _data.size();
    vSettingUpInProgress = true;
    return true;
 }
 
+/*!
+ * \brief Frees everything allocated by beginInit (when the data could not be written)
+ */
+void rBuffer::cancelInit() {
+   if ( !vStaging )
+      return;
+
+   vkUnmapMemory( vDevice_vk, vMemTemp_vk );
+   vStaging = nullptr;
+   vSize    = 0;
+   errorCleanup();
+}
+
 
 /*!
  * \brief Signals the buffer object that the command buffer has executed
@@ -289,36 +305,4 @@ VkBuffer rBuffer::getBuffer() {
 
    return vBuffer_vk;
 }
-
-// Explicit isntanciate rBuffer::cmdInit
-template bool rBuffer::cmdInit<double>( std::vector<double> const &,
-                                        VkCommandBuffer,
-                                        VkBufferUsageFlags );
-template bool rBuffer::cmdInit<float>( std::vector<float> const &,
-                                       VkCommandBuffer,
-                                       VkBufferUsageFlags );
-template bool rBuffer::cmdInit<uint8_t>( std::vector<uint8_t> const &,
-                                         VkCommandBuffer,
-                                         VkBufferUsageFlags );
-template bool rBuffer::cmdInit<uint16_t>( std::vector<uint16_t> const &,
-                                          VkCommandBuffer,
-                                          VkBufferUsageFlags );
-template bool rBuffer::cmdInit<uint32_t>( std::vector<uint32_t> const &,
-                                          VkCommandBuffer,
-                                          VkBufferUsageFlags );
-template bool rBuffer::cmdInit<uint64_t>( std::vector<uint64_t> const &,
-                                          VkCommandBuffer,
-                                          VkBufferUsageFlags );
-template bool rBuffer::cmdInit<int8_t>( std::vector<int8_t> const &,
-                                        VkCommandBuffer,
-                                        VkBufferUsageFlags );
-template bool rBuffer::cmdInit<int16_t>( std::vector<int16_t> const &,
-                                         VkCommandBuffer,
-                                         VkBufferUsageFlags );
-template bool rBuffer::cmdInit<int32_t>( std::vector<int32_t> const &,
-                                         VkCommandBuffer,
-                                         VkBufferUsageFlags );
-template bool rBuffer::cmdInit<int64_t>( std::vector<int64_t> const &,
-                                         VkCommandBuffer,
-                                         VkBufferUsageFlags );
 }
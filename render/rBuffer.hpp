@@ -22,6 +22,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include <cstring>
 #include <vector>
 #include <vulkan.h>
 
@@ -46,7 +47,11 @@ class rBuffer {
 
    uint32_t vSize = 0;
 
+   void *       vStaging     = nullptr; //!< Mapped staging memory between beginInit and cmdEndInit
+   VkDeviceSize vStagingSize = 0;
+
    bool errorCleanup();
+   void *beginInitBytes( size_t _size, VkBufferUsageFlags _flags );
 
  public:
    rBuffer() = delete;
@@ -58,8 +63,40 @@ class rBuffer {
    rBuffer &operator=( rBuffer && ) = default;
    virtual ~rBuffer();
 
+   /*!
+    * \brief Creates the buffer for _num elements and returns the mapped staging memory
+    * \returns the staging memory or nullptr on error
+    */
+   template <class T>
+   T *beginInit( size_t _num, VkBufferUsageFlags _flags ) {
+      T *lStaging = static_cast<T *>( beginInitBytes( _num * sizeof( T ), _flags ) );
+      if ( lStaging )
+         vSize = static_cast<uint32_t>( _num );
+
+      return lStaging;
+   }
+
+   bool cmdEndInit( VkCommandBuffer _buff );
+   void cancelInit();
+
+   /*!
+    * \brief Creates the buffer and records the upload of _num elements
+    * \param[in] _data Only read during this call (may point into a memory mapped file)
+    */
+   template <class T>
+   bool cmdInit( T const *_data, size_t _num, VkCommandBuffer _buff, VkBufferUsageFlags _flags ) {
+      T *lStaging = beginInit<T>( _num, _flags );
+      if ( !lStaging )
+         return false;
+
+      memcpy( lStaging, _data, _num * sizeof( T ) );
+      return cmdEndInit( _buff );
+   }
+
    template <class T>
-   bool cmdInit( std::vector<T> const &_data, VkCommandBuffer _buff, VkBufferUsageFlags _flags );
+   bool cmdInit( std::vector<T> const &_data, VkCommandBuffer _buff, VkBufferUsageFlags _flags ) {
+      return cmdInit( _data.data(), _data.size(), _buff, _flags );
+   }
 
    bool doneCopying();
    bool destroy();
@@ -0,0 +1,383 @@
+/*!
+ * \file rMeshCache.cpp
+ * \brief \b Classes: \a rMeshCache
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rMeshCache.hpp"
+#include "uFileIO.hpp"
+#include "uLog.hpp"
+#include <cstring>
+#include FILESYSTEM_INCLUDE
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace e_engine {
+
+struct rMeshCache::Header {
+   uint64_t      magic;
+   uint32_t      version;
+   uint32_t      entrySize;
+   uint64_t      fileSize;
+   uint32_t      importFlags;
+   uint32_t      layout;
+   uint32_t      numMeshes;
+   uint32_t      digestLength;
+   unsigned char digest[64];
+   uint64_t      reserved[3];
+};
+
+struct rMeshCache::Entry {
+   uint64_t indexOffset;  //!< From the start of the file
+   uint64_t vertexOffset; //!< From the start of the file
+   uint64_t nameOffset;   //!< From the start of the file
+   uint32_t nameLength;
+   uint32_t type;
+   uint32_t layout; //!< UNDEFINED: mesh not stored
+   uint32_t numIndices;
+   uint32_t numVertices;
+   float    min[3];
+   float    max[3];
+   float    center[3];
+   float    radius;
+   uint32_t reserved;
+};
+
+namespace {
+
+const uint64_t CACHE_MAGIC   = 0x48534d4e47455245ULL;
+const uint32_t CACHE_VERSION = 1;
+const uint64_t DATA_ALIGN    = 64; //!< Alignment of the index and vertex arrays
+
+uint64_t alignUp( uint64_t _offset ) { return ( _offset + DATA_ALIGN - 1 ) & ~( DATA_ALIGN - 1 ); }
+
+//! True if [_offset, _offset + _size) is inside a file of _fileSize bytes
+bool inFile( uint64_t _offset, uint64_t _size, uint64_t _fileSize ) {
+   return _offset <= _fileSize && _size <= _fileSize - _offset;
+}
+}
+
+
+rMeshCache::~rMeshCache() { close(); }
+
+/*!
+ * \brief Opens a cache file
+ *
+ * \param[in] _file        The cache file
+ * \param[in] _digest      The digest of the source file
+ * \param[in] _importFlags The assimp post processing flags used for the import
+ * \param[in] _layout      The expected vertex layout
+ *
+ * \returns false if the file does not exist or does not match the parameters
+ */
+bool rMeshCache::open( std::string const &             _file,
+                       DIGEST const &                  _digest,
+                       uint32_t                        _importFlags,
+                       rObjectBase::VERTEX_DATA_LAYOUT _layout ) {
+   static_assert( sizeof( Header ) == 128, "Unexpected mesh cache header size" );
+   static_assert( sizeof( Entry ) == 88, "Unexpected mesh cache entry size" );
+
+   close();
+
+   if ( !mapFile( _file ) )
+      return false;
+
+   if ( !parse( _digest, _importFlags, _layout ) ) {
+      wLOG( "Ignoring the outdated or invalid mesh cache '", _file, "'" );
+      close();
+      return false;
+   }
+
+   return true;
+}
+
+void rMeshCache::close() {
+#if UNIX
+   if ( vMapped_B )
+      munmap( const_cast<unsigned char *>( vData ), vSize );
+#endif
+
+   vData     = nullptr;
+   vSize     = 0;
+   vMapped_B = false;
+   vLocal.clear();
+   vMeshes.clear();
+}
+
+/*!
+ * \brief Maps the file into memory (or reads it if mapping is not possible)
+ */
+bool rMeshCache::mapFile( std::string const &_file ) {
+   if ( !FILESYSTEM_NAMESPACE::exists( _file.c_str() ) )
+      return false;
+
+#if UNIX
+   int lFD = ::open( _file.c_str(), O_RDONLY | O_CLOEXEC );
+   if ( lFD < 0 )
+      return false;
+
+   struct stat lStat;
+   if ( fstat( lFD, &lStat ) != 0 || static_cast<size_t>( lStat.st_size ) < sizeof( Header ) ) {
+      ::close( lFD );
+      return false;
+   }
+
+   size_t lSize = static_cast<size_t>( lStat.st_size );
+   void * lMap  = mmap( nullptr, lSize, PROT_READ, MAP_PRIVATE, lFD, 0 );
+   ::close( lFD );
+
+   if ( lMap != MAP_FAILED ) {
+      // Everything is copied into staging buffers right after opening
+      madvise( lMap, lSize, MADV_WILLNEED );
+
+      vData     = static_cast<unsigned char const *>( lMap );
+      vSize     = lSize;
+      vMapped_B = true;
+      return true;
+   }
+#endif
+
+   uFileIO lFile( _file );
+   if ( lFile.read() != 1 )
+      return false;
+
+   vLocal.assign( lFile.begin(), lFile.end() );
+   if ( vLocal.size() < sizeof( Header ) ) {
+      vLocal.clear();
+      return false;
+   }
+
+   vData = vLocal.data();
+   vSize = vLocal.size();
+   return true;
+}
+
+/*!
+ * \brief Checks the header and the entries and sets up vMeshes
+ *
+ * Only the header, the entries and the names are read; the index and vertex data is not touched.
+ */
+bool rMeshCache::parse( DIGEST const &                  _digest,
+                        uint32_t                        _importFlags,
+                        rObjectBase::VERTEX_DATA_LAYOUT _layout ) {
+   Header const *lHeader = reinterpret_cast<Header const *>( vData );
+
+   if ( lHeader->magic != CACHE_MAGIC || lHeader->version != CACHE_VERSION ||
+        lHeader->entrySize != sizeof( Entry ) || lHeader->fileSize != vSize ||
+        lHeader->importFlags != _importFlags ||
+        lHeader->layout != static_cast<uint32_t>( _layout ) )
+      return false;
+
+   if ( _digest.empty() || lHeader->digestLength != _digest.size() ||
+        _digest.size() > sizeof( lHeader->digest ) ||
+        memcmp( lHeader->digest, _digest.data(), _digest.size() ) != 0 )
+      return false;
+
+   if ( !inFile( sizeof( Header ), uint64_t( lHeader->numMeshes ) * sizeof( Entry ), vSize ) )
+      return false;
+
+   uint32_t lStride    = rObjectBase::getVertexStride( _layout );
+   auto     lFirstMesh = reinterpret_cast<Entry const *>( vData + sizeof( Header ) );
+
+   vMeshes.resize( lHeader->numMeshes );
+   for ( uint32_t i = 0; i < lHeader->numMeshes; ++i ) {
+      Entry const &lEntry = lFirstMesh[i];
+      MESH &       lMesh  = vMeshes[i];
+
+      if ( !inFile( lEntry.nameOffset, lEntry.nameLength, vSize ) )
+         return false;
+
+      lMesh.name.assign( reinterpret_cast<char const *>( vData + lEntry.nameOffset ),
+                         lEntry.nameLength );
+      lMesh.data.type = static_cast<MESH_TYPES>( lEntry.type );
+
+      if ( lEntry.layout == rObjectBase::UNDEFINED )
+         continue; // Not stored --> imported with assimp
+
+      uint32_t lIndexSize = rObjectBase::getIndexSize( lMesh.data.type );
+      if ( lEntry.layout != static_cast<uint32_t>( _layout ) || lIndexSize == 0 ||
+           lEntry.numIndices % lIndexSize != 0 )
+         return false;
+
+      uint64_t lIndexBytes  = uint64_t( lEntry.numIndices ) * sizeof( uint32_t );
+      uint64_t lVertexBytes = uint64_t( lEntry.numVertices ) * lStride * sizeof( float );
+
+      if ( lEntry.indexOffset % DATA_ALIGN != 0 || lEntry.vertexOffset % DATA_ALIGN != 0 ||
+           !inFile( lEntry.indexOffset, lIndexBytes, vSize ) ||
+           !inFile( lEntry.vertexOffset, lVertexBytes, vSize ) )
+         return false;
+
+      lMesh.data.layout      = _layout;
+      lMesh.data.index       = reinterpret_cast<uint32_t const *>( vData + lEntry.indexOffset );
+      lMesh.data.numIndices  = lEntry.numIndices;
+      lMesh.data.vertices    = reinterpret_cast<float const *>( vData + lEntry.vertexOffset );
+      lMesh.data.numVertices = lEntry.numVertices;
+
+      rBoundingVolume &lBounds = lMesh.data.bounds;
+      lBounds.min.setMat( lEntry.min[0], lEntry.min[1], lEntry.min[2] );
+      lBounds.max.setMat( lEntry.max[0], lEntry.max[1], lEntry.max[2] );
+      lBounds.center.setMat( lEntry.center[0], lEntry.center[1], lEntry.center[2] );
+      lBounds.radius = lEntry.radius;
+   }
+
+   return true;
+}
+
+
+/*!
+ * \brief Converts all meshes of a scene and writes them into a cache file
+ *
+ * Missing directories are created.
+ *
+ * \param[in] _file        The cache file (replaced if it exists)
+ * \param[in] _digest      The digest of the source file
+ * \param[in] _importFlags The assimp post processing flags used for the import
+ * \param[in] _layout      The vertex layout of all meshes
+ * \param[in] _scene       The imported scene
+ *
+ * \returns true on success
+ */
+bool rMeshCache::write( std::string const &             _file,
+                        DIGEST const &                  _digest,
+                        uint32_t                        _importFlags,
+                        rObjectBase::VERTEX_DATA_LAYOUT _layout,
+                        aiScene const *                 _scene ) {
+   uint32_t lStride = rObjectBase::getVertexStride( _layout );
+
+   if ( !_scene || lStride == 0 || _digest.empty() || _digest.size() > 64 ) {
+      eLOG( "Invalid parameters for the mesh cache '", _file, "'" );
+      return false;
+   }
+
+   uint32_t           lNumMeshes = _scene->mNumMeshes;
+   std::vector<Entry> lEntries( lNumMeshes );
+
+   // Compute the offsets first, so the meshes can be converted in place
+   uint64_t lOffset = sizeof( Header ) + uint64_t( lNumMeshes ) * sizeof( Entry );
+   for ( uint32_t i = 0; i < lNumMeshes; ++i ) {
+      aiMesh const *lMesh  = _scene->mMeshes[i];
+      Entry &       lEntry = lEntries[i];
+
+      memset( &lEntry, 0, sizeof( Entry ) );
+      lEntry.nameOffset = lOffset;
+      lEntry.nameLength = lMesh->mName.length;
+      lEntry.type       = getMeshType( lMesh );
+      lEntry.layout     = rObjectBase::UNDEFINED;
+      lOffset += lEntry.nameLength;
+
+      uint32_t lIndexSize = rObjectBase::getIndexSize( static_cast<MESH_TYPES>( lEntry.type ) );
+      if ( lIndexSize == 0 )
+         continue;
+
+      lEntry.layout       = _layout;
+      lEntry.numIndices   = lMesh->mNumFaces * lIndexSize;
+      lEntry.numVertices  = lMesh->mNumVertices;
+      lEntry.indexOffset  = alignUp( lOffset );
+      lEntry.vertexOffset = alignUp( lEntry.indexOffset + lEntry.numIndices * sizeof( uint32_t ) );
+      lOffset = lEntry.vertexOffset + uint64_t( lEntry.numVertices ) * lStride * sizeof( float );
+   }
+
+   std::string lData( static_cast<size_t>( lOffset ), '\0' );
+   char *      lBase = &lData[0];
+
+   for ( uint32_t i = 0; i < lNumMeshes; ++i ) {
+      aiMesh const *lMesh  = _scene->mMeshes[i];
+      Entry &       lEntry = lEntries[i];
+
+      memcpy( lBase + lEntry.nameOffset, lMesh->mName.C_Str(), lEntry.nameLength );
+
+      if ( lEntry.layout == rObjectBase::UNDEFINED )
+         continue;
+
+      auto lIndex    = reinterpret_cast<uint32_t *>( lBase + lEntry.indexOffset );
+      auto lVertices = reinterpret_cast<float *>( lBase + lEntry.vertexOffset );
+
+      if ( !rObjectBase::packMesh(
+                 lMesh, static_cast<MESH_TYPES>( lEntry.type ), _layout, lIndex, lVertices ) ) {
+         // Missing attributes --> the mesh is not cached
+         lEntry.layout      = rObjectBase::UNDEFINED;
+         lEntry.numIndices  = 0;
+         lEntry.numVertices = 0;
+         continue;
+      }
+
+      rBoundingVolume lBounds =
+            rBoundingVolume::fromPoints( lVertices, lEntry.numVertices, lStride );
+
+      for ( uint32_t j = 0; j < 3; ++j ) {
+         lEntry.min[j]    = lBounds.min[j];
+         lEntry.max[j]    = lBounds.max[j];
+         lEntry.center[j] = lBounds.center[j];
+      }
+
+      lEntry.radius = lBounds.radius;
+   }
+
+   Header lHeader;
+   memset( &lHeader, 0, sizeof( Header ) );
+   lHeader.magic        = CACHE_MAGIC;
+   lHeader.version      = CACHE_VERSION;
+   lHeader.entrySize    = sizeof( Entry );
+   lHeader.fileSize     = lOffset;
+   lHeader.importFlags  = _importFlags;
+   lHeader.layout       = _layout;
+   lHeader.numMeshes    = lNumMeshes;
+   lHeader.digestLength = static_cast<uint32_t>( _digest.size() );
+   memcpy( lHeader.digest, _digest.data(), _digest.size() );
+
+   memcpy( lBase, &lHeader, sizeof( Header ) );
+   memcpy( lBase + sizeof( Header ), lEntries.data(), lNumMeshes * sizeof( Entry ) );
+
+   FILESYSTEM_NAMESPACE::path lDir = FILESYSTEM_NAMESPACE::path( _file.c_str() ).parent_path();
+   if ( !lDir.empty() && !FILESYSTEM_NAMESPACE::exists( lDir ) ) {
+      std::error_code lError;
+      if ( !FILESYSTEM_NAMESPACE::create_directories( lDir, lError ) ) {
+         eLOG( "Failed to create the mesh cache directory '", lDir.string(), "'" );
+         return false;
+      }
+   }
+
+   // Losing the cache only costs an import --> no sync
+   if ( uFileIO( _file ).write( lData, true, uFileIO::SYNC_NONE ) != 1 ) {
+      eLOG( "Failed to write the mesh cache '", _file, "'" );
+      return false;
+   }
+
+   return true;
+}
+
+/*!
+ * \brief Returns the mesh type of the primitives of an assimp mesh
+ */
+MESH_TYPES rMeshCache::getMeshType( aiMesh const *_mesh ) {
+   switch ( _mesh->mPrimitiveTypes ) {
+      case aiPrimitiveType_POINT: return POINTS_3D;
+      case aiPrimitiveType_LINE: return LINES_3D;
+      case aiPrimitiveType_TRIANGLE: return MESH_3D;
+      case aiPrimitiveType_POLYGON: return POLYGON_3D;
+      default: return UNDEFINED_3D;
+   }
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,104 @@
+/*!
+ * \file rMeshCache.hpp
+ * \brief \b Classes: \a rMeshCache
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rObjectBase.hpp"
+#include <string>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::rMeshCache
+ * \brief Memory mapped cache of the meshes of an imported file
+ *
+ * write() stores the index and vertex data of every mesh of an aiScene in exactly the layout
+ * setData() uploads (one VERTEX_DATA_LAYOUT for the whole file), together with the bounding
+ * volumes and the mesh names. open() maps the file into memory (UNIX, read as a whole on other
+ * platforms) and only checks the header and the offsets, so the data can be uploaded straight
+ * from the mapping without touching it first.
+ *
+ * The cache is identified by the digest of the source file (see uHashCache), the assimp post
+ * processing flags and the layout. A file that does not match them is rejected by open(); write()
+ * replaces it atomically (see uFileIO::write), so a crash never leaves a broken cache behind.
+ *
+ * Meshes that can not be stored in the layout (missing attributes, polygons) are kept with the
+ * layout UNDEFINED and no data, so the mesh indexes stay the same as in the aiScene.
+ *
+ * \note The cache is written in the native byte order; other byte orders fail the magic check
+ */
+class RENDER_API rMeshCache final {
+ public:
+   typedef std::vector<unsigned char> DIGEST;
+
+   struct MESH {
+      std::string            name;
+      rObjectBase::MESH_DATA data; //!< Points into the mapping (valid until close())
+   };
+
+ private:
+   struct Header;
+   struct Entry;
+
+   unsigned char const *      vData     = nullptr;
+   size_t                     vSize     = 0;
+   bool                       vMapped_B = false;
+   std::vector<unsigned char> vLocal; //!< The file when it is not mapped
+
+   std::vector<MESH> vMeshes;
+
+   bool mapFile( std::string const &_file );
+   bool parse( DIGEST const &                  _digest,
+               uint32_t                        _importFlags,
+               rObjectBase::VERTEX_DATA_LAYOUT _layout );
+
+ public:
+   rMeshCache() = default;
+   ~rMeshCache();
+
+   rMeshCache( rMeshCache const & ) = delete;
+   rMeshCache &operator=( rMeshCache const & ) = delete;
+
+   bool open( std::string const &             _file,
+              DIGEST const &                  _digest,
+              uint32_t                        _importFlags,
+              rObjectBase::VERTEX_DATA_LAYOUT _layout );
+   void close();
+
+   static bool write( std::string const &             _file,
+                      DIGEST const &                  _digest,
+                      uint32_t                        _importFlags,
+                      rObjectBase::VERTEX_DATA_LAYOUT _layout,
+                      aiScene const *                 _scene );
+
+   static MESH_TYPES getMeshType( aiMesh const *_mesh );
+
+   bool        isOpen() const { return vData != nullptr; }
+   bool        isMapped() const { return vMapped_B; }
+   size_t      getNumMeshes() const { return vMeshes.size(); }
+   MESH const &getMesh( size_t _index ) const { return vMeshes[_index]; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -21,14 +21,45 @@
 #include "rWorld.hpp"
 #include "iInit.hpp"
 #include "uEnum2Str.hpp"
+#include "uFileIO.hpp"
 #include "uLog.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 #include <assimp/postprocess.h>
 
 namespace e_engine {
 
+namespace {
+
+const uint32_t IMPORT_FLAGS =
+      aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals |
+      aiProcess_JoinIdenticalVertices | aiProcess_SortByPType | aiProcess_RemoveRedundantMaterials |
+      aiProcess_GenUVCoords | aiProcess_FindDegenerates | aiProcess_FindInvalidData |
+      aiProcess_FixInfacingNormals | aiProcess_ImproveCacheLocality;
+
+std::string toHex( std::vector<unsigned char> const &_data ) {
+   static const char HEX[] = "0123456789abcdef";
+
+   std::string lResult;
+   for ( unsigned char i : _data ) {
+      lResult += HEX[i >> 4];
+      lResult += HEX[i & 0xF];
+   }
+
+   return lResult;
+}
+}
+
 
-rSceneBase::~rSceneBase() {}
+rSceneBase::~rSceneBase() {
+   // The objects may outlive the scene
+   for ( auto const &i : vObjects )
+      if ( i )
+         i->vScene = nullptr;
+}
 
 /*!
  * \brief Constructor
@@ -76,8 +107,79 @@ bool rSceneBase::canRenderScene() {
    return false;
 }
 
+/*!
+ * \brief Enables the mesh cache for the following loadFile() calls
+ *
+ * The meshes of every imported file are stored in _dir (in the layout _layout), keyed by the
+ * SHA-256 digest of the file. Loading the same file again only maps the cache file. Objects with
+ * another layout are still initialized from an assimp import of the file.
+ *
+ * \param[in] _dir    The cache directory (created if needed); empty disables the cache
+ * \param[in] _layout The layout of the cached vertex data
+ * \param[in] _cache  Optional hash cache (avoids hashing unchanged files); must outlive the scene
+ */
+void rSceneBase::setMeshCache( std::string                     _dir,
+                               rObjectBase::VERTEX_DATA_LAYOUT _layout,
+                               uHashCache *                    _cache ) {
+   std::lock_guard<std::recursive_mutex> lGuard( vObjectsInit_MUT );
+
+   vMeshCacheDir_str = _dir;
+   vMeshCacheLayout  = _layout;
+   vHashCache        = _cache;
+}
+
+/*!
+ * \brief Returns the name of the cache file of _file
+ * \param[in]  _file   The source file
+ * \param[out] _digest The digest of the source file
+ * \returns an empty string if the file could not be hashed
+ */
+std::string rSceneBase::getMeshCacheFile( std::string const &_file, rMeshCache::DIGEST &_digest ) {
+   int lRet;
+
+   if ( vHashCache && vHashCache->getType() == SHA2_256 ) {
+      lRet = vHashCache->hashFile( _file, _digest );
+   } else {
+      uSHA_2 lHasher( SHA2_256 );
+      lRet = uFileIO( _file ).readChunks( [&]( char const *_data, size_t _size ) {
+         lHasher.add( _data, _size );
+         return true;
+      } );
+
+      if ( lRet == 1 )
+         _digest = lHasher.end();
+   }
+
+   if ( lRet != 1 ) {
+      wLOG( "Failed to hash '", _file, "' -- not using the mesh cache" );
+      return "";
+   }
+
+   return vMeshCacheDir_str + "/" + toHex( _digest ) + "_" +
+          std::to_string( static_cast<uint32_t>( vMeshCacheLayout ) ) + ".mesh";
+}
+
+/*!
+ * \brief Imports vFile_str with assimp
+ */
+bool rSceneBase::importFile() {
+   vImporter_assimp.FreeScene();
+   vScene_assimp = vImporter_assimp.ReadFile( vFile_str, IMPORT_FLAGS );
+
+   if ( !vScene_assimp ) {
+      eLOG( "Loading ", vFile_str, " failed!" );
+      eLOG( vImporter_assimp.GetErrorString() );
+      return false;
+   }
+
+   return true;
+}
+
 /*!
  * \brief Parses and loads Object data form a file using assimp
+ *
+ * With a mesh cache (see setMeshCache) the file is only imported when it is not cached yet.
+ *
  * \param _file The file to load
  * \returns A vector of mesh names
  */
@@ -85,42 +187,50 @@ std::vector<rSceneBase::MeshInfo> rSceneBase::loadFile( std::string _file ) {
    std::lock_guard<std::recursive_mutex> lGuard( vObjectsInit_MUT );
 
    vImporter_assimp.FreeScene();
-   vScene_assimp = vImporter_assimp.ReadFile(
-         _file,
-         aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals |
-               aiProcess_JoinIdenticalVertices | aiProcess_SortByPType |
-               aiProcess_RemoveRedundantMaterials | aiProcess_GenUVCoords |
-               aiProcess_FindDegenerates | aiProcess_FindInvalidData |
-               aiProcess_FixInfacingNormals | aiProcess_ImproveCacheLocality );
+   vScene_assimp = nullptr;
+   vFile_str     = _file;
+   vMeshCache.close();
 
-   if ( !vScene_assimp ) {
-      eLOG( "Loading ", _file, " failed!" );
-      eLOG( vImporter_assimp.GetErrorString() );
-      return {};
+   std::vector<MeshInfo> lInfos;
+   MeshInfo              lTempInfo;
+   rMeshCache::DIGEST    lDigest;
+   std::string           lCacheFile;
+
+   if ( !vMeshCacheDir_str.empty() )
+      lCacheFile = getMeshCacheFile( _file, lDigest );
+
+   if ( !lCacheFile.empty() &&
+        vMeshCache.open( lCacheFile, lDigest, IMPORT_FLAGS, vMeshCacheLayout ) ) {
+      for ( uint32_t i = 0; i < vMeshCache.getNumMeshes(); i++ ) {
+         lTempInfo.index = i;
+         lTempInfo.name  = vMeshCache.getMesh( i ).name;
+         lTempInfo.type  = vMeshCache.getMesh( i ).data.type;
+         lInfos.emplace_back( lTempInfo );
+      }
+
+      iLOG( "Loaded ", _file, " from the mesh cache" );
+      return lInfos;
    }
 
+   if ( !importFile() )
+      return {};
 
    if ( !vScene_assimp->HasMeshes() ) {
       wLOG( "Imported file ", _file, " does not contain meshes!" );
       return {};
    }
 
-   std::vector<MeshInfo> lInfos;
-   MeshInfo              lTempInfo;
+   if ( !lCacheFile.empty() )
+      rMeshCache::write( lCacheFile, lDigest, IMPORT_FLAGS, vMeshCacheLayout, vScene_assimp );
+
    for ( uint32_t i = 0; i < vScene_assimp->mNumMeshes; i++ ) {
       const char *lTemp = vScene_assimp->mMeshes[i]->mName.C_Str();
       lTempInfo.index   = lInfos.size();
       lTempInfo.name    = vScene_assimp->mMeshes[i]->mName.length > 0 ? lTemp : "";
+      lTempInfo.type    = rMeshCache::getMeshType( vScene_assimp->mMeshes[i] );
 
-      switch ( vScene_assimp->mMeshes[i]->mPrimitiveTypes ) {
-         case aiPrimitiveType_POINT: lTempInfo.type    = POINTS_3D; break;
-         case aiPrimitiveType_LINE: lTempInfo.type     = LINES_3D; break;
-         case aiPrimitiveType_TRIANGLE: lTempInfo.type = MESH_3D; break;
-         case aiPrimitiveType_POLYGON: lTempInfo.type  = POLYGON_3D; break;
-         default:
-            lTempInfo.type = UNDEFINED_3D;
-            wLOG( "Unknown primitive type ", vScene_assimp->mMeshes[i]->mPrimitiveTypes );
-      }
+      if ( lTempInfo.type == UNDEFINED_3D )
+         wLOG( "Unknown primitive type ", vScene_assimp->mMeshes[i]->mPrimitiveTypes );
 
       lInfos.emplace_back( lTempInfo );
    }
@@ -131,6 +241,10 @@ std::vector<rSceneBase::MeshInfo> rSceneBase::loadFile( std::string _file ) {
 aiMesh const *rSceneBase::getAiMesh( uint32_t _objIndex ) {
    std::lock_guard<std::recursive_mutex> lGuard( vObjectsInit_MUT );
 
+   // Files loaded from the mesh cache are only imported when a mesh is not in the cache
+   if ( !vScene_assimp && !vFile_str.empty() && !importFile() )
+      return nullptr;
+
    if ( !vScene_assimp ) {
       eLOG( "File not loaded" );
       return nullptr;
@@ -184,20 +298,171 @@ bool rSceneBase::beginInitObject() {
  * The object will NOT be fully initialized until endInitObject() is called
  */
 bool rSceneBase::initObject( std::shared_ptr<rObjectBase> _obj, uint32_t _objIndex ) {
+   return initObjects( {{_obj, _objIndex}}, 1 );
+}
+
+/*!
+ * \brief STARTS initializing many objects at once
+ *
+ * The buffers of all objects are created first. Then the meshes are converted (or copied from the
+ * mesh cache) straight into the staging memory by _numThreads threads, largest meshes first.
+ * Only creating the buffers and recording the copy commands is done by the calling thread.
+ *
+ * The objects will NOT be fully initialized until endInitObject() is called
+ *
+ * \param[in] _objects    The objects and the indexes of their meshes (see loadFile)
+ * \param[in] _numThreads The maximum number of threads (0: one per CPU core)
+ * \returns false if at least one object could not be initialized
+ */
+bool rSceneBase::initObjects( INIT_OBJS const &_objects, unsigned _numThreads ) {
    if ( !vInitializingObjects ) {
       eLOG( "beginInitObject was NOT called on scene ", vName_str );
       return false;
    }
 
+   struct JOB {
+      std::shared_ptr<rObjectBase>  obj;
+      aiMesh const *                mesh     = nullptr;
+      rObjectBase::MESH_DATA const *cached   = nullptr;
+      uint32_t *                    index    = nullptr;
+      float *                       vertices = nullptr;
+      uint64_t                      size     = 0; //!< Number of values (for the scheduling only)
+      rBoundingVolume               bounds;
+      bool                          valid = false;
+   };
+
    std::lock_guard<std::recursive_mutex> lGuard( vObjectsInit_MUT );
-   auto const *                          lMesh = getAiMesh( _objIndex );
 
-   if ( !lMesh )
-      return false;
+   std::vector<JOB> lJobs;
+   bool             lAllValid = true;
 
-   _obj->setData( vInitBuff_vk, lMesh );
-   vInitObjects.emplace_back( _obj );
-   return true;
+   lJobs.reserve( _objects.size() );
+
+   // Find the data and create the buffers
+   for ( auto const &i : _objects ) {
+      JOB lJob;
+      lJob.obj = i.first;
+
+      if ( !lJob.obj ) {
+         eLOG( "Invalid Object Pointer" );
+         lAllValid = false;
+         continue;
+      }
+
+      uint32_t lNumIndices, lNumVertices;
+
+      if ( i.second < vMeshCache.getNumMeshes() &&
+           vMeshCache.getMesh( i.second ).data.layout == lJob.obj->getDataLayout() &&
+           vMeshCache.getMesh( i.second ).data.type == lJob.obj->getMeshType() ) {
+         // Upload straight from the mapped cache file
+         lJob.cached  = &vMeshCache.getMesh( i.second ).data;
+         lNumIndices  = lJob.cached->numIndices;
+         lNumVertices = lJob.cached->numVertices;
+      } else {
+         lJob.mesh = getAiMesh( i.second );
+         if ( !lJob.mesh ) {
+            lAllValid = false;
+            continue;
+         }
+
+         if ( rMeshCache::getMeshType( lJob.mesh ) != lJob.obj->getMeshType() ||
+              rObjectBase::getIndexSize( lJob.obj->getMeshType() ) == 0 ) {
+            eLOG( "Invalid primitive type ",
+                  lJob.mesh->mPrimitiveTypes,
+                  " for object ",
+                  lJob.obj->getName() );
+            lAllValid = false;
+            continue;
+         }
+
+         lNumIndices  = lJob.mesh->mNumFaces * rObjectBase::getIndexSize( lJob.obj->getMeshType() );
+         lNumVertices = lJob.mesh->mNumVertices;
+      }
+
+      uint32_t lStride = rObjectBase::getVertexStride( lJob.obj->getDataLayout() );
+
+      if ( lStride == 0 ||
+           !lJob.obj->beginData( lNumIndices, lNumVertices, &lJob.index, &lJob.vertices ) ) {
+         lAllValid = false;
+         continue;
+      }
+
+      lJob.size = uint64_t( lNumIndices ) + uint64_t( lNumVertices ) * lStride;
+      lJobs.emplace_back( lJob );
+   }
+
+   // Convert the meshes in parallel (largest first, so no thread is left with a large mesh alone)
+   std::vector<size_t> lOrder( lJobs.size() );
+   for ( size_t i = 0; i < lOrder.size(); ++i )
+      lOrder[i] = i;
+
+   std::sort( lOrder.begin(), lOrder.end(), [&]( size_t _a, size_t _b ) {
+      return lJobs[_a].size > lJobs[_b].size;
+   } );
+
+   std::atomic<size_t> lNext( 0 );
+
+   auto lWorker = [&]() {
+      for ( size_t i = lNext++; i < lOrder.size(); i = lNext++ ) {
+         JOB &lJob = lJobs[lOrder[i]];
+
+         if ( lJob.cached ) {
+            rObjectBase::MESH_DATA const &lData = *lJob.cached;
+
+            memcpy( lJob.index, lData.index, lData.numIndices * sizeof( uint32_t ) );
+            memcpy( lJob.vertices,
+                    lData.vertices,
+                    lData.numVertices * rObjectBase::getVertexStride( lData.layout ) *
+                          sizeof( float ) );
+
+            lJob.bounds = lData.bounds;
+            lJob.valid  = true;
+            continue;
+         }
+
+         lJob.valid = rObjectBase::packMesh( lJob.mesh,
+                                             lJob.obj->getMeshType(),
+                                             lJob.obj->getDataLayout(),
+                                             lJob.index,
+                                             lJob.vertices );
+
+         auto lPositions = reinterpret_cast<float const *>( lJob.mesh->mVertices );
+         lJob.bounds     = rBoundingVolume::fromPoints( lPositions, lJob.mesh->mNumVertices );
+      }
+   };
+
+   if ( _numThreads == 0 )
+      _numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+   _numThreads = static_cast<unsigned>( std::min<size_t>( _numThreads, lJobs.size() ) );
+
+   std::vector<std::thread> lThreads;
+   for ( unsigned i = 1; i < _numThreads; ++i )
+      lThreads.emplace_back( lWorker );
+
+   lWorker();
+
+   for ( auto &i : lThreads )
+      i.join();
+
+   // Record the copy commands (in the order of _objects)
+   for ( auto &i : lJobs ) {
+      if ( !i.valid ) {
+         eLOG( "Invalid data! Object ", i.obj->getName() );
+         i.obj->cancelData();
+         lAllValid = false;
+         continue;
+      }
+
+      if ( !i.obj->endData( vInitBuff_vk, i.bounds ) ) {
+         lAllValid = false;
+         continue;
+      }
+
+      vInitObjects.emplace_back( i.obj );
+   }
+
+   return lAllValid;
 }
 
 /*!
@@ -270,6 +535,14 @@ unsigned rSceneBase::addObject( std::shared_ptr<rObjectBase> _obj ) {
    std::lock_guard<std::mutex> lLockObjects( vObjects_MUT );
 
    vObjects.emplace_back( _obj );
+   unsigned lIndex = static_cast<unsigned>( vObjects.size() - 1 );
+
+   // Changes before adding the object were not queued
+   if ( _obj ) {
+      _obj->vScene      = this;
+      _obj->vSceneIndex = lIndex;
+      queueMatrices( lIndex );
+   }
 
 #if 0
    int64_t lFlags;
@@ -279,10 +552,193 @@ unsigned rSceneBase::addObject( std::shared_ptr<rObjectBase> _obj ) {
       vLightSourcesIndex.emplace_back( vObjects.size() - 1 );
 #endif
 
-   return static_cast<unsigned>( vObjects.size() - 1 );
+   return lIndex;
 }
 
 std::vector<std::shared_ptr<rObjectBase>> rSceneBase::getObjects() { return vObjects; }
+
+/*!
+ * \brief Returns the world space box of an object
+ *
+ * Objects without model matrix are placed with their object space box. Objects without vertices
+ * get an empty box (they are not part of the spatial index).
+ */
+rBVH::AABB rSceneBase::getWorldBounds( rObjectBase *_obj ) {
+   rBVH::AABB lBounds;
+   if ( !_obj )
+      return lBounds;
+
+   rBoundingVolume const &lVolume = _obj->getBoundingVolume();
+   if ( !lVolume.isValid() )
+      return lBounds;
+
+   // The render snapshot (getCullingMatrices) belongs to the render thread
+   rMat4f lModel;
+
+   if ( _obj->copyModelMatrix( lModel ) ) {
+      lVolume.getWorldAABB( lModel, lBounds.min, lBounds.max );
+   } else {
+      lBounds.min = lVolume.min;
+      lBounds.max = lVolume.max;
+   }
+
+   return lBounds;
+}
+
+/*!
+ * \brief Updates the box of a moved object in the spatial index
+ *
+ * Only the object itself is touched, the boxes of the tree are updated in updateSpatialIndex().
+ * Call this for every object whose transformation or vertex data changed.
+ *
+ * \param[in] _index The index of the object (returned by addObject())
+ */
+void rSceneBase::updateObjectBounds( unsigned _index ) {
+   std::lock_guard<std::mutex> lLockObjects( vObjects_MUT );
+
+   if ( _index >= vObjects.size() ) {
+      eLOG( "Invalid object index ", _index );
+      return;
+   }
+
+   // Objects added after the last updateSpatialIndex() are not in the tree yet
+   if ( _index < vBVH.getNumObjects() )
+      vBVH.setBounds( _index, getWorldBounds( vObjects[_index].get() ) );
+}
+
+/*!
+ * \brief Updates the spatial index after objects were added or moved
+ *
+ * The tree is rebuilt when objects were added (or an object got its first vertices). Otherwise
+ * only the boxes of the nodes above objects changed with updateObjectBounds() are updated, so
+ * nothing is done for a scene where nothing moved.
+ *
+ * \param[in] _numThreads Maximum number of threads for a rebuild (0: hardware concurrency)
+ */
+void rSceneBase::updateSpatialIndex( unsigned _numThreads ) {
+   std::lock_guard<std::mutex> lLockObjects( vObjects_MUT );
+
+   if ( vBVH.getNumObjects() == vObjects.size() && !vBVH.getNeedsRebuild() ) {
+      vBVH.refit();
+      return;
+   }
+
+   // Boxes of known objects are up to date (updateObjectBounds()), only new objects are added
+   std::vector<rBVH::AABB> lBounds( vObjects.size() );
+
+   for ( size_t i = 0; i < vObjects.size(); ++i ) {
+      if ( i < vBVH.getNumObjects() )
+         lBounds[i] = vBVH.getBounds( static_cast<uint32_t>( i ) );
+      else
+         lBounds[i] = getWorldBounds( vObjects[i].get() );
+   }
+
+   vBVH.build( lBounds, _numThreads );
+}
+
+/*!
+ * \brief Attaches an object to a node of the transform graph
+ *
+ * The model matrix of the object becomes the world matrix of the node times the own transformation
+ * of the object (position, rotation, scale). So to attach objects to each other, attach them to
+ * nodes that are children of each other (see getTransformGraph()) and move the parents with the
+ * local matrices of their nodes.
+ *
+ * \param[in] _index The index of the object (returned by addObject())
+ * \param[in] _node  The node (INVALID_NODE to detach the object)
+ *
+ * \returns false if the object or the node does not exist or the object has no model matrix
+ */
+bool rSceneBase::attachObject( unsigned _index, rTransformGraph::NODE _node ) {
+   std::lock_guard<std::mutex> lLockObjects( vObjects_MUT );
+
+   if ( _index >= vObjects.size() || !vObjects[_index] ) {
+      eLOG( "Invalid object index ", _index );
+      return false;
+   }
+
+   if ( _node != rTransformGraph::INVALID_NODE && _node >= vTransforms.size() ) {
+      eLOG( "Invalid transform node ", _node );
+      return false;
+   }
+
+   // A dirty node is passed on again by the next updateMatrices()
+   if ( !vObjects[_index]->setParentTransform( vTransforms.getWorldMatrix( _node ) ) ) {
+      eLOG( "Object ", _index, " can not be attached to a transform node" );
+      return false;
+   }
+
+   if ( vObjectNodes.size() < vObjects.size() )
+      vObjectNodes.resize( vObjects.size(), rTransformGraph::INVALID_NODE );
+
+   vObjectNodes[_index] = _node;
+
+   if ( _index < vBVH.getNumObjects() )
+      vBVH.setBounds( _index, getWorldBounds( vObjects[_index].get() ) );
+
+   return true;
+}
+
+/*!
+ * \brief Queues an object for the next updateMatrices() (called by the object on its first change)
+ */
+void rSceneBase::queueMatrices( unsigned _index ) {
+   std::lock_guard<std::mutex> lLockQueue( vMatrixQueue_MUT );
+   vMatrixQueue.push_back( _index );
+}
+
+/*!
+ * \brief Updates the transform graph and publishes the matrices of the changed objects
+ *
+ * Computes the world matrices of the changed nodes of the transform graph, passes them to the
+ * attached objects (and their boxes to the spatial index) and then publishes the matrices of the
+ * changed objects for the render thread (rMatrixObjectBase::updateFinalMatrix). The objects queue
+ * themselves on their first change (see queueMatrices()); when the camera changed, all objects are
+ * published. Call this once per frame from the game logic, after moving the objects and nodes.
+ *
+ * \param[in] _numThreads Maximum number of threads for the transform graph (0: one per core)
+ */
+void rSceneBase::updateMatrices( unsigned _numThreads ) {
+   std::lock_guard<std::mutex> lLockObjects( vObjects_MUT );
+
+   vTransforms.update( _numThreads );
+
+   // Without changed nodes there is nothing to pass on to the attached objects
+   size_t lNumNodes = vTransforms.getAnyChanged() ? vObjectNodes.size() : 0;
+
+   for ( size_t i = 0; i < lNumNodes; ++i ) {
+      rTransformGraph::NODE lNode = vObjectNodes[i];
+      if ( lNode == rTransformGraph::INVALID_NODE || !vTransforms.getWorldChanged( lNode ) )
+         continue;
+
+      vObjects[i]->setParentTransform( vTransforms.getWorldMatrix( lNode ) );
+
+      if ( i < vBVH.getNumObjects() )
+         vBVH.setBounds( static_cast<uint32_t>( i ), getWorldBounds( vObjects[i].get() ) );
+   }
+
+   // The objects lock themselves before the queue, so no object is touched while it is locked
+   {
+      std::lock_guard<std::mutex> lLockQueue( vMatrixQueue_MUT );
+      vMatrixPublish.clear();
+      vMatrixPublish.swap( vMatrixQueue );
+   }
+
+   uint64_t lVersion = getSceneMatrixVersion();
+   if ( lVersion != vPublishedVersion ) {
+      vPublishedVersion = lVersion;
+
+      for ( auto const &i : vObjects )
+         if ( i )
+            i->publishMatrices();
+
+      return;
+   }
+
+   for ( unsigned i : vMatrixPublish )
+      if ( vObjects[i] )
+         vObjects[i]->publishMatrices();
+}
 }
 
 // kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -21,12 +21,17 @@
 
 #include "defines.hpp"
 
+#include "rBVH.hpp"
 #include "rMatrixSceneBase.hpp"
+#include "rMeshCache.hpp"
 #include "rObjectBase.hpp"
+#include "rTransformGraph.hpp"
+#include "uHashCache.hpp"
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 #include <vulkan.h>
 
@@ -48,6 +53,7 @@ class RENDER_API rSceneBase {
    template <typename T>
    using OBJECTS   = std::vector<std::shared_ptr<T>>;
    using BASE_OBJS = OBJECTS<rObjectBase>;
+   using INIT_OBJS = std::vector<std::pair<std::shared_ptr<rObjectBase>, uint32_t>>; //!< Mesh index
 
  private:
    rWorld *vWorldPtr;
@@ -70,7 +76,35 @@ class RENDER_API rSceneBase {
 
    Assimp::Importer vImporter_assimp;
    aiScene const *  vScene_assimp = nullptr;
+   std::string      vFile_str; //!< The last loaded file (imported on demand when cached)
 
+   std::string                     vMeshCacheDir_str;
+   rObjectBase::VERTEX_DATA_LAYOUT vMeshCacheLayout = rObjectBase::POS_NORM;
+   uHashCache *                    vHashCache       = nullptr;
+   rMeshCache                      vMeshCache;
+
+   bool importFile();
+   std::string getMeshCacheFile( std::string const &_file, rMeshCache::DIGEST &_digest );
+
+   rBVH vBVH; //!< World space boxes of the objects (object index == index in vObjects)
+
+   rBVH::AABB getWorldBounds( rObjectBase *_obj );
+
+   rTransformGraph                    vTransforms;
+   std::vector<rTransformGraph::NODE> vObjectNodes; //!< Object index --> node (or INVALID_NODE)
+
+   std::mutex            vMatrixQueue_MUT;
+   std::vector<unsigned> vMatrixQueue;          //!< Objects changed since the last updateMatrices()
+   std::vector<unsigned> vMatrixPublish;        //!< The swapped vMatrixQueue of updateMatrices()
+   uint64_t              vPublishedVersion = 0; //!< The scene matrix version of the last publish
+
+   void queueMatrices( unsigned _index );
+
+   friend class rObjectBase;
+
+ protected:
+   //! The version of the view / projection matrix (see rMatrixSceneBase::getMatrixVersion)
+   virtual uint64_t getSceneMatrixVersion() const { return 0; }
 
  public:
    rSceneBase() = delete;
@@ -82,13 +116,30 @@ class RENDER_API rSceneBase {
    unsigned addObject( std::shared_ptr<rObjectBase> _obj );
    BASE_OBJS getObjects();
 
+   void setMeshCache( std::string                     _dir,
+                      rObjectBase::VERTEX_DATA_LAYOUT _layout = rObjectBase::POS_NORM,
+                      uHashCache *                    _cache  = nullptr );
+
    std::vector<MeshInfo> loadFile( std::string _file );
    aiMesh const *getAiMesh( uint32_t _objIndex );
 
    bool beginInitObject();
    bool initObject( std::shared_ptr<rObjectBase> _obj, uint32_t _objIndex );
+   bool initObjects( INIT_OBJS const &_objects, unsigned _numThreads = 0 );
    bool endInitObject();
 
+   void updateObjectBounds( unsigned _index );
+   void updateSpatialIndex( unsigned _numThreads = 0 );
+
+   //! \note Not thread safe with updateObjectBounds() and updateSpatialIndex()
+   rBVH const &getSpatialIndex() const { return vBVH; }
+
+   bool attachObject( unsigned _index, rTransformGraph::NODE _node );
+   void updateMatrices( unsigned _numThreads = 0 );
+
+   //! \note Not thread safe with attachObject() and updateMatrices()
+   rTransformGraph *getTransformGraph() { return &vTransforms; }
+
    size_t getNumObjects() { return vObjects.size(); }
 };
 
@@ -97,6 +148,9 @@ class RENDER_API rScene : public rSceneBase, public rMatrixSceneBase<float> {
  public:
    rScene( std::string _name, rWorld *_world )
        : rSceneBase( _name, _world ), rMatrixSceneBase<float>( _world ) {}
+
+ protected:
+   uint64_t getSceneMatrixVersion() const override { return getMatrixVersion(); }
 };
 }
 
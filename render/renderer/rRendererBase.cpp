@@ -28,6 +28,7 @@
 #include "iInit.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include <limits>
 
 
 #if D_LOG_VULKAN
@@ -286,6 +287,55 @@ void rRendererBase::recordCmdBuffersWrapper( Framebuffer_vk &_fb, RECORD_TARGET
    recordCmdBuffers( _fb, _toRender );
 }
 
+/*!
+ * \brief Finds the objects inside the view frustum
+ *
+ * The bounding spheres of the objects are transformed with the latched model matrices (see
+ * updateUniforms) and tested against the frustum of the view projection matrix (see
+ * rFrustum::cull). Objects that can not be culled (no bounding volume or no culling matrices) are
+ * always visible.
+ *
+ * \param[in]  _objects The objects to test
+ * \param[out] _visible The indexes of the visible objects (ascending)
+ */
+void rRendererBase::cullObjects( OBJECTS const &_objects, std::vector<uint32_t> &_visible ) {
+   size_t        lNum            = _objects.size();
+   rMat4f const *lViewProjection = nullptr;
+
+   for ( auto &i : vCullSpheres )
+      i.resize( lNum );
+
+   for ( size_t i = 0; i < lNum; ++i ) {
+      rMat4f const *lModel = nullptr;
+      rMat4f const *lVP    = nullptr;
+      rVec4f        lSphere( 0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity() );
+
+      auto const &lVolume = _objects[i]->getBoundingVolume();
+      if ( lVolume.isValid() && _objects[i]->getCullingMatrices( &lModel, &lVP ) ) {
+         lVolume.getWorldSphere( *lModel, lSphere );
+         lViewProjection = lViewProjection ? lViewProjection : lVP;
+      }
+
+      vCullSpheres[0][i] = lSphere.x;
+      vCullSpheres[1][i] = lSphere.y;
+      vCullSpheres[2][i] = lSphere.z;
+      vCullSpheres[3][i] = lSphere.w;
+   }
+
+   // All objects of a renderer share the camera of their scene
+   if ( lViewProjection )
+      vFrustum.setMatrix( *lViewProjection );
+
+   rFrustum::SPHERES lSpheres;
+   lSpheres.x      = vCullSpheres[0].data();
+   lSpheres.y      = vCullSpheres[1].data();
+   lSpheres.z      = vCullSpheres[2].data();
+   lSpheres.radius = vCullSpheres[3].data();
+
+   _visible.resize( lNum );
+   _visible.resize( vFrustum.cull( lSpheres, lNum, _visible.data() ) );
+}
+
 void rRendererBase::updateRenderer() {
    std::lock_guard<std::recursive_mutex> lGuard( vMutexRecordData );
 
@@ -323,9 +373,17 @@ void rRendererBase::updateRenderer() {
       recordCmdBuffersWrapper( i, RECORD_ALL );
 }
 
+/*!
+ * \brief Latches the matrices of the next frame and updates the uniforms with them
+ *
+ * The uniforms are written after a frame for the next one, so the matrices are latched here;
+ * cullObjects and the recorded push constants of the next frame use the same snapshot.
+ */
 void rRendererBase::updateUniforms() {
-   for ( auto i : vObjects )
+   for ( auto i : vObjects ) {
+      i->latchMatrices();
       i->updateUniforms();
+   }
 }
 
 
@@ -23,6 +23,7 @@
 
 #include "defines.hpp"
 
+#include "rFrustum.hpp"
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -128,6 +129,10 @@ class RENDER_API rRendererBase {
    bool vEnableRendering       = false;
    bool vUserDisabledRendering = false; //!< User manually disabled rendering
 
+   // Frustum culling (reused every frame)
+   rFrustum           vFrustum;
+   std::vector<float> vCullSpheres[4]; //!< x, y, z, radius
+
    int initImageBuffers( VkCommandBuffer _buf );
    int initRenderPass();
    int initFramebuffers();
@@ -184,6 +189,8 @@ class RENDER_API rRendererBase {
    virtual void freeCmdBuffers( VkCommandPool _pool ) = 0;
    virtual void recordCmdBuffers( Framebuffer_vk &_fb, RECORD_TARGET _toRender ) = 0;
 
+   void cullObjects( OBJECTS const &_objects, std::vector<uint32_t> &_visible );
+
  public:
    rRendererBase() = delete;
    rRendererBase( iInit *_init, rWorld *_root, std::wstring _id );
@@ -103,9 +103,18 @@ void rRendererBasic::recordCmdBuffers( Framebuffer_vk &_fb, RECORD_TARGET _toRen
    vkCmdBeginRenderPass(
          _fb.render, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
 
-   for ( uint32_t i = 0; i < vRenderObjects.size(); i++ ) {
+   // Only visible objects are executed, so only they need new push constants
+   cullObjects( vRenderObjects, vVisible );
+   auto &lVisibleCmd = vFbData[_fb.index].visibleBuffers;
+   lVisibleCmd.clear();
+
+   for ( uint32_t i = 0, lNext = 0; i < vRenderObjects.size(); i++ ) {
+      bool lIsVisible = lNext < vVisible.size() && vVisible[lNext] == i;
+      if ( lIsVisible )
+         lNext++;
+
       if ( _toRender == RECORD_PUSH_CONST_ONLY )
-         if ( !vRenderObjects[i]->supportsPushConstants() )
+         if ( !lIsVisible || !vRenderObjects[i]->supportsPushConstants() )
             continue;
 
       auto *lPipe = vRenderObjects[i]->getPipeline();
@@ -128,8 +137,13 @@ void rRendererBasic::recordCmdBuffers( Framebuffer_vk &_fb, RECORD_TARGET _toRen
       vkEndCommandBuffer( vFbData[_fb.index].buffers[i] );
    }
 
-   vkCmdExecuteCommands(
-         _fb.render, vFbData[_fb.index].buffers.size(), vFbData[_fb.index].buffers.data() );
+   for ( auto i : vVisible )
+      if ( vRenderObjects[i]->getPipeline() )
+         lVisibleCmd.push_back( vFbData[_fb.index].buffers[i] );
+
+   if ( !lVisibleCmd.empty() )
+      vkCmdExecuteCommands( _fb.render, lVisibleCmd.size(), lVisibleCmd.data() );
+
    vkCmdEndRenderPass( _fb.render );
 
    auto lRes = vkEndCommandBuffer( _fb.render );
@@ -29,6 +29,7 @@ namespace e_engine {
 class rRendererBasic : public internal::rRendererBase {
    struct FB_DATA {
       std::vector<VkCommandBuffer> buffers;
+      std::vector<VkCommandBuffer> visibleBuffers; //!< The buffers to execute (after culling)
    };
 
  private:
@@ -36,6 +37,8 @@ class rRendererBasic : public internal::rRendererBase {
 
    OBJECTS vRenderObjects;
 
+   std::vector<uint32_t> vVisible; //!< Indexes of the visible vRenderObjects
+
  protected:
    void                        setupSubpasses() override;
    std::vector<AttachmentInfo> getAttachmentInfos() override;
@@ -231,9 +231,18 @@ void rRendererDeferred::recordCmdBuffers( Framebuffer_vk &_fb, RECORD_TARGET _to
    vkCmdBeginRenderPass(
          _fb.render, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
 
-   for ( uint32_t i = 0; i < vRenderObjects.size(); i++ ) {
+   // Only visible objects are executed, so only they need new push constants
+   cullObjects( vRenderObjects, vVisible );
+   auto &lVisibleCmd = vFbData[_fb.index].visibleObjects;
+   lVisibleCmd.clear();
+
+   for ( uint32_t i = 0, lNext = 0; i < vRenderObjects.size(); i++ ) {
+      bool lIsVisible = lNext < vVisible.size() && vVisible[lNext] == i;
+      if ( lIsVisible )
+         lNext++;
+
       if ( _toRender == RECORD_PUSH_CONST_ONLY )
-         if ( !vRenderObjects[i]->supportsPushConstants() )
+         if ( !lIsVisible || !vRenderObjects[i]->supportsPushConstants() )
             continue;
 
       auto *lPipe = vRenderObjects[i]->getPipeline();
@@ -256,8 +265,12 @@ void rRendererDeferred::recordCmdBuffers( Framebuffer_vk &_fb, RECORD_TARGET _to
       vkEndCommandBuffer( vFbData[_fb.index].objects[i] );
    }
 
-   vkCmdExecuteCommands(
-         _fb.render, vFbData[_fb.index].objects.size(), vFbData[_fb.index].objects.data() );
+   for ( auto i : vVisible )
+      if ( vRenderObjects[i]->getPipeline() )
+         lVisibleCmd.push_back( vFbData[_fb.index].objects[i] );
+
+   if ( !lVisibleCmd.empty() )
+      vkCmdExecuteCommands( _fb.render, lVisibleCmd.size(), lVisibleCmd.data() );
 
    vWorldPtr->beginCommandBuffer( vFbData[_fb.index].layoutChange1,
                                   VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
@@ -31,6 +31,7 @@ class rRendererDeferred : public internal::rRendererBase {
    struct FB_DATA {
       std::vector<VkCommandBuffer> objects;
       std::vector<VkCommandBuffer> lights;
+      std::vector<VkCommandBuffer> visibleObjects; //!< The objects to execute (after culling)
 
       VkCommandBuffer layoutChange1;
       VkCommandBuffer layoutChange2;
@@ -42,6 +43,8 @@ class rRendererDeferred : public internal::rRendererBase {
    OBJECTS vRenderObjects;
    OBJECTS vLightObjects;
 
+   std::vector<uint32_t> vVisible; //!< Indexes of the visible vRenderObjects
+
    rBuffer vDeferredDataBuffer;
    rBuffer vDeferredIndexBuffer;
 
@@ -37,8 +37,14 @@ BenchClass::BenchClass( cmdANDinit *_cmd )
 
    bool lDoFunctionBench = false;
    bool lDoMutexBench = false;
+   bool lDoSHABench = false;
+   bool lDoTransformBench = false;
+   bool lDoMathBench = false;
    _cmd->getFunctionInf( vLoopsToDo, lDoFunctionBench );
    _cmd->getMutexInf( vLoopsToDoMutex, lDoMutexBench );
+   _cmd->getSHAInf( vSHAMessages, vSHASize, lDoSHABench );
+   _cmd->getTransformInf( vTransformObjects, lDoTransformBench );
+   _cmd->getMathInf( vMathLoops, lDoMathBench );
 
    if ( lDoFunctionBench ) {
       vTheSignal.connect( &vTheSlot );
@@ -58,6 +64,15 @@ BenchClass::BenchClass( cmdANDinit *_cmd )
 
    if ( lDoMutexBench )
       doMutex();
+
+   if ( lDoSHABench )
+      doSHA();
+
+   if ( lDoTransformBench )
+      doTransform();
+
+   if ( lDoMathBench )
+      doMath();
 }
 
 void BenchClass::doFunction() {
@@ -289,4 +304,238 @@ void BenchClass::doMutex() {
 }
 
 
+void BenchClass::doSHA() {
+   iLOG( "==== BEGIN SHA-256 MULTI BUFFER BENCHMARK ====" );
+   iLOG( "" );
+   iLOG( "  - Messages: ", vSHAMessages );
+   iLOG( "  - Size:     ", vSHASize, " bytes" );
+
+   vector<vector<unsigned char>> lMessages( vSHAMessages, vector<unsigned char>( vSHASize ) );
+   uint32_t lSeed = 1;
+   for ( auto &i : lMessages ) {
+      for ( auto &j : i ) {
+         lSeed = lSeed * 1664525 + 1013904223;
+         j = static_cast<unsigned char>( lSeed >> 24 );
+      }
+   }
+
+   e_engine::uSHA_2_Multi::RESULTS lSerialRes;
+   e_engine::uSHA_2_Multi::RESULTS lMultiRes;
+   e_engine::uSHA_2_Multi::RESULTS lLanesRes;
+   lSerialRes.reserve( lMessages.size() );
+
+   START( serial );
+   e_engine::uSHA_2 lHasher( e_engine::SHA2_256 );
+   for ( auto const &i : lMessages ) {
+      lSerialRes.push_back( lHasher.quickHash( e_engine::SHA2_256, i ) );
+   }
+   uint64_t lSerial = STOP( serial );
+
+   e_engine::uSHA_2_Multi lMulti( e_engine::SHA2_256 );
+
+   START( multi );
+   lMultiRes = lMulti.hash( lMessages );
+   uint64_t lMultiTime = STOP( multi );
+
+   e_engine::uSHA_2_Multi lLanes( e_engine::SHA2_256 );
+   lLanes.setUseLanes( true );
+
+   START( lanes );
+   lLanesRes = lLanes.hash( lMessages );
+   uint64_t lLanesTime = STOP( lanes );
+
+   if ( lSerialRes != lMultiRes || lSerialRes != lLanesRes ) {
+      eLOG( "uSHA_2_Multi results differ from uSHA_2!" );
+   }
+
+   auto lPerSec = []( size_t _num, uint64_t _us ) -> uint64_t {
+      return _us == 0 ? 0 : static_cast<uint64_t>( _num * 1000000.0 / _us );
+   };
+
+   iLOG( "  - Time: microseconds" );
+   iLOG( "  = Serial uSHA_2: ", lSerial, "  (", lPerSec( lMessages.size(), lSerial ), " msg/s)" );
+   iLOG( "  = uSHA_2_Multi [",
+         lMulti.getKernelName(),
+         "]: ",
+         lMultiTime,
+         "  (",
+         lPerSec( lMessages.size(), lMultiTime ),
+         " msg/s)" );
+   iLOG( "  = uSHA_2_Multi [",
+         lLanes.getKernelName(),
+         "]: ",
+         lLanesTime,
+         "  (",
+         lPerSec( lMessages.size(), lLanesTime ),
+         " msg/s)" );
+}
+
+
+void BenchClass::doTransform() {
+   const unsigned int lRounds = 10;
+
+   iLOG( "==== BEGIN OBJECT MATRIX BENCHMARK ====" );
+   iLOG( "" );
+   iLOG( "  - Objects: ", vTransformObjects );
+   iLOG( "  - Rounds:  ", lRounds );
+
+   e_engine::rMatrixSceneBase<float> lScene( nullptr );
+   lScene.calculateProjectionPerspective( 16.0f / 9.0f, 0.1f, 1000.0f, 60.0f );
+   lScene.setCamera( e_engine::rVec3f( 10.0f, 5.0f, 10.0f ),
+                     e_engine::rVec3f( 0.0f, 0.0f, 0.0f ),
+                     e_engine::rVec3f( 0.0f, 1.0f, 0.0f ) );
+
+   e_engine::rTransformBatch lBatch;
+   lBatch.resize( vTransformObjects );
+
+   vector<unique_ptr<e_engine::rMatrixObjectBase<float>>> lObjects;
+   vector<e_engine::rVec3f>                                lPositions;
+   lObjects.reserve( vTransformObjects );
+   lPositions.reserve( vTransformObjects );
+
+   uint32_t lSeed = 1;
+   auto lRand = [&]() -> float {
+      lSeed = lSeed * 1664525 + 1013904223;
+      return static_cast<float>( lSeed >> 8 ) / 16777216.0f * 100.0f - 50.0f;
+   };
+
+   for ( unsigned int i = 0; i < vTransformObjects; ++i ) {
+      e_engine::rVec3f lPos( lRand(), lRand(), lRand() );
+      e_engine::rVec3f lAxis( lRand(), lRand(), lRand() );
+      e_engine::rVec3f lScale( 1.0f, 2.0f, 0.5f );
+      float            lAngle = lRand() * 3.0f;
+
+      lBatch.setPosition( i, lPos );
+      lBatch.setRotation( i, lAxis, lAngle );
+      lBatch.setScale( i, lScale );
+
+      lObjects.emplace_back( new e_engine::rMatrixObjectBase<float>( &lScene ) );
+      lObjects.back()->setPosition( lPos );
+      lObjects.back()->setRotation( lAxis, lAngle );
+      lObjects.back()->setScale( lScale );
+      lPositions.push_back( lPos );
+   }
+
+   vector<e_engine::rMat4f> lModel( vTransformObjects );
+   vector<e_engine::rMat4f> lModelView( vTransformObjects );
+   vector<e_engine::rMat4f> lMVP( vTransformObjects );
+   vector<e_engine::rMat3f> lNormal( vTransformObjects );
+
+   e_engine::rTransformBatch::INPUT  lIn = lBatch.getInput();
+   e_engine::rTransformBatch::OUTPUT lOut;
+   lOut.model               = lModel.data();
+   lOut.modelView           = lModelView.data();
+   lOut.modelViewProjection = lMVP.data();
+   lOut.normal              = lNormal.data();
+
+   // Set the position every round, updateFinalMatrix does nothing for unchanged objects (the
+   // batch recomputes everything)
+   START( object );
+   for ( unsigned int r = 0; r < lRounds; ++r ) {
+      for ( unsigned int i = 0; i < vTransformObjects; ++i ) {
+         lObjects[i]->setPosition( lPositions[i] );
+         lObjects[i]->updateFinalMatrix();
+      }
+   }
+   uint64_t lObjectTime = STOP( object );
+
+   START( batch );
+   for ( unsigned int r = 0; r < lRounds; ++r ) {
+      e_engine::rTransformBatch::compute( lIn,
+                                          lOut,
+                                          *lScene.getViewMatrix(),
+                                          *lScene.getViewProjectionMatrix(),
+                                          0,
+                                          vTransformObjects );
+   }
+   uint64_t lBatchTime = STOP( batch );
+
+   START( parallel );
+   for ( unsigned int r = 0; r < lRounds; ++r ) {
+      e_engine::rTransformBatch::computeParallel( lIn,
+                                                  lOut,
+                                                  *lScene.getViewMatrix(),
+                                                  *lScene.getViewProjectionMatrix(),
+                                                  vTransformObjects );
+   }
+   uint64_t lParallelTime = STOP( parallel );
+
+   auto lPerMS = [&]( uint64_t _us ) -> uint64_t {
+      return _us == 0 ? 0 : static_cast<uint64_t>( vTransformObjects * lRounds * 1000.0 / _us );
+   };
+
+   iLOG( "  - Time: microseconds" );
+   iLOG( "  = rMatrixObjectBase:        ", lObjectTime, "  (", lPerMS( lObjectTime ), " obj/ms)" );
+   iLOG( "  = rTransformBatch [",
+         e_engine::rTransformBatch::getKernelName(),
+         "]: ",
+         lBatchTime,
+         "  (",
+         lPerMS( lBatchTime ),
+         " obj/ms)" );
+   iLOG( "  = rTransformBatch parallel: ",
+         lParallelTime,
+         "  (",
+         lPerMS( lParallelTime ),
+         " obj/ms)" );
+}
+
+void BenchClass::doMath() {
+   using e_engine::rMat4f;
+
+   iLOG( "==== BEGIN MATRIX EXPRESSION BENCHMARK ====" );
+   iLOG( "" );
+   iLOG( "  - Loops: ", vMathLoops );
+
+   rMat4f lA, lB, lC, lD, lOut;
+   for ( uint32_t i = 0; i < 16; ++i ) {
+      lA[i] = static_cast<float>( i ) * 0.1f;
+      lB[i] = 1.0f / static_cast<float>( i + 1 );
+      lC[i] = static_cast<float>( i % 3 );
+      lD[i] = static_cast<float>( 16 - i );
+   }
+
+   // lA changes every loop so nothing is moved out of the loops
+
+   START( mulTemp );
+   for ( unsigned int i = 0; i < vMathLoops; ++i ) {
+      rMat4f lTemp1, lTemp2;
+      lA.multiply( lB, &lTemp1 );
+      lTemp1.multiply( lC, &lTemp2 );
+      lOut = lTemp2;
+      lA[0] += lOut[5] * 1e-9f;
+   }
+   uint64_t lMulTemp = STOP( mulTemp );
+
+   START( mulExpr );
+   for ( unsigned int i = 0; i < vMathLoops; ++i ) {
+      lOut = lA * lB * lC;
+      lA[0] += lOut[5] * 1e-9f;
+   }
+   uint64_t lMulExpr = STOP( mulExpr );
+
+   START( addTemp );
+   for ( unsigned int i = 0; i < vMathLoops; ++i ) {
+      rMat4f lTemp1, lTemp2, lTemp3;
+      lA.add( lB, &lTemp1 );
+      lTemp1.subtract( lC, &lTemp2 );
+      lTemp3 = lD;
+      lTemp3 *= 2.0f;
+      lTemp2.add( lTemp3, &lOut );
+      lA[0] += lOut[5] * 1e-9f;
+   }
+   uint64_t lAddTemp = STOP( addTemp );
+
+   START( addExpr );
+   for ( unsigned int i = 0; i < vMathLoops; ++i ) {
+      lOut = lA + lB - lC + 2.0f * lD;
+      lA[0] += lOut[5] * 1e-9f;
+   }
+   uint64_t lAddExpr = STOP( addExpr );
+
+   iLOG( "  - Time: microseconds" );
+   iLOG( "  = A * B * C           temporaries: ", lMulTemp, "  expression: ", lMulExpr );
+   iLOG( "  = A + B - C + 2 * D   temporaries: ", lAddTemp, "  expression: ", lAddExpr );
+}
+
 // kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -72,8 +72,18 @@ class BenchClass : public BenchBaseVirtual {
 
    unsigned int vLoopsToDoCast;
 
+   unsigned int vSHAMessages;
+   unsigned int vSHASize;
+
+   unsigned int vTransformObjects;
+
+   unsigned int vMathLoops;
+
    void doFunction();
    void doMutex();
+   void doSHA();
+   void doTransform();
+   void doMath();
 
  public:
    BenchClass() = delete;
@@ -59,6 +59,16 @@ cmdANDinit::cmdANDinit( int argc, char *argv[], bool _color ) {
 
    vDoMutex = false;
    vMutexLoops = 10000000;
+
+   vDoSHA = false;
+   vSHAMessages = 100000;
+   vSHASize = 256;
+
+   vDoTransform = false;
+   vTransformObjects = 100000;
+
+   vDoMath = false;
+   vMathLoops = 1000000;
 }
 
 
@@ -77,7 +87,10 @@ void cmdANDinit::usage() {
    iLOG( "MODES:"
          "\nall            : do all benchmarks"
          "\nfunc           : do the functions benchmark"
-         "\nmutex          : do the mutex benchmark" );
+         "\nmutex          : do the mutex benchmark"
+         "\nsha            : do the SHA-256 multi buffer benchmark"
+         "\ntransform      : do the object matrix (rTransformBatch) benchmark"
+         "\nmath           : do the matrix expression benchmark" );
    iLOG( "" );
    iLOG( "BENCHMARK OPTIONS:" );
    dLOG( "    --funcLoops=<loops>  : ammount of loops to do in function benchmark (default: ",
@@ -86,6 +99,18 @@ void cmdANDinit::usage() {
    dLOG( "    --mutexLoops=<loops> : ammount of loops to do in mutex benchmark    (default: ",
          vMutexLoops,
          ")" );
+   dLOG( "    --shaMsgs=<num>      : number of messages in the SHA benchmark      (default: ",
+         vSHAMessages,
+         ")" );
+   dLOG( "    --shaSize=<bytes>    : size of one message in the SHA benchmark     (default: ",
+         vSHASize,
+         ")" );
+   dLOG( "    --transformObjs=<num>: number of objects in the transform benchmark (default: ",
+         vTransformObjects,
+         ")" );
+   dLOG( "    --mathLoops=<loops>  : ammount of loops to do in math benchmark     (default: ",
+         vMathLoops,
+         ")" );
    wLOG( "You MUST define one ore more modes\n\n" );
 }
 
@@ -125,6 +150,9 @@ bool cmdANDinit::parseArgsAndInit() {
       if ( arg == "all" ) {
          vDoFunction = true;
          vDoMutex = true;
+         vDoSHA = true;
+         vDoTransform = true;
+         vDoMath = true;
          continue;
       }
 
@@ -138,6 +166,21 @@ bool cmdANDinit::parseArgsAndInit() {
          continue;
       }
 
+      if ( arg == "sha" ) {
+         vDoSHA = true;
+         continue;
+      }
+
+      if ( arg == "transform" ) {
+         vDoTransform = true;
+         continue;
+      }
+
+      if ( arg == "math" ) {
+         vDoMath = true;
+         continue;
+      }
+
 
 
       std::regex lFuncRegex( "^\\-\\-funcLoops=[0-9 ]*$" );
@@ -158,10 +201,47 @@ bool cmdANDinit::parseArgsAndInit() {
          continue;
       }
 
+      std::regex lSHAMsgsRegex( "^\\-\\-shaMsgs=[0-9 ]*$" );
+      if ( std::regex_match( arg, lSHAMsgsRegex ) ) {
+         std::regex lSHAMsgsRegexRep( "^\\-\\-shaMsgs=" );
+         const char *lRep = "";
+         string shaString = std::regex_replace( arg, lSHAMsgsRegexRep, lRep );
+         vSHAMessages = static_cast<unsigned>( atoi( shaString.c_str() ) );
+         continue;
+      }
+
+      std::regex lSHASizeRegex( "^\\-\\-shaSize=[0-9 ]*$" );
+      if ( std::regex_match( arg, lSHASizeRegex ) ) {
+         std::regex lSHASizeRegexRep( "^\\-\\-shaSize=" );
+         const char *lRep = "";
+         string shaString = std::regex_replace( arg, lSHASizeRegexRep, lRep );
+         vSHASize = static_cast<unsigned>( atoi( shaString.c_str() ) );
+         continue;
+      }
+
+      std::regex lTransformRegex( "^\\-\\-transformObjs=[0-9 ]*$" );
+      if ( std::regex_match( arg, lTransformRegex ) ) {
+         std::regex lTransformRegexRep( "^\\-\\-transformObjs=" );
+         const char *lRep = "";
+         string objString = std::regex_replace( arg, lTransformRegexRep, lRep );
+         vTransformObjects = static_cast<unsigned>( atoi( objString.c_str() ) );
+         continue;
+      }
+
+      std::regex lMathRegex( "^\\-\\-mathLoops=[0-9 ]*$" );
+      if ( std::regex_match( arg, lMathRegex ) ) {
+         std::regex lMathRegexRep( "^\\-\\-mathLoops=" );
+         const char *lRep = "";
+         string mathString = std::regex_replace( arg, lMathRegexRep, lRep );
+         vMathLoops = static_cast<unsigned>( atoi( mathString.c_str() ) );
+         continue;
+      }
+
       eLOG( "Unkonwn option '", arg, "'" );
    }
 
-   if ( vDoFunction == false && vDoMutex == false ) {
+   if ( vDoFunction == false && vDoMutex == false && vDoSHA == false && vDoTransform == false &&
+        vDoMath == false ) {
       postInit();
       usage();
       return false;
@@ -34,6 +34,16 @@ class cmdANDinit {
    bool vDoMutex;
    unsigned int vMutexLoops;
 
+   bool vDoSHA;
+   unsigned int vSHAMessages;
+   unsigned int vSHASize;
+
+   bool vDoTransform;
+   unsigned int vTransformObjects;
+
+   bool vDoMath;
+   unsigned int vMathLoops;
+
    cmdANDinit() {}
 
    void postInit();
@@ -53,6 +63,19 @@ class cmdANDinit {
       _loops = vMutexLoops;
       _doIt = vDoMutex;
    }
+   void getSHAInf( unsigned int &_messages, unsigned int &_size, bool &_doIt ) {
+      _messages = vSHAMessages;
+      _size = vSHASize;
+      _doIt = vDoSHA;
+   }
+   void getTransformInf( unsigned int &_objects, bool &_doIt ) {
+      _objects = vTransformObjects;
+      _doIt = vDoTransform;
+   }
+   void getMathInf( unsigned int &_loops, bool &_doIt ) {
+      _loops = vMathLoops;
+      _doIt = vDoMath;
+   }
 };
 
 #endif // CMDANDINIT_H
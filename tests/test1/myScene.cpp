@@ -34,17 +34,20 @@ int myScene::init() {
 
    beginInitObject();
 
-   auto lNames = loadFile( vFilePath );
+   INIT_OBJS lInit;
+   auto      lNames = loadFile( vFilePath );
    for ( auto const &i : lNames ) {
       if ( i.type != MESH_3D )
          continue;
 
       vObjects.emplace_back( std::make_shared<rSimpleMesh>( this, i.name ) );
 
-      initObject( vObjects.back(), i.index );
+      lInit.emplace_back( vObjects.back(), i.index );
       vObjects.back()->setPosition( rVec3f( 0, 0, -5 ) );
+      vObjects.back()->updateFinalMatrix();
    }
 
+   initObjects( lInit );
    endInitObject();
 
    vPointLights.emplace_back( std::make_shared<rPointLightF>( this, "L1" ) );
@@ -108,6 +111,8 @@ void myScene::objectMoveLoop() {
       for ( auto &i : vObjects )
          i->setRotation( lAxis, lRotDeg );
 
+      updateMatrices(); // Publish for the render thread
+
       getWorldPtr()->waitForFrame( lWaitMutex );
    }
 }
@@ -121,10 +126,12 @@ void myScene::keySlot( const iEventInfo &_inf ) {
          case L'z':
             vRotationAngle += 0.25;
             i->setRotation( rVec3f( 0, 1, 0 ), vRotationAngle );
+            i->updateFinalMatrix();
             break;
          case L't':
             vRotationAngle -= 0.25;
             i->setRotation( rVec3f( 0, 1, 0 ), vRotationAngle );
+            i->updateFinalMatrix();
             break;
       }
    }
@@ -132,8 +139,7 @@ void myScene::keySlot( const iEventInfo &_inf ) {
 
 
 void myScene::afterCameraUpdate() {
-   for ( auto &i : vObjects )
-      i->updateFinalMatrix();
+   // objectMoveLoop publishes all objects for the new camera with its next updateMatrices()
 
    //    vLight1.updateFinalMatrix();
    //    vLight2.updateFinalMatrix();
@@ -0,0 +1,660 @@
+/*!
+ * \file uAsyncFileLoader.cpp
+ * \brief \b Classes: \a uAsyncFileLoader
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uAsyncFileLoader.hpp"
+#include "uHashCache.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined( __linux__ ) && defined( __has_include )
+#if __has_include( <linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined( __NR_io_uring_setup ) && defined( __NR_io_uring_enter )
+#define U_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+#endif // UNIX
+
+#ifndef U_HAVE_IO_URING
+#define U_HAVE_IO_URING 0
+#endif
+
+namespace e_engine {
+
+#if U_HAVE_IO_URING
+struct uAsyncFileLoader::Ring {
+   int      fd      = -1;
+   unsigned entries = 0;
+
+   void * sqPtr    = MAP_FAILED;
+   void * cqPtr    = MAP_FAILED;
+   void * sqesPtr  = MAP_FAILED;
+   size_t sqSize   = 0;
+   size_t cqSize   = 0;
+   size_t sqesSize = 0;
+
+   unsigned *    sqTail  = nullptr;
+   unsigned *    sqMask  = nullptr;
+   unsigned *    sqArray = nullptr;
+   io_uring_sqe *sqes    = nullptr;
+
+   unsigned *    cqHead = nullptr;
+   unsigned *    cqTail = nullptr;
+   unsigned *    cqMask = nullptr;
+   io_uring_cqe *cqes   = nullptr;
+};
+#else
+struct uAsyncFileLoader::Ring {};
+#endif
+
+namespace {
+
+#if UNIX
+int openFile( uAsyncFile &_file, int &_fd, size_t &_size ) {
+   struct stat lStat;
+   if ( stat( _file.path.c_str(), &lStat ) != 0 ) {
+      eLOG( "File '", _file.path, "' does not exists" );
+      return 3;
+   }
+
+   if ( !S_ISREG( lStat.st_mode ) ) {
+      eLOG( "'", _file.path, "' is not a file!" );
+      return 4;
+   }
+
+   _fd = open( _file.path.c_str(), O_RDONLY | O_CLOEXEC );
+   if ( _fd < 0 ) {
+      eLOG( "Unable to open ", _file.path );
+      return 5;
+   }
+
+   _size = static_cast<size_t>( lStat.st_size );
+   return 1;
+}
+
+int preadAll( int _fd, uAsyncFile &_file, size_t _offset ) {
+   while ( _offset < _file.data.size() ) {
+      ssize_t lRes = pread( _fd,
+                            &_file.data[_offset],
+                            _file.data.size() - _offset,
+                            static_cast<off_t>( _offset ) );
+
+      if ( lRes < 0 ) {
+         if ( errno == EINTR )
+            continue;
+
+         eLOG( "Failed to read '", _file.path, "': ", std::strerror( errno ) );
+         return 5;
+      }
+
+      if ( lRes == 0 ) {
+         wLOG( "File size missmatch (to small)! File: '", _file.path, "'" );
+         _file.data.resize( _offset );
+         break;
+      }
+
+      _offset += static_cast<size_t>( lRes );
+   }
+
+   return 1;
+}
+#endif
+
+int readBlocking( uAsyncFile &_file ) {
+#if UNIX
+   int    lFD   = -1;
+   size_t lSize = 0;
+   int    lRet  = openFile( _file, lFD, lSize );
+
+   if ( lRet != 1 )
+      return lRet;
+
+   _file.data.resize( lSize );
+   lRet = preadAll( lFD, _file, 0 );
+   close( lFD );
+   return lRet;
+#else
+   uFileIO lFile( _file.path );
+   int     lRet = lFile.read();
+   _file.data   = std::move( *lFile.getData() );
+   return lRet;
+#endif
+}
+}
+
+
+/*!
+ * \brief Starts the loader
+ *
+ * Tries to set up io_uring first. If that fails _numThreads reader threads are started.
+ *
+ * \param[in] _numThreads Number of threads for the pread fallback (0: number of cores, at least 2)
+ * \param[in] _queueDepth Maximum number of reads in flight when io_uring is used
+ */
+uAsyncFileLoader::uAsyncFileLoader( unsigned _numThreads, unsigned _queueDepth ) {
+   vRunning_B    = true;
+   vUseIOuring_B = initIOuring( _queueDepth );
+
+   if ( vUseIOuring_B ) {
+      vThreads.emplace_back( &uAsyncFileLoader::ioUringLoop, this );
+      return;
+   }
+
+   if ( _numThreads == 0 )
+      _numThreads = std::max( 2u, std::thread::hardware_concurrency() );
+
+   for ( unsigned i = 0; i < _numThreads; ++i )
+      vThreads.emplace_back( &uAsyncFileLoader::poolLoop, this );
+}
+
+/*!
+ * \brief Finishes all queued reads and stops the loader threads
+ */
+uAsyncFileLoader::~uAsyncFileLoader() {
+   {
+      std::lock_guard<std::mutex> lLock( vQueue_MUT );
+      vRunning_B = false;
+   }
+
+   vQueue_CV.notify_all();
+
+   for ( auto &i : vThreads )
+      if ( i.joinable() )
+         i.join();
+
+   destroyIOuring();
+}
+
+
+/*!
+ * \brief Queues one file
+ * \returns a future with the content of the file
+ */
+std::future<uAsyncFile> uAsyncFileLoader::load( std::string _file ) {
+   std::vector<Job> lJobs( 1 );
+   lJobs[0].path                   = _file;
+   std::future<uAsyncFile> lResult = lJobs[0].promise.get_future();
+   queue( lJobs );
+   return lResult;
+}
+
+/*!
+ * \brief Queues a batch of files
+ * \returns one future per file (same order as _files)
+ */
+std::vector<std::future<uAsyncFile>> uAsyncFileLoader::load(
+      std::vector<std::string> const &_files ) {
+   std::vector<Job>                     lJobs( _files.size() );
+   std::vector<std::future<uAsyncFile>> lResult;
+   lResult.reserve( _files.size() );
+
+   for ( size_t i = 0; i < _files.size(); ++i ) {
+      lJobs[i].path = _files[i];
+      lResult.emplace_back( lJobs[i].promise.get_future() );
+   }
+
+   queue( lJobs );
+   return lResult;
+}
+
+/*!
+ * \brief Queues one file
+ * \param[in] _callback called from a loader thread when the file was read
+ */
+void uAsyncFileLoader::load( std::string _file, CALLBACK _callback ) {
+   std::vector<Job> lJobs( 1 );
+   lJobs[0].path     = _file;
+   lJobs[0].callback = _callback;
+   queue( lJobs );
+}
+
+/*!
+ * \brief Queues a batch of files
+ * \param[in] _callback called from a loader thread for every file that was read
+ */
+void uAsyncFileLoader::load( std::vector<std::string> const &_files, CALLBACK _callback ) {
+   std::vector<Job> lJobs( _files.size() );
+
+   for ( size_t i = 0; i < _files.size(); ++i ) {
+      lJobs[i].path     = _files[i];
+      lJobs[i].callback = _callback;
+   }
+
+   queue( lJobs );
+}
+
+
+void uAsyncFileLoader::queue( std::vector<Job> &_jobs ) {
+   {
+      std::lock_guard<std::mutex> lLock( vQueue_MUT );
+      for ( auto &i : _jobs )
+         vQueue.emplace_back( std::move( i ) );
+   }
+
+   if ( _jobs.size() == 1 )
+      vQueue_CV.notify_one();
+   else
+      vQueue_CV.notify_all();
+}
+
+/*!
+ * \brief Moves up to _max jobs from the queue into _jobs
+ * \param[in] _wait block until there is at least one job or the loader is stopped
+ * \returns false if the loader is stopped and there is nothing left to do
+ */
+bool uAsyncFileLoader::popJobs( std::vector<Job> &_jobs, size_t _max, bool _wait ) {
+   std::unique_lock<std::mutex> lLock( vQueue_MUT );
+
+   if ( _wait )
+      vQueue_CV.wait( lLock, [this]() { return !vQueue.empty() || !vRunning_B; } );
+
+   while ( !vQueue.empty() && _jobs.size() < _max ) {
+      _jobs.emplace_back( std::move( vQueue.front() ) );
+      vQueue.pop_front();
+   }
+
+   return vRunning_B || !_jobs.empty();
+}
+
+void uAsyncFileLoader::finish( Job &_job, uAsyncFile &&_file ) {
+   if ( vHashCache && _file.status == 1 ) {
+      uHashCache::FileInfo lInfo;
+      bool                 lHaveInfo = uHashCache::getFileInfo( _file.path, lInfo ) == 1;
+
+      if ( !lHaveInfo || !vHashCache->lookup( _file.path, lInfo, _file.digest ) ) {
+         uSHA_2 lHasher( vHashCache->getType() );
+         _file.digest = lHasher.quickHash( vHashCache->getType(), _file.data );
+
+         // A change after the read has a recent mtime and is not stored (see uHashCache)
+         if ( lHaveInfo && lInfo.size == _file.data.size() )
+            vHashCache->insert( _file.path, lInfo, _file.digest );
+      }
+   }
+
+   if ( _job.callback )
+      _job.callback( _file );
+   else
+      _job.promise.set_value( std::move( _file ) );
+}
+
+
+void uAsyncFileLoader::poolLoop() {
+   LOG.nameThread( L"fload" );
+
+   std::vector<Job> lJobs;
+   while ( popJobs( lJobs, 1, true ) ) {
+      for ( auto &i : lJobs ) {
+         uAsyncFile lFile;
+         lFile.path   = i.path;
+         lFile.status = readBlocking( lFile );
+         finish( i, std::move( lFile ) );
+      }
+
+      lJobs.clear();
+   }
+}
+
+
+
+/*
+ *  ___                         _
+ * |_ _|___    _   _ _ __ _ __ (_)_ __   __ _
+ *  | |/ _ \  | | | | '__| '_ \| | '_ \ / _` |
+ *  | | (_) | | |_| | |  | | | | | | | | (_| |
+ * |___\___/___\__,_|_|  |_| |_|_|_| |_|\__, |
+ *        |_____|                       |___/
+ */
+
+/*!
+ * \brief Creates the io_uring instance and maps its rings
+ * \returns true when io_uring can be used
+ */
+bool uAsyncFileLoader::initIOuring( unsigned _entries ) {
+#if U_HAVE_IO_URING
+   io_uring_params lParams;
+   std::memset( &lParams, 0, sizeof( lParams ) );
+
+   int lFD = static_cast<int>( syscall( __NR_io_uring_setup, std::max( _entries, 1u ), &lParams ) );
+   if ( lFD < 0 ) {
+      iLOG( "io_uring not available (", std::strerror( errno ), ") -- using a pread thread pool" );
+      return false;
+   }
+
+   vRing          = new Ring;
+   vRing->fd      = lFD;
+   vRing->entries = lParams.sq_entries;
+   vRing->sqSize  = lParams.sq_off.array + lParams.sq_entries * sizeof( unsigned );
+   vRing->cqSize  = lParams.cq_off.cqes + lParams.cq_entries * sizeof( io_uring_cqe );
+
+   bool lSingleMap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+   lSingleMap = ( lParams.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+   if ( lSingleMap )
+      vRing->sqSize = vRing->cqSize = std::max( vRing->sqSize, vRing->cqSize );
+#endif
+
+   vRing->sqPtr = mmap( nullptr,
+                        vRing->sqSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        lFD,
+                        IORING_OFF_SQ_RING );
+
+   if ( lSingleMap ) {
+      vRing->cqPtr = vRing->sqPtr;
+   } else {
+      vRing->cqPtr = mmap( nullptr,
+                           vRing->cqSize,
+                           PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE,
+                           lFD,
+                           IORING_OFF_CQ_RING );
+   }
+
+   vRing->sqesSize = lParams.sq_entries * sizeof( io_uring_sqe );
+   vRing->sqesPtr  = mmap( nullptr,
+                          vRing->sqesSize,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE,
+                          lFD,
+                          IORING_OFF_SQES );
+
+   if ( vRing->sqPtr == MAP_FAILED || vRing->cqPtr == MAP_FAILED || vRing->sqesPtr == MAP_FAILED ) {
+      wLOG( "Failed to map the io_uring buffers -- using a pread thread pool" );
+      destroyIOuring();
+      return false;
+   }
+
+   char *lSQ = static_cast<char *>( vRing->sqPtr );
+   char *lCQ = static_cast<char *>( vRing->cqPtr );
+
+   vRing->sqTail  = reinterpret_cast<unsigned *>( lSQ + lParams.sq_off.tail );
+   vRing->sqMask  = reinterpret_cast<unsigned *>( lSQ + lParams.sq_off.ring_mask );
+   vRing->sqArray = reinterpret_cast<unsigned *>( lSQ + lParams.sq_off.array );
+   vRing->sqes    = static_cast<io_uring_sqe *>( vRing->sqesPtr );
+
+   vRing->cqHead = reinterpret_cast<unsigned *>( lCQ + lParams.cq_off.head );
+   vRing->cqTail = reinterpret_cast<unsigned *>( lCQ + lParams.cq_off.tail );
+   vRing->cqMask = reinterpret_cast<unsigned *>( lCQ + lParams.cq_off.ring_mask );
+   vRing->cqes   = reinterpret_cast<io_uring_cqe *>( lCQ + lParams.cq_off.cqes );
+
+   iLOG( "Async file loader: using io_uring (", vRing->entries, " entries)" );
+   return true;
+#else
+   (void)_entries;
+   return false;
+#endif
+}
+
+void uAsyncFileLoader::destroyIOuring() {
+   if ( !vRing )
+      return;
+
+#if U_HAVE_IO_URING
+   if ( vRing->sqesPtr != MAP_FAILED )
+      munmap( vRing->sqesPtr, vRing->sqesSize );
+
+   if ( vRing->cqPtr != MAP_FAILED && vRing->cqPtr != vRing->sqPtr )
+      munmap( vRing->cqPtr, vRing->cqSize );
+
+   if ( vRing->sqPtr != MAP_FAILED )
+      munmap( vRing->sqPtr, vRing->sqSize );
+
+   if ( vRing->fd >= 0 )
+      close( vRing->fd );
+#endif
+
+   delete vRing;
+   vRing = nullptr;
+}
+
+/*!
+ * \brief Submits and reaps all reads through io_uring
+ *
+ * Every file is opened and stat-ed on this thread. The reads are then submitted in one
+ * io_uring_enter call per loop iteration. Short reads are resubmitted with the new offset.
+ *
+ * When io_uring_enter fails, the reads the kernel already has are waited for, and the remaining
+ * reads are finished with pread. If even waiting fails, these reads fail with status 5, because
+ * the kernel may still write into their buffers.
+ */
+void uAsyncFileLoader::ioUringLoop() {
+#if U_HAVE_IO_URING
+   LOG.nameThread( L"uring" );
+
+   struct InFlight {
+      Job        job;
+      uAsyncFile file;
+      int        fd   = -1;
+      size_t     done = 0;
+   };
+
+   // Not a std::vector: the slots are leaked when the kernel might still write into them
+   unsigned                    lNumSlots = vRing->entries;
+   std::unique_ptr<InFlight[]> lSlotMem( new InFlight[lNumSlots] );
+   InFlight *                  lSlots = lSlotMem.get();
+
+   std::vector<unsigned> lFree;
+   std::vector<Job>      lNew;
+   unsigned              lInFlight = 0;
+   unsigned              lToSubmit = 0; //!< Prepared SQEs
+   unsigned              lPending  = 0; //!< Submitted reads without a reaped CQE
+
+   for ( unsigned i = 0; i < vRing->entries; ++i )
+      lFree.push_back( vRing->entries - i - 1 );
+
+   auto lPrepRead = [&]( unsigned _slot ) {
+      InFlight &lSlot  = lSlots[_slot];
+      unsigned  lTail  = *vRing->sqTail;
+      unsigned  lIndex = lTail & *vRing->sqMask;
+      size_t    lLeft  = lSlot.file.data.size() - lSlot.done;
+
+      io_uring_sqe *lSQE = &vRing->sqes[lIndex];
+      std::memset( lSQE, 0, sizeof( io_uring_sqe ) );
+      lSQE->opcode    = IORING_OP_READ;
+      lSQE->fd        = lSlot.fd;
+      lSQE->addr      = reinterpret_cast<uint64_t>( &lSlot.file.data[lSlot.done] );
+      lSQE->len       = static_cast<uint32_t>( std::min<size_t>( lLeft, 1u << 30 ) );
+      lSQE->off       = lSlot.done;
+      lSQE->user_data = _slot;
+
+      vRing->sqArray[lIndex] = lIndex;
+      __atomic_store_n( vRing->sqTail, lTail + 1, __ATOMIC_RELEASE );
+      ++lToSubmit;
+   };
+
+   auto lFinish = [&]( unsigned _slot ) {
+      InFlight &lSlot = lSlots[_slot];
+      close( lSlot.fd );
+      finish( lSlot.job, std::move( lSlot.file ) );
+      lSlot = InFlight();
+      lFree.push_back( _slot );
+      --lInFlight;
+   };
+
+   bool lRunning = true;
+   while ( true ) {
+      // Only block on the queue when the kernel has nothing to do
+      lRunning = popJobs( lNew, lFree.size(), lInFlight == 0 );
+      if ( !lRunning && lInFlight == 0 )
+         break;
+
+      for ( auto &i : lNew ) {
+         uAsyncFile lFile;
+         int        lFD   = -1;
+         size_t     lSize = 0;
+
+         lFile.path   = i.path;
+         lFile.status = openFile( lFile, lFD, lSize );
+
+         if ( lFile.status != 1 || lSize == 0 ) {
+            if ( lFD >= 0 )
+               close( lFD );
+
+            finish( i, std::move( lFile ) );
+            continue;
+         }
+
+         lFile.data.resize( lSize );
+
+         unsigned lSlot = lFree.back();
+         lFree.pop_back();
+
+         lSlots[lSlot].job  = std::move( i );
+         lSlots[lSlot].file = std::move( lFile );
+         lSlots[lSlot].fd   = lFD;
+         lSlots[lSlot].done = 0;
+         ++lInFlight;
+         lPrepRead( lSlot );
+      }
+
+      lNew.clear();
+
+      if ( lInFlight == 0 )
+         continue;
+
+      int lRet = static_cast<int>( syscall(
+            __NR_io_uring_enter, vRing->fd, lToSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0 ) );
+
+      if ( lRet < 0 ) {
+         if ( errno == EINTR || errno == EAGAIN || errno == EBUSY )
+            continue;
+
+         eLOG( "io_uring_enter failed: ", std::strerror( errno ) );
+         break;
+      }
+
+      unsigned lSubmitted = std::min( lToSubmit, static_cast<unsigned>( lRet ) );
+      lToSubmit -= lSubmitted;
+      lPending += lSubmitted;
+
+      unsigned lHead = *vRing->cqHead;
+      while ( lHead != __atomic_load_n( vRing->cqTail, __ATOMIC_ACQUIRE ) ) {
+         io_uring_cqe *lCQE  = &vRing->cqes[lHead & *vRing->cqMask];
+         unsigned      lId   = static_cast<unsigned>( lCQE->user_data );
+         int           lRes  = lCQE->res;
+         InFlight &    lSlot = lSlots[lId];
+         ++lHead;
+         --lPending;
+
+         if ( lRes > 0 ) {
+            lSlot.done += static_cast<size_t>( lRes );
+            if ( lSlot.done < lSlot.file.data.size() ) {
+               lPrepRead( lId ); // Short read
+               continue;
+            }
+         } else if ( lRes == 0 ) {
+            wLOG( "File size missmatch (to small)! File: '", lSlot.file.path, "'" );
+            lSlot.file.data.resize( lSlot.done );
+         } else if ( lRes == -EINTR || lRes == -EAGAIN ) {
+            lPrepRead( lId );
+            continue;
+         } else if ( lRes == -EINVAL || lRes == -EOPNOTSUPP ) {
+            // IORING_OP_READ is not supported by this kernel
+            lSlot.file.status = preadAll( lSlot.fd, lSlot.file, lSlot.done );
+         } else {
+            eLOG( "Failed to read '", lSlot.file.path, "': ", std::strerror( -lRes ) );
+            lSlot.file.status = 5;
+         }
+
+         lFinish( lId );
+      }
+
+      __atomic_store_n( vRing->cqHead, lHead, __ATOMIC_RELEASE );
+   }
+
+   // io_uring failed: wait until the kernel is done with the submitted reads
+   bool lDrained = true;
+   while ( true ) {
+      unsigned lHead = *vRing->cqHead;
+      for ( ; lHead != __atomic_load_n( vRing->cqTail, __ATOMIC_ACQUIRE ); ++lHead ) {
+         io_uring_cqe *lCQE = &vRing->cqes[lHead & *vRing->cqMask];
+         if ( lCQE->res > 0 )
+            lSlots[lCQE->user_data].done += static_cast<size_t>( lCQE->res );
+
+         --lPending;
+      }
+
+      __atomic_store_n( vRing->cqHead, lHead, __ATOMIC_RELEASE );
+
+      if ( lPending == 0 )
+         break;
+
+      int lRet = static_cast<int>( syscall(
+            __NR_io_uring_enter, vRing->fd, 0, lPending, IORING_ENTER_GETEVENTS, nullptr, 0 ) );
+
+      if ( lRet < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY ) {
+         eLOG( "Unable to wait for ", lPending, " io_uring reads: ", std::strerror( errno ) );
+         lDrained = false;
+         break;
+      }
+   }
+
+   // Closing the ring cancels what is left in the kernel
+   destroyIOuring();
+
+   // Finish the remaining reads without io_uring
+   for ( unsigned i = 0; i < lNumSlots && lInFlight > 0; ++i ) {
+      InFlight &lSlot = lSlots[i];
+      if ( lSlot.fd < 0 )
+         continue;
+
+      if ( lDrained ) {
+         lSlot.file.status = preadAll( lSlot.fd, lSlot.file, lSlot.done );
+         lFinish( i );
+         continue;
+      }
+
+      // Do not touch (or free) the buffer, the kernel may still write into it
+      uAsyncFile lFailed;
+      lFailed.path   = lSlot.file.path;
+      lFailed.status = 5;
+
+      close( lSlot.fd );
+      lSlot.fd = -1;
+      finish( lSlot.job, std::move( lFailed ) );
+      --lInFlight;
+   }
+
+   if ( !lDrained ) {
+      wLOG( "Leaking the io_uring read buffers" );
+      lSlotMem.release();
+   }
+
+   if ( lRunning )
+      poolLoop();
+#endif
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
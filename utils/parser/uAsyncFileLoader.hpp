@@ -0,0 +1,118 @@
+/*!
+ * \file uAsyncFileLoader.hpp
+ * \brief \b Classes: \a uAsyncFileLoader
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uFileIO.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace e_engine {
+
+class uHashCache;
+
+/*!
+ * \brief Result of one asynchronous read
+ *
+ * status has the same meaning as the return value of uFileIO::read
+ */
+struct uAsyncFile {
+   std::string                path;
+   uFileIO::TYPE              data;
+   int                        status = 0;
+   std::vector<unsigned char> digest; //!< SHA-2 digest of data (only with a hash cache)
+};
+
+/*!
+ * \class e_engine::uAsyncFileLoader
+ * \brief Reads batches of files in the background
+ *
+ * On Linux all reads of a batch are submitted through one io_uring instance, which is driven by a
+ * single thread. When io_uring is not available (old kernel, disabled by the system, other
+ * platforms) a pool of threads reading the files with pread is used instead.
+ *
+ * Every request either fulfills a std::future or calls a callback. Callbacks are called from the
+ * loader threads.
+ *
+ * With a hash cache (setHashCache) the digest of every read file is looked up in the cache and
+ * only calculated (and stored) for new or changed files. The cache has to be set before files are
+ * queued.
+ */
+class UTILS_API uAsyncFileLoader final {
+ public:
+   typedef std::function<void( uAsyncFile & )> CALLBACK;
+
+ private:
+   struct Job {
+      std::string              path;
+      std::promise<uAsyncFile> promise;
+      CALLBACK                 callback;
+   };
+
+   struct Ring; //!< io_uring mappings (only defined when io_uring is supported)
+
+   std::deque<Job>          vQueue;
+   std::mutex               vQueue_MUT;
+   std::condition_variable  vQueue_CV;
+   std::vector<std::thread> vThreads;
+
+   bool        vRunning_B    = false;
+   bool        vUseIOuring_B = false;
+   Ring *      vRing         = nullptr;
+   uHashCache *vHashCache    = nullptr;
+
+   void queue( std::vector<Job> &_jobs );
+   bool popJobs( std::vector<Job> &_jobs, size_t _max, bool _wait );
+
+   void finish( Job &_job, uAsyncFile &&_file );
+
+   bool initIOuring( unsigned _entries );
+   void destroyIOuring();
+   void ioUringLoop();
+   void poolLoop();
+
+ public:
+   uAsyncFileLoader( unsigned _numThreads = 0, unsigned _queueDepth = 64 );
+   ~uAsyncFileLoader();
+
+   uAsyncFileLoader( uAsyncFileLoader const & ) = delete;
+   uAsyncFileLoader &operator=( uAsyncFileLoader const & ) = delete;
+
+   std::future<uAsyncFile> load( std::string _file );
+   std::vector<std::future<uAsyncFile>> load( std::vector<std::string> const &_files );
+
+   void load( std::string _file, CALLBACK _callback );
+   void load( std::vector<std::string> const &_files, CALLBACK _callback );
+
+   void setHashCache( uHashCache *_cache ) { vHashCache = _cache; }
+
+   bool isUsingIOuring() const { return vUseIOuring_B; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,225 @@
+/*!
+ * \file uFileChunkReader.cpp
+ * \brief \b Classes: \a uFileChunkReader
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uFileChunkReader.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include FILESYSTEM_INCLUDE
+
+#if UNIX
+#include <fcntl.h>
+#endif
+
+namespace e_engine {
+
+/*!
+ * \param[in] _file      The file to read
+ * \param[in] _chunkSize The size of one chunk in bytes
+ */
+uFileChunkReader::uFileChunkReader( std::string _file, size_t _chunkSize )
+    : vFilePath_str( _file ), vChunkSize( std::max<size_t>( _chunkSize, 1 ) ) {}
+
+uFileChunkReader::~uFileChunkReader() { close(); }
+
+/*!
+ * \brief Opens the file and starts reading the first chunks in the background
+ *
+ * The background thread is only started when the file is larger than one chunk.
+ *
+ * \returns 1 if everything went fine
+ * \returns 2 if the file is already open
+ * \returns 3 if the file doesn't exists
+ * \returns 4 if the file is not a regular file
+ * \returns 5 if the file is not readable
+ */
+int uFileChunkReader::open() {
+   if ( vFile != nullptr )
+      return 2;
+
+   FILESYSTEM_NAMESPACE::path        lFilePath_BFS( vFilePath_str.c_str() );
+   FILESYSTEM_NAMESPACE::file_status lStatus = FILESYSTEM_NAMESPACE::status( lFilePath_BFS );
+
+   if ( !FILESYSTEM_NAMESPACE::exists( lStatus ) ) {
+      eLOG( "File '", vFilePath_str, "' does not exists" );
+      return 3;
+   }
+
+   if ( !FILESYSTEM_NAMESPACE::is_regular_file( lStatus ) ) {
+      eLOG( "'", vFilePath_str, "' is not a file!" );
+      return 4;
+   }
+
+   vFile = fopen( vFilePath_str.c_str(), "rb" );
+   if ( vFile == nullptr ) {
+      eLOG( "Unable to open ", vFilePath_str );
+      return 5;
+   }
+
+   // We already read in large chunks; stdio buffering would only add a copy
+   setvbuf( vFile, nullptr, _IONBF, 0 );
+
+#if UNIX
+   posix_fadvise( fileno( vFile ), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+   vFileSize   = static_cast<uint64_t>( FILESYSTEM_NAMESPACE::file_size( lFilePath_BFS ) );
+   vNextSlot   = 0;
+   vHoldSlot_B = false;
+   vDone_B     = false;
+   vError_B    = false;
+   vStop_B     = false;
+   vState[0]   = SLOT_FREE;
+   vState[1]   = SLOT_FREE;
+   vAsync_B    = vFileSize > vChunkSize;
+
+   // Small files get a buffer of their size (at least 1 byte to notice that the file grew)
+   vReadSize = vAsync_B ? vChunkSize : std::max<size_t>( static_cast<size_t>( vFileSize ), 1 );
+
+   for ( unsigned i = 0; i < ( vAsync_B ? 2u : 1u ); ++i ) {
+      if ( vBufferSize[i] < vReadSize ) {
+         vBuffer[i].reset( new char[vReadSize] );
+         vBufferSize[i] = vReadSize;
+      }
+   }
+
+   if ( vAsync_B )
+      vReadThread = std::thread( &uFileChunkReader::readLoop, this );
+
+   return 1;
+}
+
+/*!
+ * \brief Returns the next chunk
+ *
+ * The returned data stays valid until the next call of next() or close(). Every chunk has the full
+ * chunk size, except for the last one.
+ *
+ * \param[out] _data the chunk
+ * \param[out] _size the size of the chunk
+ *
+ * \returns false at the end of the file or on a read error (see hasError())
+ */
+bool uFileChunkReader::next( char const *&_data, size_t &_size ) {
+   if ( vFile == nullptr )
+      return false;
+
+   // Read small files directly; there is nothing to overlap with
+   if ( !vAsync_B ) {
+      if ( vDone_B )
+         return false;
+
+      vDone_B = readChunk( 0, vSize[0], vError_B );
+      _data   = vBuffer[0].get();
+      _size   = vSize[0];
+      return _size > 0;
+   }
+
+   std::unique_lock<std::mutex> lLock( vSlot_MUT );
+
+   // Hand the previous chunk back to the read thread
+   if ( vHoldSlot_B ) {
+      vState[vNextSlot ^ 1] = SLOT_FREE;
+      vHoldSlot_B           = false;
+      vSlot_CV.notify_all();
+   }
+
+   vSlot_CV.wait( lLock, [this]() { return vState[vNextSlot] == SLOT_FILLED || vDone_B; } );
+
+   if ( vState[vNextSlot] != SLOT_FILLED || vSize[vNextSlot] == 0 )
+      return false;
+
+   _data       = vBuffer[vNextSlot].get();
+   _size       = vSize[vNextSlot];
+   vHoldSlot_B = true;
+   vNextSlot ^= 1;
+   return true;
+}
+
+/*!
+ * \brief Stops the read thread and closes the file
+ */
+void uFileChunkReader::close() {
+   {
+      std::lock_guard<std::mutex> lLock( vSlot_MUT );
+      vStop_B = true;
+   }
+
+   vSlot_CV.notify_all();
+
+   if ( vReadThread.joinable() )
+      vReadThread.join();
+
+   if ( vFile != nullptr ) {
+      fclose( vFile );
+      vFile = nullptr;
+   }
+}
+
+/*!
+ * \brief Reads the next chunk of the file into the buffer of _slot
+ * \returns true at the end of the file (or on a read error)
+ */
+bool uFileChunkReader::readChunk( unsigned _slot, size_t &_size, bool &_error ) {
+   _size  = fread( vBuffer[_slot].get(), 1, vReadSize, vFile );
+   _error = ferror( vFile ) != 0;
+
+   if ( _error )
+      eLOG( "Failed to read '", vFilePath_str, "'" );
+
+   return _error || _size < vReadSize;
+}
+
+void uFileChunkReader::readLoop() {
+   unsigned lSlot = 0;
+
+   while ( true ) {
+      {
+         std::unique_lock<std::mutex> lLock( vSlot_MUT );
+         vSlot_CV.wait( lLock, [&]() { return vState[lSlot] == SLOT_FREE || vStop_B; } );
+
+         if ( vStop_B )
+            return;
+      }
+
+      // The slot is free, so nobody else touches this buffer
+      size_t lRead;
+      bool   lError;
+      bool   lDone = readChunk( lSlot, lRead, lError );
+
+      {
+         std::lock_guard<std::mutex> lLock( vSlot_MUT );
+         vSize[lSlot]  = lRead;
+         vState[lSlot] = SLOT_FILLED;
+         vDone_B       = lDone;
+         vError_B      = lError;
+      }
+
+      vSlot_CV.notify_all();
+
+      if ( lDone )
+         return;
+
+      lSlot ^= 1;
+   }
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,104 @@
+/*!
+ * \file uFileChunkReader.hpp
+ * \brief \b Classes: \a uFileChunkReader
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uFileChunkReader
+ * \brief Reads a file in fixed size chunks
+ *
+ * Two chunk buffers are used: while the caller works on one chunk, a background thread reads the
+ * next chunk into the other buffer. Only 2 * chunk size bytes are resident, no matter how large
+ * the file is.
+ *
+ * Files that fit into one chunk are read by next() directly, without the background thread and
+ * with a single buffer of the file size.
+ *
+ * \code
+ * uFileChunkReader lReader( "big.bin" );
+ * if ( lReader.open() != 1 )
+ *    return;
+ *
+ * char const *lData;
+ * size_t      lSize;
+ * while ( lReader.next( lData, lSize ) )
+ *    lHash.add( lData, lSize );
+ * \endcode
+ */
+class UTILS_API uFileChunkReader final {
+ private:
+   enum SLOT_STATE { SLOT_FREE, SLOT_FILLED };
+
+   std::string vFilePath_str;
+   FILE *      vFile = nullptr;
+
+   std::unique_ptr<char[]> vBuffer[2];              //!< Not initialized (allocated by open())
+   size_t                  vBufferSize[2] = {0, 0}; //!< Allocated size of the buffers
+   size_t                  vReadSize      = 0;      //!< Bytes read into a buffer at once
+   size_t                  vChunkSize;
+   size_t                  vSize[2]  = {0, 0};
+   SLOT_STATE              vState[2] = {SLOT_FREE, SLOT_FREE};
+
+   unsigned vNextSlot   = 0;     //!< The slot next() returns next
+   bool     vHoldSlot_B = false; //!< The caller currently holds the other slot
+   bool     vDone_B     = false; //!< The read thread reached the end of the file (or an error)
+   bool     vError_B    = false;
+   bool     vStop_B     = false;
+   bool     vAsync_B    = false; //!< The file is larger than one chunk (vReadThread reads ahead)
+   uint64_t vFileSize   = 0;
+
+   std::thread             vReadThread;
+   std::mutex              vSlot_MUT;
+   std::condition_variable vSlot_CV;
+
+   bool readChunk( unsigned _slot, size_t &_size, bool &_error );
+   void readLoop();
+
+ public:
+   uFileChunkReader( std::string _file, size_t _chunkSize = 1024 * 1024 );
+   ~uFileChunkReader();
+
+   uFileChunkReader() = delete;
+   uFileChunkReader( uFileChunkReader const & ) = delete;
+   uFileChunkReader &operator=( uFileChunkReader const & ) = delete;
+
+   int  open();
+   bool next( char const *&_data, size_t &_size );
+   void close();
+
+   bool     hasError() const { return vError_B; }
+   uint64_t getFileSize() const { return vFileSize; }
+   size_t   getChunkSize() const { return vChunkSize; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
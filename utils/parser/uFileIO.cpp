@@ -19,11 +19,164 @@
  */
 
 #include "uFileIO.hpp"
+#include "uFileChunkReader.hpp"
 #include "uLog.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <set>
 #include FILESYSTEM_INCLUDE
 
+#if UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if WINDOWS
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#endif
+
 namespace e_engine {
 
+namespace {
+
+std::string parentDir( std::string const &_file ) {
+   std::string lDir = FILESYSTEM_NAMESPACE::path( _file ).parent_path().string();
+   return lDir.empty() ? std::string( "." ) : lDir;
+}
+
+std::string tempName( std::string const &_file ) {
+   static std::atomic<unsigned> lCounter( 0 );
+#if WINDOWS
+   int lPID = _getpid();
+#else
+   int lPID = static_cast<int>( getpid() );
+#endif
+   return _file + ".tmp." + std::to_string( lPID ) + "." + std::to_string( lCounter++ );
+}
+
+/*!
+ * \brief Writes _data into a new temporary file next to _file
+ * \param[out] _tmp the name of the temporary file
+ * \returns 1 on success and 5 on failure (the temporary file is then removed)
+ */
+int writeTemp( std::string const &  _file,
+               uFileIO::TYPE const &_data,
+               uFileIO::DURABILITY  _durability,
+               std::string &        _tmp ) {
+   _tmp = tempName( _file );
+
+#if UNIX
+   int lFD = open( _tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666 );
+   if ( lFD < 0 ) {
+      eLOG( "Unable to open '", _tmp, "': ", std::strerror( errno ) );
+      return 5;
+   }
+
+   // Keep the permissions of the file we are replacing
+   struct stat lStat;
+   if ( stat( _file.c_str(), &lStat ) == 0 )
+      fchmod( lFD, lStat.st_mode & 07777 );
+
+   bool   lOK   = true;
+   size_t lDone = 0;
+   while ( lDone < _data.size() ) {
+      ssize_t lRes = ::write( lFD, _data.data() + lDone, _data.size() - lDone );
+      if ( lRes < 0 ) {
+         if ( errno == EINTR )
+            continue;
+
+         lOK = false;
+         break;
+      }
+
+      lDone += static_cast<size_t>( lRes );
+   }
+
+   if ( lOK && _durability == uFileIO::SYNC_DATA )
+      lOK = fdatasync( lFD ) == 0;
+
+   if ( lOK && _durability == uFileIO::SYNC_FULL )
+      lOK = fsync( lFD ) == 0;
+
+   if ( close( lFD ) != 0 )
+      lOK = false;
+#else
+   FILE *lFile = fopen( _tmp.c_str(), "wb" );
+   if ( lFile == nullptr ) {
+      eLOG( "Unable to open '", _tmp, "'" );
+      return 5;
+   }
+
+   bool lOK = fwrite( _data.data(), 1, _data.size(), lFile ) == _data.size();
+   lOK      = fflush( lFile ) == 0 && lOK;
+
+   if ( lOK && _durability != uFileIO::SYNC_NONE )
+      lOK = _commit( _fileno( lFile ) ) == 0;
+
+   lOK = fclose( lFile ) == 0 && lOK;
+#endif
+
+   if ( !lOK ) {
+      eLOG( "Failed to write '", _tmp, "': ", std::strerror( errno ) );
+      std::remove( _tmp.c_str() );
+      return 5;
+   }
+
+   return 1;
+}
+
+/*!
+ * \brief Atomically replaces _file with _tmp
+ * \returns 1 on success and 4 on failure (the temporary file is then removed)
+ */
+int replaceFile( std::string const & _tmp,
+                 std::string const & _file,
+                 uFileIO::DURABILITY _durability ) {
+#if WINDOWS
+   DWORD lFlags = MOVEFILE_REPLACE_EXISTING;
+   if ( _durability == uFileIO::SYNC_FULL )
+      lFlags |= MOVEFILE_WRITE_THROUGH;
+
+   bool lOK = MoveFileExA( _tmp.c_str(), _file.c_str(), lFlags ) != 0;
+#else
+   (void)_durability;
+   bool lOK = ::rename( _tmp.c_str(), _file.c_str() ) == 0;
+#endif
+
+   if ( !lOK ) {
+      eLOG( "Failed to replace '", _file, "' with '", _tmp, "'" );
+      std::remove( _tmp.c_str() );
+      return 4;
+   }
+
+   return 1;
+}
+
+/*!
+ * \brief fsyncs a directory so that renames inside it are on the disk
+ */
+void syncDir( std::string const &_dir ) {
+#if UNIX
+   int lFD = open( _dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+   if ( lFD < 0 ) {
+      wLOG( "Unable to open directory '", _dir, "' for syncing" );
+      return;
+   }
+
+   if ( fsync( lFD ) != 0 )
+      wLOG( "Failed to sync directory '", _dir, "': ", std::strerror( errno ) );
+
+   close( lFD );
+#else
+   (void)_dir; // MOVEFILE_WRITE_THROUGH already did this
+#endif
+}
+}
+
 void uFileIO::clear() {
    vFileRead_B = false;
    vData.clear();
@@ -73,13 +226,10 @@ int uFileIO::read( bool _autoReload ) {
    if ( lSize != static_cast<uintmax_t>( -1 ) ) {
       vData.resize( lSize );
 
-      for ( auto &i : vData ) {
-         if ( ( c = fgetc( lFile ) ) == EOF ) {
-            wLOG( "File size missmatch (to small)! File: '", vFilePath_str, "'" );
-            break;
-         }
-
-         i = static_cast<char>( c );
+      size_t lRead = fread( &vData[0], 1, vData.size(), lFile );
+      if ( lRead < vData.size() ) {
+         wLOG( "File size missmatch (to small)! File: '", vFilePath_str, "'" );
+         vData.resize( lRead );
       }
 
       if ( ( c = fgetc( lFile ) ) != EOF )
@@ -100,18 +250,42 @@ int uFileIO::read( bool _autoReload ) {
 }
 
 /*!
- * \brief Writes the file
+ * \brief Reads the file in chunks without keeping the whole file in memory
+ *
+ * For files larger than one chunk, the next chunk is read in the background while _callback
+ * processes the current one (see uFileChunkReader). The content of the file is \b not stored in
+ * this object.
  *
- * \param[in] _data      what to write
- * \param[in] _overWrite when true, replaces the content of a file
+ * \param[in] _callback  called for every chunk; return false to stop reading
+ * \param[in] _chunkSize the size of one chunk in bytes
  *
  * \returns 1 if everything went fine
- * \returns 2 if the file already exisits read (and _overWrite == false)
- * \returns 3 if the file exists and is not a regular file
- * \returns 4 if the file exists and is not removable
- * \returns 5 if the file is not writable
+ * \returns 3 if the file doesn't exists
+ * \returns 4 if the file is not a regular file
+ * \returns 5 if the file is not readable (also when reading failed in the middle of the file)
+ */
+int uFileIO::readChunks( CHUNK_CALLBACK _callback, size_t _chunkSize ) {
+   uFileChunkReader lReader( vFilePath_str, _chunkSize );
+
+   int lRet = lReader.open();
+   if ( lRet != 1 )
+      return lRet;
+
+   char const *lData;
+   size_t      lSize;
+
+   while ( lReader.next( lData, lSize ) )
+      if ( !_callback( lData, lSize ) )
+         return 1;
+
+   return lReader.hasError() ? 5 : 1;
+}
+
+/*!
+ * \brief Checks whether the file may be (over)written
+ * \returns the error codes of write() (1 if writing is OK)
  */
-int uFileIO::write( const uFileIO::TYPE &_data, bool _overWrite ) {
+int uFileIO::checkWrite( bool _overWrite ) {
    FILESYSTEM_NAMESPACE::path lFilePath_BFS( vFilePath_str.c_str() );
 
    if ( FILESYSTEM_NAMESPACE::exists( lFilePath_BFS ) ) {
@@ -126,25 +300,95 @@ int uFileIO::write( const uFileIO::TYPE &_data, bool _overWrite ) {
       }
 
       wLOG( "File '", vFilePath_str, "' already exists -- overwrite" );
+   }
+
+   return 1;
+}
+
+/*!
+ * \brief Writes the file
+ *
+ * The data is written in one go to a temporary file in the same directory, which is then renamed
+ * over the target. A crash can never leave a half written or missing file behind.
+ *
+ * \param[in] _data       what to write
+ * \param[in] _overWrite  when true, replaces the content of a file
+ * \param[in] _durability when to sync the data to the disk (see DURABILITY)
+ *
+ * \returns 1 if everything went fine
+ * \returns 2 if the file already exisits read (and _overWrite == false)
+ * \returns 3 if the file exists and is not a regular file
+ * \returns 4 if the file could not be replaced
+ * \returns 5 if the file is not writable
+ */
+int uFileIO::write( const uFileIO::TYPE &_data, bool _overWrite, DURABILITY _durability ) {
+   int lRet = checkWrite( _overWrite );
+   if ( lRet != 1 )
+      return lRet;
+
+   std::string lTemp;
+   if ( ( lRet = writeTemp( vFilePath_str, _data, _durability, lTemp ) ) != 1 )
+      return lRet;
+
+   if ( ( lRet = replaceFile( lTemp, vFilePath_str, _durability ) ) != 1 )
+      return lRet;
+
+   if ( _durability == SYNC_FULL )
+      syncDir( parentDir( vFilePath_str ) );
+
+   return 1;
+}
+
+/*!
+ * \brief Writes the data (getData()) of many files at once
+ *
+ * All files are first written to temporary files and synced, then they are all renamed over
+ * their targets. With SYNC_FULL every affected directory is synced only once at the end.
+ *
+ * \param[in] _files      the files to write
+ * \param[in] _overWrite  when true, replaces the content of existing files
+ * \param[in] _durability when to sync the data to the disk (see DURABILITY)
+ *
+ * \returns 1 if all files were written; otherwise the error code (see write) of the first failed
+ *          file. The other files are still written.
+ */
+int uFileIO::writeBatch( std::vector<uFileIO *> const &_files,
+                         bool                          _overWrite,
+                         DURABILITY                    _durability ) {
+   int                      lResult = 1;
+   std::vector<std::string> lTemp( _files.size() );
+   std::set<std::string>    lDirs;
+
+   for ( size_t i = 0; i < _files.size(); ++i ) {
+      int lRet = _files[i]->checkWrite( _overWrite );
 
-      if ( !FILESYSTEM_NAMESPACE::remove( lFilePath_BFS ) ) {
-         eLOG( "Failed to remove '", vFilePath_str, "'" );
-         return 4;
+      if ( lRet == 1 )
+         lRet = writeTemp( _files[i]->vFilePath_str, _files[i]->vData, _durability, lTemp[i] );
+
+      if ( lRet != 1 ) {
+         lTemp[i].clear();
+         lResult = lResult == 1 ? lRet : lResult;
       }
    }
 
-   FILE *lFile = fopen( vFilePath_str.c_str(), "wb" );
-   if ( lFile == nullptr ) {
-      eLOG( "Unable to open '", vFilePath_str, "'" );
-      return 5;
-   }
+   for ( size_t i = 0; i < _files.size(); ++i ) {
+      if ( lTemp[i].empty() )
+         continue;
 
-   for ( char ch : _data )
-      fputc( ch, lFile );
+      int lRet = replaceFile( lTemp[i], _files[i]->vFilePath_str, _durability );
+      if ( lRet != 1 ) {
+         lResult = lResult == 1 ? lRet : lResult;
+         continue;
+      }
 
-   fclose( lFile );
+      lDirs.insert( parentDir( _files[i]->vFilePath_str ) );
+   }
 
-   return 1;
+   if ( _durability == SYNC_FULL )
+      for ( auto const &i : lDirs )
+         syncDir( i );
+
+   return lResult;
 }
 }
 // kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -33,11 +34,27 @@ class UTILS_API uFileIO final {
 
    typedef std::string TYPE;
 
+   typedef std::function<bool( char const *, size_t )> CHUNK_CALLBACK;
+
+   /*!
+    * \brief How hard write() tries to get the data onto the disk
+    *
+    * The file is always written to a temporary file and then renamed over the target, so the
+    * target never contains a partly written file.
+    */
+   enum DURABILITY {
+      SYNC_NONE = 0, //!< Only the atomic rename; survives a crash of the process
+      SYNC_DATA,     //!< fdatasync the data before the rename; the old or the new file survives
+      SYNC_FULL      //!< fsync the file and its directory; the new file is on disk on return
+   };
+
  private:
    std::string vFilePath_str;
    TYPE        vData;
    bool        vFileRead_B;
 
+   int checkWrite( bool _overWrite );
+
  public:
    uFileIO() : vFileRead_B( false ) {}
    uFileIO( std::string _file ) : vFilePath_str( _file ), vFileRead_B( false ) {}
@@ -53,12 +70,17 @@ class UTILS_API uFileIO final {
    bool isFileRead() { return vFileRead_B; }
 
    int read( bool _autoReload = true );
-   int write( TYPE const &_data, bool _overWrite = false );
+   int readChunks( CHUNK_CALLBACK _callback, size_t _chunkSize = 1024 * 1024 );
+   int write( TYPE const &_data, bool _overWrite = false, DURABILITY _durability = SYNC_DATA );
    void clear();
 
    TYPE *getData() { return &vData; }
 
    int operator()( bool _autoReload = true ) { return read( _autoReload ); }
+
+   static int writeBatch( std::vector<uFileIO *> const &_files,
+                          bool                          _overWrite  = false,
+                          DURABILITY                    _durability = SYNC_DATA );
 };
 }
 
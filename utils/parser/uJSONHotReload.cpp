@@ -0,0 +1,111 @@
+/*!
+ * \file uJSONHotReload.cpp
+ * \brief \b Classes: \a uJSONHotReload
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uJSONHotReload.hpp"
+#include "uLog.hpp"
+#include "uParserJSON.hpp"
+
+namespace e_engine {
+
+/*!
+ * \brief Loads the file and starts watching it
+ *
+ * \param[in] _watcher   The watcher to use (must outlive this object)
+ * \param[in] _file      The JSON file
+ * \param[in] _overWrite Passed to uJSON_data::merge; when false reloads only add new values
+ * \param[in] _cache     Optional hash cache; skips parsing when the content did not change
+ */
+uJSONHotReload::uJSONHotReload( uFileWatcher &_watcher,
+                                std::string   _file,
+                                bool          _overWrite,
+                                uHashCache *  _cache )
+    : vFilePath_str( _file ),
+      vOverWrite_B( _overWrite ),
+      vHashCache( _cache ),
+      vChangedSlot( &uJSONHotReload::fileChanged, this ) {
+   reload();
+
+   uFileWatcher::SIGNAL *lSignal = _watcher.watch( _file );
+   if ( lSignal )
+      lSignal->connect( &vChangedSlot );
+}
+
+/*!
+ * \brief Parses the file again and merges it into the stored data
+ *
+ * Sends the reload signal on success. With a hash cache nothing happens when the content is the
+ * same as on the last reload.
+ *
+ * \returns the return value of uParserJSON::parse (1 if everything went fine)
+ */
+int uJSONHotReload::reload() {
+   uHashCache::DIGEST lDigest;
+
+   if ( vHashCache && vHashCache->hashFile( vFilePath_str, lDigest ) == 1 ) {
+      std::lock_guard<std::mutex> lLock( vData_MUT );
+      if ( lDigest == vDigest ) {
+         dLOG( "'", vFilePath_str, "' did not change -- not reloading it" );
+         return 1;
+      }
+   }
+
+   uParserJSON lParser( vFilePath_str );
+
+   int lRet = lParser.parse();
+   if ( lRet != 1 ) {
+      wLOG( "Failed to reload '", vFilePath_str, "' -- keeping the old data" );
+      return lRet;
+   }
+
+   uJSON_data lData;
+
+   {
+      std::lock_guard<std::mutex> lLock( vData_MUT );
+
+      if ( vData.type == __JSON_NOT_SET__ )
+         vData = lParser.getData();
+      else
+         vData.merge( *lParser.getDataP(), vOverWrite_B );
+
+      vDigest = lDigest;
+      lData   = vData;
+   }
+
+   // Not under the lock, so the slots may call getData()
+   vReloadSignal( lData );
+   return 1;
+}
+
+/*!
+ * \brief Returns a copy of the current data
+ */
+uJSON_data uJSONHotReload::getData() {
+   std::lock_guard<std::mutex> lLock( vData_MUT );
+   return vData;
+}
+
+void uJSONHotReload::fileChanged( std::string _file ) {
+   iLOG( "Reloading '", _file, "'" );
+   reload();
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
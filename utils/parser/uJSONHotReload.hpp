@@ -0,0 +1,82 @@
+/*!
+ * \file uJSONHotReload.hpp
+ * \brief \b Classes: \a uJSONHotReload
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uFileWatcher.hpp"
+#include "uHashCache.hpp"
+#include "uParserJSON_data.hpp"
+#include "uSignalSlot.hpp"
+#include <mutex>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uJSONHotReload
+ * \brief Keeps a uJSON_data structure in sync with a JSON file
+ *
+ * The file is parsed with uParserJSON on construction and every time the uFileWatcher reports a
+ * change. The new content is merged (uJSON_data::merge) into the stored data and the reload signal
+ * is sent (from the watcher thread) with the merged data.
+ *
+ * With a uHashCache the file is only parsed again when its content changed (a touch or a rewrite
+ * with the same content does not send the signal). The cache must outlive this object.
+ *
+ * Connect a slot to the reload signal to apply the values, e.g. to GlobConf:
+ * \code
+ * uJSONHotReload lConf( lWatcher, "config.json" );
+ * lConf.getReloadSignal()->connect( &lApplyConfigSlot );
+ * \endcode
+ */
+class UTILS_API uJSONHotReload final {
+ public:
+   typedef uSignal<void, uJSON_data const &> SIGNAL;
+
+ private:
+   std::string        vFilePath_str;
+   uJSON_data         vData;
+   std::mutex         vData_MUT;
+   bool               vOverWrite_B;
+   uHashCache *       vHashCache;
+   uHashCache::DIGEST vDigest; //!< Digest of the last parsed content
+
+   SIGNAL                                   vReloadSignal;
+   uSlot<void, uJSONHotReload, std::string> vChangedSlot;
+
+   void fileChanged( std::string _file );
+
+ public:
+   uJSONHotReload( uFileWatcher &_watcher,
+                   std::string   _file,
+                   bool          _overWrite = true,
+                   uHashCache *  _cache     = nullptr );
+
+   uJSONHotReload() = delete;
+
+   int reload();
+
+   uJSON_data getData();
+   SIGNAL *   getReloadSignal() { return &vReloadSignal; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -157,6 +157,7 @@ void uJSON_data::merge( uJSON_data &_toMerge, bool _overWrite ) {
       type       = _toMerge.type;
       value_str  = _toMerge.value_str;
       value_num  = _toMerge.value_num;
+      value_int  = _toMerge.value_int;
       value_bool = _toMerge.value_bool;
       value_obj  = _toMerge.value_obj;
    }
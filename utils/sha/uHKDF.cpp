@@ -0,0 +1,90 @@
+/*!
+ * \file uHKDF.cpp
+ * \brief \b Classes: \a uHKDF
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uHKDF.hpp"
+#include "uLog.hpp"
+
+namespace e_engine {
+
+/*!
+ * \brief HKDF-Extract: PRK = HMAC( salt, IKM )
+ *
+ * An empty salt is a string of hash length zeros (the HMAC key padding gives the same result).
+ */
+void uHKDF::extract( DIGEST const &_ikm, DIGEST const &_salt ) {
+   uHMAC lExtract( getType(), _salt );
+   setPRK( lExtract.mac( _ikm ) );
+}
+
+/*!
+ * \brief Uses an existing pseudo random key (skips extract)
+ */
+void uHKDF::setPRK( DIGEST const &_prk ) {
+   vPRK = _prk;
+   vPRK_HMAC.setKey( vPRK.data(), vPRK.size() );
+}
+
+/*!
+ * \brief HKDF-Expand: derives _length bytes of key material for the context _info
+ *
+ * \returns the output key material or an empty vector if _length is larger than 255 times the
+ *          hash length
+ */
+uHKDF::DIGEST uHKDF::expand( DIGEST const &_info, size_t _length ) {
+   size_t lHashLength = vPRK_HMAC.getHashLength();
+
+   if ( _length > 255 * lHashLength ) {
+      eLOG( "HKDF: can not derive more than ", 255 * lHashLength, " bytes" );
+      return DIGEST();
+   }
+
+   DIGEST lResult;
+   DIGEST lT;
+   lResult.reserve( _length + lHashLength );
+
+   // T(i) = HMAC( PRK, T(i - 1) | info | i )
+   for ( unsigned char i = 1; lResult.size() < _length; ++i ) {
+      vPRK_HMAC.add( lT );
+      vPRK_HMAC.add( _info );
+      vPRK_HMAC.add( &i, 1 );
+      lT = vPRK_HMAC.end();
+      lResult.insert( lResult.end(), lT.begin(), lT.end() );
+   }
+
+   lResult.resize( _length );
+   return lResult;
+}
+
+/*!
+ * \brief Extract and expand in one call
+ */
+uHKDF::DIGEST uHKDF::derive( HASH_FUNCTION _type,
+                             DIGEST const &_ikm,
+                             DIGEST const &_salt,
+                             DIGEST const &_info,
+                             size_t        _length ) {
+   uHKDF lKDF( _type );
+   lKDF.extract( _ikm, _salt );
+   return lKDF.expand( _info, _length );
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
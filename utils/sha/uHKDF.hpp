@@ -0,0 +1,73 @@
+/*!
+ * \file uHKDF.hpp
+ * \brief \b Classes: \a uHKDF
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uHMAC.hpp"
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uHKDF
+ * \brief HMAC based key derivation (HKDF, RFC 5869)
+ *
+ * extract() condenses the input key material into the pseudo random key (PRK). The HMAC state of
+ * the PRK is kept, so deriving several keys with expand() does not hash the PRK again.
+ *
+ * \code
+ * uHKDF lKDF( SHA2_256 );
+ * lKDF.extract( lSharedSecret, lSalt );
+ * std::vector<unsigned char> lEncKey = lKDF.expand( "save game encryption", 32 );
+ * std::vector<unsigned char> lMacKey = lKDF.expand( "save game mac", 32 );
+ * \endcode
+ */
+class UTILS_API uHKDF final {
+ public:
+   typedef std::vector<unsigned char> DIGEST;
+
+ private:
+   uHMAC  vPRK_HMAC; //!< HMAC keyed with the PRK
+   DIGEST vPRK;
+
+ public:
+   uHKDF( HASH_FUNCTION _type ) : vPRK_HMAC( _type, nullptr, 0 ) {}
+
+   void extract( DIGEST const &_ikm, DIGEST const &_salt = DIGEST() );
+   void setPRK( DIGEST const &_prk );
+
+   DIGEST expand( DIGEST const &_info, size_t _length );
+   DIGEST expand( std::string const &_info, size_t _length ) {
+      return expand( DIGEST( _info.begin(), _info.end() ), _length );
+   }
+
+   DIGEST const &getPRK() const { return vPRK; }
+   HASH_FUNCTION getType() const { return vPRK_HMAC.getType(); }
+
+   static DIGEST derive( HASH_FUNCTION _type,
+                         DIGEST const &_ikm,
+                         DIGEST const &_salt,
+                         DIGEST const &_info,
+                         size_t        _length );
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,128 @@
+/*!
+ * \file uHMAC.cpp
+ * \brief \b Classes: \a uHMAC
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uHMAC.hpp"
+#include <algorithm>
+#include <array>
+
+namespace e_engine {
+
+namespace {
+
+//! Overwrites key material (the volatile access keeps the compiler from removing it)
+void wipe( unsigned char *_data, size_t _size ) {
+   volatile unsigned char *lData = _data;
+   for ( size_t i = 0; i < _size; ++i )
+      lData[i] = 0;
+}
+}
+
+uHMAC::uHMAC( HASH_FUNCTION _type, void const *_key, size_t _keySize )
+    : vType( _type ), vInner( _type ), vOuter( _type ), vMessage( _type ) {
+   setKey( _key, _keySize );
+}
+
+/*!
+ * \brief Sets a new key and aborts the message in progress
+ *
+ * Keys longer than the block size are hashed first (RFC 2104).
+ */
+void uHMAC::setKey( void const *_key, size_t _keySize ) {
+   size_t lBlockSize = ( vType == SHA2_224 || vType == SHA2_256 ) ? 64 : 128;
+
+   std::array<unsigned char, 128> lKey;
+   std::array<unsigned char, 128> lPad;
+   lKey.fill( 0 );
+
+   if ( _keySize > lBlockSize ) {
+      DIGEST lHashed = vInner.quickHash( vType, _key, _keySize );
+      std::copy( lHashed.begin(), lHashed.end(), lKey.begin() );
+      wipe( lHashed.data(), lHashed.size() );
+   } else if ( _keySize > 0 ) {
+      unsigned char const *lData = static_cast<unsigned char const *>( _key );
+      std::copy( lData, lData + _keySize, lKey.begin() );
+   }
+
+   for ( size_t i = 0; i < lBlockSize; ++i )
+      lPad[i] = lKey[i] ^ 0x36;
+
+   vInner.reset( vType );
+   vInner.add( lPad.data(), lBlockSize );
+
+   for ( size_t i = 0; i < lBlockSize; ++i )
+      lPad[i] = lKey[i] ^ 0x5c;
+
+   vOuter.reset( vType );
+   vOuter.add( lPad.data(), lBlockSize );
+
+   wipe( lKey.data(), lKey.size() );
+   wipe( lPad.data(), lPad.size() );
+
+   vMessage = vInner;
+}
+
+/*!
+ * \brief Returns the MAC of the message added so far and starts a new message
+ */
+uHMAC::DIGEST uHMAC::end() {
+   DIGEST lInner = vMessage.end();
+
+   uSHA_2 lOuter( vOuter );
+   lOuter.add( lInner );
+
+   vMessage = vInner;
+   return lOuter.end();
+}
+
+/*!
+ * \brief Calculates the MAC of one message
+ *
+ * A message in progress (add) is discarded.
+ */
+uHMAC::DIGEST uHMAC::mac( void const *_data, size_t _size ) {
+   vMessage = vInner;
+   vMessage.add( _data, _size );
+   return end();
+}
+
+/*!
+ * \brief Checks the MAC of a message (in constant time)
+ */
+bool uHMAC::verify( void const *_data, size_t _size, DIGEST const &_mac ) {
+   return equal( mac( _data, _size ), _mac );
+}
+
+/*!
+ * \brief Compares two digests; the time only depends on the size, not on the content
+ */
+bool uHMAC::equal( DIGEST const &_lhs, DIGEST const &_rhs ) {
+   if ( _lhs.size() != _rhs.size() )
+      return false;
+
+   unsigned char lDiff = 0;
+   for ( size_t i = 0; i < _lhs.size(); ++i )
+      lDiff |= _lhs[i] ^ _rhs[i];
+
+   return lDiff == 0;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
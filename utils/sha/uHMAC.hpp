@@ -0,0 +1,81 @@
+/*!
+ * \file uHMAC.hpp
+ * \brief \b Classes: \a uHMAC
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uSHA_2.hpp"
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uHMAC
+ * \brief HMAC (RFC 2104) with the SHA-2 functions of uSHA_2
+ *
+ * The key blocks (key XOR ipad and key XOR opad) are hashed once in setKey(); every message then
+ * starts from a copy of these states. A short message costs 2 blocks instead of 4.
+ *
+ * \code
+ * uHMAC lMac( SHA2_256, lKey );
+ * lMac.add( lHeader );
+ * lMac.add( lPayload.data(), lPayload.size() );
+ * std::vector<unsigned char> lTag = lMac.end(); // ready for the next message
+ * \endcode
+ */
+class UTILS_API uHMAC final {
+ public:
+   typedef std::vector<unsigned char> DIGEST;
+
+ private:
+   HASH_FUNCTION vType;
+
+   uSHA_2 vInner;   //!< State after the block key XOR ipad
+   uSHA_2 vOuter;   //!< State after the block key XOR opad
+   uSHA_2 vMessage; //!< The message in progress
+
+ public:
+   uHMAC( HASH_FUNCTION _type, void const *_key, size_t _keySize );
+   uHMAC( HASH_FUNCTION _type, DIGEST const &_key ) : uHMAC( _type, _key.data(), _key.size() ) {}
+   uHMAC( HASH_FUNCTION _type, std::string const &_key )
+       : uHMAC( _type, _key.data(), _key.size() ) {}
+
+   void setKey( void const *_key, size_t _keySize );
+
+   bool add( void const *_data, size_t _size ) { return vMessage.add( _data, _size ); }
+   bool add( std::string const &_message ) { return vMessage.add( _message ); }
+   bool add( DIGEST const &_binary ) { return vMessage.add( _binary ); }
+
+   DIGEST end();
+
+   DIGEST mac( void const *_data, size_t _size );
+   DIGEST mac( std::string const &_message ) { return mac( _message.data(), _message.size() ); }
+   DIGEST mac( DIGEST const &_binary ) { return mac( _binary.data(), _binary.size() ); }
+
+   bool verify( void const *_data, size_t _size, DIGEST const &_mac );
+
+   HASH_FUNCTION getType() const { return vType; }
+   unsigned      getHashLength() { return vInner.getHashLength(); }
+
+   static bool equal( DIGEST const &_lhs, DIGEST const &_rhs );
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
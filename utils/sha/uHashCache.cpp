@@ -0,0 +1,475 @@
+/*!
+ * \file uHashCache.cpp
+ * \brief \b Classes: \a uHashCache
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uHashCache.hpp"
+#include "uFileIO.hpp"
+#include "uLog.hpp"
+#include <chrono>
+#include <cstring>
+#include FILESYSTEM_INCLUDE
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace e_engine {
+
+struct uHashCache::Header {
+   uint64_t magic;
+   uint32_t version;
+   uint32_t entrySize;
+   uint64_t capacity; //!< Number of slots (power of 2)
+   uint64_t count;    //!< Number of used slots
+   uint64_t reserved[4];
+};
+
+struct uHashCache::Entry {
+   uint64_t      check; //!< entryCheck() of the slot; written last
+   uint64_t      key;   //!< pathKey() of the file (0: empty slot)
+   uint64_t      device;
+   uint64_t      inode;
+   uint64_t      size;
+   int64_t       mtime;
+   uint32_t      type;
+   uint32_t      length;
+   unsigned char digest[64];
+   uint64_t      reserved;
+};
+
+namespace {
+
+const uint64_t CACHE_MAGIC    = 0x45484341434845ULL;
+const uint32_t CACHE_VERSION  = 1;
+const uint64_t MIN_CAPACITY   = 1024;
+const int64_t  RACY_WINDOW_NS = 2000000000LL;
+const uint64_t STREAM_SIZE    = 1024 * 1024; //!< Files larger than this are hashed in chunks
+
+uint64_t fnv1a( void const *_data, size_t _size, uint64_t _hash = 0xcbf29ce484222325ULL ) {
+   unsigned char const *lData = static_cast<unsigned char const *>( _data );
+   for ( size_t i = 0; i < _size; ++i ) {
+      _hash ^= lData[i];
+      _hash *= 0x100000001b3ULL;
+   }
+
+   return _hash;
+}
+
+int64_t nowNS() {
+#if UNIX
+   auto lNow = std::chrono::system_clock::now().time_since_epoch();
+#else
+   auto lNow = FILESYSTEM_NAMESPACE::file_time_type::clock::now().time_since_epoch();
+#endif
+   return std::chrono::duration_cast<std::chrono::nanoseconds>( lNow ).count();
+}
+}
+
+
+/*!
+ * \param[in] _cacheFile The cache file (created if needed); empty for a cache in memory
+ * \param[in] _type      The hash function of the stored digests
+ */
+uHashCache::uHashCache( std::string _cacheFile, HASH_FUNCTION _type )
+    : vCacheFile_str( _cacheFile ), vType( _type ), vHits( 0 ), vMisses( 0 ) {
+   static_assert( sizeof( Header ) == 64, "Unexpected cache header size" );
+   static_assert( sizeof( Entry ) == 128, "Unexpected cache slot size" );
+
+   openTable();
+}
+
+uHashCache::~uHashCache() {
+   sync();
+   unmapTable();
+}
+
+
+/*!
+ * \brief Returns the digest of a file, reading and hashing it only if it is not cached
+ *
+ * Files up to one chunk are read at once (uFileIO::read), larger files are streamed with
+ * uFileIO::readChunks.
+ *
+ * \returns the return values of uFileIO::read / readChunks (1 if everything went fine)
+ */
+int uHashCache::hashFile( std::string _file, DIGEST &_digest ) {
+   FileInfo lBefore;
+   int      lRet = getFileInfo( _file, lBefore );
+   if ( lRet != 1 )
+      return lRet;
+
+   if ( lookup( _file, lBefore, _digest ) )
+      return 1;
+
+   uSHA_2  lHasher( vType );
+   uFileIO lFile( _file );
+
+   if ( lBefore.size <= STREAM_SIZE ) {
+      lRet = lFile.read();
+      if ( lRet == 1 )
+         lHasher.add( lFile.getData()->data(), lFile.getData()->size() );
+   } else {
+      lRet = lFile.readChunks(
+            [&]( char const *_data, size_t _size ) {
+               lHasher.add( _data, _size );
+               return true;
+            },
+            STREAM_SIZE );
+   }
+
+   if ( lRet != 1 )
+      return lRet;
+
+   _digest = lHasher.end();
+
+   // Only store the digest if the file did not change while reading it
+   FileInfo lAfter;
+   if ( getFileInfo( _file, lAfter ) == 1 && lAfter == lBefore )
+      insert( _file, lAfter, _digest );
+
+   return 1;
+}
+
+/*!
+ * \brief Looks up the digest of a file
+ *
+ * \param[in]  _file   The file
+ * \param[in]  _info   The current state of the file (see getFileInfo)
+ * \param[out] _digest The digest (only changed on a hit)
+ *
+ * \returns true if the file is cached and did not change
+ */
+bool uHashCache::lookup( std::string const &_file, FileInfo const &_info, DIGEST &_digest ) {
+   uint64_t                    lKey = pathKey( _file );
+   std::lock_guard<std::mutex> lLock( vTable_MUT );
+
+   Entry *lEntry = find( lKey );
+   if ( lEntry->key != lKey || lEntry->check != entryCheck( lEntry ) ||
+        lEntry->type != static_cast<uint32_t>( vType ) || lEntry->length > 64 ||
+        lEntry->device != _info.device || lEntry->inode != _info.inode ||
+        lEntry->size != _info.size || lEntry->mtime != _info.mtime ) {
+      ++vMisses;
+      return false;
+   }
+
+   _digest.assign( lEntry->digest, lEntry->digest + lEntry->length );
+   ++vHits;
+   return true;
+}
+
+/*!
+ * \brief Stores the digest of a file
+ *
+ * Nothing is stored when the file was modified less than 2 seconds ago (see the class
+ * description).
+ *
+ * \param[in] _file   The file
+ * \param[in] _info   The state of the file the digest was calculated from
+ * \param[in] _digest The digest
+ */
+void uHashCache::insert( std::string const &_file, FileInfo const &_info, DIGEST const &_digest ) {
+   if ( _digest.size() > 64 || _info.mtime > nowNS() - RACY_WINDOW_NS )
+      return;
+
+   uint64_t                    lKey = pathKey( _file );
+   std::lock_guard<std::mutex> lLock( vTable_MUT );
+
+   Entry *lEntry = find( lKey );
+
+   if ( lEntry->key == 0 ) {
+      if ( ( header()->count + 1 ) * 2 > header()->capacity ) {
+         rebuildTable( header()->capacity * 2 );
+         lEntry = find( lKey );
+      }
+
+      header()->count++;
+   }
+
+   storeEntry( lEntry, lKey, _info, _digest );
+}
+
+/*!
+ * \brief Writes the changes to the disk
+ */
+void uHashCache::sync() {
+   std::lock_guard<std::mutex> lLock( vTable_MUT );
+
+#if UNIX
+   if ( vMapped_B ) {
+      msync( vTable, vTableSize, MS_SYNC );
+      return;
+   }
+#endif
+
+   if ( !vDirty_B || vCacheFile_str.empty() )
+      return;
+
+   uFileIO lFile( vCacheFile_str );
+   if ( lFile.write( uFileIO::TYPE( vLocal.begin(), vLocal.end() ), true ) != 1 )
+      wLOG( "Failed to write the hash cache '", vCacheFile_str, "'" );
+
+   vDirty_B = false;
+}
+
+/*!
+ * \brief Removes all entries
+ */
+void uHashCache::clear() {
+   std::lock_guard<std::mutex> lLock( vTable_MUT );
+   header()->count = 0; // Nothing to copy into the new table
+   rebuildTable( MIN_CAPACITY );
+}
+
+size_t uHashCache::getNumEntries() {
+   std::lock_guard<std::mutex> lLock( vTable_MUT );
+   return static_cast<size_t>( header()->count );
+}
+
+/*!
+ * \brief Reads the device, inode, size and modification time of a file
+ *
+ * \returns 1 if everything went fine
+ * \returns 3 if the file doesn't exists
+ * \returns 4 if the file is not a regular file
+ */
+int uHashCache::getFileInfo( std::string const &_file, FileInfo &_info ) {
+#if UNIX
+   struct stat lStat;
+   if ( stat( _file.c_str(), &lStat ) != 0 )
+      return 3;
+
+   if ( !S_ISREG( lStat.st_mode ) )
+      return 4;
+
+   _info.device = static_cast<uint64_t>( lStat.st_dev );
+   _info.inode  = static_cast<uint64_t>( lStat.st_ino );
+   _info.size   = static_cast<uint64_t>( lStat.st_size );
+#if defined( __APPLE__ )
+   _info.mtime = lStat.st_mtimespec.tv_sec * 1000000000LL + lStat.st_mtimespec.tv_nsec;
+#else
+   _info.mtime = lStat.st_mtim.tv_sec * 1000000000LL + lStat.st_mtim.tv_nsec;
+#endif
+#else
+   FILESYSTEM_NAMESPACE::path lPath( _file.c_str() );
+   std::error_code            lError;
+
+   if ( !FILESYSTEM_NAMESPACE::exists( lPath, lError ) )
+      return 3;
+
+   if ( !FILESYSTEM_NAMESPACE::is_regular_file( lPath, lError ) )
+      return 4;
+
+   auto lTime   = FILESYSTEM_NAMESPACE::last_write_time( lPath, lError ).time_since_epoch();
+   _info.device = 0;
+   _info.inode  = 0;
+   _info.size   = static_cast<uint64_t>( FILESYSTEM_NAMESPACE::file_size( lPath, lError ) );
+   _info.mtime  = std::chrono::duration_cast<std::chrono::nanoseconds>( lTime ).count();
+#endif
+
+   return 1;
+}
+
+
+uHashCache::Entry *uHashCache::entries() {
+   return reinterpret_cast<Entry *>( vTable + sizeof( Header ) );
+}
+
+/*!
+ * \brief Returns the slot of _key or the empty slot where it would be inserted
+ */
+uHashCache::Entry *uHashCache::find( uint64_t _key ) {
+   uint64_t lMask  = header()->capacity - 1;
+   Entry *  lSlots = entries();
+
+   for ( uint64_t i = _key & lMask;; i = ( i + 1 ) & lMask )
+      if ( lSlots[i].key == _key || lSlots[i].key == 0 )
+         return &lSlots[i];
+}
+
+void uHashCache::storeEntry( Entry *         _entry,
+                             uint64_t        _key,
+                             FileInfo const &_info,
+                             DIGEST const &  _digest ) {
+   // Invalidate the slot first, so that a half written slot never has a valid checksum
+   _entry->check = 0;
+   std::atomic_thread_fence( std::memory_order_release );
+
+   _entry->key    = _key;
+   _entry->device = _info.device;
+   _entry->inode  = _info.inode;
+   _entry->size   = _info.size;
+   _entry->mtime  = _info.mtime;
+   _entry->type   = static_cast<uint32_t>( vType );
+   _entry->length = static_cast<uint32_t>( _digest.size() );
+   std::memset( _entry->digest, 0, sizeof( _entry->digest ) );
+   std::memcpy( _entry->digest, _digest.data(), _digest.size() );
+
+   std::atomic_thread_fence( std::memory_order_release );
+   _entry->check = entryCheck( _entry );
+   vDirty_B      = true;
+}
+
+uint64_t uHashCache::pathKey( std::string const &_file ) {
+   std::string lPath = FILESYSTEM_NAMESPACE::absolute( _file.c_str() ).string();
+   uint64_t    lKey  = fnv1a( lPath.data(), lPath.size() );
+   return lKey == 0 ? 1 : lKey;
+}
+
+uint64_t uHashCache::entryCheck( Entry const *_entry ) {
+   unsigned char const *lData = reinterpret_cast<unsigned char const *>( _entry );
+   return fnv1a( lData + sizeof( uint64_t ), sizeof( Entry ) - sizeof( uint64_t ) ) | 1;
+}
+
+
+/*!
+ * \brief Maps (or reads) the cache file and creates a new table if it is missing or invalid
+ */
+void uHashCache::openTable() {
+   if ( !vCacheFile_str.empty() ) {
+#if UNIX
+      if ( mapTable() )
+         return;
+#else
+      uFileIO lFile( vCacheFile_str );
+      if ( lFile.read() == 1 ) {
+         vLocal.assign( lFile.begin(), lFile.end() );
+         vTable     = vLocal.data();
+         vTableSize = vLocal.size();
+
+         Header *lHeader = header();
+         if ( vTableSize >= sizeof( Header ) && lHeader->magic == CACHE_MAGIC &&
+              lHeader->version == CACHE_VERSION && lHeader->entrySize == sizeof( Entry ) &&
+              vTableSize == sizeof( Header ) + lHeader->capacity * sizeof( Entry ) )
+            return;
+      }
+#endif
+
+      if ( FILESYSTEM_NAMESPACE::exists( vCacheFile_str.c_str() ) )
+         wLOG( "Replacing the invalid hash cache '", vCacheFile_str, "'" );
+   }
+
+   vTable     = nullptr;
+   vTableSize = 0;
+   rebuildTable( MIN_CAPACITY );
+}
+
+/*!
+ * \brief Maps the cache file into memory (UNIX only)
+ * \returns false if the file does not exist or is not a valid cache file
+ */
+bool uHashCache::mapTable() {
+#if UNIX
+   int lFD = open( vCacheFile_str.c_str(), O_RDWR | O_CLOEXEC );
+   if ( lFD < 0 )
+      return false;
+
+   struct stat lStat;
+   if ( fstat( lFD, &lStat ) != 0 || static_cast<size_t>( lStat.st_size ) < sizeof( Header ) ) {
+      close( lFD );
+      return false;
+   }
+
+   size_t lSize = static_cast<size_t>( lStat.st_size );
+   void * lMap  = mmap( nullptr, lSize, PROT_READ | PROT_WRITE, MAP_SHARED, lFD, 0 );
+   close( lFD );
+
+   if ( lMap == MAP_FAILED )
+      return false;
+
+   Header *lHeader = static_cast<Header *>( lMap );
+   if ( lHeader->magic != CACHE_MAGIC || lHeader->version != CACHE_VERSION ||
+        lHeader->entrySize != sizeof( Entry ) || lHeader->capacity < MIN_CAPACITY ||
+        ( lHeader->capacity & ( lHeader->capacity - 1 ) ) != 0 ||
+        lSize != sizeof( Header ) + lHeader->capacity * sizeof( Entry ) ) {
+      munmap( lMap, lSize );
+      return false;
+   }
+
+   vTable     = static_cast<unsigned char *>( lMap );
+   vTableSize = lSize;
+   vMapped_B  = true;
+   return true;
+#else
+   return false;
+#endif
+}
+
+void uHashCache::unmapTable() {
+#if UNIX
+   if ( vMapped_B )
+      munmap( vTable, vTableSize );
+#endif
+
+   vTable    = nullptr;
+   vMapped_B = false;
+}
+
+/*!
+ * \brief Creates a new table with all valid entries of the current one
+ *
+ * The new table replaces the cache file atomically and is mapped again.
+ */
+void uHashCache::rebuildTable( uint64_t _capacity ) {
+   std::vector<unsigned char> lNew( sizeof( Header ) + _capacity * sizeof( Entry ), 0 );
+   Header *                   lHeader = reinterpret_cast<Header *>( lNew.data() );
+   Entry *                    lSlots  = reinterpret_cast<Entry *>( lNew.data() + sizeof( Header ) );
+
+   lHeader->magic     = CACHE_MAGIC;
+   lHeader->version   = CACHE_VERSION;
+   lHeader->entrySize = sizeof( Entry );
+   lHeader->capacity  = _capacity;
+
+   if ( vTable != nullptr && header()->count > 0 ) {
+      Entry *lOld = entries();
+
+      for ( uint64_t i = 0; i < header()->capacity; ++i ) {
+         if ( lOld[i].key == 0 || lOld[i].check != entryCheck( &lOld[i] ) )
+            continue;
+
+         uint64_t j = lOld[i].key & ( _capacity - 1 );
+         while ( lSlots[j].key != 0 )
+            j = ( j + 1 ) & ( _capacity - 1 );
+
+         lSlots[j] = lOld[i];
+         lHeader->count++;
+      }
+   }
+
+   unmapTable();
+
+   if ( !vCacheFile_str.empty() ) {
+      uFileIO lFile( vCacheFile_str );
+      if ( lFile.write( uFileIO::TYPE( lNew.begin(), lNew.end() ), true, uFileIO::SYNC_NONE ) != 1 )
+         wLOG( "Failed to write the hash cache '", vCacheFile_str, "'" );
+      else if ( mapTable() )
+         return;
+   }
+
+   vLocal.swap( lNew );
+   vTable     = vLocal.data();
+   vTableSize = vLocal.size();
+   vDirty_B   = false;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,124 @@
+/*!
+ * \file uHashCache.hpp
+ * \brief \b Classes: \a uHashCache
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uSHA_2.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uHashCache
+ * \brief Persistent cache of the SHA-2 hashes of files
+ *
+ * Maps a file (absolute path, device, inode, size and modification time) to the uSHA_2 digest of
+ * its content. As long as none of these change, hashFile() returns the stored digest without
+ * reading the file.
+ *
+ * The cache file is a fixed size open addressing hash table (one 128 byte slot per path) that is
+ * mapped into memory on UNIX and read / written as a whole on other platforms. Every slot carries
+ * a checksum that is written last, so a slot that was only partly written (crash, concurrent
+ * writer) is treated as a miss. The table is rebuilt with twice the size (and atomically renamed
+ * over the old file, see uFileIO::write) when it is half full. A cache file that does not match
+ * the expected format is silently replaced.
+ *
+ * Files modified less than 2 seconds before they are hashed are not stored: a change within the
+ * timestamp resolution of the file system would not be noticed otherwise.
+ *
+ * Without a cache file the table only lives in memory.
+ */
+class UTILS_API uHashCache final {
+ public:
+   typedef std::vector<unsigned char> DIGEST;
+
+   struct FileInfo {
+      uint64_t device = 0;
+      uint64_t inode  = 0;
+      uint64_t size   = 0;
+      int64_t  mtime  = 0; //!< Modification time in ns
+
+      bool operator==( FileInfo const &_rhs ) const {
+         return device == _rhs.device && inode == _rhs.inode && size == _rhs.size &&
+                mtime == _rhs.mtime;
+      }
+   };
+
+ private:
+   struct Header;
+   struct Entry;
+
+   std::string   vCacheFile_str;
+   HASH_FUNCTION vType;
+
+   unsigned char *            vTable     = nullptr; //!< Header followed by the slots
+   size_t                     vTableSize = 0;
+   bool                       vMapped_B  = false;
+   bool                       vDirty_B   = false; //!< vLocal has unsaved changes
+   std::vector<unsigned char> vLocal;              //!< The table when it is not mapped
+
+   std::atomic<uint64_t> vHits;
+   std::atomic<uint64_t> vMisses;
+   std::mutex            vTable_MUT;
+
+   Header *header() { return reinterpret_cast<Header *>( vTable ); }
+   Entry * entries();
+   Entry * find( uint64_t _key );
+
+   void openTable();
+   bool mapTable();
+   void unmapTable();
+   void rebuildTable( uint64_t _capacity );
+   void storeEntry( Entry *_entry, uint64_t _key, FileInfo const &_info, DIGEST const &_digest );
+
+   static uint64_t pathKey( std::string const &_file );
+   static uint64_t entryCheck( Entry const *_entry );
+
+ public:
+   uHashCache( std::string _cacheFile = "", HASH_FUNCTION _type = SHA2_256 );
+   ~uHashCache();
+
+   uHashCache( uHashCache const & ) = delete;
+   uHashCache &operator=( uHashCache const & ) = delete;
+
+   int hashFile( std::string _file, DIGEST &_digest );
+
+   bool lookup( std::string const &_file, FileInfo const &_info, DIGEST &_digest );
+   void insert( std::string const &_file, FileInfo const &_info, DIGEST const &_digest );
+
+   void sync();
+   void clear();
+
+   static int getFileInfo( std::string const &_file, FileInfo &_info );
+
+   size_t        getNumEntries();
+   uint64_t      getHits() const { return vHits; }
+   uint64_t      getMisses() const { return vMisses; }
+   HASH_FUNCTION getType() const { return vType; }
+   bool          isMapped() const { return vMapped_B; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -19,6 +19,8 @@
  */
 
 #include "uSHA_2.hpp"
+#include <algorithm>
+#include <cstring>
 #include <stdio.h>
 
 namespace e_engine {
@@ -50,91 +52,139 @@ uSHA_2::uSHA_2( HASH_FUNCTION _type ) {
    init();
 }
 
-
 /*!
- * \brief Fills the data in a buffer and calculates the hash when it's full
+ * \brief Copies the complete state, including data of an unfinished block
  *
- * \param _message What should be hashed
- * \returns false if the hash is already calculated or true if all went fine
+ * Used to continue several hashes from one common prefix (e.g. the HMAC key blocks).
  */
-bool uSHA_2::add( std::string const &_message ) {
-   if ( vEnded_B )
-      return false;
+uSHA_2::uSHA_2( uSHA_2 const &_rhs ) { *this = _rhs; }
 
-   if ( vType == SHA2_224 || vType == SHA2_256 ) {
-      for ( char const &c : _message ) {
+uSHA_2 &uSHA_2::operator=( uSHA_2 const &_rhs ) {
+   if ( this == &_rhs )
+      return *this;
 
-         if ( vCurrentPos512_A_IT == vBuffer512_A_uC.end() ) {
-            block( vBuffer512_A_uC );
-            vCurrentPos512_A_IT = vBuffer512_A_uC.begin();
-         }
+   vType             = _rhs.vType;
+   vBlockCounter_ulI = _rhs.vBlockCounter_ulI;
+   vBlockSize_uI     = _rhs.vBlockSize_uI;
+   vEnded_B          = _rhs.vEnded_B;
+   vResult_str       = _rhs.vResult_str;
 
-         *vCurrentPos512_A_IT = static_cast<uint8_t>( c );
-         ++vCurrentPos512_A_IT;
-      }
-   } else {
-      for ( char const &c : _message ) {
+   std::memcpy( h_512, _rhs.h_512, sizeof( h_512 ) );
+   std::memcpy( h_1024, _rhs.h_1024, sizeof( h_1024 ) );
 
-         if ( vCurrentPos1024_A_IT == vBuffer1024_A_uC.end() ) {
-            block( vBuffer1024_A_uC );
-            vCurrentPos1024_A_IT = vBuffer1024_A_uC.begin();
-         }
+   // The iterators point into the buffers of _rhs; only the filled part has to be copied
+   auto lFill512  = _rhs.vCurrentPos512_A_IT - _rhs.vBuffer512_A_uC.begin();
+   auto lFill1024 = _rhs.vCurrentPos1024_A_IT - _rhs.vBuffer1024_A_uC.begin();
 
-         *vCurrentPos1024_A_IT = static_cast<uint8_t>( c );
-         ++vCurrentPos1024_A_IT;
-      }
-   }
+   auto lBuf512  = _rhs.vBuffer512_A_uC.begin();
+   auto lBuf1024 = _rhs.vBuffer1024_A_uC.begin();
+   std::copy( lBuf512, lBuf512 + lFill512, vBuffer512_A_uC.begin() );
+   std::copy( lBuf1024, lBuf1024 + lFill1024, vBuffer1024_A_uC.begin() );
 
-   return true;
+   vCurrentPos512_A_IT  = vBuffer512_A_uC.begin() + lFill512;
+   vCurrentPos1024_A_IT = vBuffer1024_A_uC.begin() + lFill1024;
+   return *this;
 }
 
+
 /*!
- * \brief Fills the data in a buffer and calculates the hash when it's full
+ * \brief Hashes the data
  *
- * \param _binary What should be hashed
+ * Whole blocks are hashed directly from _data. Only a partial block at the end is copied into
+ * the internal buffer (and completed with the next call of add or end).
+ *
+ * \param _data What should be hashed
+ * \param _size The size of _data in bytes
  * \returns false if the hash is already calculated or true if all went fine
  */
-bool uSHA_2::add( std::vector<unsigned char> const &_binary ) {
+bool uSHA_2::add( void const *_data, size_t _size ) {
    if ( vEnded_B )
       return false;
 
+   unsigned char const *lData = static_cast<unsigned char const *>( _data );
+
    if ( vType == SHA2_224 || vType == SHA2_256 ) {
-      for ( unsigned char const &c : _binary ) {
+      size_t lFill = static_cast<size_t>( vCurrentPos512_A_IT - vBuffer512_A_uC.begin() );
 
-         if ( vCurrentPos512_A_IT == vBuffer512_A_uC.end() ) {
-            block( vBuffer512_A_uC );
-            vCurrentPos512_A_IT = vBuffer512_A_uC.begin();
-         }
+      // Complete the buffered block first
+      if ( lFill > 0 ) {
+         size_t lCopy = std::min( _size, vBuffer512_A_uC.size() - lFill );
+         std::memcpy( vBuffer512_A_uC.data() + lFill, lData, lCopy );
+         vCurrentPos512_A_IT += lCopy;
+         lData += lCopy;
+         _size -= lCopy;
+
+         if ( vCurrentPos512_A_IT != vBuffer512_A_uC.end() )
+            return true;
 
-         *vCurrentPos512_A_IT = c;
-         ++vCurrentPos512_A_IT;
+         block512( vBuffer512_A_uC.data() );
+         vCurrentPos512_A_IT = vBuffer512_A_uC.begin();
       }
+
+      size_t lBlocks = _size / 64;
+      block512( lData, lBlocks );
+      lData += lBlocks * 64;
+      _size -= lBlocks * 64;
+
+      std::memcpy( vBuffer512_A_uC.data(), lData, _size );
+      vCurrentPos512_A_IT = vBuffer512_A_uC.begin() + _size;
    } else {
-      for ( unsigned char const &c : _binary ) {
+      size_t lFill = static_cast<size_t>( vCurrentPos1024_A_IT - vBuffer1024_A_uC.begin() );
 
-         if ( vCurrentPos1024_A_IT == vBuffer1024_A_uC.end() ) {
-            block( vBuffer1024_A_uC );
-            vCurrentPos1024_A_IT = vBuffer1024_A_uC.begin();
-         }
+      // Complete the buffered block first
+      if ( lFill > 0 ) {
+         size_t lCopy = std::min( _size, vBuffer1024_A_uC.size() - lFill );
+         std::memcpy( vBuffer1024_A_uC.data() + lFill, lData, lCopy );
+         vCurrentPos1024_A_IT += lCopy;
+         lData += lCopy;
+         _size -= lCopy;
 
-         *vCurrentPos1024_A_IT = c;
-         ++vCurrentPos1024_A_IT;
+         if ( vCurrentPos1024_A_IT != vBuffer1024_A_uC.end() )
+            return true;
+
+         block1024( vBuffer1024_A_uC.data() );
+         vCurrentPos1024_A_IT = vBuffer1024_A_uC.begin();
       }
+
+      size_t lBlocks = _size / 128;
+      block1024( lData, lBlocks );
+      lData += lBlocks * 128;
+      _size -= lBlocks * 128;
+
+      std::memcpy( vBuffer1024_A_uC.data(), lData, _size );
+      vCurrentPos1024_A_IT = vBuffer1024_A_uC.begin() + _size;
    }
 
    return true;
 }
 
+/*!
+ * \brief Calculates the hash for one block (SHA-224 / SHA-256)
+ */
+void uSHA_2::block( std::array<unsigned char, 64> const &_data ) { block512( _data.data() ); }
 
-std::vector<unsigned char> uSHA_2::quickHash( HASH_FUNCTION _type, std::string _message ) {
+/*!
+ * \brief Calculates the hash for one block (SHA-384 / SHA-512)
+ */
+void uSHA_2::block( std::array<unsigned char, 128> const &_data ) { block1024( _data.data() ); }
+
+
+std::vector<unsigned char> uSHA_2::quickHash( HASH_FUNCTION _type,
+                                              void const *  _data,
+                                              size_t        _size ) {
    reset( _type );
-   add( _message );
+   add( _data, _size );
    return end();
 }
 
+std::vector<unsigned char> uSHA_2::quickHash( HASH_FUNCTION _type, std::string const &_message ) {
+   reset( _type );
+   add( _message );
+   return end();
+}
 
-std::vector<unsigned char> uSHA_2::quickHash( HASH_FUNCTION              _type,
-                                              std::vector<unsigned char> _binary ) {
+std::vector<unsigned char> uSHA_2::quickHash( HASH_FUNCTION                     _type,
+                                              std::vector<unsigned char> const &_binary ) {
    reset( _type );
    add( _binary );
    return end();
@@ -23,6 +23,7 @@
 #include "defines.hpp"
 
 #include <array>
+#include <cstddef>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -57,18 +58,28 @@ class UTILS_API uSHA_2 {
 
    void init();
 
+   void block512( unsigned char const *_data, size_t _num = 1 );
+   void block1024( unsigned char const *_data, size_t _num = 1 );
+
    void padd512();
    void padd1024();
 
    bool test( HASH_FUNCTION _type, std::string const &_message, std::string const &_result );
+   bool testKernels();
+   bool testHMAC();
 
    uSHA_2() {}
 
  public:
    uSHA_2( HASH_FUNCTION _type );
+   uSHA_2( uSHA_2 const &_rhs );
+   uSHA_2 &operator=( uSHA_2 const &_rhs );
 
-   bool add( std::string const &_message );
-   bool add( std::vector<unsigned char> const &_binary );
+   bool add( void const *_data, size_t _size );
+   bool add( std::string const &_message ) { return add( _message.data(), _message.size() ); }
+   bool add( std::vector<unsigned char> const &_binary ) {
+      return add( _binary.data(), _binary.size() );
+   }
 
    void block( std::array<unsigned char, 64> const &_data );
    void block( std::array<unsigned char, 128> const &_data );
@@ -76,14 +87,16 @@ class UTILS_API uSHA_2 {
    std::vector<unsigned char> end();
    std::string get( bool _space = false );
 
-   std::vector<unsigned char> quickHash( HASH_FUNCTION _type, std::string _message );
-   std::vector<unsigned char> quickHash( HASH_FUNCTION _type, std::vector<unsigned char> _binary );
+   std::vector<unsigned char> quickHash( HASH_FUNCTION _type, void const *_data, size_t _size );
+   std::vector<unsigned char> quickHash( HASH_FUNCTION _type, std::string const &_message );
+   std::vector<unsigned char> quickHash( HASH_FUNCTION                     _type,
+                                         std::vector<unsigned char> const &_binary );
 
-   std::vector<unsigned char> operator()( HASH_FUNCTION _type, std::string _message ) {
+   std::vector<unsigned char> operator()( HASH_FUNCTION _type, std::string const &_message ) {
       return quickHash( _type, _message );
    }
-   std::vector<unsigned char> operator()( HASH_FUNCTION              _type,
-                                          std::vector<unsigned char> _binary ) {
+   std::vector<unsigned char> operator()( HASH_FUNCTION                     _type,
+                                          std::vector<unsigned char> const &_binary ) {
       return quickHash( _type, _binary );
    }
 
@@ -19,6 +19,7 @@
  */
 
 #include "uSHA_2.hpp"
+#include "uSHA_2_kernels.hpp"
 
 namespace e_engine {
 
@@ -52,106 +53,121 @@ inline uint32_t S1( uint32_t x ) {
 }
 
 
+namespace internal {
+
+const uint32_t SHA256_K[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+      0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+      0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+      0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+      0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+      0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+      0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+      0xc67178f2
+};
+
 /*!
- * \brief Calculates the hash for one block
+ * \brief Calculates the hash for _num blocks
  *
  * This is the main hash function of the SHA 2 algorithm
- * ( 256 AND 224 bit )
+ * ( 256 AND 224 bit ), portable version
  *
- * \param _data A pointer to the data (MUST have 512 bit)
+ * \param _state The hash state
+ * \param _data  A pointer to the data (MUST have _num * 512 bit)
+ * \param _num   The number of blocks
  */
-void uSHA_2::block( std::array<unsigned char, 64> const &_data ) {
-   const static uint32_t K[] = {
-         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
-         0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
-         0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
-         0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-         0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
-         0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
-         0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
-         0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
-         0xc67178f2,
-   };
-
-
-   uint32_t a, b, c, d, e, f, g, h, t1, t2;
-   std::array<uint32_t, 64> word;
-   uint16_t t;
-
-   for ( t = 0; t < 16; ++t ) {
-      word[t] = ( static_cast<uint32_t>( _data[t * 4 + 0] ) << 24 ) +
-                ( static_cast<uint32_t>( _data[t * 4 + 1] ) << 16 ) +
-                ( static_cast<uint32_t>( _data[t * 4 + 2] ) << 8 ) +
-                ( static_cast<uint32_t>( _data[t * 4 + 3] ) );
-   }
+void sha256Scalar( uint32_t *_state, unsigned char const *_data, size_t _num ) {
+   for ( ; _num > 0; --_num, _data += 64 ) {
+      uint32_t a, b, c, d, e, f, g, h, t1, t2;
+      std::array<uint32_t, 64> word;
+      uint16_t t;
+
+      for ( t = 0; t < 16; ++t ) {
+         word[t] = ( static_cast<uint32_t>( _data[t * 4 + 0] ) << 24 ) +
+                   ( static_cast<uint32_t>( _data[t * 4 + 1] ) << 16 ) +
+                   ( static_cast<uint32_t>( _data[t * 4 + 2] ) << 8 ) +
+                   ( static_cast<uint32_t>( _data[t * 4 + 3] ) );
+      }
 
 
-   for ( ; t < 64; ++t ) {
-      word[t] = S1( word[t - 2] ) + word[t - 7] + S0( word[t - 15] ) + word[t - 16];
-   }
+      for ( ; t < 64; ++t ) {
+         word[t] = S1( word[t - 2] ) + word[t - 7] + S0( word[t - 15] ) + word[t - 16];
+      }
 
-   a = h_512[0];
-   b = h_512[1];
-   c = h_512[2];
-   d = h_512[3];
-   e = h_512[4];
-   f = h_512[5];
-   g = h_512[6];
-   h = h_512[7];
-
-   for ( t = 0; t < 64; t += 8 ) { // the faster unrolled version
-      t1 = h + Sum1( e ) + Ch( e, f, g ) + K[t] + word[t];
-      t2 = Sum0( a ) + Maj( a, b, c );
-      d += t1;
-      h = t1 + t2;
-
-      t1 = g + Sum1( d ) + Ch( d, e, f ) + K[t + 1] + word[t + 1];
-      t2 = Sum0( h ) + Maj( h, a, b );
-      c += t1;
-      g = t1 + t2;
-
-      t1 = f + Sum1( c ) + Ch( c, d, e ) + K[t + 2] + word[t + 2];
-      t2 = Sum0( g ) + Maj( g, h, a );
-      b += t1;
-      f = t1 + t2;
-
-      t1 = e + Sum1( b ) + Ch( b, c, d ) + K[t + 3] + word[t + 3];
-      t2 = Sum0( f ) + Maj( f, g, h );
-      a += t1;
-      e = t1 + t2;
-
-      t1 = d + Sum1( a ) + Ch( a, b, c ) + K[t + 4] + word[t + 4];
-      t2 = Sum0( e ) + Maj( e, f, g );
-      h += t1;
-      d = t1 + t2;
-
-      t1 = c + Sum1( h ) + Ch( h, a, b ) + K[t + 5] + word[t + 5];
-      t2 = Sum0( d ) + Maj( d, e, f );
-      g += t1;
-      c = t1 + t2;
-
-      t1 = b + Sum1( g ) + Ch( g, h, a ) + K[t + 6] + word[t + 6];
-      t2 = Sum0( c ) + Maj( c, d, e );
-      f += t1;
-      b = t1 + t2;
-
-      t1 = a + Sum1( f ) + Ch( f, g, h ) + K[t + 7] + word[t + 7];
-      t2 = Sum0( b ) + Maj( b, c, d );
-      e += t1;
-      a = t1 + t2;
-   }
+      a = _state[0];
+      b = _state[1];
+      c = _state[2];
+      d = _state[3];
+      e = _state[4];
+      f = _state[5];
+      g = _state[6];
+      h = _state[7];
+
+      for ( t = 0; t < 64; t += 8 ) { // the faster unrolled version
+         t1 = h + Sum1( e ) + Ch( e, f, g ) + SHA256_K[t] + word[t];
+         t2 = Sum0( a ) + Maj( a, b, c );
+         d += t1;
+         h = t1 + t2;
+
+         t1 = g + Sum1( d ) + Ch( d, e, f ) + SHA256_K[t + 1] + word[t + 1];
+         t2 = Sum0( h ) + Maj( h, a, b );
+         c += t1;
+         g = t1 + t2;
+
+         t1 = f + Sum1( c ) + Ch( c, d, e ) + SHA256_K[t + 2] + word[t + 2];
+         t2 = Sum0( g ) + Maj( g, h, a );
+         b += t1;
+         f = t1 + t2;
+
+         t1 = e + Sum1( b ) + Ch( b, c, d ) + SHA256_K[t + 3] + word[t + 3];
+         t2 = Sum0( f ) + Maj( f, g, h );
+         a += t1;
+         e = t1 + t2;
+
+         t1 = d + Sum1( a ) + Ch( a, b, c ) + SHA256_K[t + 4] + word[t + 4];
+         t2 = Sum0( e ) + Maj( e, f, g );
+         h += t1;
+         d = t1 + t2;
+
+         t1 = c + Sum1( h ) + Ch( h, a, b ) + SHA256_K[t + 5] + word[t + 5];
+         t2 = Sum0( d ) + Maj( d, e, f );
+         g += t1;
+         c = t1 + t2;
+
+         t1 = b + Sum1( g ) + Ch( g, h, a ) + SHA256_K[t + 6] + word[t + 6];
+         t2 = Sum0( c ) + Maj( c, d, e );
+         f += t1;
+         b = t1 + t2;
+
+         t1 = a + Sum1( f ) + Ch( f, g, h ) + SHA256_K[t + 7] + word[t + 7];
+         t2 = Sum0( b ) + Maj( b, c, d );
+         e += t1;
+         a = t1 + t2;
+      }
 
-   h_512[0] += a;
-   h_512[1] += b;
-   h_512[2] += c;
-   h_512[3] += d;
-   h_512[4] += e;
-   h_512[5] += f;
-   h_512[6] += g;
-   h_512[7] += h;
+      _state[0] += a;
+      _state[1] += b;
+      _state[2] += c;
+      _state[3] += d;
+      _state[4] += e;
+      _state[5] += f;
+      _state[6] += g;
+      _state[7] += h;
+   }
+}
+}
 
-   ++vBlockCounter_ulI;
+/*!
+ * \brief Calculates the hash for _num blocks with the fastest kernel of this CPU
+ *
+ * \param _data A pointer to the data (MUST have _num * 512 bit)
+ * \param _num  The number of blocks
+ */
+void uSHA_2::block512( unsigned char const *_data, size_t _num ) {
+   internal::sha2Kernels().sha256( h_512, _data, _num );
+   vBlockCounter_ulI += _num;
 }
 
 void uSHA_2::padd512() {
@@ -160,7 +176,7 @@ void uSHA_2::padd512() {
 
    // Are is there a full block?
    if ( vCurrentPos512_A_IT == vBuffer512_A_uC.end() ) {
-      block( vBuffer512_A_uC );
+      block512( vBuffer512_A_uC.data() );
       vCurrentPos512_A_IT  = vBuffer512_A_uC.begin();
       lElementsInBuffer_uI = 0;
    }
@@ -208,7 +224,7 @@ void uSHA_2::padd512() {
          ++vCurrentPos512_A_IT;
       }
 
-      block( vBuffer512_A_uC );
+      block512( vBuffer512_A_uC.data() );
       vCurrentPos512_A_IT = vBuffer512_A_uC.begin();
 
       // Fill with zeros
@@ -240,7 +256,7 @@ void uSHA_2::padd512() {
 #pragma clang diagnostic pop
 #endif
 
-   block( vBuffer512_A_uC );
+   block512( vBuffer512_A_uC.data() );
 }
 }
 
@@ -0,0 +1,290 @@
+/*!
+ * \file uSHA_2_Multi.cpp
+ * \brief \b Classes: \a uSHA_2_Multi
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uSHA_2_Multi.hpp"
+#include "uSHA_2_kernels.hpp"
+#include <cstring>
+
+namespace e_engine {
+
+namespace {
+
+const uint32_t IV_224[8] = {0xc1059ed8,
+                            0x367cd507,
+                            0x3070dd17,
+                            0xf70e5939,
+                            0xffc00b31,
+                            0x68581511,
+                            0x64f98fa7,
+                            0xbefa4fa4};
+
+const uint32_t IV_256[8] = {0x6a09e667,
+                            0xbb67ae85,
+                            0x3c6ef372,
+                            0xa54ff53a,
+                            0x510e527f,
+                            0x9b05688c,
+                            0x1f83d9ab,
+                            0x5be0cd19};
+
+const unsigned MAX_LANES = 16;
+
+//! The progress of one message in a lane
+struct Lane {
+   size_t               msg     = 0;       //!< Index of the message
+   unsigned char const *data    = nullptr; //!< The next whole block of the message
+   size_t               left    = 0;       //!< Bytes of the message not yet hashed
+   uint64_t             bits    = 0;       //!< Message length in bit
+   unsigned             tail    = 0;       //!< Number of padding blocks (0: not yet built)
+   unsigned             tailPos = 0;       //!< Next padding block
+   bool                 active  = false;
+
+   unsigned char pad[128];
+
+   void start( size_t _msg, void const *_data, size_t _size ) {
+      msg     = _msg;
+      data    = static_cast<unsigned char const *>( _data );
+      left    = _size;
+      bits    = static_cast<uint64_t>( _size ) * 8;
+      tail    = 0;
+      tailPos = 0;
+      active  = true;
+   }
+
+   //! Builds the last block(s): rest of the message, 0x80, zeros and the length (FIPS-180-4 5.1.1)
+   void buildTail() {
+      tail = left < 56 ? 1 : 2;
+
+      std::memcpy( pad, data, left );
+      std::memset( pad + left, 0, tail * 64 - left );
+      pad[left] = 0x80;
+
+      for ( unsigned i = 0; i < 8; ++i )
+         pad[tail * 64 - 1 - i] = static_cast<unsigned char>( bits >> ( i * 8 ) );
+
+      left = 0;
+   }
+
+   unsigned char const *next() {
+      if ( left >= 64 ) {
+         unsigned char const *lBlock = data;
+         data += 64;
+         left -= 64;
+         return lBlock;
+      }
+
+      if ( tail == 0 )
+         buildTail();
+
+      return pad + 64 * tailPos++;
+   }
+
+   bool done() const { return tail != 0 && tailPos == tail; }
+};
+
+void writeDigest( std::vector<unsigned char> &_out, uint32_t const *_state, unsigned _words ) {
+   _out.resize( _words * 4 );
+   for ( unsigned i = 0; i < _words; ++i ) {
+      _out[i * 4]     = static_cast<unsigned char>( _state[i] >> 24 );
+      _out[i * 4 + 1] = static_cast<unsigned char>( _state[i] >> 16 );
+      _out[i * 4 + 2] = static_cast<unsigned char>( _state[i] >> 8 );
+      _out[i * 4 + 3] = static_cast<unsigned char>( _state[i] );
+   }
+}
+}
+
+/*!
+ * \brief Hashes _num messages
+ *
+ * \param[in] _data  Pointers to the messages
+ * \param[in] _sizes The sizes of the messages in bytes
+ * \param[in] _num   The number of messages
+ * \returns the digests in the order of the messages
+ */
+uSHA_2_Multi::RESULTS uSHA_2_Multi::hash( void const *const *_data,
+                                          size_t const *     _sizes,
+                                          size_t             _num ) {
+   RESULTS lResults( _num );
+
+   if ( vType == SHA2_224 || vType == SHA2_256 ) {
+      hashLanes( _data, _sizes, _num, lResults );
+   } else {
+      hashSerial( _data, _sizes, _num, lResults );
+   }
+
+   return lResults;
+}
+
+uSHA_2_Multi::RESULTS uSHA_2_Multi::hash( std::vector<std::string> const &_messages ) {
+   std::vector<void const *> lData( _messages.size() );
+   std::vector<size_t>       lSizes( _messages.size() );
+
+   for ( size_t i = 0; i < _messages.size(); ++i ) {
+      lData[i]  = _messages[i].data();
+      lSizes[i] = _messages[i].size();
+   }
+
+   return hash( lData.data(), lSizes.data(), _messages.size() );
+}
+
+uSHA_2_Multi::RESULTS uSHA_2_Multi::hash(
+      std::vector<std::vector<unsigned char>> const &_messages ) {
+   std::vector<void const *> lData( _messages.size() );
+   std::vector<size_t>       lSizes( _messages.size() );
+
+   for ( size_t i = 0; i < _messages.size(); ++i ) {
+      lData[i]  = _messages[i].data();
+      lSizes[i] = _messages[i].size();
+   }
+
+   return hash( lData.data(), lSizes.data(), _messages.size() );
+}
+
+
+void uSHA_2_Multi::hashSerial( void const *const *_data,
+                               size_t const *     _sizes,
+                               size_t             _num,
+                               RESULTS &          _out ) {
+   uSHA_2 lHasher( vType );
+
+   for ( size_t i = 0; i < _num; ++i )
+      _out[i] = lHasher.quickHash( vType, _data[i], _sizes[i] );
+}
+
+void uSHA_2_Multi::hashLanes( void const *const *_data,
+                              size_t const *     _sizes,
+                              size_t             _num,
+                              RESULTS &          _out ) {
+   internal::uSHA_2_LaneKernel const &lKernel = internal::sha256LaneKernel();
+   internal::SHA256_BLOCKS            lSerial = internal::sha2Kernels().sha256;
+
+   unsigned        lLanes  = getLanes();
+   unsigned        lWords  = vType == SHA2_224 ? 7 : 8;
+   uint32_t const *lIV     = vType == SHA2_224 ? IV_224 : IV_256;
+   size_t          lNext   = 0;
+   unsigned        lActive = 0;
+
+   Lane                 lLane[MAX_LANES];
+   unsigned char const *lBlocks[MAX_LANES];
+   uint32_t             lState[8 * MAX_LANES];
+   uint32_t             lSingle[8];
+   unsigned char        lIdle[64] = {0};
+
+   auto lStartLane = [&]( unsigned _l ) {
+      if ( lNext >= _num ) {
+         lLane[_l].active = false;
+         return;
+      }
+
+      lLane[_l].start( lNext, _data[lNext], _sizes[lNext] );
+      ++lNext;
+      ++lActive;
+
+      for ( unsigned w = 0; w < 8; ++w )
+         lState[w * lLanes + _l] = lIV[w];
+   };
+
+   for ( unsigned l = 0; l < lLanes; ++l )
+      lStartLane( l );
+
+   while ( lActive > 0 ) {
+      // Keep the lanes busy while there are enough messages
+      if ( lLanes > 1 && ( lNext < _num || lActive * 2 > lLanes ) ) {
+         for ( unsigned l = 0; l < lLanes; ++l )
+            lBlocks[l] = lLane[l].active ? lLane[l].next() : lIdle;
+
+         lKernel.blocks( lState, lBlocks );
+
+         for ( unsigned l = 0; l < lLanes; ++l ) {
+            if ( !lLane[l].active || !lLane[l].done() )
+               continue;
+
+            for ( unsigned w = 0; w < 8; ++w )
+               lSingle[w] = lState[w * lLanes + l];
+
+            writeDigest( _out[lLane[l].msg], lSingle, lWords );
+            --lActive;
+            lStartLane( l );
+         }
+
+         continue;
+      }
+
+      // Single lane (SHA extensions) or only a few messages left: use the single buffer kernel
+      for ( unsigned l = 0; l < lLanes; ++l ) {
+         Lane &lCur = lLane[l];
+         if ( !lCur.active )
+            continue;
+
+         for ( unsigned w = 0; w < 8; ++w )
+            lSingle[w] = lState[w * lLanes + l];
+
+         size_t lWhole = lCur.left / 64;
+         lSerial( lSingle, lCur.data, lWhole );
+         lCur.data += lWhole * 64;
+         lCur.left -= lWhole * 64;
+
+         if ( lCur.tail == 0 )
+            lCur.buildTail();
+
+         lSerial( lSingle, lCur.pad + 64 * lCur.tailPos, lCur.tail - lCur.tailPos );
+         writeDigest( _out[lCur.msg], lSingle, lWords );
+         --lActive;
+         lStartLane( l );
+      }
+   }
+}
+
+/*!
+ * \brief Returns the number of messages hashed in parallel
+ *
+ * This is 1 for SHA-384 / SHA-512, without a lane kernel and (unless forced with
+ * setUseLanes( true )) on CPUs with the SHA extensions.
+ */
+unsigned uSHA_2_Multi::getLanes() const {
+   if ( vType != SHA2_224 && vType != SHA2_256 )
+      return 1;
+
+   internal::uSHA_2_LaneKernel const &lKernel = internal::sha256LaneKernel();
+
+   if ( lKernel.lanes <= 1 )
+      return 1;
+
+   // Not even the 16 AVX-512 lanes were measurably faster than SHA-NI (see the class description)
+   bool lHardwareSHA = internal::sha2Kernels().sha256 != &internal::sha256Scalar;
+   if ( !vUseLanes_B && lHardwareSHA )
+      return 1;
+
+   return lKernel.lanes;
+}
+
+/*!
+ * \brief Returns the name of the kernel used for SHA-224 / SHA-256
+ */
+char const *uSHA_2_Multi::getKernelName() const {
+   if ( getLanes() > 1 )
+      return internal::sha256LaneKernel().name;
+
+   return internal::sha2Kernels().sha256Name;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
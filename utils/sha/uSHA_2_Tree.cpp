@@ -0,0 +1,417 @@
+/*!
+ * \file uSHA_2_Tree.cpp
+ * \brief \b Classes: \a uSHA_2_Tree
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uSHA_2_Tree.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include FILESYSTEM_INCLUDE
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace e_engine {
+
+namespace {
+
+const unsigned char PREFIX_LEAF = 0x00;
+const unsigned char PREFIX_NODE = 0x01;
+const unsigned char PREFIX_ROOT = 0x02;
+
+//! Starting a thread costs more than hashing a few leaves, small updates are hashed serially
+const uint64_t MIN_BYTES_PER_THREAD = 4 * 1024 * 1024;
+
+int seek64( FILE *_file, uint64_t _offset ) {
+#if WINDOWS
+   return _fseeki64( _file, static_cast<__int64>( _offset ), SEEK_SET );
+#else
+   return fseeko( _file, static_cast<off_t>( _offset ), SEEK_SET );
+#endif
+}
+
+void be64( unsigned char *_out, uint64_t _num ) {
+   for ( int i = 7; i >= 0; --i, _num >>= 8 )
+      _out[i] = static_cast<unsigned char>( _num );
+}
+
+int64_t modificationTime( FILESYSTEM_NAMESPACE::path const &_path ) {
+   std::error_code lError;
+   auto            lTime = FILESYSTEM_NAMESPACE::last_write_time( _path, lError );
+
+   if ( lError )
+      return INT64_MIN;
+
+   return std::chrono::duration_cast<std::chrono::nanoseconds>( lTime.time_since_epoch() ).count();
+}
+}
+
+/*!
+ * \param[in] _type       The SHA-2 function for the leaves and nodes
+ * \param[in] _leafSize   The size of one leaf in bytes
+ * \param[in] _numThreads The number of threads hashing leaves (0: one per CPU core)
+ */
+uSHA_2_Tree::uSHA_2_Tree( HASH_FUNCTION _type, uint64_t _leafSize, unsigned _numThreads )
+    : vType( _type ), vLeafSize( std::max<uint64_t>( _leafSize, 1 ) ), vNumThreads( _numThreads ) {
+   if ( vNumThreads == 0 )
+      vNumThreads = std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+/*!
+ * \brief Hashes the whole file
+ *
+ * \returns 1 if everything went fine
+ * \returns 3 if the file doesn't exists
+ * \returns 4 if the file is not a regular file
+ * \returns 5 if the file could not be read
+ */
+int uSHA_2_Tree::hashFile( std::string _file ) {
+   clear();
+   return update( _file, {} );
+}
+
+/*!
+ * \brief Hashes a buffer
+ */
+void uSHA_2_Tree::hash( void const *_data, uint64_t _size ) {
+   clear();
+   update( _data, _size, {} );
+}
+
+/*!
+ * \brief Rehashes the leaves of a changed file
+ *
+ * Only the leaves overlapping one of the changed byte ranges are hashed again. When the file size
+ * changed, the (new and old) last leaf and all added leaves are hashed as well.
+ *
+ * The stored leaves are only reused for the file they were hashed from (or restored for with
+ * setLeaves()); for any other file the whole file is hashed. Without changed ranges the whole file
+ * is hashed as well if its modification time differs from (or, after setLeaves(), is not known
+ * for) the stored leaves; nothing is hashed if it is the same.
+ *
+ * \param[in] _file    The file
+ * \param[in] _changed The changed byte ranges (offset and size) of the file
+ * \returns the same values as hashFile()
+ */
+int uSHA_2_Tree::update( std::string _file, std::vector<RANGE> const &_changed ) {
+   FILESYSTEM_NAMESPACE::path lPath( _file.c_str() );
+
+   if ( !FILESYSTEM_NAMESPACE::exists( lPath ) ) {
+      eLOG( "File '", _file, "' does not exists" );
+      return 3;
+   }
+
+   if ( !FILESYSTEM_NAMESPACE::is_regular_file( lPath ) ) {
+      eLOG( "'", _file, "' is not a file!" );
+      return 4;
+   }
+
+   uint64_t lSize  = static_cast<uint64_t>( FILESYSTEM_NAMESPACE::file_size( lPath ) );
+   int64_t  lMTime = modificationTime( lPath );
+
+   // Without changed ranges a modified file may have changed anywhere
+   bool lModified = lMTime != vMTime || lMTime == INT64_MIN;
+   if ( _file != vFile_str || ( _changed.empty() && lModified ) )
+      clear();
+
+   int lRet = hashFileLeaves( _file, leavesToUpdate( lSize, _changed ) );
+
+   if ( lRet != 1 ) {
+      clear();
+      return lRet;
+   }
+
+   vFile_str = _file;
+   vMTime    = lMTime;
+   buildRoot();
+   return 1;
+}
+
+/*!
+ * \brief Rehashes the leaves of a changed buffer
+ * \sa update( std::string, std::vector<RANGE> const & )
+ */
+void uSHA_2_Tree::update( void const *_data, uint64_t _size, std::vector<RANGE> const &_changed ) {
+   if ( !vFile_str.empty() )
+      clear();
+
+   hashLeaves( leavesToUpdate( _size, _changed ),
+               static_cast<unsigned char const *>( _data ),
+               std::string() );
+   buildRoot();
+}
+
+/*!
+ * \brief Restores stored leaf hashes (e.g. from a cache) and calculates the root
+ *
+ * update() only reuses the leaves for _file (or for a buffer when _file is empty). The
+ * modification time of the leaves is unknown, so update( _file, {} ) hashes the whole file; pass
+ * the changed ranges to reuse them.
+ *
+ * \param[in] _size   The size of the hashed data
+ * \param[in] _leaves The leaf hashes
+ * \param[in] _file   The file the leaves were hashed from (empty: a buffer)
+ * \returns false (and changes nothing) if the leaves don't match the size, leaf size or type
+ */
+bool uSHA_2_Tree::setLeaves( uint64_t _size, std::vector<DIGEST> _leaves, std::string _file ) {
+   unsigned lLength = uSHA_2( vType ).getHashLength();
+
+   if ( _leaves.size() != numLeaves( _size ) )
+      return false;
+
+   for ( auto const &i : _leaves )
+      if ( i.size() != lLength )
+         return false;
+
+   vSize     = _size;
+   vLeaves   = std::move( _leaves );
+   vFile_str = std::move( _file );
+   vMTime    = INT64_MIN;
+   buildRoot();
+   return true;
+}
+
+void uSHA_2_Tree::clear() {
+   vSize = 0;
+   vLeaves.clear();
+   vRoot.clear();
+   vFile_str.clear();
+   vMTime = INT64_MIN;
+}
+
+/*!
+ * \brief Returns the root as a hex string (empty when nothing is hashed)
+ */
+std::string uSHA_2_Tree::getRootString() const {
+   static const char HEX[] = "0123456789abcdef";
+
+   std::string lResult;
+   for ( unsigned char i : vRoot ) {
+      lResult += HEX[i >> 4];
+      lResult += HEX[i & 0xF];
+   }
+
+   return lResult;
+}
+
+
+size_t uSHA_2_Tree::numLeaves( uint64_t _size ) const {
+   return _size == 0 ? 1 : static_cast<size_t>( ( _size - 1 ) / vLeafSize + 1 );
+}
+
+/*!
+ * \brief Resizes the leaf list for the new size and returns the leaves that have to be hashed
+ */
+std::vector<size_t> uSHA_2_Tree::leavesToUpdate( uint64_t                  _newSize,
+                                                 std::vector<RANGE> const &_changed ) {
+   size_t lOld = vLeaves.size();
+   size_t lNew = numLeaves( _newSize );
+
+   std::vector<bool> lDirty( lNew, lOld == 0 );
+
+   // The last leaf changes with the size, new leaves have no hash yet
+   if ( lOld != 0 && _newSize != vSize )
+      for ( size_t i = std::min( lOld, lNew ) - 1; i < lNew; ++i )
+         lDirty[i] = true;
+
+   for ( RANGE const &i : _changed ) {
+      if ( i.second == 0 || i.first >= _newSize )
+         continue;
+
+      size_t lFirst = static_cast<size_t>( i.first / vLeafSize );
+      size_t lLast  = static_cast<size_t>( ( i.first + i.second - 1 ) / vLeafSize );
+
+      for ( size_t j = lFirst; j <= lLast && j < lNew; ++j )
+         lDirty[j] = true;
+   }
+
+   vLeaves.resize( lNew );
+   vSize = _newSize;
+
+   std::vector<size_t> lTodo;
+   for ( size_t i = 0; i < lNew; ++i )
+      if ( lDirty[i] )
+         lTodo.push_back( i );
+
+   return lTodo;
+}
+
+/*!
+ * \brief Hashes the leaves of a file (memory mapped if possible)
+ * \returns 1 or 5 (read error)
+ */
+int uSHA_2_Tree::hashFileLeaves( std::string const &_file, std::vector<size_t> const &_todo ) {
+   if ( _todo.empty() )
+      return 1;
+
+#if UNIX
+   if ( vSize > 0 ) {
+      int lFD = open( _file.c_str(), O_RDONLY | O_CLOEXEC );
+      if ( lFD < 0 ) {
+         eLOG( "Unable to open ", _file );
+         return 5;
+      }
+
+      void *lMap = mmap( nullptr, static_cast<size_t>( vSize ), PROT_READ, MAP_PRIVATE, lFD, 0 );
+      close( lFD );
+
+      if ( lMap != MAP_FAILED ) {
+         // Every thread reads its leaves front to back
+         madvise( lMap, static_cast<size_t>( vSize ), MADV_SEQUENTIAL );
+
+         bool lOK = hashLeaves( _todo, static_cast<unsigned char const *>( lMap ), _file );
+         munmap( lMap, static_cast<size_t>( vSize ) );
+         return lOK ? 1 : 5;
+      }
+
+      wLOG( "Unable to map '", _file, "' -- reading it" );
+   }
+#endif
+
+   return hashLeaves( _todo, nullptr, _file ) ? 1 : 5;
+}
+
+/*!
+ * \brief Hashes the leaves _todo with up to vNumThreads threads
+ *
+ * Every thread gets at least MIN_BYTES_PER_THREAD bytes, so small updates are hashed on the
+ * calling thread. The data is either read from _data or (when _data is nullptr) from _file, with
+ * one FILE handle per thread.
+ *
+ * \returns false on a read error
+ */
+bool uSHA_2_Tree::hashLeaves( std::vector<size_t> const &_todo,
+                              unsigned char const *      _data,
+                              std::string const &        _file ) {
+   static const unsigned char EMPTY = 0;
+
+   std::atomic<size_t> lNext( 0 );
+   std::atomic<bool>   lError( false );
+
+   auto lWorker = [&]() {
+      uSHA_2                     lHasher( vType );
+      std::vector<unsigned char> lBuffer;
+      FILE *                     lFile = nullptr;
+
+      if ( _data == nullptr && vSize > 0 ) {
+         lFile = fopen( _file.c_str(), "rb" );
+         if ( lFile == nullptr ) {
+            eLOG( "Unable to open ", _file );
+            lError = true;
+            return;
+         }
+
+         lBuffer.resize( static_cast<size_t>( std::min( vLeafSize, vSize ) ) );
+      }
+
+      for ( size_t i = lNext++; i < _todo.size() && !lError; i = lNext++ ) {
+         uint64_t             lOffset = _todo[i] * vLeafSize;
+         uint64_t             lLeft   = vSize - lOffset;
+         size_t               lSize   = static_cast<size_t>( std::min( vLeafSize, lLeft ) );
+         unsigned char const *lLeaf   = &EMPTY;
+
+         if ( lSize > 0 && _data != nullptr ) {
+            lLeaf = _data + lOffset;
+         } else if ( lSize > 0 ) {
+            if ( seek64( lFile, lOffset ) != 0 ||
+                 fread( lBuffer.data(), 1, lSize, lFile ) != lSize ) {
+               eLOG( "Failed to read '", _file, "'" );
+               lError = true;
+               break;
+            }
+
+            lLeaf = lBuffer.data();
+         }
+
+         lHasher.reset( vType );
+         lHasher.add( &PREFIX_LEAF, 1 );
+         lHasher.add( lLeaf, lSize );
+         vLeaves[_todo[i]] = lHasher.end();
+      }
+
+      if ( lFile != nullptr )
+         fclose( lFile );
+   };
+
+   uint64_t lBytes      = _todo.size() * std::min( vLeafSize, vSize );
+   uint64_t lMaxThreads = std::max<uint64_t>( 1, lBytes / MIN_BYTES_PER_THREAD );
+   size_t   lNumThreads = std::min<size_t>( vNumThreads, _todo.size() );
+   lNumThreads          = std::min<size_t>( lNumThreads, lMaxThreads );
+
+   std::vector<std::thread> lThreads;
+
+   for ( size_t i = 1; i < lNumThreads; ++i )
+      lThreads.emplace_back( lWorker );
+
+   lWorker();
+
+   for ( auto &i : lThreads )
+      i.join();
+
+   return !lError;
+}
+
+/*!
+ * \brief Builds the tree from the leaves and calculates the root (see the class description)
+ */
+void uSHA_2_Tree::buildRoot() {
+   uSHA_2              lHasher( vType );
+   std::vector<DIGEST> lLevel = vLeaves;
+
+   while ( lLevel.size() > 1 ) {
+      std::vector<DIGEST> lUp;
+      lUp.reserve( ( lLevel.size() + 1 ) / 2 );
+
+      for ( size_t i = 0; i < lLevel.size(); i += 2 ) {
+         if ( i + 1 == lLevel.size() ) {
+            lUp.push_back( std::move( lLevel[i] ) );
+            continue;
+         }
+
+         lHasher.reset( vType );
+         lHasher.add( &PREFIX_NODE, 1 );
+         lHasher.add( lLevel[i] );
+         lHasher.add( lLevel[i + 1] );
+         lUp.push_back( lHasher.end() );
+      }
+
+      lLevel.swap( lUp );
+   }
+
+   unsigned char lSizes[16];
+   be64( lSizes, vSize );
+   be64( lSizes + 8, vLeafSize );
+
+   lHasher.reset( vType );
+   lHasher.add( &PREFIX_ROOT, 1 );
+   lHasher.add( lSizes, sizeof( lSizes ) );
+   lHasher.add( lLevel[0] );
+   vRoot = lHasher.end();
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
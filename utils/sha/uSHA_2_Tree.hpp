@@ -0,0 +1,108 @@
+/*!
+ * \file uSHA_2_Tree.hpp
+ * \brief \b Classes: \a uSHA_2_Tree
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uSHA_2.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uSHA_2_Tree
+ * \brief Merkle tree hash of large files, the leaves are hashed in parallel
+ *
+ * The data is split into leaves of a fixed size (the last leaf may be shorter, empty data has one
+ * empty leaf). H is the SHA-2 function of the object, || concatenation and be64 a 64 bit big
+ * endian integer:
+ *
+ * \code
+ * leaf[i] = H( 0x00 || data[i * leafSize, (i + 1) * leafSize) )
+ * node    = H( 0x01 || left || right )
+ * root    = H( 0x02 || be64( size ) || be64( leafSize ) || top )
+ * \endcode
+ *
+ * The nodes of one level are built from pairs of the level below; a single node at the end of a
+ * level is moved up unchanged. top is the last remaining node. The prefix bytes keep leaves,
+ * nodes and the root apart, and the root binds the data size and the leaf size.
+ *
+ * The root is NOT the plain SHA-2 hash of the file.
+ *
+ * Files are mapped into memory (UNIX) or read leaf by leaf with one handle per thread. The leaf
+ * hashes are kept together with the path and modification time of the file, so update() only has
+ * to rehash the leaves in the changed byte ranges of the same file. Small updates are hashed on
+ * the calling thread.
+ */
+class UTILS_API uSHA_2_Tree final {
+ public:
+   typedef std::vector<unsigned char>    DIGEST;
+   typedef std::pair<uint64_t, uint64_t> RANGE; //!< offset and size in bytes
+
+ private:
+   HASH_FUNCTION vType;
+   uint64_t      vLeafSize;
+   unsigned      vNumThreads;
+
+   uint64_t            vSize = 0;
+   std::vector<DIGEST> vLeaves;
+   DIGEST              vRoot;
+
+   std::string vFile_str;          //!< The file of the leaves (empty: a buffer)
+   int64_t     vMTime = INT64_MIN; //!< The modification time of vFile_str (INT64_MIN: unknown)
+
+   size_t numLeaves( uint64_t _size ) const;
+
+   bool hashLeaves( std::vector<size_t> const &_todo,
+                    unsigned char const *      _data,
+                    std::string const &        _file );
+   int hashFileLeaves( std::string const &_file, std::vector<size_t> const &_todo );
+   void buildRoot();
+
+   std::vector<size_t> leavesToUpdate( uint64_t _newSize, std::vector<RANGE> const &_changed );
+
+ public:
+   uSHA_2_Tree( HASH_FUNCTION _type = SHA2_256,
+                uint64_t      _leafSize   = 1024 * 1024,
+                unsigned      _numThreads = 0 );
+
+   int  hashFile( std::string _file );
+   void hash( void const *_data, uint64_t _size );
+
+   int  update( std::string _file, std::vector<RANGE> const &_changed );
+   void update( void const *_data, uint64_t _size, std::vector<RANGE> const &_changed );
+
+   bool setLeaves( uint64_t _size, std::vector<DIGEST> _leaves, std::string _file = "" );
+   void clear();
+
+   DIGEST const &             getRoot() const { return vRoot; }
+   std::string                getRootString() const;
+   std::vector<DIGEST> const &getLeaves() const { return vLeaves; }
+   uint64_t                   getSize() const { return vSize; }
+   uint64_t                   getLeafSize() const { return vLeafSize; }
+   HASH_FUNCTION              getType() const { return vType; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
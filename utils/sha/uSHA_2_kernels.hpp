@@ -0,0 +1,72 @@
+/*!
+ * \file uSHA_2_kernels.hpp
+ * \brief \b Classes: \a uSHA_2_Kernels
+ *
+ * Internal header -- the block functions used by uSHA_2
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <cstddef>
+#include <stdint.h>
+
+namespace e_engine {
+namespace internal {
+
+typedef void ( *SHA256_BLOCKS )( uint32_t *_state, unsigned char const *_data, size_t _num );
+typedef void ( *SHA512_BLOCKS )( uint64_t *_state, unsigned char const *_data, size_t _num );
+
+/*!
+ * \brief A set of block functions (hash _num whole blocks into _state)
+ */
+struct uSHA_2_Kernels {
+   SHA256_BLOCKS sha256;
+   SHA512_BLOCKS sha512;
+   char const *  sha256Name;
+   char const *  sha512Name;
+};
+
+typedef void ( *SHA256_LANES )( uint32_t *_state, unsigned char const *const *_blocks );
+
+/*!
+ * \brief Hashes one block per lane
+ *
+ * _state holds the 8 state words of all lanes interleaved ( _state[word * lanes + lane] ) and
+ * _blocks one block pointer per lane.
+ */
+struct uSHA_2_LaneKernel {
+   SHA256_LANES blocks;
+   unsigned     lanes;
+   char const * name;
+};
+
+extern const uint32_t SHA256_K[64];
+extern const uint64_t SHA512_K[80];
+
+void sha256Scalar( uint32_t *_state, unsigned char const *_data, size_t _num );
+void sha512Scalar( uint64_t *_state, unsigned char const *_data, size_t _num );
+
+uSHA_2_Kernels const &sha2Kernels();
+uSHA_2_Kernels const &sha2ScalarKernels();
+uSHA_2_LaneKernel const &sha256LaneKernel();
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -19,10 +19,38 @@
  */
 
 #include "uSHA_2.hpp"
+#include "uHKDF.hpp"
+#include "uHMAC.hpp"
 #include "uLog.hpp"
+#include "uSHA_2_kernels.hpp"
+#include <cstring>
 
 namespace e_engine {
 
+namespace {
+
+std::string toHex( std::vector<unsigned char> const &_data ) {
+   static const char HEX[] = "0123456789abcdef";
+
+   std::string lResult;
+   for ( unsigned char i : _data ) {
+      lResult += HEX[i >> 4];
+      lResult += HEX[i & 0xF];
+   }
+
+   return lResult;
+}
+
+//! The bytes _first, _first + 1, ..., _last
+std::vector<unsigned char> byteRange( unsigned _first, unsigned _last ) {
+   std::vector<unsigned char> lResult;
+   for ( unsigned i = _first; i <= _last; ++i )
+      lResult.push_back( static_cast<unsigned char>( i ) );
+
+   return lResult;
+}
+}
+
 bool uSHA_2::test( HASH_FUNCTION _type, const std::string &_message, const std::string &_result ) {
    reset( _type );
    add( _message );
@@ -73,6 +101,277 @@ bool uSHA_2::test( HASH_FUNCTION _type, const std::string &_message, const std::
 }
 
 
+/*!
+ * \brief Compares the block functions in use with the portable ones
+ *
+ * The test vectors above only run through the kernels of this CPU, so the hardware kernels are
+ * additionally checked against the scalar kernels with pseudo random multi block input.
+ */
+bool uSHA_2::testKernels() {
+   internal::uSHA_2_Kernels const &lHW     = internal::sha2Kernels();
+   internal::uSHA_2_Kernels const &lScalar = internal::sha2ScalarKernels();
+
+   std::vector<unsigned char> lData( 128 * 17 );
+   uint32_t                   lSeed = 0x2545f491;
+   for ( unsigned char &i : lData ) {
+      lSeed = lSeed * 1664525 + 1013904223;
+      i     = static_cast<unsigned char>( lSeed >> 24 );
+   }
+
+   bool lReturn_B = true;
+
+   for ( size_t lBlocks : {1, 2, 17} ) {
+      uint32_t l256_HW[8], l256_S[8];
+      uint64_t l512_HW[8], l512_S[8];
+
+      for ( uint32_t i = 0; i < 8; ++i ) {
+         l256_HW[i] = l256_S[i] = 0x6a09e667u * ( i + 1 );
+         l512_HW[i] = l512_S[i] = 0x6a09e667f3bcc908ULL * ( i + 1 );
+      }
+
+      lHW.sha256( l256_HW, lData.data(), lBlocks * 2 );
+      lScalar.sha256( l256_S, lData.data(), lBlocks * 2 );
+      lHW.sha512( l512_HW, lData.data(), lBlocks );
+      lScalar.sha512( l512_S, lData.data(), lBlocks );
+
+      if ( std::memcmp( l256_HW, l256_S, sizeof( l256_S ) ) != 0 ) {
+         eLOG( "SHA2-256: kernel '", lHW.sha256Name, "' differs from the scalar kernel" );
+         lReturn_B = false;
+      }
+
+      if ( std::memcmp( l512_HW, l512_S, sizeof( l512_S ) ) != 0 ) {
+         eLOG( "SHA2-512: kernel '", lHW.sha512Name, "' differs from the scalar kernel" );
+         lReturn_B = false;
+      }
+   }
+
+   // Lane kernel: every lane hashes 2 other blocks of the data
+   internal::uSHA_2_LaneKernel const &lLanes = internal::sha256LaneKernel();
+   if ( lLanes.lanes > 0 ) {
+      std::vector<uint32_t>             lState( 8 * lLanes.lanes );
+      std::vector<unsigned char const *> lBlocks( lLanes.lanes );
+
+      for ( unsigned w = 0; w < 8; ++w )
+         for ( unsigned l = 0; l < lLanes.lanes; ++l )
+            lState[w * lLanes.lanes + l] = 0x6a09e667u * ( w + 1 ) + l;
+
+      for ( unsigned b = 0; b < 2; ++b ) {
+         for ( unsigned l = 0; l < lLanes.lanes; ++l )
+            lBlocks[l] = lData.data() + ( ( l * 2 + b ) % 34 ) * 64;
+
+         lLanes.blocks( lState.data(), lBlocks.data() );
+      }
+
+      for ( unsigned l = 0; l < lLanes.lanes; ++l ) {
+         uint32_t lSingle[8];
+         for ( unsigned w = 0; w < 8; ++w )
+            lSingle[w] = 0x6a09e667u * ( w + 1 ) + l;
+
+         lScalar.sha256( lSingle, lData.data() + ( ( l * 2 ) % 34 ) * 64, 1 );
+         lScalar.sha256( lSingle, lData.data() + ( ( l * 2 + 1 ) % 34 ) * 64, 1 );
+
+         for ( unsigned w = 0; w < 8; ++w ) {
+            if ( lSingle[w] != lState[w * lLanes.lanes + l] ) {
+               eLOG( "SHA2-256: lane ", l, " of kernel '", lLanes.name, "' differs" );
+               lReturn_B = false;
+               break;
+            }
+         }
+      }
+   }
+
+   if ( lReturn_B ) {
+      iLOG( "[OK] SHA2-256 kernel: ", lHW.sha256Name );
+      iLOG( "[OK] SHA2-512 kernel: ", lHW.sha512Name );
+      iLOG( "[OK] SHA2-256 lane kernel: ", lLanes.name );
+   }
+
+   return lReturn_B;
+}
+
+
+/*!
+ * \brief Checks uHMAC and uHKDF with the test vectors of RFC 4231 and RFC 5869 (SHA-256 cases)
+ *
+ * The expected MAC of RFC 4231 test case 5 is truncated to 128 bits.
+ */
+bool uSHA_2::testHMAC() {
+   struct HMACTest {
+      std::string key;
+      std::string data;
+      char const *mac[4]; //!< SHA-224, SHA-256, SHA-384, SHA-512
+   };
+
+   struct HKDFTest {
+      std::vector<unsigned char> ikm;
+      std::vector<unsigned char> salt;
+      std::vector<unsigned char> info;
+      size_t                     length;
+      char const *               prk;
+      char const *               okm;
+   };
+
+   std::vector<unsigned char> lKey4 = byteRange( 0x01, 0x19 );
+
+   const HMACTest lHMACTests[] = {
+      // Test case 1
+      {std::string( 20, '\x0b' ),
+       "Hi There",
+       {"896fb1128abbdf196832107cd49df33f47b4b1169912ba4f53684b22",
+        "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+        "afd03944d84895626b0825f4ab46907f15f9dadbe4101ec682aa034c7cebc59c"
+        "faea9ea9076ede7f4af152e8b2fa9cb6",
+        "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cde"
+        "daa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854"}},
+      // Test case 2
+      {"Jefe",
+       "what do ya want for nothing?",
+       {"a30e01098bc6dbbf45690f3a7e9e6d0f8bbea2a39e6148008fd05e44",
+        "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+        "af45d2e376484031617f78d2b58a6b1b9c7ef464f5a01b47e42ec3736322445e"
+        "8e2240ca5e69e2c78b3239ecfab21649",
+        "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+        "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"}},
+      // Test case 3
+      {std::string( 20, '\xaa' ),
+       std::string( 50, '\xdd' ),
+       {"7fb3cb3588c6c1f6ffa9694d7d6ad2649365b0c1f65d69d1ec8333ea",
+        "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe",
+        "88062608d3e6ad8a0aa2ace014c8a86f0aa635d947ac9febe83ef4e55966144b"
+        "2a5ab39dc13814b94e3ab6e101a34f27",
+        "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39"
+        "bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb"}},
+      // Test case 4
+      {std::string( lKey4.begin(), lKey4.end() ),
+       std::string( 50, '\xcd' ),
+       {"6c11506874013cac6a2abc1bb382627cec6a90d86efc012de7afec5a",
+        "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+        "3e8a69b7783c25851933ab6290af6ca77a9981480850009cc5577c6e1f573b4e"
+        "6801dd23c4a7d679ccf8a386c674cffb",
+        "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3db"
+        "a91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd"}},
+      // Test case 5
+      {std::string( 20, '\x0c' ),
+       "Test With Truncation",
+       {"0e2aea68a90c8d37c988bcdb9fca6fa8",
+        "a3b6167473100ee06e0c796c2955552b",
+        "3abf34c3503b2a23a46efc619baef897",
+        "415fad6271580a531d4179bc891d87a6"}},
+      // Test case 6
+      {std::string( 131, '\xaa' ),
+       "Test Using Larger Than Block-Size Key - Hash Key First",
+       {"95e9a0db962095adaebe9b2d6f0dbce2d499f112f2d2b7273fa6870e",
+        "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+        "4ece084485813e9088d2c63a041bc5b44f9ef1012a2b588f3cd11f05033ac4c6"
+        "0c2ef6ab4030fe8296248df163f44952",
+        "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+        "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"}},
+      // Test case 7
+      {std::string( 131, '\xaa' ),
+       "This is a test using a larger than block-size key and a larger than block-size data. The "
+       "key needs to be hashed before being used by the HMAC algorithm.",
+       {"3a854166ac5d9f023f54d517d0b39dbd946770db9c2b95c9f6f565d1",
+        "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2",
+        "6617178e941f020d351e2f254e8fd32c602420feb0b8fb9adccebb82461e99c5"
+        "a678cc31e799176d3860e6110c46523e",
+        "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944"
+        "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58"}},
+   };
+
+   const HKDFTest lHKDFTests[] = {
+      // Test case 1
+      {std::vector<unsigned char>( 22, 0x0b ),
+       byteRange( 0x00, 0x0c ),
+       byteRange( 0xf0, 0xf9 ),
+       42,
+       "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+       "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865"},
+      // Test case 2
+      {byteRange( 0x00, 0x4f ),
+       byteRange( 0x60, 0xaf ),
+       byteRange( 0xb0, 0xff ),
+       82,
+       "06a6b88c5853361a06104c9ceb35b45cef760014904671014a193f40c15fc244",
+       "b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+       "59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+       "cc30c58179ec3e87c14c01d5c1f3434f1d87"},
+      // Test case 3
+      {std::vector<unsigned char>( 22, 0x0b ),
+       std::vector<unsigned char>(),
+       std::vector<unsigned char>(),
+       42,
+       "19ef24a32c717b167f33a91d6f648bdf96596776afdb6377ac434c1c293ccb04",
+       "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8"},
+   };
+
+   const HASH_FUNCTION lTypes[]  = {SHA2_224, SHA2_256, SHA2_384, SHA2_512};
+   char const *        lNames[]  = {"SHA2-224", "SHA2-256", "SHA2-384", "SHA2-512"};
+   bool                lReturn_B = true;
+
+   for ( size_t i = 0; i < sizeof( lHMACTests ) / sizeof( lHMACTests[0] ); ++i ) {
+      HMACTest const &lTest = lHMACTests[i];
+
+      for ( size_t j = 0; j < 4; ++j ) {
+         uHMAC       lHMAC( lTypes[j], lTest.key );
+         std::string lOneShot = toHex( lHMAC.mac( lTest.data ) );
+
+         // The same MAC from two add() calls and a reused key state
+         size_t lHalf = lTest.data.size() / 2;
+         lHMAC.add( lTest.data.data(), lHalf );
+         lHMAC.add( lTest.data.data() + lHalf, lTest.data.size() - lHalf );
+         std::string lStreamed = toHex( lHMAC.end() );
+         std::string lExpected = lTest.mac[j];
+
+         if ( lOneShot.compare( 0, lExpected.size(), lExpected ) != 0 || lStreamed != lOneShot ) {
+            eLOG( "HMAC-",
+                  lNames[j],
+                  ": RFC 4231 test case ",
+                  i + 1,
+                  "\nRESULT:   ",
+                  lOneShot,
+                  "\nSTREAMED: ",
+                  lStreamed,
+                  "\nEXPECTED: ",
+                  lExpected );
+            lReturn_B = false;
+            continue;
+         }
+
+         iLOG( "[OK] HMAC-", lNames[j], ": RFC 4231 test case ", i + 1 );
+      }
+   }
+
+   for ( size_t i = 0; i < sizeof( lHKDFTests ) / sizeof( lHKDFTests[0] ); ++i ) {
+      HKDFTest const &lTest = lHKDFTests[i];
+
+      uHKDF lKDF( SHA2_256 );
+      lKDF.extract( lTest.ikm, lTest.salt );
+
+      std::string lPRK = toHex( lKDF.getPRK() );
+      std::string lOKM = toHex( lKDF.expand( lTest.info, lTest.length ) );
+
+      if ( lPRK != lTest.prk || lOKM != lTest.okm ) {
+         eLOG( "HKDF-SHA2-256: RFC 5869 test case ",
+               i + 1,
+               "\nPRK:      ",
+               lPRK,
+               "\nEXPECTED: ",
+               lTest.prk,
+               "\nOKM:      ",
+               lOKM,
+               "\nEXPECTED: ",
+               lTest.okm );
+         lReturn_B = false;
+         continue;
+      }
+
+      iLOG( "[OK] HKDF-SHA2-256: RFC 5869 test case ", i + 1 );
+   }
+
+   return lReturn_B;
+}
+
+
 bool uSHA_2::selftest() {
    std::string lResult_str;
    bool        lReturn_B = true;
@@ -163,6 +462,16 @@ bool uSHA_2::selftest() {
    }
 
 
+   if ( !testKernels() ) {
+      lReturn_B = false;
+   }
+
+
+   if ( !testHMAC() ) {
+      lReturn_B = false;
+   }
+
+
    iLOG( "========== END SHA 2 selftest ==========" );
 
    return lReturn_B;
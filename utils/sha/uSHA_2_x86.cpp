@@ -0,0 +1,590 @@
+/*!
+ * \file uSHA_2_x86.cpp
+ * \brief \b Classes: \a uSHA_2_Kernels
+ *
+ * SHA-NI (SHA-256) and AVX2 (SHA-512) block functions and the runtime CPU dispatch
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uSHA_2_kernels.hpp"
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#define U_SHA_X86 1
+#else
+#define U_SHA_X86 0
+#endif
+
+#if U_SHA_X86
+#include <immintrin.h>
+
+#if COMPILER_MSC
+#include <intrin.h>
+#define SHA_TARGET( _x_ )
+#else
+#include <cpuid.h>
+#define SHA_TARGET( _x_ ) __attribute__( ( target( _x_ ) ) )
+#endif
+#endif
+
+// The multi-buffer kernels need the GCC / Clang vector extensions
+#define U_SHA_LANES ( U_SHA_X86 && !COMPILER_MSC )
+
+#if U_SHA_LANES
+#include <cstring>
+#endif
+
+namespace e_engine {
+namespace internal {
+
+#if U_SHA_X86
+
+namespace {
+
+/*
+ *   _____ _____ _   _  ______      _            _
+ *  /  __ \| ___ \ | | | |  _  \    | |          | |
+ *  | /  \/| |_/ / | | | | | | | ___| |_ ___  ___| |_
+ *  | |    |  __/| | | | | | | |/ _ \ __/ _ \/ __| __|
+ *  | \__/\| |   | |_| | | |/ /  __/ ||  __/ (__| |_
+ *   \____/\_|    \___/  |___/ \___|\__\___|\___|\__|
+ *
+ */
+
+struct CPUFeatures {
+   bool sse2    = false;
+   bool sha     = false;
+   bool avx2    = false;
+   bool avx512f = false;
+};
+
+void cpuid( uint32_t _leaf, uint32_t _sub, uint32_t *_regs ) {
+#if COMPILER_MSC
+   int lRegs[4];
+   __cpuidex( lRegs, static_cast<int>( _leaf ), static_cast<int>( _sub ) );
+   for ( int i = 0; i < 4; ++i )
+      _regs[i] = static_cast<uint32_t>( lRegs[i] );
+#else
+   __cpuid_count( _leaf, _sub, _regs[0], _regs[1], _regs[2], _regs[3] );
+#endif
+}
+
+//! Returns the state components the OS saves on a context switch (XCR0)
+uint64_t xgetbv0() {
+#if COMPILER_MSC
+   return _xgetbv( 0 );
+#else
+   uint32_t lEAX, lEDX;
+   __asm__ __volatile__( "xgetbv" : "=a"( lEAX ), "=d"( lEDX ) : "c"( 0 ) );
+   return ( static_cast<uint64_t>( lEDX ) << 32 ) | lEAX;
+#endif
+}
+
+CPUFeatures detectCPU() {
+   CPUFeatures lFeatures;
+   uint32_t    lRegs[4];
+
+   cpuid( 0, 0, lRegs );
+   uint32_t lMaxLeaf = lRegs[0];
+   if ( lMaxLeaf < 1 )
+      return lFeatures;
+
+   cpuid( 1, 0, lRegs );
+   lFeatures.sse2 = ( lRegs[3] & ( 1u << 26 ) ) != 0;
+
+   if ( lMaxLeaf < 7 )
+      return lFeatures;
+
+   bool lSSSE3   = ( lRegs[2] & ( 1u << 9 ) ) != 0;
+   bool lSSE41   = ( lRegs[2] & ( 1u << 19 ) ) != 0;
+   bool lOSXSAVE = ( lRegs[2] & ( 1u << 27 ) ) != 0;
+   bool lAVX     = ( lRegs[2] & ( 1u << 28 ) ) != 0;
+
+   // The YMM registers are only usable when the OS saves them (XMM and YMM state in XCR0)
+   // AVX-512 additionally needs the opmask and ZMM state
+   uint64_t lXCR0 = lOSXSAVE ? xgetbv0() : 0;
+   bool     lYMM  = lAVX && ( lXCR0 & 0x6 ) == 0x6;
+   bool     lZMM  = lYMM && ( lXCR0 & 0xE0 ) == 0xE0;
+
+   cpuid( 7, 0, lRegs );
+   lFeatures.sha     = lSSSE3 && lSSE41 && ( lRegs[1] & ( 1u << 29 ) ) != 0;
+   lFeatures.avx2    = lYMM && ( lRegs[1] & ( 1u << 5 ) ) != 0;
+   lFeatures.avx512f = lZMM && ( lRegs[1] & ( 1u << 16 ) ) != 0;
+
+   return lFeatures;
+}
+
+
+
+/*
+ *   _____ _   _   ___         _____  _____  ____
+ *  /  ___| | | | / _ \       / __  \|  ___|/ ___|
+ *  \ `--.| |_| |/ /_\ \______`' / /'|___ \/ /___
+ *   `--. \  _  ||  _  |______| / /      \ \ ___ \
+ *  /\__/ / | | || | | |      ./ /___/\__/ / \_/ |
+ *  \____/\_| |_/\_| |_/      \_____/\____/\_____/
+ *
+ */
+
+// 4 rounds with the message words in _msg_ and the constants of the quad round _k_
+#define SHA256_QROUND( _msg_, _k_ )                                                                \
+   lTmp    = _mm_add_epi32( _msg_, _mm_loadu_si128( lK + _k_ ) );                                 \
+   lState1 = _mm_sha256rnds2_epu32( lState1, lState0, lTmp );                                     \
+   lTmp    = _mm_shuffle_epi32( lTmp, 0x0E );                                                     \
+   lState0 = _mm_sha256rnds2_epu32( lState0, lState1, lTmp );
+
+// Finishes the next 4 message words (_next_ already went through sha256msg1)
+#define SHA256_MSG2( _next_, _cur_, _prev_ )                                                       \
+   _next_ = _mm_add_epi32( _next_, _mm_alignr_epi8( _cur_, _prev_, 4 ) );                          \
+   _next_ = _mm_sha256msg2_epu32( _next_, _cur_ );
+
+#define SHA256_MSG1( _prev_, _cur_ ) _prev_ = _mm_sha256msg1_epu32( _prev_, _cur_ );
+
+/*!
+ * \brief SHA-256 block function using the SHA extensions
+ *
+ * The state stays in the ABEF / CDGH register layout of sha256rnds2 for all blocks and is only
+ * converted back at the end.
+ */
+SHA_TARGET( "sha,sse4.1,ssse3" )
+void sha256SHANI( uint32_t *_state, unsigned char const *_data, size_t _num ) {
+   const __m128i  lSwap = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+   __m128i const *lK    = reinterpret_cast<__m128i const *>( SHA256_K );
+
+   __m128i lTmp    = _mm_loadu_si128( reinterpret_cast<__m128i const *>( _state ) );
+   __m128i lState1 = _mm_loadu_si128( reinterpret_cast<__m128i const *>( _state + 4 ) );
+   __m128i lState0;
+
+   lTmp    = _mm_shuffle_epi32( lTmp, 0xB1 );          // CDAB
+   lState1 = _mm_shuffle_epi32( lState1, 0x1B );       // EFGH
+   lState0 = _mm_alignr_epi8( lTmp, lState1, 8 );      // ABEF
+   lState1 = _mm_blend_epi16( lState1, lTmp, 0xF0 );   // CDGH
+
+   for ( ; _num > 0; --_num, _data += 64 ) {
+      __m128i const *lData  = reinterpret_cast<__m128i const *>( _data );
+      __m128i        lSave0 = lState0;
+      __m128i        lSave1 = lState1;
+
+      __m128i lM0 = _mm_shuffle_epi8( _mm_loadu_si128( lData + 0 ), lSwap );
+      __m128i lM1 = _mm_shuffle_epi8( _mm_loadu_si128( lData + 1 ), lSwap );
+      __m128i lM2 = _mm_shuffle_epi8( _mm_loadu_si128( lData + 2 ), lSwap );
+      __m128i lM3 = _mm_shuffle_epi8( _mm_loadu_si128( lData + 3 ), lSwap );
+
+      SHA256_QROUND( lM0, 0 )
+      SHA256_QROUND( lM1, 1 )
+      SHA256_MSG1( lM0, lM1 )
+      SHA256_QROUND( lM2, 2 )
+      SHA256_MSG1( lM1, lM2 )
+
+      for ( int i = 3; i < 11; i += 4 ) {
+         SHA256_QROUND( lM3, i )
+         SHA256_MSG2( lM0, lM3, lM2 )
+         SHA256_MSG1( lM2, lM3 )
+         SHA256_QROUND( lM0, i + 1 )
+         SHA256_MSG2( lM1, lM0, lM3 )
+         SHA256_MSG1( lM3, lM0 )
+         SHA256_QROUND( lM1, i + 2 )
+         SHA256_MSG2( lM2, lM1, lM0 )
+         SHA256_MSG1( lM0, lM1 )
+         SHA256_QROUND( lM2, i + 3 )
+         SHA256_MSG2( lM3, lM2, lM1 )
+         SHA256_MSG1( lM1, lM2 )
+      }
+
+      SHA256_QROUND( lM3, 11 )
+      SHA256_MSG2( lM0, lM3, lM2 )
+      SHA256_MSG1( lM2, lM3 )
+      SHA256_QROUND( lM0, 12 )
+      SHA256_MSG2( lM1, lM0, lM3 )
+      SHA256_MSG1( lM3, lM0 )
+      SHA256_QROUND( lM1, 13 )
+      SHA256_MSG2( lM2, lM1, lM0 )
+      SHA256_QROUND( lM2, 14 )
+      SHA256_MSG2( lM3, lM2, lM1 )
+      SHA256_QROUND( lM3, 15 )
+
+      lState0 = _mm_add_epi32( lState0, lSave0 );
+      lState1 = _mm_add_epi32( lState1, lSave1 );
+   }
+
+   lTmp    = _mm_shuffle_epi32( lState0, 0x1B );       // FEBA
+   lState1 = _mm_shuffle_epi32( lState1, 0xB1 );       // DCHG
+   lState0 = _mm_blend_epi16( lTmp, lState1, 0xF0 );   // DCBA
+   lState1 = _mm_alignr_epi8( lState1, lTmp, 8 );      // HGFE
+
+   _mm_storeu_si128( reinterpret_cast<__m128i *>( _state ), lState0 );
+   _mm_storeu_si128( reinterpret_cast<__m128i *>( _state + 4 ), lState1 );
+}
+
+#undef SHA256_QROUND
+#undef SHA256_MSG2
+#undef SHA256_MSG1
+
+
+
+/*
+ *   _____ _   _   ___         _____  __   _____
+ *  /  ___| | | | / _ \       |  ___|/  | / __  \
+ *  \ `--.| |_| |/ /_\ \______|___ \ `| | `' / /'
+ *   `--. \  _  ||  _  |______|   \ \ | |   / /
+ *  /\__/ / | | || | | |      /\__/ /_| |_./ /___
+ *  \____/\_| |_/\_| |_/      \____/ \___/\_____/
+ *
+ */
+
+inline uint64_t ROTR64( uint64_t x, uint64_t n ) { return ( x >> n ) | ( x << ( 64 - n ) ); }
+
+inline uint64_t Ch64( uint64_t x, uint64_t y, uint64_t z ) { return ( x & y ) ^ ( ~x & z ); }
+
+inline uint64_t Maj64( uint64_t x, uint64_t y, uint64_t z ) {
+   return ( x & y ) ^ ( x & z ) ^ ( y & z );
+}
+
+inline uint64_t Sum0_64( uint64_t x ) {
+   return ROTR64( x, 28 ) ^ ROTR64( x, 34 ) ^ ROTR64( x, 39 );
+}
+
+inline uint64_t Sum1_64( uint64_t x ) {
+   return ROTR64( x, 14 ) ^ ROTR64( x, 18 ) ^ ROTR64( x, 41 );
+}
+
+SHA_TARGET( "avx2" )
+inline __m256i ROTR256( __m256i x, int n ) {
+   return _mm256_or_si256( _mm256_srli_epi64( x, n ), _mm256_slli_epi64( x, 64 - n ) );
+}
+
+SHA_TARGET( "avx2" )
+inline __m128i ROTR128( __m128i x, int n ) {
+   return _mm_or_si128( _mm_srli_epi64( x, n ), _mm_slli_epi64( x, 64 - n ) );
+}
+
+//! FIPS-180-4  --- 4.12 (4 words at once)
+SHA_TARGET( "avx2" )
+inline __m256i S0_256( __m256i x ) {
+   return _mm256_xor_si256( _mm256_xor_si256( ROTR256( x, 1 ), ROTR256( x, 8 ) ),
+                            _mm256_srli_epi64( x, 7 ) );
+}
+
+//! FIPS-180-4  --- 4.13 (2 words at once)
+SHA_TARGET( "avx2" )
+inline __m128i S1_128( __m128i x ) {
+   return _mm_xor_si128( _mm_xor_si128( ROTR128( x, 19 ), ROTR128( x, 61 ) ),
+                         _mm_srli_epi64( x, 6 ) );
+}
+
+/*!
+ * \brief SHA-512 block function with an AVX2 message schedule
+ *
+ * The byte swap and the message schedule (including the addition of K) are done 4 words at a
+ * time. Only sigma1 has to be split into 2 + 2 words because W[t] depends on W[t - 2]. The rounds
+ * themselves are serial and stay scalar.
+ */
+SHA_TARGET( "avx2" )
+void sha512AVX2( uint64_t *_state, unsigned char const *_data, size_t _num ) {
+   alignas( 32 ) uint64_t lWK[80];
+
+   // Reverses the bytes of each 64 bit word
+   const __m256i lSwap = _mm256_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+                                          8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7 );
+
+   __m256i const *lK = reinterpret_cast<__m256i const *>( SHA512_K );
+
+   for ( ; _num > 0; --_num, _data += 128 ) {
+      __m256i const *lData = reinterpret_cast<__m256i const *>( _data );
+      __m256i *      lOut  = reinterpret_cast<__m256i *>( lWK );
+
+      // The last 16 words of the schedule: W[t - 16 .. t - 13] ... W[t - 4 .. t - 1]
+      __m256i lX0 = _mm256_shuffle_epi8( _mm256_loadu_si256( lData + 0 ), lSwap );
+      __m256i lX1 = _mm256_shuffle_epi8( _mm256_loadu_si256( lData + 1 ), lSwap );
+      __m256i lX2 = _mm256_shuffle_epi8( _mm256_loadu_si256( lData + 2 ), lSwap );
+      __m256i lX3 = _mm256_shuffle_epi8( _mm256_loadu_si256( lData + 3 ), lSwap );
+
+      _mm256_store_si256( lOut + 0, _mm256_add_epi64( lX0, _mm256_loadu_si256( lK + 0 ) ) );
+      _mm256_store_si256( lOut + 1, _mm256_add_epi64( lX1, _mm256_loadu_si256( lK + 1 ) ) );
+      _mm256_store_si256( lOut + 2, _mm256_add_epi64( lX2, _mm256_loadu_si256( lK + 2 ) ) );
+      _mm256_store_si256( lOut + 3, _mm256_add_epi64( lX3, _mm256_loadu_si256( lK + 3 ) ) );
+
+      for ( int i = 4; i < 20; ++i ) {
+         // W[t - 15 .. t - 12] and W[t - 7 .. t - 4]
+         __m256i lW15 = _mm256_alignr_epi8( _mm256_permute2x128_si256( lX0, lX1, 0x21 ), lX0, 8 );
+         __m256i lW7  = _mm256_alignr_epi8( _mm256_permute2x128_si256( lX2, lX3, 0x21 ), lX2, 8 );
+
+         __m256i lSum = _mm256_add_epi64( _mm256_add_epi64( lX0, S0_256( lW15 ) ), lW7 );
+         __m128i lLo  = _mm256_castsi256_si128( lSum );
+         __m128i lHi  = _mm256_extracti128_si256( lSum, 1 );
+
+         lLo = _mm_add_epi64( lLo, S1_128( _mm256_extracti128_si256( lX3, 1 ) ) );
+         lHi = _mm_add_epi64( lHi, S1_128( lLo ) );
+
+         lX0 = lX1;
+         lX1 = lX2;
+         lX2 = lX3;
+         lX3 = _mm256_inserti128_si256( _mm256_castsi128_si256( lLo ), lHi, 1 );
+
+         _mm256_store_si256( lOut + i, _mm256_add_epi64( lX3, _mm256_loadu_si256( lK + i ) ) );
+      }
+
+      uint64_t a = _state[0];
+      uint64_t b = _state[1];
+      uint64_t c = _state[2];
+      uint64_t d = _state[3];
+      uint64_t e = _state[4];
+      uint64_t f = _state[5];
+      uint64_t g = _state[6];
+      uint64_t h = _state[7];
+      uint64_t t1, t2;
+
+      for ( int t = 0; t < 80; t += 8 ) {
+         t1 = h + Sum1_64( e ) + Ch64( e, f, g ) + lWK[t];
+         t2 = Sum0_64( a ) + Maj64( a, b, c );
+         d += t1;
+         h = t1 + t2;
+
+         t1 = g + Sum1_64( d ) + Ch64( d, e, f ) + lWK[t + 1];
+         t2 = Sum0_64( h ) + Maj64( h, a, b );
+         c += t1;
+         g = t1 + t2;
+
+         t1 = f + Sum1_64( c ) + Ch64( c, d, e ) + lWK[t + 2];
+         t2 = Sum0_64( g ) + Maj64( g, h, a );
+         b += t1;
+         f = t1 + t2;
+
+         t1 = e + Sum1_64( b ) + Ch64( b, c, d ) + lWK[t + 3];
+         t2 = Sum0_64( f ) + Maj64( f, g, h );
+         a += t1;
+         e = t1 + t2;
+
+         t1 = d + Sum1_64( a ) + Ch64( a, b, c ) + lWK[t + 4];
+         t2 = Sum0_64( e ) + Maj64( e, f, g );
+         h += t1;
+         d = t1 + t2;
+
+         t1 = c + Sum1_64( h ) + Ch64( h, a, b ) + lWK[t + 5];
+         t2 = Sum0_64( d ) + Maj64( d, e, f );
+         g += t1;
+         c = t1 + t2;
+
+         t1 = b + Sum1_64( g ) + Ch64( g, h, a ) + lWK[t + 6];
+         t2 = Sum0_64( c ) + Maj64( c, d, e );
+         f += t1;
+         b = t1 + t2;
+
+         t1 = a + Sum1_64( f ) + Ch64( f, g, h ) + lWK[t + 7];
+         t2 = Sum0_64( b ) + Maj64( b, c, d );
+         e += t1;
+         a = t1 + t2;
+      }
+
+      _state[0] += a;
+      _state[1] += b;
+      _state[2] += c;
+      _state[3] += d;
+      _state[4] += e;
+      _state[5] += f;
+      _state[6] += g;
+      _state[7] += h;
+   }
+}
+
+/*
+ *  ___  ___      _ _   _       _            __  __
+ *  |  \/  |     | | | (_)     | |          / _|/ _|
+ *  | .  . |_   _| | |_ _ ______| |__  _   _| |_| |_ ___ _ __
+ *  | |\/| | | | | | __| |______| '_ \| | | |  _|  _/ _ \ '__|
+ *  | |  | | |_| | | |_| |      | |_) | |_| | | | ||  __/ |
+ *  \_|  |_/\__,_|_|\__|_|      |_.__/ \__,_|_| |_| \___|_|
+ *
+ */
+
+#if U_SHA_LANES
+
+/*
+ * The lane kernels are written once with the GCC / Clang vector extensions. The template is always
+ * inlined into the wrappers below, so it is compiled for the target of each wrapper.
+ */
+
+typedef uint32_t VEC4  __attribute__( ( vector_size( 16 ) ) );
+typedef uint32_t VEC8  __attribute__( ( vector_size( 32 ) ) );
+typedef uint32_t VEC16 __attribute__( ( vector_size( 64 ) ) );
+
+#define SHA_LANES_INLINE __attribute__( ( always_inline ) ) inline
+
+// A macro and not a function: vector arguments / return values would change the ABI
+#define ROTR_V( _x_, _n_ ) ( ( ( _x_ ) >> ( _n_ ) ) | ( ( _x_ ) << ( 32 - ( _n_ ) ) ) )
+
+// One round, the caller rotates the variable names instead of moving the values
+#define SHA256_LANE_ROUND( a, b, c, d, e, f, g, h, _t_ )                                           \
+   t1 = h + ( ROTR_V( e, 6 ) ^ ROTR_V( e, 11 ) ^ ROTR_V( e, 25 ) ) + ( g ^ ( e & ( f ^ g ) ) );    \
+   t1 += SHA256_K[_t_] + lW[_t_];                                                                  \
+   t2 = ( ROTR_V( a, 2 ) ^ ROTR_V( a, 13 ) ^ ROTR_V( a, 22 ) );                                    \
+   t2 += ( a & b ) | ( c & ( a | b ) );                                                            \
+   d += t1;                                                                                        \
+   h = t1 + t2;
+
+template <class V, int LANES>
+SHA_LANES_INLINE void sha256LanesT( uint32_t *_state, unsigned char const *const *_blocks ) {
+   V lW[64];
+   V lS[8];
+
+   // Transpose: word t of every lane into one vector
+   for ( int t = 0; t < 16; ++t ) {
+      for ( int l = 0; l < LANES; ++l ) {
+         uint32_t lWord;
+         std::memcpy( &lWord, _blocks[l] + t * 4, 4 );
+         lW[t][l] = __builtin_bswap32( lWord );
+      }
+   }
+
+   for ( int t = 16; t < 64; ++t ) {
+      V lW2  = lW[t - 2];
+      V lW15 = lW[t - 15];
+      lW[t]  = ( ROTR_V( lW2, 17 ) ^ ROTR_V( lW2, 19 ) ^ ( lW2 >> 10 ) ) + lW[t - 7] +
+              ( ROTR_V( lW15, 7 ) ^ ROTR_V( lW15, 18 ) ^ ( lW15 >> 3 ) ) + lW[t - 16];
+   }
+
+   std::memcpy( lS, _state, sizeof( lS ) );
+
+   V a = lS[0], b = lS[1], c = lS[2], d = lS[3], e = lS[4], f = lS[5], g = lS[6], h = lS[7];
+   V t1, t2;
+
+   for ( int t = 0; t < 64; t += 8 ) {
+      SHA256_LANE_ROUND( a, b, c, d, e, f, g, h, t )
+      SHA256_LANE_ROUND( h, a, b, c, d, e, f, g, t + 1 )
+      SHA256_LANE_ROUND( g, h, a, b, c, d, e, f, t + 2 )
+      SHA256_LANE_ROUND( f, g, h, a, b, c, d, e, t + 3 )
+      SHA256_LANE_ROUND( e, f, g, h, a, b, c, d, t + 4 )
+      SHA256_LANE_ROUND( d, e, f, g, h, a, b, c, t + 5 )
+      SHA256_LANE_ROUND( c, d, e, f, g, h, a, b, t + 6 )
+      SHA256_LANE_ROUND( b, c, d, e, f, g, h, a, t + 7 )
+   }
+
+   lS[0] += a;
+   lS[1] += b;
+   lS[2] += c;
+   lS[3] += d;
+   lS[4] += e;
+   lS[5] += f;
+   lS[6] += g;
+   lS[7] += h;
+
+   std::memcpy( _state, lS, sizeof( lS ) );
+}
+
+SHA_TARGET( "sse2" )
+void sha256x4SSE2( uint32_t *_state, unsigned char const *const *_blocks ) {
+   sha256LanesT<VEC4, 4>( _state, _blocks );
+}
+
+SHA_TARGET( "avx2" )
+void sha256x8AVX2( uint32_t *_state, unsigned char const *const *_blocks ) {
+   sha256LanesT<VEC8, 8>( _state, _blocks );
+}
+
+//! 16 lanes in the ZMM registers, rotates are native (vprord)
+SHA_TARGET( "avx512f" )
+void sha256x16AVX512( uint32_t *_state, unsigned char const *const *_blocks ) {
+   sha256LanesT<VEC16, 16>( _state, _blocks );
+}
+
+#undef SHA_LANES_INLINE
+#undef ROTR_V
+#undef SHA256_LANE_ROUND
+
+#endif // U_SHA_LANES
+
+
+uSHA_2_Kernels detectKernels() {
+   CPUFeatures    lCPU     = detectCPU();
+   uSHA_2_Kernels lKernels = sha2ScalarKernels();
+
+   if ( lCPU.sha ) {
+      lKernels.sha256     = &sha256SHANI;
+      lKernels.sha256Name = "SHA-NI";
+   }
+
+   if ( lCPU.avx2 ) {
+      lKernels.sha512     = &sha512AVX2;
+      lKernels.sha512Name = "AVX2";
+   }
+
+   return lKernels;
+}
+
+uSHA_2_LaneKernel detectLaneKernel() {
+   uSHA_2_LaneKernel lKernel = {nullptr, 0, "none"};
+
+#if U_SHA_LANES
+   CPUFeatures lCPU = detectCPU();
+
+   if ( lCPU.avx512f ) {
+      lKernel = {&sha256x16AVX512, 16, "AVX-512 x16"};
+   } else if ( lCPU.avx2 ) {
+      lKernel = {&sha256x8AVX2, 8, "AVX2 x8"};
+   } else if ( lCPU.sse2 ) {
+      lKernel = {&sha256x4SSE2, 4, "SSE2 x4"};
+   }
+#endif
+
+   return lKernel;
+}
+}
+
+#endif // U_SHA_X86
+
+
+/*!
+ * \brief Returns the fastest block functions supported by this CPU
+ *
+ * The CPU is only checked once (on the first call)
+ */
+uSHA_2_Kernels const &sha2Kernels() {
+#if U_SHA_X86
+   static const uSHA_2_Kernels lKernels = detectKernels();
+   return lKernels;
+#else
+   return sha2ScalarKernels();
+#endif
+}
+
+/*!
+ * \brief Returns the SHA-256 kernel hashing one block in each of several lanes
+ *
+ * This is the widest kernel the CPU supports, even if the CPU has the SHA extensions (which are
+ * usually faster). lanes is 0 (and blocks nullptr) when there is no such kernel for this CPU /
+ * compiler.
+ */
+uSHA_2_LaneKernel const &sha256LaneKernel() {
+#if U_SHA_X86
+   static const uSHA_2_LaneKernel lKernel = detectLaneKernel();
+#else
+   static const uSHA_2_LaneKernel lKernel = {nullptr, 0, "none"};
+#endif
+   return lKernel;
+}
+
+/*!
+ * \brief Returns the portable block functions
+ */
+uSHA_2_Kernels const &sha2ScalarKernels() {
+   static const uSHA_2_Kernels lKernels = {&sha256Scalar, &sha512Scalar, "scalar", "scalar"};
+   return lKernels;
+}
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,279 @@
+/*!
+ * \file uFileWatcher.cpp
+ * \brief \b Classes: \a uFileWatcher
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uFileWatcher.hpp"
+#include "uLog.hpp"
+#include <cerrno>
+#include <cstring>
+#include FILESYSTEM_INCLUDE
+
+#if UNIX && defined( __linux__ )
+#define U_HAVE_INOTIFY 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#define U_HAVE_INOTIFY 0
+#endif
+
+namespace e_engine {
+
+#if U_HAVE_INOTIFY
+namespace {
+const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+}
+#endif
+
+/*!
+ * \brief Starts the watcher thread
+ * \param[in] _debounceMS How long a path has to be quiet before its signal is sent
+ */
+uFileWatcher::uFileWatcher( unsigned _debounceMS )
+    : vRunning_B( false ), vDebounce_MS( _debounceMS ) {
+#if U_HAVE_INOTIFY
+   vInotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+   vEpollFD   = epoll_create1( EPOLL_CLOEXEC );
+   vWakeFD    = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+   if ( vInotifyFD < 0 || vEpollFD < 0 || vWakeFD < 0 ) {
+      eLOG( "Failed to initialize the file watcher: ", std::strerror( errno ) );
+      return;
+   }
+
+   epoll_event lEvent;
+   std::memset( &lEvent, 0, sizeof( lEvent ) );
+   lEvent.events  = EPOLLIN;
+   lEvent.data.fd = vInotifyFD;
+   epoll_ctl( vEpollFD, EPOLL_CTL_ADD, vInotifyFD, &lEvent );
+
+   lEvent.data.fd = vWakeFD;
+   epoll_ctl( vEpollFD, EPOLL_CTL_ADD, vWakeFD, &lEvent );
+
+   vRunning_B = true;
+   vThread    = std::thread( &uFileWatcher::watchLoop, this );
+#else
+   wLOG( "File watching is not supported on this platform" );
+#endif
+}
+
+uFileWatcher::~uFileWatcher() {
+   vRunning_B = false;
+
+#if U_HAVE_INOTIFY
+   if ( vWakeFD >= 0 ) {
+      uint64_t lWake = 1;
+      if ( ::write( vWakeFD, &lWake, sizeof( lWake ) ) < 0 )
+         wLOG( "Failed to wake up the file watcher thread" );
+   }
+#endif
+
+   if ( vThread.joinable() )
+      vThread.join();
+
+#if U_HAVE_INOTIFY
+   for ( int i : {vInotifyFD, vEpollFD, vWakeFD} )
+      if ( i >= 0 )
+         close( i );
+#endif
+}
+
+
+/*!
+ * \brief Starts watching a file or directory
+ *
+ * For directories the signal is sent with the path of the changed file in the directory.
+ * Watching the same path twice returns the same signal.
+ *
+ * \param[in] _path The file or directory to watch (the parent directory of a file must exist)
+ * \returns the signal of the path or nullptr on error
+ */
+uFileWatcher::SIGNAL *uFileWatcher::watch( std::string _path ) {
+   std::lock_guard<std::recursive_mutex> lLock( vWatches_MUT );
+
+   for ( auto &i : vWatches )
+      if ( i->path == _path )
+         return &i->signal;
+
+   FILESYSTEM_NAMESPACE::path lPath( _path );
+   std::unique_ptr<Watch>     lWatch( new Watch );
+   lWatch->path = _path;
+
+   if ( FILESYSTEM_NAMESPACE::is_directory( lPath ) ) {
+      lWatch->dir = _path;
+   } else {
+      lWatch->dir  = lPath.parent_path().string();
+      lWatch->name = lPath.filename().string();
+
+      if ( lWatch->dir.empty() )
+         lWatch->dir = ".";
+   }
+
+#if U_HAVE_INOTIFY
+   if ( vInotifyFD >= 0 ) {
+      lWatch->wd = inotify_add_watch( vInotifyFD, lWatch->dir.c_str(), WATCH_MASK );
+      if ( lWatch->wd < 0 ) {
+         eLOG( "Unable to watch '", lWatch->dir, "': ", std::strerror( errno ) );
+         return nullptr;
+      }
+   }
+#endif
+
+   vWatches.emplace_back( std::move( lWatch ) );
+   return &vWatches.back()->signal;
+}
+
+/*!
+ * \brief Stops watching a path
+ *
+ * The signal of the path is destroyed (and all slots disconnected).
+ *
+ * \returns false if the path was not watched
+ */
+bool uFileWatcher::unwatch( std::string _path ) {
+   std::lock_guard<std::recursive_mutex> lLock( vWatches_MUT );
+
+   for ( auto lIT = vWatches.begin(); lIT != vWatches.end(); ++lIT ) {
+      if ( ( *lIT )->path != _path )
+         continue;
+
+      int lWD = ( *lIT )->wd;
+      vWatches.erase( lIT );
+
+#if U_HAVE_INOTIFY
+      // Several files in one directory share the same inotify watch
+      for ( auto &i : vWatches )
+         if ( i->wd == lWD )
+            return true;
+
+      if ( lWD >= 0 )
+         inotify_rm_watch( vInotifyFD, lWD );
+#endif
+
+      return true;
+   }
+
+   return false;
+}
+
+
+void uFileWatcher::watchLoop() {
+#if U_HAVE_INOTIFY
+   LOG.nameThread( L"watch" );
+
+   epoll_event lEvents[2];
+   int         lTimeout = -1;
+
+   while ( vRunning_B ) {
+      int lNum = epoll_wait( vEpollFD, lEvents, 2, lTimeout );
+      if ( lNum < 0 && errno != EINTR ) {
+         eLOG( "epoll_wait failed: ", std::strerror( errno ) );
+         break;
+      }
+
+      for ( int i = 0; i < lNum; ++i )
+         if ( lEvents[i].data.fd == vInotifyFD )
+            handleEvents();
+
+      lTimeout = sendPending();
+   }
+#endif
+}
+
+/*!
+ * \brief Reads all inotify events and (re)starts the debounce timer of the affected paths
+ */
+void uFileWatcher::handleEvents() {
+#if U_HAVE_INOTIFY
+   alignas( inotify_event ) char lBuffer[4096];
+
+   while ( true ) {
+      ssize_t lLength = read( vInotifyFD, lBuffer, sizeof( lBuffer ) );
+      if ( lLength <= 0 )
+         break;
+
+      std::lock_guard<std::recursive_mutex> lLock( vWatches_MUT );
+
+      CLOCK::time_point lDeadline = CLOCK::now() + std::chrono::milliseconds( vDebounce_MS );
+
+      for ( char *lPtr = lBuffer; lPtr < lBuffer + lLength; ) {
+         inotify_event *lEvent = reinterpret_cast<inotify_event *>( lPtr );
+         lPtr += sizeof( inotify_event ) + lEvent->len;
+
+         if ( lEvent->mask & IN_Q_OVERFLOW ) {
+            wLOG( "inotify queue overflow -- treating all watched paths as changed" );
+            for ( auto &i : vWatches ) {
+               i->pending  = true;
+               i->deadline = lDeadline;
+               i->changed  = i->path;
+            }
+            continue;
+         }
+
+         std::string lName = lEvent->len > 0 ? std::string( lEvent->name ) : std::string();
+
+         for ( auto &i : vWatches ) {
+            if ( i->wd != lEvent->wd || ( !i->name.empty() && i->name != lName ) )
+               continue;
+
+            i->pending  = true;
+            i->deadline = lDeadline;
+            i->changed  = ( i->name.empty() && !lName.empty() ) ? i->dir + "/" + lName : i->path;
+         }
+      }
+   }
+#endif
+}
+
+/*!
+ * \brief Sends the signals of all paths whose debounce time is over
+ * \returns the time in ms until the next pending path is due (-1 if nothing is pending)
+ */
+int uFileWatcher::sendPending() {
+   std::lock_guard<std::recursive_mutex> lLock( vWatches_MUT );
+
+   CLOCK::time_point lNow     = CLOCK::now();
+   int               lTimeout = -1;
+
+   for ( size_t i = 0; i < vWatches.size(); ++i ) {
+      Watch *lWatch = vWatches[i].get();
+      if ( !lWatch->pending )
+         continue;
+
+      if ( lWatch->deadline <= lNow ) {
+         lWatch->pending      = false;
+         std::string lChanged = lWatch->changed;
+         lWatch->signal.send( lChanged );
+         continue;
+      }
+
+      auto lLeft = std::chrono::duration_cast<std::chrono::milliseconds>( lWatch->deadline - lNow );
+      int  lMS   = static_cast<int>( lLeft.count() ) + 1;
+
+      if ( lTimeout < 0 || lMS < lTimeout )
+         lTimeout = lMS;
+   }
+
+   return lTimeout;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
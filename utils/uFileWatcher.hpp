@@ -0,0 +1,101 @@
+/*!
+ * \file uFileWatcher.hpp
+ * \brief \b Classes: \a uFileWatcher
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "uSignalSlot.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uFileWatcher
+ * \brief Notifies about changed files and directories
+ *
+ * Every watched path gets its own signal. The signal is sent (from the watcher thread) with the
+ * path of the changed file, after no further change was seen for the debounce time. This way the
+ * many events of one save (create, write, rename, ...) only trigger one signal.
+ *
+ * Files are watched through their parent directory, so atomic saves (write a temporary file and
+ * rename it over the old one) are detected as well.
+ *
+ * On Linux this uses inotify and epoll in a single thread. On other platforms watch() works, but
+ * the signals are never sent.
+ *
+ * \warning Do not call unwatch() from a connected slot
+ */
+class UTILS_API uFileWatcher final {
+ public:
+   typedef uSignal<void, std::string> SIGNAL;
+   typedef std::chrono::steady_clock  CLOCK;
+
+ private:
+   struct Watch {
+      std::string path; //!< The path as passed to watch()
+      std::string dir;  //!< The directory with the inotify watch
+      std::string name; //!< The file name in dir (empty when a directory is watched)
+      int         wd = -1;
+
+      SIGNAL signal;
+
+      bool              pending = false;
+      CLOCK::time_point deadline;
+      std::string       changed;
+   };
+
+   std::vector<std::unique_ptr<Watch>> vWatches;
+   std::recursive_mutex                vWatches_MUT;
+
+   std::thread           vThread;
+   std::atomic<bool>     vRunning_B;
+   std::atomic<unsigned> vDebounce_MS;
+
+   int vInotifyFD = -1;
+   int vEpollFD   = -1;
+   int vWakeFD    = -1;
+
+   void watchLoop();
+   void handleEvents();
+   int  sendPending();
+
+ public:
+   uFileWatcher( unsigned _debounceMS = 100 );
+   ~uFileWatcher();
+
+   uFileWatcher( uFileWatcher const & ) = delete;
+   uFileWatcher &operator=( uFileWatcher const & ) = delete;
+
+   SIGNAL *watch( std::string _path );
+   bool unwatch( std::string _path );
+
+   void setDebounce( unsigned _ms ) { vDebounce_MS = _ms; }
+   bool isActive() const { return vRunning_B; }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
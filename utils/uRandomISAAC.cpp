@@ -19,7 +19,9 @@
  */
 
 #include "uRandomISAAC.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #if defined __liunx__
 #include <sys/time.h>
 #else
@@ -54,6 +56,15 @@
       a += b;                                                                                      \
    }
 
+// One step of get() for the result _i of a block (a = aa, b = bb)
+#define ISAAC_STEP( _mix, _i )                                                                     \
+   {                                                                                               \
+      x      = mm[_i];                                                                             \
+      a      = ( a ^ ( _mix ) ) + mm[( _i + 128 ) & 255];                                          \
+      mm[_i] = y = mm[( x >> 2 ) & 255] + a + b;                                                   \
+      _out[_i] = b = mm[( y >> 10 ) & 255] + x;                                                    \
+   }
+
 namespace e_engine {
 
 void uRandomISAAC::init( uint32_t _seed ) {
@@ -202,6 +213,130 @@ uint32_t uRandomISAAC::get() {
    ++step;
    return bb;
 }
+
+/*!
+ * \brief Generates the next 256 results at once (only valid at the start of a block: step == 0)
+ *
+ * Same results as 256 calls of get(), without the per call branches.
+ */
+void uRandomISAAC::generateBlock( uint32_t *_out ) {
+   uint32_t x, y;
+   uint32_t a = aa;
+   uint32_t b = bb + ( ++cc );
+
+   for ( uint32_t i = 0; i < 256; i += 4 ) {
+      ISAAC_STEP( a << 13, i );
+      ISAAC_STEP( a >> 6, i + 1 );
+      ISAAC_STEP( a << 2, i + 2 );
+      ISAAC_STEP( a >> 16, i + 3 );
+   }
+
+   aa = a;
+   bb = b;
+}
+
+/*!
+ * \brief Fills _data with random numbers (the same numbers as _size calls of get())
+ *
+ * Whole blocks of 256 results are generated directly into _data.
+ */
+void uRandomISAAC::fill( uint32_t *_data, size_t _size ) {
+   // Finish the current block
+   for ( ; step != 0 && _size > 0; --_size )
+      *_data++ = get();
+
+   for ( ; _size >= 256; _size -= 256, _data += 256 )
+      generateBlock( _data );
+
+   for ( ; _size > 0; --_size )
+      *_data++ = get();
+}
+
+/*!
+ * \brief Fills _data with random numbers in [_min, _max] (see getBounded)
+ */
+void uRandomISAAC::fill( uint32_t *_data, size_t _size, uint32_t _min, uint32_t _max ) {
+   if ( _max <= _min ) {
+      for ( size_t i = 0; i < _size; ++i )
+         _data[i] = _min;
+
+      return;
+   }
+
+   uint32_t lRange = _max - _min + 1;
+   if ( lRange == 0 )
+      return fill( _data, _size );
+
+   uint32_t lThreshold = ( 0u - lRange ) % lRange;
+   fill( _data, _size );
+
+   for ( size_t i = 0; i < _size; ++i ) {
+      uint64_t lMul = static_cast<uint64_t>( _data[i] ) * lRange;
+
+      while ( static_cast<uint32_t>( lMul ) < lThreshold )
+         lMul = static_cast<uint64_t>( get() ) * lRange;
+
+      _data[i] = static_cast<uint32_t>( lMul >> 32 ) + _min;
+   }
+}
+
+/*!
+ * \brief Fills _data with random numbers in [0, 1)
+ *
+ * The upper 23 bits of a random number become the mantissa of a float in [1, 2) (exponent of
+ * 1.0f), then 1 is subtracted. No division or int to float conversion.
+ */
+void uRandomISAAC::fill( float *_data, size_t _size ) {
+   static_assert( sizeof( float ) == sizeof( uint32_t ), "float must be 32 bit" );
+
+   // The random bits go through an integer buffer (writing them into _data breaks strict aliasing)
+   uint32_t lRaw[256];
+
+   while ( _size > 0 ) {
+      size_t lNum = std::min<size_t>( _size, 256 );
+      fill( lRaw, lNum );
+
+      for ( size_t i = 0; i < lNum; ++i ) {
+         uint32_t lBits = 0x3F800000u | ( lRaw[i] >> 9 );
+         float    lValue;
+         std::memcpy( &lValue, &lBits, sizeof( lValue ) );
+         _data[i] = lValue - 1.0f;
+      }
+
+      _data += lNum;
+      _size -= lNum;
+   }
+}
+
+/*!
+ * \brief Fills _data with random numbers in [0, 1)
+ *
+ * Two random numbers per double; 52 of the 64 bits are the mantissa of a double in [1, 2).
+ * \sa fill( float *, size_t )
+ */
+void uRandomISAAC::fill( double *_data, size_t _size ) {
+   static_assert( sizeof( double ) == 2 * sizeof( uint32_t ), "double must be 64 bit" );
+
+   uint32_t lRaw[256];
+
+   while ( _size > 0 ) {
+      size_t lNum = std::min<size_t>( _size, 128 );
+      fill( lRaw, lNum * 2 );
+
+      for ( size_t i = 0; i < lNum; ++i ) {
+         uint64_t lBits;
+         double   lValue;
+         std::memcpy( &lBits, &lRaw[i * 2], sizeof( lBits ) );
+
+         lBits = 0x3FF0000000000000ULL | ( lBits >> 12 );
+         std::memcpy( &lValue, &lBits, sizeof( lValue ) );
+         _data[i] = lValue - 1.0;
+      }
+
+      _data += lNum;
+      _size -= lNum;
+   }
+}
 }
 
 // kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
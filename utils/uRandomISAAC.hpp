@@ -22,6 +22,7 @@
 
 #include "defines.hpp"
 #include <stdint.h>
+#include <vector>
 
 namespace e_engine {
 
@@ -35,6 +36,7 @@ class UTILS_API uRandomISAAC {
    uint8_t step;
 
    void mixUp( uint32_t _seed[256] );
+   void generateBlock( uint32_t *_out );
 
  public:
    uRandomISAAC() { init( 0 ); }
@@ -42,9 +44,46 @@ class UTILS_API uRandomISAAC {
 
    void init( uint32_t _seed = 0 );
 
-   uint32_t        get();
+   uint32_t get();
+
+   /*!
+    * \brief Returns a random number in [0, _range) without modulo bias (Lemire's method)
+    *
+    * The 32 bit number is multiplied with _range; the upper half of the product is the result.
+    * Only products whose lower half falls into the (rare) biased area are drawn again, so there
+    * is usually no division at all. _range == 0 returns the full 32 bit range.
+    */
+   inline uint32_t getBounded( uint32_t _range ) {
+      if ( _range == 0 )
+         return get();
+
+      uint64_t lMul = static_cast<uint64_t>( get() ) * _range;
+      uint32_t lLow = static_cast<uint32_t>( lMul );
+
+      if ( lLow < _range ) {
+         uint32_t lThreshold = ( 0u - _range ) % _range;
+         while ( lLow < lThreshold ) {
+            lMul = static_cast<uint64_t>( get() ) * _range;
+            lLow = static_cast<uint32_t>( lMul );
+         }
+      }
+
+      return static_cast<uint32_t>( lMul >> 32 );
+   }
+
+   //! Returns a random number in [_min, _max]
    inline uint32_t get( uint32_t _min, uint32_t _max ) {
-      return ( _max <= _min ) ? _min : ( get() % ( ( _max + 1 ) - _min ) + _min );
+      return ( _max <= _min ) ? _min : getBounded( _max - _min + 1 ) + _min;
+   }
+
+   void fill( uint32_t *_data, size_t _size );
+   void fill( uint32_t *_data, size_t _size, uint32_t _min, uint32_t _max );
+   void fill( float *_data, size_t _size );
+   void fill( double *_data, size_t _size );
+
+   template <class T>
+   inline void fill( std::vector<T> &_data ) {
+      fill( _data.data(), _data.size() );
    }
 
    inline uint32_t operator()() { return get(); }
@@ -0,0 +1,233 @@
+/*!
+ * \file uRandomXoshiro.hpp
+ * \brief \b Classes: \a uRandomXoshiro
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uRandomXoshiro.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && !COMPILER_MSC
+#define U_XOSHIRO_AVX2 1
+#include <immintrin.h>
+#else
+#define U_XOSHIRO_AVX2 0
+#endif
+
+namespace e_engine {
+
+namespace {
+
+// Jump polynomials from the reference implementation (Blackman / Vigna)
+const uint64_t JUMP[4] = {
+      0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+const uint64_t LONG_JUMP[4] = {
+      0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+inline uint64_t rotl64( uint64_t _x, int _k ) { return ( _x << _k ) | ( _x >> ( 64 - _k ) ); }
+
+//! 4 lanes without SIMD (same result as the AVX2 version)
+void blocksPortable( uint64_t *_lanes, uint64_t *_out, size_t _num ) {
+   // Local copies, so the compiler knows _out does not alias the state
+   uint64_t s0[4], s1[4], s2[4], s3[4];
+   std::memcpy( s0, _lanes, sizeof( s0 ) );
+   std::memcpy( s1, _lanes + 4, sizeof( s1 ) );
+   std::memcpy( s2, _lanes + 8, sizeof( s2 ) );
+   std::memcpy( s3, _lanes + 12, sizeof( s3 ) );
+
+   for ( size_t i = 0; i < _num; ++i, _out += 4 ) {
+      for ( unsigned k = 0; k < 4; ++k ) {
+         _out[k]     = rotl64( s0[k] + s3[k], 23 ) + s0[k];
+         uint64_t lT = s1[k] << 17;
+
+         s2[k] ^= s0[k];
+         s3[k] ^= s1[k];
+         s1[k] ^= s2[k];
+         s0[k] ^= s3[k];
+         s2[k] ^= lT;
+         s3[k] = rotl64( s3[k], 45 );
+      }
+   }
+
+   std::memcpy( _lanes, s0, sizeof( s0 ) );
+   std::memcpy( _lanes + 4, s1, sizeof( s1 ) );
+   std::memcpy( _lanes + 8, s2, sizeof( s2 ) );
+   std::memcpy( _lanes + 12, s3, sizeof( s3 ) );
+}
+
+#if U_XOSHIRO_AVX2
+// AVX2 has no 64 bit rotate
+#define ROTL_256( _x, _k )                                                                         \
+   _mm256_or_si256( _mm256_slli_epi64( _x, _k ), _mm256_srli_epi64( _x, 64 - _k ) )
+
+__attribute__( ( target( "avx2" ) ) ) void blocksAVX2( uint64_t *_lanes,
+                                                       uint64_t *_out,
+                                                       size_t    _num ) {
+   __m256i s0 = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( _lanes ) );
+   __m256i s1 = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( _lanes + 4 ) );
+   __m256i s2 = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( _lanes + 8 ) );
+   __m256i s3 = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( _lanes + 12 ) );
+
+   for ( size_t i = 0; i < _num; ++i ) {
+      __m256i lSum    = _mm256_add_epi64( s0, s3 );
+      __m256i lResult = _mm256_add_epi64( ROTL_256( lSum, 23 ), s0 );
+      __m256i lT      = _mm256_slli_epi64( s1, 17 );
+
+      s2 = _mm256_xor_si256( s2, s0 );
+      s3 = _mm256_xor_si256( s3, s1 );
+      s1 = _mm256_xor_si256( s1, s2 );
+      s0 = _mm256_xor_si256( s0, s3 );
+      s2 = _mm256_xor_si256( s2, lT );
+      s3 = ROTL_256( s3, 45 );
+
+      _mm256_storeu_si256( reinterpret_cast<__m256i *>( _out + i * 4 ), lResult );
+   }
+
+   _mm256_storeu_si256( reinterpret_cast<__m256i *>( _lanes ), s0 );
+   _mm256_storeu_si256( reinterpret_cast<__m256i *>( _lanes + 4 ), s1 );
+   _mm256_storeu_si256( reinterpret_cast<__m256i *>( _lanes + 8 ), s2 );
+   _mm256_storeu_si256( reinterpret_cast<__m256i *>( _lanes + 12 ), s3 );
+}
+
+#undef ROTL_256
+#endif
+
+typedef void ( *BLOCKS_FUNC )( uint64_t *, uint64_t *, size_t );
+
+BLOCKS_FUNC blocksFunc() {
+#if U_XOSHIRO_AVX2
+   static const BLOCKS_FUNC lFunc =
+         __builtin_cpu_supports( "avx2" ) ? &blocksAVX2 : &blocksPortable;
+   return lFunc;
+#else
+   return &blocksPortable;
+#endif
+}
+}
+
+/*!
+ * \brief Sets the state from a 64 bit seed (expanded with splitmix64)
+ */
+void uRandomXoshiro::seed( uint64_t _seed ) {
+   for ( auto &i : vS ) {
+      uint64_t lZ = ( _seed += 0x9e3779b97f4a7c15ULL );
+      lZ          = ( lZ ^ ( lZ >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+      lZ          = ( lZ ^ ( lZ >> 27 ) ) * 0x94d049bb133111ebULL;
+      i           = lZ ^ ( lZ >> 31 );
+   }
+
+   vLanesValid_B = false;
+}
+
+/*!
+ * \brief Advances the state by 2^128 numbers
+ */
+void uRandomXoshiro::jump() { applyJump( JUMP ); }
+
+/*!
+ * \brief Advances the state by 2^192 numbers
+ */
+void uRandomXoshiro::longJump() { applyJump( LONG_JUMP ); }
+
+/*!
+ * \brief Returns a generator with the current state and jumps this generator (see jump)
+ */
+uRandomXoshiro uRandomXoshiro::fork() {
+   uRandomXoshiro lChild( *this );
+   lChild.vLanesValid_B = false;
+   jump();
+   return lChild;
+}
+
+/*!
+ * \brief Fills _data with 4 interleaved streams (see the class description)
+ *
+ * _data[4 * i + k] is number i of lane k. The lanes continue on the next call.
+ */
+void uRandomXoshiro::fill( uint64_t *_data, size_t _size ) {
+   if ( !vLanesValid_B )
+      initLanes();
+
+   size_t lBlocks = _size / 4;
+   blocksFunc()( vLanes, _data, lBlocks );
+
+   // A partial block would break the lane order of the next call; the rest of it is dropped
+   if ( _size % 4 != 0 ) {
+      uint64_t lTail[4];
+      blocksFunc()( vLanes, lTail, 1 );
+      std::memcpy( _data + lBlocks * 4, lTail, ( _size % 4 ) * sizeof( uint64_t ) );
+   }
+}
+
+/*!
+ * \brief Fills _data with doubles in [0, 1) (53 random bits each, see getDouble)
+ */
+void uRandomXoshiro::fill( double *_data, size_t _size ) {
+   static_assert( sizeof( double ) == sizeof( uint64_t ), "double must be 64 bit" );
+
+   // The random bits go through an integer buffer (writing them into _data breaks strict aliasing)
+   uint64_t lRaw[256]; // A multiple of 4, so the lanes stay in order
+
+   while ( _size > 0 ) {
+      size_t lNum = std::min<size_t>( _size, 256 );
+      fill( lRaw, lNum );
+
+      for ( size_t i = 0; i < lNum; ++i )
+         _data[i] = static_cast<double>( lRaw[i] >> 11 ) * ( 1.0 / 9007199254740992.0 );
+
+      _data += lNum;
+      _size -= lNum;
+   }
+}
+
+
+void uRandomXoshiro::applyJump( uint64_t const _poly[4] ) {
+   uint64_t lS[4] = {0, 0, 0, 0};
+
+   for ( unsigned i = 0; i < 4; ++i ) {
+      for ( unsigned b = 0; b < 64; ++b ) {
+         if ( _poly[i] & ( 1ULL << b ) )
+            for ( unsigned j = 0; j < 4; ++j )
+               lS[j] ^= vS[j];
+
+         get();
+      }
+   }
+
+   std::memcpy( vS, lS, sizeof( vS ) );
+   vLanesValid_B = false;
+}
+
+/*!
+ * \brief Derives the fill() lanes from the current state: lane k = state + ( k + 1 ) * 2^192
+ */
+void uRandomXoshiro::initLanes() {
+   uRandomXoshiro lLane( *this );
+
+   for ( unsigned k = 0; k < 4; ++k ) {
+      lLane.longJump();
+      for ( unsigned w = 0; w < 4; ++w )
+         vLanes[w * 4 + k] = lLane.vS[w];
+   }
+
+   vLanesValid_B = true;
+}
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;
@@ -0,0 +1,115 @@
+/*!
+ * \file uRandomXoshiro.hpp
+ * \brief \b Classes: \a uRandomXoshiro
+ */
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \class e_engine::uRandomXoshiro
+ * \brief xoshiro256++ random number generator (32 byte state)
+ *
+ * Meets the UniformRandomBitGenerator requirements, so it works with the std distributions.
+ *
+ * Independent streams for threads / tasks: jump() advances the generator by 2^128 numbers,
+ * longJump() by 2^192. fork() returns a generator with the current state and then jumps this one,
+ * so every fork (and the parent) has its own non overlapping stream and the result only depends
+ * on the seed and the order of the forks:
+ *
+ * \code
+ * uRandomXoshiro lBase( 42 );
+ * std::vector<uRandomXoshiro> lPerTask;
+ * for ( size_t i = 0; i < lNumTasks; ++i )
+ *    lPerTask.push_back( lBase.fork() );
+ * \endcode
+ *
+ * fill() generates 4 streams at once (AVX2 when available, else a portable loop with the same
+ * result). Lane k of this block generator starts k + 1 long jumps after the state the lanes were
+ * derived from (the current state when fill() is called after seeding or jumping). The output
+ * does not depend on the CPU.
+ */
+class UTILS_API uRandomXoshiro final {
+ public:
+   typedef uint64_t result_type;
+
+ private:
+   uint64_t vS[4];
+
+   uint64_t vLanes[16]; //!< State of the 4 fill() lanes: word w of lane k at [w * 4 + k]
+   bool     vLanesValid_B = false;
+
+   static inline uint64_t rotl( uint64_t _x, int _k ) {
+      return ( _x << _k ) | ( _x >> ( 64 - _k ) );
+   }
+
+   void applyJump( uint64_t const _poly[4] );
+   void initLanes();
+
+ public:
+   uRandomXoshiro( uint64_t _seed = 0x853c49e6748fea9bULL ) { seed( _seed ); }
+
+   void seed( uint64_t _seed );
+
+   //! Returns the next 64 random bits
+   inline uint64_t get() {
+      uint64_t lResult = rotl( vS[0] + vS[3], 23 ) + vS[0];
+      uint64_t lT      = vS[1] << 17;
+
+      vS[2] ^= vS[0];
+      vS[3] ^= vS[1];
+      vS[1] ^= vS[2];
+      vS[0] ^= vS[3];
+      vS[2] ^= lT;
+      vS[3] = rotl( vS[3], 45 );
+
+      return lResult;
+   }
+
+   //! Returns a double in [0, 1) (53 random bits)
+   inline double getDouble() {
+      return static_cast<double>( get() >> 11 ) * ( 1.0 / 9007199254740992.0 ); // 2^-53
+   }
+
+   void jump();
+   void longJump();
+   uRandomXoshiro fork();
+
+   void fill( uint64_t *_data, size_t _size );
+   void fill( double *_data, size_t _size );
+
+   template <class T>
+   inline void fill( std::vector<T> &_data ) {
+      fill( _data.data(), _data.size() );
+   }
+
+   inline uint64_t operator()() { return get(); }
+
+   static constexpr result_type min() { return 0; }
+   static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+};
+}
+
+
+// kate: indent-mode cstyle; indent-width 3; replace-tabs on; line-numbers on;